@@ -34,7 +34,6 @@ void EnemyShip::Update(float dt, float fov, int w, int h)
 	float viewLeft = -0.7f * viewWidth;
 	float viewRight = viewLeft + viewWidth * 1.4f;
 	float viewBottom = -1.0f * viewHeight;
-	float viewTop = viewBottom + viewHeight;
 
 	glm::vec3 tempPosition = position + glm::vec3(velocity.x, velocity.y, 0.0f) * dt;
 
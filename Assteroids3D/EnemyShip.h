@@ -6,7 +6,7 @@ class EnemyShip : public GameObject
 {
 private:
 	float fireRate = 2.0f;
-	float timeSinceLastFire;
+	float timeSinceLastFire = 0.0f;
 
 public:
 	EnemyShip();
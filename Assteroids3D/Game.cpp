@@ -1,5 +1,7 @@
 #include "Game.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 
 struct MinFilter {
@@ -33,7 +35,19 @@ const MagFilter g_magFilters[] = {
 };
 const int g_numMagFilters = sizeof(g_magFilters) / sizeof(g_magFilters[0]);
 
+// profiler zones timed in the telemetry block
+const char* const g_telemetryPhases[] = {
+	"Game::update", "input", "spawn", "entities", "collision", "effects", "events",
+	"Game::draw", "draw scene", "draw effects", "draw UI", "glutSwapBuffers",
+};
+const int g_numTelemetryPhases = sizeof(g_telemetryPhases) / sizeof(g_telemetryPhases[0]);
+
+const char* const g_telemetryCounters[NUM_TELEMETRY_COUNTERS] = {
+	"asteroids", "missiles", "enemy_missiles", "effects", "state", "score", "lives",
+};
+
 Game::Game()
+	: mIndirectBuffer(GL_DRAW_INDIRECT_BUFFER)
 {
 }
 
@@ -43,36 +57,56 @@ Game::~Game()
 
 bool Game::initialize(int w, int h)
 {
+	glsh::Profiler::SetThreadName("main");
+	GLSH_MEMORY_SCOPE(glsh::MEMORY_TAG_LOADING);
 
-	currentState = PAUSED;
-
-	timeSinceLastFire = fireRate;
+	InitSimulation(w, h);
 
 	glEnable(GL_DEPTH_TEST);    // !!!!!!111!!1!!!11!^&#(!@^(!!!!!!
 
 	glEnable(GL_CULL_FACE);
 
-	// build shaders
-	uColorProg = BuildShaderProgram("shaders/ucolor-vs.glsl", "shaders/ucolor-fs.glsl");
-	dirLightProg = BuildShaderProgram("shaders/ucolor-DirLight-vs.glsl", "shaders/ucolor-DirLight-fs.glsl");
-	effectsProg = glsh::BuildShaderProgram("shaders/TexNoLight-vs.glsl", "shaders/TexNoLight-fs.glsl");
-	texTintProgram = glsh::BuildShaderProgram("shaders/TexNoLight-vs.glsl", "shaders/TexTintNoLight-fs.glsl");
-
-	// window aspect ratio
-	float aspectRatio = w / (float)h;
+	// start building shaders; the driver compiles them while the assets below load
+	// (linked programs are also cached, so later launches skip compiling)
+	glsh::SetProgramCacheDirectory(SHADER_CACHE_DIR);
+	glsh::ShaderProgramBatch shaderBatch;
+	int uColorShaders = shaderBatch.add("shaders/ucolor-vs.glsl", "shaders/ucolor-fs.glsl");
+	int dirLightShaders = shaderBatch.add(PACK_MESH_VERTICES ? "shaders/DirLightInstancedPacked-vs.glsl" : "shaders/DirLightInstanced-vs.glsl",
+										  "shaders/DirLightInstanced-fs.glsl");
+	int effectsShaders = shaderBatch.add("shaders/EffectInstanced-vs.glsl", "shaders/EffectInstanced-fs.glsl");
+	int uiShaders = shaderBatch.add("shaders/ui-vs.glsl", "shaders/ui-fs.glsl");
+	shaderBatch.submit();
+
+	// per-frame geometry (UI, effects) is streamed through this
+	mStreamBuffer.Create(256 * 1024);
+	mIndirectBuffer.Create(4 * 1024);
 
 	// set background color (yay cornflower blue)
 	glClearColor(0.01f, 0.03f, 0.06f, 1.0f);
 
-	shipMesh = (glsh::IndexedMesh*)LoadWavefrontOBJ("meshes/player-ship.obj");
-	asteroidMesh = (glsh::IndexedMesh*)LoadWavefrontOBJ("meshes/asteroid.obj");
-	missileMesh = (glsh::IndexedMesh*)LoadWavefrontOBJ("meshes/missile.obj");
-	enemyShipMesh = (glsh::IndexedMesh*)LoadWavefrontOBJ("meshes/enemy-ship.obj");
-	enemyMissileMesh = (glsh::IndexedMesh*)LoadWavefrontOBJ("meshes/enemy-missile.obj");
+	// all meshes share one VBO/IBO, so the whole scene draws from a single VAO
+	mMeshArena = new glsh::MeshArena(PACK_MESH_VERTICES ? glsh::VertexPackedPositionNormalTexture::GetFormat()
+														: glsh::VertexPositionNormalTexture::GetFormat());
+
+	glsh::VertexFormat instanceFormat;
+	for (int i = 0; i < 4; i++) {
+		instanceFormat.addAttrib(glsh::VertexAttrib(glsh::VA_INSTANCE + i, 4, GL_FLOAT, sizeof(SceneInstance), GLSH_BUFFER_OFFSET(offsetof(SceneInstance, model) + i * sizeof(glm::vec4))));
+	}
+	instanceFormat.addAttrib(glsh::VertexAttrib(glsh::VA_INSTANCE + 4, 4, GL_FLOAT, sizeof(SceneInstance), GLSH_BUFFER_OFFSET(offsetof(SceneInstance, color))));
+	mMeshArena->SetInstanceFormat(instanceFormat);
+
+	shipMesh = LoadWavefrontOBJ("meshes/player-ship.obj", *mMeshArena, 1, PACK_MESH_VERTICES);
+	asteroidMesh = LoadWavefrontOBJ("meshes/asteroid.obj", *mMeshArena, ASTEROID_LODS, PACK_MESH_VERTICES);
+	missileMesh = LoadWavefrontOBJ("meshes/missile.obj", *mMeshArena, 1, PACK_MESH_VERTICES);
+	enemyShipMesh = LoadWavefrontOBJ("meshes/enemy-ship.obj", *mMeshArena, 1, PACK_MESH_VERTICES);
+	enemyMissileMesh = LoadWavefrontOBJ("meshes/enemy-missile.obj", *mMeshArena, 1, PACK_MESH_VERTICES);
 
 	InitGame();
 
-	explosionSheet = TextureSheet::Create("media/explosion.tga", 16);
+	// sprite sheets and other file textures, block-compressed
+	mTexMgr = new TextureManager("media/", true, 64 * 1024 * 1024);
+
+	explosionSheet = TextureSheet::Create(*mTexMgr, "explosion.tga", 16);
 	if (!explosionSheet) {
 		std::cout << "failed to load explosion" << std::endl;
 	}
@@ -81,12 +115,35 @@ bool Game::initialize(int w, int h)
 
 	font = glsh::CreateFont("fonts/Consolas13");
 
-	mTexMgr = new TextureManager("textures/");
+	// text and HUD panels sample from one atlas texture (effects use the sheet's texture array)
+	mAtlas = new glsh::TextureAtlas(2);
+	if (!mAtlas->Load("media/ui-atlas")) {
+		mAtlas->AddImageFile("font", "fonts/Consolas13.tga");
+
+		// solid UI fills sample this, so panels draw in one batch with the text
+		glsh::Image white;
+		white.Allocate(4, 4, 4);
+		std::fill(white.getData(), white.getData() + 4 * 4 * 4, 255);
+		mAtlas->AddImage("white", white);
+
+		mAtlas->Build();
+	}
+	// uncompressed: 4x4 blocks smear the anti-aliased edges of small glyphs
+	if (mAtlas->CreateTexture(false, false)) {
+		font->MoveToAtlas(*mAtlas, "font");
+		if (const glsh::TextureAtlas::Entry* white = mAtlas->findEntry("white")) {
+			mUIBatch.SetWhiteTexel(mAtlas->getTex(), mAtlas->RemapTexCoord(*white, glm::vec2(0.5f, 0.5f)));
+		}
+	}
 
 	InitTextures();
 
-	UpdateScorePanel();
-	UpdateLivesPanel();
+	glsh::SetTelemetryPhases(g_telemetryPhases, g_numTelemetryPhases);
+	for (int i = 0; i < NUM_TELEMETRY_COUNTERS; i++) {
+		mTelemetrySlots[i] = glsh::AddTelemetryCounter(g_telemetryCounters[i]);
+	}
+
+	RefreshHUD();
 
 	// set UI TextBatches
 	SetUIText();
@@ -95,17 +152,99 @@ bool Game::initialize(int w, int h)
 	LightCol = glm::vec3(0.8f, 0.8f, 0.75f);
 	AmbientCol = glm::vec3(0, 0, 0.1f);
 
+	updateProjection();
+
+	// nothing above draws, so the programs are only needed now
+	uColorProg = shaderBatch.getProgram(uColorShaders);
+	dirLightProg = shaderBatch.getProgram(dirLightShaders);
+	effectsProg = shaderBatch.getProgram(effectsShaders);
+	uiProgram = shaderBatch.getProgram(uiShaders);
+
+	const glsh::ProgramCacheStats& shaderStats = glsh::GetProgramCacheStats();
+	std::cout << "Shader programs built in " << shaderStats.buildMs << " ms of blocking time (" << shaderStats.loaded << " from cache, "
+		<< shaderStats.compiled << " compiled, " << shaderStats.rejected << " stale)" << std::endl;
+
+	const glsh::TextureUploadTotals& texStats = glsh::GetTextureUploadTotals();
+	std::cout << "Compressed textures: " << texStats.textures << ", " << texStats.uncompressedBytes / 1024 << " KB -> " << texStats.uploadedBytes / 1024
+		<< " KB, uploaded in " << texStats.uploadMs << " ms";
+	if (texStats.uncompressedUploadMs > 0) {
+		std::cout << " (" << texStats.uncompressedUploadMs << " ms uncompressed)";
+	}
+	std::cout << std::endl;
+
+	return true;
+}
+
+void Game::InitSimulation(int w, int h)
+{
+	currentState = PAUSED;
+
+	timeSinceLastFire = mSettings.fireRate;
+
+	for (int i = 0; i < MISSILE_POOL_SIZE; i++) {
+		mMissilePool.push_back(new Missile());
+	}
+
 	// initialize camera
 	mainCamera = new glsh::FreeLookCamera(this);
 	mainCamera->setPosition(0, 0.0f, 100.0f);
 	mainCamera->lookAt(0, 0.0f, -100.0f);
-	mainCamera->mFOV = w / h * 10.0f;
+	mainCamera->mFOV = mSettings.worldSize > 0.0f ? mSettings.worldSize : w / h * 10.0f;
+}
 
-	updateProjection();
+void Game::InitializeHeadless(int w, int h)
+{
+	// no meshes, textures or UI; the objects are simulated the same without them
+	InitSimulation(w, h);
+	InitGame();
+}
 
+bool Game::LoadHeadlessUI()
+{
+	// CreateFont always returns a Font, loaded or not
+	font = glsh::CreateFont("fonts/Consolas13");
+	if (!font->IsLoaded())
+	{
+		delete font;
+		font = nullptr;
+		return false;
+	}
+	SetUIText();
 	return true;
 }
 
+void Game::StartGame()
+{
+	CleanUpGame();
+	InitGame();
+	currentState = PLAYING;
+}
+
+void Game::SetPlayerInvulnerable(bool invulnerable)
+{
+	mPlayerInvulnerable = invulnerable;
+}
+
+int Game::GetAsteroidCount() const
+{
+	return (int)asteroids.size();
+}
+
+PerfEntityCounts Game::GetEntityCounts() const
+{
+	PerfEntityCounts counts = { (int)asteroids.size(), (int)missiles.size(), (int)enemyMissiles.size(), (int)effectlist.size() };
+	return counts;
+}
+
+void Game::SetSimulationSettings(const SimulationSettings& settings)
+{
+	mSettings = settings;
+	if (mainCamera != nullptr && mSettings.worldSize > 0.0f)
+	{
+		mainCamera->mFOV = mSettings.worldSize;
+	}
+}
+
 void Game::updateProjection()
 {
 	// get window dimensions
@@ -141,10 +280,32 @@ void Game::shutdown()
 	{
 		delete m;
 	}
+	for (auto & m : mMissilePool)
+	{
+		delete m;
+	}
+	for (auto & e : enemyShips)
+	{
+		delete e;
+	}
+
+	// owns every mesh loaded into it
+	delete mMeshArena;
 
-	delete asteroidMesh;
-	delete missileMesh;
-	delete shipMesh;
+	delete font;
+	delete mAtlas;
+
+	// releases its texture, so before the manager goes
+	delete explosionSheet;
+
+	if (mTexMgr) {
+		mTexMgr->ReportStats();
+		delete mTexMgr;
+	}
+
+	glsh::StopGLStatsLog();
+	glsh::StopTelemetry();
+	glsh::StopInputLog();
 }
 
 void Game::InitTextures()
@@ -170,6 +331,9 @@ void Game::InitTextures()
 		glGenFramebuffers(1, &mFBO);
 		glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mFBOTex, 0);  // set framebuffer texture
+		glsh::LabelGLObject(GL_FRAMEBUFFER, mFBO, "Game2 framebuffer");
+		glsh::LabelGLObject(GL_TEXTURE, mFBOTex, "Game2 framebuffer color");
+		glsh::TrackGPUMemory(glsh::GPU_FRAMEBUFFER, mFBOTex, mFBOWidth * mFBOHeight * 3);
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);  // unbind for now
 
 		mMeshTextures.addItem(mFBOTex);
@@ -190,22 +354,27 @@ void Game::resize(int w, int h)
 
 void Game::draw()
 {
+	GLSH_PROFILE_ZONE("Game::draw");
+	GLSH_MEMORY_SCOPE(glsh::MEMORY_TAG_DRAW);
+
+	PerfEntityCounts counts = GetEntityCounts();
+	mPerfHUD.BeginFrame(font, counts);
+	PublishTelemetry(counts);
+
 	// clear the screen
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	RefreshHUD();
+
 	if (currentState == PLAYING)
 	{
 
-		DrawMissiles();
-		DrawAsteroids();
-		DrawPlayer();
-		if (enemyShip != nullptr)
-		{
-			DrawEnemyShip();
-		}
+		DrawScene();
 
 		// render explosion effects
-		glUseProgram(effectsProg);
+		GLSH_PROFILE_ZONE("draw effects");
+		GLSH_GL_DEBUG_GROUP("draw effects");
+		glsh::UseProgram(effectsProg);
 
 		if (blendMode == kDisableBlending) {
 			glDisable(GL_BLEND);
@@ -227,15 +396,15 @@ void Game::draw()
 		glBlendFunc(GL_ONE, GL_ONE);
 		glsh::SetShaderUniform("u_BlendWeight", glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
 		glsh::SetShaderUniform("u_ProjectionMatrix", glm::ortho(mViewLeft, mViewRight, mViewBottom, mViewTop));
-		glsh::SetShaderUniform("u_TexSampler", 0);
-		for (auto & effect : effectlist) {
-			if (effect != NULL) {
-				glm::mat4 tf = glsh::CreateTranslation(effect->mPos.x, effect->mPos.y, 0);
-				glm::mat4 rm = glsh::CreateRotationZ(effect->mAngle);
-				glsh::SetShaderUniform("u_ModelviewMatrix", tf* rm);
-				effect->DrawCurrentFrame();
-			}
-		}
+		glsh::SetShaderUniformInt("u_TexSampler", 0);
+		mEffectRenderer.Draw(explosionSheet);
+	}
+
+	GLSH_PROFILE_ZONE("draw UI");
+	GLSH_GL_DEBUG_GROUP("draw UI");
+
+	if (currentState == PLAYING)
+	{
 		// disable for UI drawing
 		glDisable(GL_DEPTH_TEST);
 		glDisable(GL_BLEND);
@@ -283,17 +452,70 @@ void Game::draw()
 		DrawTextArea(scoreTextBatch, glm::vec2(scoreOffset.x, scoreOffset.y + mScrTop), BUTTON_MARGIN, textColor, bgColor, borderColor);
 		DrawTextArea(quitTextBatch, glm::vec2(QUIT_RECT.x - quitTextBatch.GetWidth() * 0.5f, mScrTop - QUIT_RECT.z), BUTTON_MARGIN, textColor, bgColor, borderColor);
 	}
+
+	// submit all UI panels queued above
+	FlushUI();
+
+	if (mPerfHUD.IsVisible())
+	{
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_BLEND);
+
+		glm::vec4 textColor(1.0f, 1.0f, 1.0f, 1.0f);
+		glm::vec4 bgColor(0.1f, 0.1f, 0.1f, 0.3f);
+		glm::vec4 borderColor(1.0f, 1.0f, 1.0f, 0.25f);
+		float margin = 10;
+
+		// top right, with the frame-time graph under the numbers
+		const glsh::TextBatch& perfText = mPerfHUD.GetText();
+		float panelWidth = std::max(perfText.GetWidth() + 2 * margin, (float)PerfHUD::WINDOW);
+		glm::vec2 perfPos(mScrWidth - 20.0f - panelWidth, mScrTop - 20.0f);
+
+		DrawTextArea(perfText, perfPos, margin, textColor, bgColor, borderColor);
+		mPerfHUD.QueueGraph(mUIBatch, glm::vec2(perfPos.x, perfPos.y - perfText.GetHeight() - 2 * margin - 5.0f));
+
+		// flushed on its own, so its stream writes, text upload and draws count toward the overlay
+		uint64_t submitStart = glsh::Profiler::Now();
+		FlushUI();
+		mPerfHUD.AddSubmitCost(glsh::Profiler::Now() - submitStart, mUIBatch.GetLastUploadBytes());
+	}
+
+	mStreamBuffer.EndFrame();
+	mIndirectBuffer.EndFrame();
+	mTexMgr->EndFrame();
 }
 
 void Game::update(float dt)
 {
+	GLSH_PROFILE_ZONE("Game::update");
+	GLSH_MEMORY_SCOPE(glsh::MEMORY_TAG_UPDATE);
+
+	if (getKeyboard()->keyPressed(glsh::KC_F3)) {
+		mPerfHUD.Toggle();
+	}
+
+	if (getKeyboard()->keyPressed(glsh::KC_F4)) {
+		if (glsh::IsGLStatsLogOpen()) {
+			glsh::StopGLStatsLog();
+		} else {
+			glsh::StartGLStatsLog(GL_STATS_LOG_PATH);
+		}
+	}
+
+#if GLSH_PROFILER
+	if (getKeyboard()->keyPressed(glsh::KC_F9)) {
+		glsh::Profiler::WriteChromeTrace(PROFILE_TRACE_PATH);
+	}
+#endif
+
 	// get pointer to keyboard data
 	const glsh::Keyboard* kb = getKeyboard();
 
 	// quit if Escape key was pressed
 	if (kb->keyPressed(glsh::KC_ESCAPE)) {
 		//quit();
-		if (currentState == PAUSED || currentState == GAME_OVER)
+		// there's no ship to go back to after a game over
+		if (currentState == PAUSED)
 		{
 			currentState = PLAYING;
 		}
@@ -305,6 +527,8 @@ void Game::update(float dt)
 
 	if (currentState == PAUSED || currentState == GAME_OVER)
 	{
+		mQuietFrames = 0;
+
 		// handle mouse click
 		const glsh::Mouse* mouse = getMouse();
 		if (mouse->buttonPressed(glsh::MOUSE_BUTTON_LEFT)) {
@@ -318,9 +542,7 @@ void Game::update(float dt)
 					NEW_GAME_RECT.z,
 					NEW_GAME_RECT.z + newGameTextBatch.GetHeight() + BUTTON_MARGIN * 2)))
 			{
-				CleanUpGame();
-				InitGame();
-				currentState = PLAYING;
+				StartGame();
 			}
 
 			// check for quit click
@@ -338,280 +560,438 @@ void Game::update(float dt)
 	// game not paused
 	else
 	{
-		timeSinceLastFire += dt;
-		lastEnemySpawn += dt;
-
-		// turn right
-		if (kb->isKeyDown(glsh::KC_RIGHT))
-		{
-			playerShip->UpdateYaw(-2.0f);
-		}
-		// turn left
-		if (kb->isKeyDown(glsh::KC_LEFT))
 		{
-			playerShip->UpdateYaw(2.0f);
-		}
-		// move forward
-		if (kb->isKeyDown(glsh::KC_UP))
-		{
-			playerShip->SetSpeed(2.5f);
-		}
-		else if (kb->isKeyDown(glsh::KC_DOWN))
-		{
-			playerShip->SetSpeed(-1.5f);
-		}
-		else
-		{
-			playerShip->SetSpeed(0.0f);
-		}
+			GLSH_PROFILE_ZONE("input");
 
-		// spawn enemy?
-		if (lastEnemySpawn > enemyInterval)
-		{
-			lastEnemySpawn = 0.0f;
-			if (enemyShip != nullptr)
+			timeSinceLastFire += dt;
+			lastEnemySpawn += dt;
+
+			// turn right
+			if (kb->isKeyDown(glsh::KC_RIGHT))
+			{
+				playerShip->UpdateYaw(-2.0f);
+			}
+			// turn left
+			if (kb->isKeyDown(glsh::KC_LEFT))
+			{
+				playerShip->UpdateYaw(2.0f);
+			}
+			// move forward
+			if (kb->isKeyDown(glsh::KC_UP))
+			{
+				playerShip->SetSpeed(2.5f);
+			}
+			else if (kb->isKeyDown(glsh::KC_DOWN))
 			{
-				delete enemyShip;
-				enemyShip = nullptr;
+				playerShip->SetSpeed(-1.5f);
+			}
+			else
+			{
+				playerShip->SetSpeed(0.0f);
 			}
-			enemyShip = new EnemyShip();
-			enemyShip->SetMesh(enemyShipMesh);
-			enemyShip->SetPosition(glm::vec3(-6.9f, 2.0f, 0.0f));
-			enemyShip->SetYaw(glm::radians(0.0f));
-			enemyShip->SetSpeed(3.0f);
-			enemyShip->SetScale(glm::vec3(0.3f));
-			enemyShip->Initialize();
 		}
 
-		// fire/spawn missile
-		if (kb->isKeyDown(glsh::KC_SPACE))
 		{
-			if (timeSinceLastFire >= fireRate)
+			GLSH_PROFILE_ZONE("spawn");
+
+			// spawn enemy?
+			if (lastEnemySpawn > mSettings.enemyInterval && mSettings.maxEnemies > 0)
 			{
-				Missile* m = new Missile();
-				m->SetMesh(missileMesh);
-				m->SetPosition(playerShip->GetPosition());
-				m->SetYaw(playerShip->GetYaw());
-				m->SetScale(glm::vec3(0.3f, 0.3f, 0.3f));
-				m->SetSpeed(5.0f);
-				m->SetYaw(playerShip->GetYaw());
-				m->Initialize();
-				missiles.push_back(m);
-				timeSinceLastFire = 0.0f;
+				lastEnemySpawn = 0.0f;
+				// the oldest ship makes room for the new one
+				while ((int)enemyShips.size() >= mSettings.maxEnemies)
+				{
+					delete enemyShips.front();
+					enemyShips.pop_front();
+				}
+				EnemyShip* enemyShip = new EnemyShip();
+				enemyShip->SetMesh(enemyShipMesh);
+				enemyShip->SetPosition(glm::vec3(-6.9f, 2.0f, 0.0f));
+				enemyShip->SetYaw(glm::radians(0.0f));
+				enemyShip->SetSpeed(3.0f);
+				enemyShip->SetScale(glm::vec3(0.3f));
+				enemyShip->Initialize();
+				enemyShips.push_back(enemyShip);
+				mEvents.Push(EVENT_SPAWN, glm::vec2(enemyShip->GetPosition().x, enemyShip->GetPosition().y));
 			}
-		}
 
-		// re-populate with asteroids if need be
-		if (asteroids.size() <= 0)
-		{
-			// reset player position
-			playerShip->SetPosition(glm::vec3(0.0f, 0.0f, 0.0f));
-			// initialize asteroids
-			for (int i = 0; i < 3; i++)
+			// a steady stream of asteroids on top of the splits
+			if (mSettings.asteroidSpawnRate > 0.0f)
 			{
-				float radius = 5.0f;
-				float angle = glsh::Random(0.0f, 360.f);
-				SpawnAsteroid(glm::vec3(radius * cos(angle), radius * sin(angle), 0.0f), ASTEROID_SCALE);
+				mAsteroidSpawnClock += dt * mSettings.asteroidSpawnRate;
+				int count = (int)mAsteroidSpawnClock;
+				mAsteroidSpawnClock -= count;
+				SpawnFieldAsteroids(count);
 			}
-		}
 
-		playerShip->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
-		// update asteroid list
-		for (auto & a : asteroids)
-		{
-			float scaler = 0.6f;
-			if (a->dead)
+			// fire/spawn missile
+			if (kb->isKeyDown(glsh::KC_SPACE))
 			{
-				if (a->GetScale().x > ASTEROID_SCALE * scaler * scaler)
+				if (timeSinceLastFire >= mSettings.fireRate)
 				{
-					for (int i = 0; i < 3; i++)
-					{
-						SpawnAsteroid(a->GetPosition(), a->GetScale().x * scaler);
-					}
+					Missile* m = SpawnMissile(missiles);
+					m->SetMesh(missileMesh);
+					m->SetPosition(playerShip->GetPosition());
+					m->SetYaw(playerShip->GetYaw());
+					m->SetScale(glm::vec3(0.3f, 0.3f, 0.3f));
+					m->SetSpeed(mSettings.missileSpeed);
+					m->SetYaw(playerShip->GetYaw());
+					m->Initialize();
+					timeSinceLastFire = 0.0f;
 				}
-				currentScore += 10;
-				UpdateScorePanel();
-				delete a;
-				asteroids.remove(a);
-				break;
 			}
-			else
+
+			// re-populate with asteroids if need be
+			if (asteroids.size() <= 0)
 			{
-				a->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
+				// reset player position
+				playerShip->SetPosition(glm::vec3(0.0f, 0.0f, 0.0f));
+				// initialize asteroids
+				SpawnFieldAsteroids(mSettings.asteroids);
 			}
-
 		}
-		// update missile list
-		for (auto & m : missiles)
+
 		{
-			if (m->dead)
+			GLSH_PROFILE_ZONE("entities");
+
+			playerShip->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
+			// update asteroid list
+			for (auto & a : asteroids)
 			{
-				effectlist.push_back(new AnimatedEffect(explosionSheet, 1.0f,
-					glm::vec2(m->GetPosition().x - (m->GetScale().x * 0.5f), m->GetPosition().y - (m->GetScale().y * 0.5f)),
-					m->GetPitch()));
-				delete m;
-				missiles.remove(m);
-				break;
+				float scaler = 0.6f;
+				if (a->dead)
+				{
+					if (a->GetScale().x > ASTEROID_SCALE * scaler * scaler)
+					{
+						for (int i = 0; i < 3; i++)
+						{
+							SpawnAsteroid(a->GetPosition(), a->GetScale().x * scaler);
+						}
+					}
+					mEvents.Push(EVENT_KILL, glm::vec2(a->GetPosition().x, a->GetPosition().y), 0.0f, 10);
+					delete a;
+					asteroids.remove(a);
+					break;
+				}
+				else
+				{
+					a->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
+				}
+
 			}
-			else
+			// update missile list
+			for (auto & m : missiles)
 			{
-				if (m->lifetime <= 0.0f)
+				if (m->dead)
 				{
-					delete m;
-					missiles.remove(m);
+					mEvents.Push(EVENT_HIT,
+						glm::vec2(m->GetPosition().x - (m->GetScale().x * 0.5f), m->GetPosition().y - (m->GetScale().y * 0.5f)),
+						m->GetPitch());
+					RecycleMissile(missiles, m);
 					break;
 				}
-				m->lifetime -= dt;
-				m->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
+				else
+				{
+					if (m->lifetime <= 0.0f)
+					{
+						RecycleMissile(missiles, m);
+						break;
+					}
+					m->lifetime -= dt;
+					m->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
+				}
 			}
-		}
-		// update enemy missile list
-		// update missile list
-		for (auto & m : enemyMissiles)
-		{
-			if (m->dead)
+			// update enemy missile list
+			// update missile list
+			for (auto & m : enemyMissiles)
 			{
-				effectlist.push_back(new AnimatedEffect(explosionSheet, 1.0f,
-					glm::vec2(m->GetPosition().x - (m->GetScale().x * 0.5f), m->GetPosition().y - (m->GetScale().y * 0.5f)),
-					m->GetPitch()));
-				delete m;
-				enemyMissiles.remove(m);
-				break;
+				if (m->dead)
+				{
+					mEvents.Push(EVENT_HIT,
+						glm::vec2(m->GetPosition().x - (m->GetScale().x * 0.5f), m->GetPosition().y - (m->GetScale().y * 0.5f)),
+						m->GetPitch());
+					RecycleMissile(enemyMissiles, m);
+					break;
+				}
+				else
+				{
+					if (m->lifetime <= 0.0f)
+					{
+						RecycleMissile(enemyMissiles, m);
+						break;
+					}
+					m->lifetime -= dt;
+					m->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
+				}
 			}
-			else
+
+			for (auto it = enemyShips.begin(); it != enemyShips.end(); )
 			{
-				if (m->lifetime <= 0.0f)
+				EnemyShip* enemyShip = *it;
+				if (enemyShip->dead)
 				{
-					delete m;
-					enemyMissiles.remove(m);
-					break;
+					// do stuff
+					delete enemyShip;
+					it = enemyShips.erase(it);
+				}
+				else
+				{
+					glm::vec2 displacement = glm::vec2(playerShip->GetPosition().x - enemyShip->GetPosition().x, (playerShip->GetPosition().y - enemyShip->GetPosition().y));
+					enemyShip->SetYaw(glm::degrees(atan2(displacement.y, displacement.x)));
+					enemyShip->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
+					// fire?
+					if (enemyShip->Fire())
+					{
+						Missile* m = SpawnMissile(enemyMissiles);
+						m->SetMesh(enemyMissileMesh);
+						m->SetPosition(enemyShip->GetPosition());
+						m->SetYaw(enemyShip->GetYaw());
+						m->SetScale(glm::vec3(0.3f, 0.3f, 0.3f));
+						m->SetSpeed(mSettings.missileSpeed);
+						m->SetYaw(enemyShip->GetYaw());
+						m->Initialize();
+					}
+					++it;
 				}
-				m->lifetime -= dt;
-				m->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
 			}
 		}
 
-		if (enemyShip != nullptr)
 		{
-			if (enemyShip->dead)
-			{
-				// do stuff
-				delete enemyShip;
-				enemyShip = nullptr;
-			}
-			else
+			GLSH_PROFILE_ZONE("collision");
+
+			for (auto & m : missiles)
 			{
-				glm::vec2 displacement = glm::vec2(playerShip->GetPosition().x - enemyShip->GetPosition().x, (playerShip->GetPosition().y - enemyShip->GetPosition().y));
-				enemyShip->SetYaw(glm::degrees(atan2(displacement.y, displacement.x)));
-				enemyShip->Update(dt, mainCamera->mFOV, getWindow()->getWidth(), getWindow()->getHeight());
-				// fire?
-				if (enemyShip->Fire())
+				for (auto & a : asteroids)
 				{
-					Missile* m = new Missile();
-					m->SetMesh(enemyMissileMesh);
-					m->SetPosition(enemyShip->GetPosition());
-					m->SetYaw(enemyShip->GetYaw());
-					m->SetScale(glm::vec3(0.3f, 0.3f, 0.3f));
-					m->SetSpeed(5.0f);
-					m->SetYaw(enemyShip->GetYaw());
-					m->Initialize();
-					enemyMissiles.push_back(m);
+					if (m->CheckCollision(a))
+					{
+						m->dead = true;
+						a->dead = true;
+					}
 				}
 
+				for (auto & enemyShip : enemyShips)
+				{
+					if (m->CheckCollision(enemyShip))
+					{
+						mEvents.Push(EVENT_KILL, glm::vec2(enemyShip->GetPosition().x, enemyShip->GetPosition().y), 0.0f, 100);
+						m->dead = true;
+						enemyShip->dead = true;
+					}
+				}
 			}
-		}
 
-		for (auto & m : missiles)
-		{
+			bool playerDied = false;
+
 			for (auto & a : asteroids)
 			{
-				if (m->CheckCollision(a))
+				if (!a->dead && a->CheckCollision(playerShip))
 				{
-					m->dead = true;
-					a->dead = true;
+					// player death, the ship is rebuilt when the events are drained
+					if (!mPlayerInvulnerable)
+					{
+						mEvents.Push(EVENT_PLAYER_DEATH,
+							glm::vec2(playerShip->GetPosition().x - (playerShip->GetScale().x * 0.5f), playerShip->GetPosition().y - (playerShip->GetScale().y * 0.5f)),
+							playerShip->GetPitch());
+					}
+					playerDied = true;
+					break;
 				}
 			}
 
-			if (enemyShip != nullptr && m->CheckCollision(enemyShip))
+			for (auto & m : enemyMissiles)
 			{
-				currentScore += 100;
-				UpdateScorePanel();
-				m->dead = true;
-				enemyShip->dead = true;
+				if (playerDied)
+				{
+					break;
+				}
+				if (!m->dead && m->CheckCollision(playerShip))
+				{
+					// player death, the ship is rebuilt when the events are drained
+					if (!mPlayerInvulnerable)
+					{
+						mEvents.Push(EVENT_PLAYER_DEATH,
+							glm::vec2(playerShip->GetPosition().x - (playerShip->GetScale().x * 0.5f), playerShip->GetPosition().y - (playerShip->GetScale().y * 0.5f)),
+							playerShip->GetPitch());
+					}
+					playerDied = true;
+					break;
+				}
 			}
 		}
 
-		for (auto & a : asteroids)
 		{
-			if (!a->dead && a->CheckCollision(playerShip))
-			{
-				// player death
-				effectlist.push_back(new AnimatedEffect(explosionSheet, 1.0f,
-					glm::vec2(playerShip->GetPosition().x - (playerShip->GetScale().x * 0.5f), playerShip->GetPosition().y - (playerShip->GetScale().y * 0.5f)),
-					playerShip->GetPitch()));
-				currentLives -= 1;
-				UpdateLivesPanel();
-				// delete and rebuild player
-				if (enemyShip != nullptr)
-				{
-					delete enemyShip;
-					enemyShip = nullptr;
+			GLSH_PROFILE_ZONE("effects");
+
+			// the renderer's instances are in the same order as the list
+			mEffectRenderer.AddTime(dt);
+			size_t index = 0;
+			for (auto it = effectlist.begin(); it != effectlist.end(); ) {
+				AnimatedEffect* effect = *it;
+				effect->AddTime(dt);
+				if (effect->FinishedPlaying()) {
+					delete effect;
+					it = effectlist.erase(it);
+					mEffectRenderer.Remove(index);
+				} else {
+					++it;
+					++index;
 				}
-				delete playerShip;
-				ResetGame();
-				break;
 			}
 		}
 
-		for (auto & m : enemyMissiles)
+		mainCamera->update(dt);
+
+		// with nothing spawned, killed or scored for a while, the frame should run on what's allocated
+		mQuietFrames = mEvents.Size() == 0 ? mQuietFrames + 1 : 0;
+		if (mQuietFrames >= STEADY_STATE_FRAMES) {
+			glsh::MarkSteadyStateFrame();
+		}
+
 		{
-			if (!m->dead && m->CheckCollision(playerShip))
-			{
-				// player death
-				effectlist.push_back(new AnimatedEffect(explosionSheet, 1.0f,
-					glm::vec2(playerShip->GetPosition().x - (playerShip->GetScale().x * 0.5f), playerShip->GetPosition().y - (playerShip->GetScale().y * 0.5f)),
-					playerShip->GetPitch()));
-				currentLives -= 1;
-				UpdateLivesPanel();
-				// delete and rebuild player
-				if (enemyShip != nullptr)
-				{
-					delete enemyShip;
-					enemyShip = nullptr;
-				}
-				delete playerShip;
-				ResetGame();
-				break;
-			}
+			GLSH_PROFILE_ZONE("events");
+			ProcessEvents();
 		}
+	}
 
-		for (auto effect : effectlist) {
-			effect->AddTime(dt);
-			if (effect->FinishedPlaying()) {
-				effectlist.remove(effect);
-				break;
-			}
+}
+
+// FNV-1a over what a replay has to reproduce: the state, score and where everything is
+static void HashBytes(uint32_t& hash, const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ p[i]) * 16777619u;
+	}
+}
+
+static void HashObject(uint32_t& hash, GameObject* obj)
+{
+	glm::vec3 pos = obj->GetPosition();
+	float yaw = obj->GetYaw();
+	HashBytes(hash, &pos, sizeof(pos));
+	HashBytes(hash, &yaw, sizeof(yaw));
+}
+
+uint32_t Game::getStateChecksum() const
+{
+	uint32_t hash = 2166136261u;
+	int counts[] = { (int)currentState, currentScore, currentLives,
+		(int)asteroids.size(), (int)missiles.size(), (int)enemyMissiles.size(), (int)enemyShips.size() };
+	HashBytes(hash, counts, sizeof(counts));
+
+	if (playerShip != nullptr)
+	{
+		HashObject(hash, playerShip);
+	}
+	for (auto & a : asteroids)
+	{
+		HashObject(hash, a);
+	}
+	for (auto & m : missiles)
+	{
+		HashObject(hash, m);
+	}
+	for (auto & m : enemyMissiles)
+	{
+		HashObject(hash, m);
+	}
+	for (auto & e : enemyShips)
+	{
+		HashObject(hash, e);
+	}
+	return hash;
+}
+
+void Game::ProcessEvents()
+{
+	bool playerDied = false;
+
+	for (int i = 0; i < mEvents.Size(); i++)
+	{
+		const GameEvent& e = mEvents[i];
+		switch (e.type)
+		{
+		case EVENT_KILL:
+			currentScore += e.points;
+			mScorePanelDirty = true;
+			break;
+		case EVENT_HIT:
+			effectlist.push_back(new AnimatedEffect(explosionSheet, 1.0f, e.pos, e.angle));
+			mEffectRenderer.Add(*effectlist.back());
+			break;
+		case EVENT_PLAYER_DEATH:
+			effectlist.push_back(new AnimatedEffect(explosionSheet, 1.0f, e.pos, e.angle));
+			mEffectRenderer.Add(*effectlist.back());
+			currentLives -= 1;
+			mLivesPanelDirty = true;
+			playerDied = true;
+			break;
+		case EVENT_SPAWN:
+			// nothing on the HUD depends on spawns
+			break;
 		}
+	}
 
-		mainCamera->update(dt);
+	mEvents.Clear();
+
+	if (playerDied)
+	{
+		// delete and rebuild player
+		for (auto & enemyShip : enemyShips)
+		{
+			delete enemyShip;
+		}
+		enemyShips.clear();
+		delete playerShip;
+		playerShip = nullptr;
+		ResetGame();
 	}
+}
 
+void Game::PublishTelemetry(const PerfEntityCounts& counts)
+{
+	// the values go out with the rest of the frame, after the swap
+	glsh::SetTelemetryCounter(mTelemetrySlots[TELEMETRY_ASTEROIDS], counts.asteroids);
+	glsh::SetTelemetryCounter(mTelemetrySlots[TELEMETRY_MISSILES], counts.missiles);
+	glsh::SetTelemetryCounter(mTelemetrySlots[TELEMETRY_ENEMY_MISSILES], counts.enemyMissiles);
+	glsh::SetTelemetryCounter(mTelemetrySlots[TELEMETRY_EFFECTS], counts.effects);
+	glsh::SetTelemetryCounter(mTelemetrySlots[TELEMETRY_STATE], currentState);
+	glsh::SetTelemetryCounter(mTelemetrySlots[TELEMETRY_SCORE], currentScore);
+	glsh::SetTelemetryCounter(mTelemetrySlots[TELEMETRY_LIVES], currentLives);
+}
+
+void Game::RefreshHUD()
+{
+	// panels are rebuilt at most once per frame, however many events touched them
+	if (mScorePanelDirty) {
+		UpdateScorePanel();
+		mScorePanelDirty = false;
+	}
+	if (mLivesPanelDirty) {
+		UpdateLivesPanel();
+		mLivesPanelDirty = false;
+	}
 }
 
 void Game::InitGame()
 {
 	timeSinceLastFire = 0.0f;
 	lastEnemySpawn = 0.0f;
+	mAsteroidSpawnClock = 0.0f;
 
 	currentScore = 0;
 	currentLives = 3;
-	UpdateScorePanel();
-	UpdateLivesPanel();
+	mScorePanelDirty = true;
+	mLivesPanelDirty = true;
+	mEvents.Clear();
 
 	asteroids = std::list<Asteroid*>();
-	missiles = std::list<Missile*>();
-	enemyMissiles = std::list<Missile*>();
+	mMissilePool.splice(mMissilePool.end(), missiles);
+	mMissilePool.splice(mMissilePool.end(), enemyMissiles);
 	effectlist = std::list<AnimatedEffect*>();
+	mEffectRenderer.Clear();
 
 	playerShip = new Ship();
 	playerShip->SetMesh(shipMesh);
@@ -620,12 +1000,7 @@ void Game::InitGame()
 	playerShip->Initialize();
 
 	// initialize asteroids
-	for (int i = 0; i < 3; i++)
-	{
-		float radius = 5.0f;
-		float angle = glsh::Random(0.0f, 360.f);
-		SpawnAsteroid(glm::vec3(radius * cos(angle), radius * sin(angle), 0.0f), ASTEROID_SCALE);
-	}
+	SpawnFieldAsteroids(mSettings.asteroids);
 }
 
 void Game::ResetGame()
@@ -641,15 +1016,16 @@ void Game::ResetGame()
 		lastEnemySpawn = 0.0f;
 
 		asteroids = std::list<Asteroid*>();
-		missiles = std::list<Missile*>();
-		enemyMissiles = std::list<Missile*>();
+		mMissilePool.splice(mMissilePool.end(), missiles);
+		mMissilePool.splice(mMissilePool.end(), enemyMissiles);
 		effectlist = std::list<AnimatedEffect*>();
+		mEffectRenderer.Clear();
 
-		if (enemyShip != nullptr)
+		for (auto & enemyShip : enemyShips)
 		{
 			delete enemyShip;
-			enemyShip == nullptr;
 		}
+		enemyShips.clear();
 
 		playerShip = new Ship();
 		playerShip->SetMesh(shipMesh);
@@ -658,12 +1034,7 @@ void Game::ResetGame()
 		playerShip->Initialize();
 
 		// initialize asteroids
-		for (int i = 0; i < 3; i++)
-		{
-			float radius = 5.0f;
-			float angle = glsh::Random(0.0f, 360.f);
-			SpawnAsteroid(glm::vec3(radius * cos(angle), radius * sin(angle), 0.0f), ASTEROID_SCALE);
-		}
+		SpawnFieldAsteroids(mSettings.asteroids);
 
 		currentState = PLAYING;
 	}
@@ -677,255 +1048,161 @@ void Game::CleanUpGame()
 	{
 		delete a;
 	}
-	for (auto & m : missiles)
-	{
-		delete m;
-	}
+	mMissilePool.splice(mMissilePool.end(), missiles);
+	mMissilePool.splice(mMissilePool.end(), enemyMissiles);
 	for (auto & e : effectlist)
 	{
 		delete e;
 	}
-	if (enemyShip != nullptr)
+	for (auto & enemyShip : enemyShips)
 	{
 		delete enemyShip;
-		enemyShip == nullptr;
 	}
+	enemyShips.clear();
 	//if (playerShip != nullptr)
 	//{
 	//	delete playerShip;
 	//}
 }
 
-GLuint Game::BuildShaderProgram(std::string vertexPath, std::string fragmentPath)
+static void AddSceneInstance(std::vector<SceneInstance>& instances, const glm::mat4& model, const glm::vec4& color)
 {
-	// load and compile the vertex shader
-
-	// load shader source code from a text file
-	std::string vsString = glsh::ReadTextFile(vertexPath);
+	SceneInstance inst;
+	inst.model = model;
+	inst.color = color;
+	instances.push_back(inst);
+}
 
-	// create vertex shader object
-	GLuint vso = glCreateShader(GL_VERTEX_SHADER);
-	if (!vso) {
-		std::cerr << "*** Poop: Failed to create shader object" << std::endl;
-		return false;
-	}
+// queue the instances added since 'first' as one draw of the mesh
+static void QueueSceneDraw(glsh::MeshArena* arena, const glsh::ArenaMesh* mesh, const std::vector<SceneInstance>& instances, GLuint& first)
+{
+	GLuint count = (GLuint)instances.size() - first;
+	arena->AddDraw(mesh, count, first);
+	first += count;
+}
 
-	// set shader source code
-	const char* vsSource[1];
-	vsSource[0] = vsString.c_str();
-	glShaderSource(vso, 1, vsSource, NULL);
+void Game::DrawScene()
+{
+	GLSH_PROFILE_ZONE("draw scene");
+	GLSH_GL_DEBUG_GROUP("draw scene");
 
-	// compile the shader
-	glCompileShader(vso);
+	glm::mat4 projMatrix = mainCamera->getProjectionMatrix();
+	glm::mat4 viewMatrix = mainCamera->getViewMatrix();
 
-	// load and compile the fragment shader
+	//
+	// gather one instance per object, grouped by mesh
+	// (model matrices end with the mesh's dequantization, which is identity for unpacked vertices)
+	//
+	mSceneInstances.clear();
+	GLuint first = 0;
 
-	// load shader source code from a text file
-	std::string fsString = glsh::ReadTextFile(fragmentPath);
+	glm::mat4 missileQuant = missileMesh->getQuantization().getMatrix();
 
-	// create fragment shader object
-	GLuint fso = glCreateShader(GL_FRAGMENT_SHADER);
-	if (!fso) {
-		std::cerr << "*** Poop: Failed to create shader object" << std::endl;
-		return false;
+	for (auto & m : missiles)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), m->GetPosition());
+		model = glm::rotate(model, glm::radians(m->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
+		model = glm::scale(model, m->GetScale());
+		AddSceneInstance(mSceneInstances, model * missileQuant, glm::vec4(0.0f, 0.4f, 0.8f, 1.0f));
 	}
+	QueueSceneDraw(mMeshArena, missileMesh, mSceneInstances, first);
 
-	// set shader source code
-	const char* fsSource[1];
-	fsSource[0] = fsString.c_str();
-	glShaderSource(fso, 1, fsSource, NULL);
-
-	// compile the shader
-	glCompileShader(fso);
+	glm::mat4 enemyMissileQuant = enemyMissileMesh->getQuantization().getMatrix();
 
-	// create and link shader program
-
-	// create program object
-	GLuint prog = glCreateProgram();
-	if (!prog) {
-		std::cerr << "*** Poop: Failed to create program object" << std::endl;
-		return false;
+	for (auto & m : enemyMissiles)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), m->GetPosition());
+		model = glm::rotate(model, glm::radians(m->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
+		model = glm::scale(model, m->GetScale());
+		AddSceneInstance(mSceneInstances, model * enemyMissileQuant, glm::vec4(0.8f, 0.8f, 0.1f, 1.0f));
 	}
+	QueueSceneDraw(mMeshArena, enemyMissileMesh, mSceneInstances, first);
 
-	// attach vertex and fragment shaders to the program
-	glAttachShader(prog, vso);
-	glAttachShader(prog, fso);
-
-	// link the program
-	glLinkProgram(prog);
-
-	// TODO: check link status (omitted for brevity)
-
-	// mark shader objects ready for deletion
-	glDeleteShader(vso);
-	glDeleteShader(fso);
-
-	return prog;
-}
-
-void Game::DrawAsteroids()
-{
-	// create projection matrix
-	glm::mat4 projMatrix = mainCamera->getProjectionMatrix();
-	glm::mat4 viewMatrix = mainCamera->getViewMatrix();
+	// asteroids pick a level of detail from their size on screen, then go in one group per level
+	GLuint lodCounts[ASTEROID_LODS] = { 0 };
+	float projScale = mainCamera->getProjectionScale(mScrHeight);
+	float meshRadius = asteroidMesh->getBounds().radius;
+	glm::mat4 asteroidQuant = asteroidMesh->getQuantization().getMatrix();   // shared by every level
 
-	glUseProgram(dirLightProg);
-	glsh::SetShaderUniform("u_ProjectionMatrix", projMatrix);
-
-	// render asteroid list
+	mAsteroidLODs.clear();
 	for (auto & a : asteroids)
 	{
-		viewMatrix = mainCamera->getViewMatrix();
-
-		// set lighting parameters for the directional light shader
-		glm::vec3 lightDir(1.5f, 2.0f, 3.0f);           // direction to light in world space
-		lightDir = glm::mat3(viewMatrix) * lightDir;    // direction to light in camera space
-		lightDir = glm::normalize(lightDir);            // normalized for sanity
-		glsh::SetShaderUniform("u_LightDir", lightDir);
-		glsh::SetShaderUniform("u_LightColor", LightCol);
-		glsh::SetShaderUniform("u_AmbientCol", AmbientCol);
-
-		viewMatrix = glm::translate(viewMatrix, a->GetPosition());
-		viewMatrix = glm::rotate(viewMatrix, glm::radians(a->GetRoll()), glm::vec3(0.0f, 0.0f, 1.0f));
-		viewMatrix = glm::rotate(viewMatrix, glm::radians(a->GetYaw()), glm::vec3(0.0f, 1.0f, 0.0f));
-		viewMatrix = glm::rotate(viewMatrix, glm::radians(a->GetPitch()), glm::vec3(1.0f, 0.0f, 0.0f));
-		viewMatrix = glm::scale(viewMatrix, a->GetScale());
-
-		glsh::SetShaderUniform("u_ModelViewMatrix", viewMatrix);
-
-		// set transform and material properties
-		glsh::SetShaderUniform("u_NormalMatrix", glm::transpose(glm::inverse(glm::mat3(viewMatrix))));
-
-		// set material properties
-		glsh::SetShaderUniform("u_Color", glm::vec4(0.545f, 0.27f, 0.07f, 1.0f));
-
-		a->Render();
+		glm::vec3 s = a->GetScale();
+		float radius = meshRadius * std::max(s.x, std::max(s.y, s.z));
+		float screenRadius = mainCamera->getScreenRadius(a->GetPosition(), radius, projScale);
+		int level = std::min(asteroidMesh->selectLOD(screenRadius, LOD_PIXEL_ERROR), ASTEROID_LODS - 1);
+		mAsteroidLODs.push_back((unsigned char)level);
+		lodCounts[level]++;
 	}
-}
 
-void Game::DrawEnemyShip()
-{
-	if (enemyShip != nullptr)
+	GLuint lodNext[ASTEROID_LODS];
+	GLuint end = first;
+	for (int level = 0; level < ASTEROID_LODS; level++)
 	{
-		// create projection matrix
-		glm::mat4 projMatrix = mainCamera->getProjectionMatrix();
-		glm::mat4 viewMatrix = mainCamera->getViewMatrix();
-
-		glUseProgram(dirLightProg);
-		glsh::SetShaderUniform("u_ProjectionMatrix", projMatrix);
-
-		// draw ship
-		viewMatrix = mainCamera->getViewMatrix();
-
-		// set lighting parameters for the directional light shader
-		glm::vec3 lightDir(1.5f, 2.0f, 3.0f);           // direction to light in world space
-		lightDir = glm::mat3(viewMatrix) * lightDir;    // direction to light in camera space
-		lightDir = glm::normalize(lightDir);            // normalized for sanity
-		glsh::SetShaderUniform("u_LightDir", lightDir);
-		glsh::SetShaderUniform("u_LightColor", LightCol);
-		glsh::SetShaderUniform("u_AmbientCol", AmbientCol);
-
-		viewMatrix = glm::translate(viewMatrix, enemyShip->GetPosition());
-		viewMatrix = glm::rotate(viewMatrix, glm::radians(enemyShip->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
-		viewMatrix = glm::scale(viewMatrix, enemyShip->GetScale());
+		lodNext[level] = end;
+		end += lodCounts[level];
+	}
+	mSceneInstances.resize(end);
 
-		glsh::SetShaderUniform("u_ModelViewMatrix", viewMatrix);
+	int ai = 0;
+	for (auto & a : asteroids)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), a->GetPosition());
+		model = glm::rotate(model, glm::radians(a->GetRoll()), glm::vec3(0.0f, 0.0f, 1.0f));
+		model = glm::rotate(model, glm::radians(a->GetYaw()), glm::vec3(0.0f, 1.0f, 0.0f));
+		model = glm::rotate(model, glm::radians(a->GetPitch()), glm::vec3(1.0f, 0.0f, 0.0f));
+		model = glm::scale(model, a->GetScale());
+
+		SceneInstance& inst = mSceneInstances[lodNext[mAsteroidLODs[ai++]]++];
+		inst.model = model * asteroidQuant;
+		inst.color = glm::vec4(0.545f, 0.27f, 0.07f, 1.0f);
+	}
 
-		// set transform and material properties
-		glsh::SetShaderUniform("u_NormalMatrix", glm::transpose(glm::inverse(glm::mat3(viewMatrix))));
+	for (int level = 0; level < ASTEROID_LODS; level++)
+	{
+		mMeshArena->AddDraw(asteroidMesh->getLOD(level), lodCounts[level], first);
+		first += lodCounts[level];
+	}
 
-		// set material properties
-		glsh::SetShaderUniform("u_Color", glm::vec4(0.8f, 0.1f, 0.05f, 1.0f));
+	if (playerShip != nullptr)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), playerShip->GetPosition());
+		model = glm::rotate(model, glm::radians(playerShip->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
+		model = glm::scale(model, playerShip->GetScale());
+		AddSceneInstance(mSceneInstances, model * shipMesh->getQuantization().getMatrix(), glm::vec4(0.0f, 0.8f, 0.4f, 1.0f));
+		QueueSceneDraw(mMeshArena, shipMesh, mSceneInstances, first);
+	}
 
-		if (enemyShip == nullptr)
+	if (!enemyShips.empty())
+	{
+		for (auto & enemyShip : enemyShips)
 		{
-			std::cout << "IT FUCKING HAPPENED" << std::endl;
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), enemyShip->GetPosition());
+			model = glm::rotate(model, glm::radians(enemyShip->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
+			model = glm::scale(model, enemyShip->GetScale());
+			AddSceneInstance(mSceneInstances, model * enemyShipMesh->getQuantization().getMatrix(), glm::vec4(0.8f, 0.1f, 0.05f, 1.0f));
 		}
-
-		enemyShip->Render();
+		QueueSceneDraw(mMeshArena, enemyShipMesh, mSceneInstances, first);
 	}
 
-}
-
-void Game::DrawMissiles()
-{
-	// create projection matrix
-	glm::mat4 projMatrix = mainCamera->getProjectionMatrix();
-	glm::mat4 viewMatrix = mainCamera->getViewMatrix();
-
-	glUseProgram(dirLightProg);
-	glsh::SetShaderUniform("u_ProjectionMatrix", projMatrix);
-
-	// render missile list
-	for (auto & m : missiles)
+	if (mSceneInstances.empty())
 	{
-		viewMatrix = mainCamera->getViewMatrix();
-
-		// set lighting parameters for the directional light shader
-		glm::vec3 lightDir(1.5f, 2.0f, 3.0f);           // direction to light in world space
-		lightDir = glm::mat3(viewMatrix) * lightDir;    // direction to light in camera space
-		lightDir = glm::normalize(lightDir);            // normalized for sanity
-		glsh::SetShaderUniform("u_LightDir", lightDir);
-		glsh::SetShaderUniform("u_LightColor", LightCol);
-		glsh::SetShaderUniform("u_AmbientCol", AmbientCol);
-
-		viewMatrix = glm::translate(viewMatrix, m->GetPosition());
-		//viewMatrix *= m->GetRotationMatrix();
-		viewMatrix = glm::rotate(viewMatrix, glm::radians(m->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
-		viewMatrix = glm::scale(viewMatrix, m->GetScale());
-
-		glsh::SetShaderUniform("u_ModelViewMatrix", viewMatrix);
-
-		// set transform and material properties
-		glsh::SetShaderUniform("u_NormalMatrix", glm::transpose(glm::inverse(glm::mat3(viewMatrix))));
-
-		// set material properties
-		glsh::SetShaderUniform("u_Color", glm::vec4(0.0f, 0.4f, 0.8f, 1.0f));
-
-		m->Render();
+		return;
 	}
 
-	// render missile list
-	for (auto & m : enemyMissiles)
+	GLintptr instanceOffset = mStreamBuffer.Write(&mSceneInstances[0], mSceneInstances.size() * sizeof(SceneInstance));
+	if (instanceOffset < 0)
 	{
-		viewMatrix = mainCamera->getViewMatrix();
-
-		// set lighting parameters for the directional light shader
-		glm::vec3 lightDir(1.5f, 2.0f, 3.0f);           // direction to light in world space
-		lightDir = glm::mat3(viewMatrix) * lightDir;    // direction to light in camera space
-		lightDir = glm::normalize(lightDir);            // normalized for sanity
-		glsh::SetShaderUniform("u_LightDir", lightDir);
-		glsh::SetShaderUniform("u_LightColor", LightCol);
-		glsh::SetShaderUniform("u_AmbientCol", AmbientCol);
-
-		viewMatrix = glm::translate(viewMatrix, m->GetPosition());
-		//viewMatrix *= m->GetRotationMatrix();
-		viewMatrix = glm::rotate(viewMatrix, glm::radians(m->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
-		viewMatrix = glm::scale(viewMatrix, m->GetScale());
-
-		glsh::SetShaderUniform("u_ModelViewMatrix", viewMatrix);
-
-		// set transform and material properties
-		glsh::SetShaderUniform("u_NormalMatrix", glm::transpose(glm::inverse(glm::mat3(viewMatrix))));
-
-		// set material properties
-		glsh::SetShaderUniform("u_Color", glm::vec4(0.8f, 0.8f, 0.1f, 1.0f));
-
-		m->Render();
+		mMeshArena->CancelBatch();
+		return;
 	}
-}
 
-void Game::DrawPlayer()
-{
-	// create projection matrix
-	glm::mat4 projMatrix = mainCamera->getProjectionMatrix();
-	glm::mat4 viewMatrix = mainCamera->getViewMatrix();
-
-	glUseProgram(dirLightProg);
+	//
+	// shared state is set once for the whole pass
+	//
+	glsh::UseProgram(dirLightProg);
 	glsh::SetShaderUniform("u_ProjectionMatrix", projMatrix);
-
-	// draw ship
-	viewMatrix = mainCamera->getViewMatrix();
+	glsh::SetShaderUniform("u_ViewMatrix", viewMatrix);
 
 	// set lighting parameters for the directional light shader
 	glm::vec3 lightDir(1.5f, 2.0f, 3.0f);           // direction to light in world space
@@ -935,19 +1212,7 @@ void Game::DrawPlayer()
 	glsh::SetShaderUniform("u_LightColor", LightCol);
 	glsh::SetShaderUniform("u_AmbientCol", AmbientCol);
 
-	viewMatrix = glm::translate(viewMatrix, playerShip->GetPosition());
-	viewMatrix = glm::rotate(viewMatrix, glm::radians(playerShip->GetYaw()), glm::vec3(0.0f, 0.0f, 1.0f));
-	viewMatrix = glm::scale(viewMatrix, playerShip->GetScale());
-
-	glsh::SetShaderUniform("u_ModelViewMatrix", viewMatrix);
-
-	// set transform and material properties
-	glsh::SetShaderUniform("u_NormalMatrix", glm::transpose(glm::inverse(glm::mat3(viewMatrix))));
-
-	// set material properties
-	glsh::SetShaderUniform("u_Color", glm::vec4(0.0f, 0.8f, 0.4f, 1.0f));
-
-	playerShip->Render();
+	mMeshArena->SubmitBatch(mStreamBuffer.getBuffer(), instanceOffset, mIndirectBuffer);
 }
 
 void Game::DrawTextArea(const glsh::TextBatch& textBatch, const glm::vec2& pos, float margin, const glm::vec4& textColor, const glm::vec4& bgColor, const glm::vec4& borderColor)
@@ -955,45 +1220,25 @@ void Game::DrawTextArea(const glsh::TextBatch& textBatch, const glm::vec2& pos,
 	float bgWidth = textBatch.GetWidth() + 2 * margin;
 	float bgHeight = textBatch.GetHeight() + 2 * margin;
 
-	// background fill quad (triangle strip)
-	glsh::VertexPosition bgQuad[] = {
-		glsh::VertexPosition(0,       -bgHeight, 0),    // bottom-left
-		glsh::VertexPosition(bgWidth, -bgHeight, 0),    // bottom-right
-		glsh::VertexPosition(0,         0, 0),    // top-left
-		glsh::VertexPosition(bgWidth,         0, 0),    // top-right
-	};
-
-	// background border (line loop)
-	glsh::VertexPosition border[] = {
-		glsh::VertexPosition(0,       -bgHeight, 0),    // bottom-left
-		glsh::VertexPosition(bgWidth, -bgHeight, 0),    // bottom-right
-		glsh::VertexPosition(bgWidth,         0, 0),    // top-right
-		glsh::VertexPosition(0,         0, 0),    // top-left
-	};
-
-	glm::mat4 uiProj = glm::ortho(-0.5f, mScrWidth - 0.5f, -0.5f, mScrHeight - 0.5f, -1.0f, 1.0f);
-
-	glUseProgram(uColorProg);
+	// queued into the UI batch, drawn by FlushUI
+	mUIBatch.AddRect(pos, bgWidth, bgHeight, bgColor);
+	mUIBatch.AddOutline(pos, bgWidth, bgHeight, 1.0f, borderColor);
+	mUIBatch.AddText(textBatch, glm::vec2(pos.x + margin, pos.y - margin), textColor);
+}
 
-	// draw background fill
-	glsh::SetShaderUniform("u_ProjectionMatrix", uiProj);
-	glsh::SetShaderUniform("u_ModelViewMatrix", glsh::CreateTranslation(pos.x, pos.y, 0.0f));
-	glsh::SetShaderUniform("u_Color", bgColor);
-	glsh::DrawGeometry(GL_TRIANGLE_STRIP, bgQuad, 4);
+void Game::FlushUI()
+{
+	if (mUIBatch.IsEmpty()) {
+		return;
+	}
 
-	// draw background border
-	glsh::SetShaderUniform("u_Color", borderColor);
-	glsh::DrawGeometry(GL_LINE_LOOP, border, 4);
+	glm::mat4 uiProj = glm::ortho(-0.5f, mScrWidth - 0.5f, -0.5f, mScrHeight - 0.5f, -1.0f, 1.0f);
 
-	// draw text
-	glUseProgram(texTintProgram);
+	glsh::UseProgram(uiProgram);
 	glsh::SetShaderUniform("u_ProjectionMatrix", uiProj);
-	glsh::SetShaderUniform("u_ModelviewMatrix", glsh::CreateTranslation(pos.x + margin, pos.y - margin, 0.0f));
-	glsh::SetShaderUniform("u_Tint", textColor);
-
-	glBindTexture(GL_TEXTURE_2D, textBatch.GetFont()->getTex());
+	glsh::SetShaderUniformInt("u_TexSampler", 0);
 
-	textBatch.DrawGeometry();
+	mUIBatch.Flush(mStreamBuffer);
 }
 
 void Game::ApplyFilteringSettings(GLuint sampler)
@@ -1008,22 +1253,28 @@ void Game::ApplyFilteringSettings(GLuint sampler)
 	glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, minFilter.anisotropy);
 }
 
-void Game::UpdateScorePanel()
+// "<label><value>" without going through a stream
+static void SetPanelText(glsh::TextBatch& textBatch, const glsh::Font* font, const char* label, int value)
 {
-	std::ostringstream ss;
+	char text[64];
+	int len = 0;
+	while (label[len] && len < 32) {
+		text[len] = label[len];
+		len++;
+	}
+	glsh::FormatInt(text + len, sizeof(text) - len, value);
 
-	ss << "Score: " << currentScore;
+	textBatch.SetText(font, text, false);
+}
 
-	scoreTextBatch.SetText(font, ss.str(), false);
+void Game::UpdateScorePanel()
+{
+	SetPanelText(scoreTextBatch, font, "Score: ", currentScore);
 }
 
 void Game::UpdateLivesPanel()
 {
-	std::ostringstream ss;
-
-	ss << "Lives: " << currentLives;
-
-	livesTextBatch.SetText(font, ss.str(), false);
+	SetPanelText(livesTextBatch, font, "Lives: ", currentLives);
 }
 
 void Game::SetUIText() {
@@ -1056,6 +1307,17 @@ bool Game::PointInRect(glm::vec2 pos, glm::vec4 rect)
 	}
 }
 
+void Game::SpawnFieldAsteroids(int count)
+{
+	// on a circle around the player's starting point
+	for (int i = 0; i < count; i++)
+	{
+		float radius = 5.0f;
+		float angle = glsh::Random(0.0f, 360.f);
+		SpawnAsteroid(glm::vec3(radius * cos(angle), radius * sin(angle), 0.0f), ASTEROID_SCALE);
+	}
+}
+
 void Game::SpawnAsteroid(glm::vec3 position, float scale)
 {
 	Asteroid* a = new Asteroid();
@@ -1104,4 +1366,27 @@ void Game::SpawnAsteroid(glm::vec3 position, float scale)
 	a->Initialize();
 	// add to list
 	asteroids.push_back(a);
-}
\ No newline at end of file
+	mEvents.Push(EVENT_SPAWN, glm::vec2(position.x, position.y));
+}
+
+Missile* Game::SpawnMissile(std::list<Missile*>& list)
+{
+	// only grows past the pre-allocated missiles when more are in flight than ever before
+	if (mMissilePool.empty())
+	{
+		mMissilePool.push_back(new Missile());
+	}
+	Missile* m = mMissilePool.front();
+	list.splice(list.end(), mMissilePool, mMissilePool.begin());
+	*m = Missile();
+	return m;
+}
+
+void Game::RecycleMissile(std::list<Missile*>& list, Missile* m)
+{
+	auto it = std::find(list.begin(), list.end(), m);
+	if (it != list.end())
+	{
+		mMissilePool.splice(mMissilePool.end(), list, it);
+	}
+}
@@ -4,21 +4,49 @@
 #include "Asteroid.h"
 #include "CircularListSelector.h"
 #include "EnemyShip.h"
+#include "GameEvents.h"
 #include "GameObject.h"
 #include "GLSH.h"
 #include "Missile.h"
+#include "PerfHUD.h"
 #include "Ship.h"
 #include "TextureAnimation.h"
 #include "TextureManager.h"
 #include "Wavefront.h"
 
 const float			ASTEROID_SCALE	=		0.4f;
+const int			ASTEROID_LODS	=		4;			// full mesh plus simplified levels
+const float			LOD_PIXEL_ERROR	=		0.5f;		// largest on-screen error a level of detail may introduce
+const bool			PACK_MESH_VERTICES =	true;		// 16-byte quantized vertices (shaders/DirLightInstancedPacked-vs.glsl)
+const char* const	SHADER_CACHE_DIR =		"shadercache";	// linked program binaries (see glsh::SetProgramCacheDirectory)
+const char* const	PROFILE_TRACE_PATH =	"profile.json";	// F9 writes the recent profiler zones here (chrome://tracing)
+const char* const	GL_STATS_LOG_PATH =		"glstats.csv";	// F4 starts and stops logging per-frame GL call counts here
+const char* const	TELEMETRY_NAME =		"/assteroids";	// shared memory block published with --telemetry (tools/TelemetryReader)
+const int			MISSILE_POOL_SIZE =		32;			// missiles allocated up front, so firing doesn't allocate
+const int			STEADY_STATE_FRAMES =	60;			// frames without events before a frame must not allocate (see --assert-no-alloc)
 
 const glm::vec4		NEW_GAME_RECT	=		glm::vec4(380.0f, 420.0f, 80.0f, 120.0f);
 const glm::vec4		QUIT_RECT		=		glm::vec4(380.0f, 420.0f, 200.0f, 220.0f);
 
 const float			BUTTON_MARGIN	=		10.0f;
 
+// per-instance data for the lit scene pass (shaders/DirLightInstanced-vs.glsl)
+struct SceneInstance {
+	glm::mat4		model;
+	glm::vec4		color;
+};
+
+// what a scenario can change about the simulation (tools/Stress); the defaults are the game as it ships
+struct SimulationSettings {
+	float			worldSize			= 0.0f;		// view height in world units; 0 derives it from the window size
+	int				asteroids			= 3;		// asteroids in a new field
+	float			asteroidSpawnRate	= 0.0f;		// more asteroids per second while playing
+	int				maxEnemies			= 1;		// enemy ships alive at once; a new one replaces the oldest
+	float			enemyInterval		= 10.0f;	// seconds between enemy ships
+	float			missileSpeed		= 5.0f;		// player and enemy missiles
+	float			fireRate			= 0.5f;		// seconds between player missiles
+};
+
 enum BlendMode {
 	kDisableBlending,
 	kAlphaBlending,
@@ -32,23 +60,39 @@ enum GameState {
 	GAME_OVER,
 };
 
+// game counters in the telemetry block; "state" is the GameState value
+enum TelemetryCounter {
+	TELEMETRY_ASTEROIDS,
+	TELEMETRY_MISSILES,
+	TELEMETRY_ENEMY_MISSILES,
+	TELEMETRY_EFFECTS,
+	TELEMETRY_STATE,
+	TELEMETRY_SCORE,
+	TELEMETRY_LIVES,
+	NUM_TELEMETRY_COUNTERS
+};
+
 class Game : public glsh::App
 {
 	GLuint					uColorProg = 0;
 	GLuint					dirLightProg = 0;
-	GLuint					texTintProgram = 0;
+	GLuint					uiProgram = 0;
 	GLuint					effectsProg = 0;
 
 	GLuint					mSampler;
 
-	TextureManager*         mTexMgr;
+	TextureManager*         mTexMgr = nullptr;
 
-	glsh::Font*				font;
+	glsh::TextureAtlas*		mAtlas = nullptr;
+	glsh::Font*				font = nullptr;
 	glsh::TextBatch			scoreTextBatch;
 	glsh::TextBatch			livesTextBatch;
 	glsh::TextBatch			newGameTextBatch;
 	glsh::TextBatch			restartTextBatch;
 	glsh::TextBatch			quitTextBatch;
+	glsh::UIBatch			mUIBatch;
+	glsh::DynamicBuffer		mStreamBuffer;
+	glsh::DynamicBuffer		mIndirectBuffer;
 
 	GameState				currentState = PAUSED;
 
@@ -62,34 +106,41 @@ class Game : public glsh::App
 
 	float					mSpinAngle = 0.0f;
 	float					timeSinceLastFire;
-	float					fireRate = 0.5f;
 
 	float                   mScrWidth, mScrHeight;  // useful for drawing UI stuff
 	float                   mScrTop;
 
-	float					enemyInterval = 10.0f;
+	SimulationSettings		mSettings;
 	float					lastEnemySpawn;
+	float					mAsteroidSpawnClock = 0.0f;	// asteroids owed to asteroidSpawnRate
 	bool					leftSide = true;
 
-	glsh::FreeLookCamera*	mainCamera;
+	glsh::FreeLookCamera*	mainCamera = nullptr;
 
 	TextureSheet*			explosionSheet = nullptr;
 	BlendMode				blendMode;
 	std::list<AnimatedEffect*> effectlist;
+	EffectRenderer			mEffectRenderer;
 
     void                    updateProjection();
-
-	glsh::IndexedMesh*			shipMesh;
-	glsh::IndexedMesh*			missileMesh;
-	glsh::IndexedMesh*			enemyShipMesh;
-	glsh::IndexedMesh*			enemyMissileMesh;
-	glsh::IndexedMesh*			asteroidMesh;
+    void                    InitSimulation(int w, int h);
+    void                    SpawnFieldAsteroids(int count);
+
+	glsh::MeshArena*			mMeshArena = nullptr;		// every OBJ mesh, drawn from one VAO
+	glsh::ArenaMesh*			shipMesh = nullptr;
+	glsh::ArenaMesh*			missileMesh = nullptr;
+	glsh::ArenaMesh*			enemyShipMesh = nullptr;
+	glsh::ArenaMesh*			enemyMissileMesh = nullptr;
+	glsh::ArenaMesh*			asteroidMesh = nullptr;
+	std::vector<SceneInstance>	mSceneInstances;
+	std::vector<unsigned char>	mAsteroidLODs;			// level picked for each asteroid this frame
 
 	std::list<Asteroid*>	asteroids;
 	std::list<Missile*>		missiles;
 	std::list<Missile*>     enemyMissiles;
-	Ship*					playerShip;
-	EnemyShip*				enemyShip;
+	std::list<Missile*>		mMissilePool;			// spent missiles; the list nodes move along with them
+	Ship*					playerShip = nullptr;
+	std::list<EnemyShip*>	enemyShips;
 
 	CircularListSelector<GLuint>    mMeshTextures;
 
@@ -97,6 +148,9 @@ class Game : public glsh::App
 	GLuint                  mFBOTex;
 	GLuint                  mFBO;
 
+	PerfHUD					mPerfHUD;
+	int						mTelemetrySlots[NUM_TELEMETRY_COUNTERS];
+
 	glm::vec3				LightCol;
 	glm::vec3				AmbientCol;
 
@@ -109,26 +163,44 @@ public:
     void                    resize(int w, int h)        override;
     void                    draw()                      override;
     void                    update(float dt)            override;
+    uint32_t                getStateChecksum() const    override;
+
+	// the game without GL, on a headless window (benchmarks, stress tests, replays); call instead of initialize
+	void					InitializeHeadless(int w, int h);
+	bool					LoadHeadlessUI();			// menu text, so replayed clicks land on the buttons; needs a GL context
+	void					StartGame();				// what the New Game button does
+	void					SetPlayerInvulnerable(bool invulnerable);	// collisions are still checked, they just don't kill
+	int						GetAsteroidCount() const;
+	PerfEntityCounts		GetEntityCounts() const;
+	void					SetSimulationSettings(const SimulationSettings& settings);	// call before InitializeHeadless or StartGame
 
-	GLuint					BuildShaderProgram(std::string, std::string);
 	void					ApplyFilteringSettings(GLuint sampler);
-	void					DrawAsteroids();
-	void					DrawEnemyShip();
-	void					DrawMissiles();
-	void					DrawPlayer();
+	void					DrawScene();
 	void					DrawTextArea(const glsh::TextBatch& textBatch, const glm::vec2& pos, float margin, const glm::vec4& textColor, const glm::vec4& bgColor, const glm::vec4& borderColor);
+	void					FlushUI();
 	void					CleanUpGame();
 	void					InitGame();
 	void					ResetGame();
 	void					InitTextures();
 	bool					PointInRect(glm::vec2 pos, glm::vec4 rect);
+	void					ProcessEvents();
+	void					PublishTelemetry(const PerfEntityCounts& counts);
+	void					RefreshHUD();
 	void					UpdateScorePanel();
 	void					UpdateLivesPanel();
 	void					SetUIText();
 	void					SpawnAsteroid(glm::vec3 position, float scale);
+	Missile*				SpawnMissile(std::list<Missile*>& list);
+	void					RecycleMissile(std::list<Missile*>& list, Missile* m);
 
 	int						currentScore = 0;
 	int						currentLives = 3;
+
+	GameEventQueue			mEvents;
+	bool					mScorePanelDirty = true;
+	bool					mLivesPanelDirty = true;
+	int						mQuietFrames = 0;		// consecutive PLAYING updates without events
+	bool					mPlayerInvulnerable = false;
 };
 
 #endif
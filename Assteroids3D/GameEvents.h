@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+enum GameEventType
+{
+	EVENT_KILL,				// an asteroid or enemy was destroyed, awards points
+	EVENT_HIT,				// a missile hit something
+	EVENT_PLAYER_DEATH,
+	EVENT_SPAWN,			// an asteroid or enemy entered play
+};
+
+struct GameEvent
+{
+	GameEventType	type;
+	int				points;
+	glm::vec2		pos;
+	float			angle;
+};
+
+// Events recorded during a simulation tick and drained once at the end of it.
+// The storage is reused between ticks, so recording doesn't allocate in steady state.
+class GameEventQueue
+{
+	std::vector<GameEvent> mEvents;
+
+public:
+	GameEventQueue()
+	{
+		mEvents.reserve(256);
+	}
+
+	void Push(GameEventType type, const glm::vec2& pos, float angle = 0.0f, int points = 0)
+	{
+		GameEvent e;
+		e.type = type;
+		e.points = points;
+		e.pos = pos;
+		e.angle = angle;
+		mEvents.push_back(e);
+	}
+
+	int Size() const
+	{
+		return (int)mEvents.size();
+	}
+
+	const GameEvent& operator[](int i) const
+	{
+		return mEvents[i];
+	}
+
+	void Clear()
+	{
+		mEvents.clear();
+	}
+};
@@ -117,7 +117,6 @@ void GameObject::UpdatePosition(glm::vec3 delta, float fov, int w, int h)
 	float viewLeft = -0.7f * viewWidth;
 	float viewRight = viewLeft + viewWidth * 1.4f;
 	float viewBottom = -1.0f * viewHeight;
-	float viewTop = viewBottom + viewHeight;
 
 	// wrap around
 	if (position.x < viewLeft)
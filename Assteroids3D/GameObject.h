@@ -37,8 +37,8 @@ public:
 
 public:
 	GameObject() 
-		: position(glm::vec3(0.0f, 0.0f, 0.0f)), yaw(0.0f), pitch(0.0f), roll(0.0f), rotationMatrix(glm::mat4(1.0f)), scale(glm::vec3(1.0f, 1.0f, 1.0f)),
-		velocity(glm::vec2(0.0f, 0.0f)), yawRotationSpeed(0.0f), pitchRotationSpeed(0.0f), rollRotationSpeed(0.0f), dead(false), mesh(nullptr), collider(Collider())
+		: position(glm::vec3(0.0f, 0.0f, 0.0f)), yaw(0.0f), pitch(0.0f), roll(0.0f), scale(glm::vec3(1.0f, 1.0f, 1.0f)), rotationMatrix(glm::mat4(1.0f)),
+		velocity(glm::vec2(0.0f, 0.0f)), yawRotationSpeed(0.0f), pitchRotationSpeed(0.0f), rollRotationSpeed(0.0f), mesh(nullptr), collider(Collider()), dead(false)
 	{
 
 	}
@@ -0,0 +1,221 @@
+#include "PerfHUD.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+// profiler zones shown in the overlay, nested ones indented under their parent
+struct Phase
+{
+	const char*		zone;
+	const char*		label;
+};
+
+const Phase PHASES[] = {
+	{ "Game::update",		"update" },
+	{ "input",				"  input" },
+	{ "spawn",				"  spawn" },
+	{ "entities",			"  entities" },
+	{ "collision",			"  collision" },
+	{ "effects",			"  effects" },
+	{ "events",				"  events" },
+	{ "Game::draw",			"draw" },
+	{ "draw scene",			"  scene" },
+	{ "draw effects",		"  effects" },
+	{ "draw UI",			"  UI" },
+	{ "glutSwapBuffers",	"swap" },
+};
+const int NUM_PHASES = sizeof(PHASES) / sizeof(PHASES[0]);
+
+const uint64_t		REFRESH_INTERVAL_NS	=	250 * 1000 * 1000;		// how often the numbers change
+const float			GRAPH_HEIGHT		=	60.0f;
+const float			GRAPH_MAX_MS		=	50.0f;					// frame time at the top of the graph
+const float			BUDGET_MS			=	1000.0f / 60.0f;
+
+// printf onto the end of a fixed buffer
+void Append(char* buf, int bufSize, int& len, const char* format, ...)
+{
+	if (len >= bufSize - 1) {
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	int n = std::vsnprintf(buf + len, bufSize - len, format, args);
+	va_end(args);
+
+	if (n > 0) {
+		len = std::min(len + n, bufSize - 1);
+	}
+}
+
+}
+
+PerfHUD::PerfHUD()
+	: mVisible(false)
+	, mNextFrame(0)
+	, mNumFrames(0)
+	, mLastFrameNs(0)
+	, mEventCursor(0)
+	, mPhaseNs(NUM_PHASES, 0)
+	, mPhaseFrames(0)
+	, mOverheadNs(0)
+	, mOverheadBytes(0)
+	, mLastRefreshNs(0)
+{
+	std::fill(mFrameMs, mFrameMs + WINDOW, 0.0f);
+	mEvents.reserve(256);
+}
+
+void PerfHUD::Toggle()
+{
+	mVisible = !mVisible;
+
+	// start the phase totals over; the text is refreshed on the next frame
+	std::fill(mPhaseNs.begin(), mPhaseNs.end(), 0);
+	mPhaseFrames = 0;
+	mOverheadNs = 0;
+	mOverheadBytes = 0;
+	mLastRefreshNs = 0;
+}
+
+void PerfHUD::BeginFrame(const glsh::Font* font, const PerfEntityCounts& counts)
+{
+	uint64_t now = glsh::Profiler::Now();
+
+	// frame times are recorded while hidden too, so the window is full as soon as the overlay is shown
+	if (mLastFrameNs) {
+		mFrameMs[mNextFrame] = (now - mLastFrameNs) * 1e-6f;
+		mNextFrame = (mNextFrame + 1) % WINDOW;
+		mNumFrames = std::min(mNumFrames + 1, WINDOW);
+	}
+	mLastFrameNs = now;
+
+	// the cursor follows along either way, so showing the overlay doesn't pull in the whole event ring
+	glsh::Profiler::GetThreadEvents(mEventCursor, mEvents);
+
+	if (!mVisible) {
+		return;
+	}
+
+	for (unsigned i = 0; i < mEvents.size(); i++) {
+		const glsh::ProfileEvent& e = mEvents[i];
+		for (int p = 0; p < NUM_PHASES; p++) {
+			if (std::strcmp(e.name, PHASES[p].zone) == 0) {
+				mPhaseNs[p] += e.endNs - e.beginNs;
+				break;
+			}
+		}
+	}
+	mPhaseFrames++;
+
+	if (now - mLastRefreshNs >= REFRESH_INTERVAL_NS) {
+		RefreshText(font, counts);
+		mLastRefreshNs = now;
+	}
+
+	mOverheadNs += glsh::Profiler::Now() - now;
+}
+
+void PerfHUD::RefreshText(const glsh::Font* font, const PerfEntityCounts& counts)
+{
+	// percentiles of the whole window
+	float sorted[WINDOW];
+	int n = mNumFrames;
+	float sum = 0.0f;
+	float maxMs = 0.0f;
+	for (int i = 0; i < n; i++) {
+		sorted[i] = mFrameMs[i];
+		sum += mFrameMs[i];
+		maxMs = std::max(maxMs, mFrameMs[i]);
+	}
+
+	float p50 = 0.0f;
+	float p99 = 0.0f;
+	if (n > 0) {
+		std::nth_element(sorted, sorted + n / 2, sorted + n);
+		p50 = sorted[n / 2];
+		int i99 = std::min(n - 1, (n * 99 + 99) / 100 - 1);
+		std::nth_element(sorted, sorted + i99, sorted + n);
+		p99 = sorted[i99];
+	}
+
+	char text[1024];
+	int len = 0;
+	const int size = sizeof(text);
+
+	Append(text, size, len, "frame ms  avg %.2f  p50 %.2f  p99 %.2f  max %.2f\n", n ? sum / n : 0.0f, p50, p99, maxMs);
+
+	// phases are averaged over the frames since the last refresh
+	int frames = std::max(mPhaseFrames, 1);
+#if GLSH_PROFILER
+	for (int p = 0; p < NUM_PHASES; p++) {
+		Append(text, size, len, "%-12s %7.3f ms\n", PHASES[p].label, mPhaseNs[p] * 1e-6 / frames);
+	}
+#else
+	Append(text, size, len, "(profiler zones compiled out)\n");
+#endif
+
+	const glsh::GLFrameStats& gl = glsh::GetLastFrameGLStats();
+	Append(text, size, len, "draw calls %u  uniforms %u (%u redundant)\n", gl.drawCalls, gl.uniformUploads, gl.redundantUniforms);
+	Append(text, size, len, "programs %u (%u redundant)  VAOs %u (%u redundant)\n",
+		gl.programBinds, gl.redundantProgramBinds, gl.vaoBinds, gl.redundantVAOBinds);
+	Append(text, size, len, "buffer uploads %u (%lu KB)  texture uploads %u\n",
+		gl.bufferUploads, (unsigned long)(gl.bufferBytes / 1024), gl.textureUploads);
+	const glsh::MemoryFrameStats& mem = glsh::GetLastFrameMemoryStats();
+	Append(text, size, len, "heap allocs %u (%lu KB)  live %lu KB  peak %lu KB  GPU %lu KB\n",
+		mem.totalAllocs(), (unsigned long)(mem.totalAllocBytes() / 1024), (unsigned long)(mem.totalHeapBytes() / 1024),
+		(unsigned long)(mem.peakHeapBytes / 1024), (unsigned long)(mem.totalGPUBytes() / 1024));
+	Append(text, size, len, "asteroids %d  missiles %d  enemy missiles %d  effects %d\n",
+		counts.asteroids, counts.missiles, counts.enemyMissiles, counts.effects);
+	Append(text, size, len, "overlay %.4f ms  %.1f KB uploaded", mOverheadNs * 1e-6 / frames, mOverheadBytes / 1024.0 / frames);
+
+	mText.SetText(font, text, true);
+
+	std::fill(mPhaseNs.begin(), mPhaseNs.end(), 0);
+	mPhaseFrames = 0;
+	mOverheadNs = 0;
+	mOverheadBytes = 0;
+}
+
+void PerfHUD::QueueGraph(glsh::UIBatch& batch, const glm::vec2& topLeft)
+{
+	uint64_t start = glsh::Profiler::Now();
+
+	float bottom = topLeft.y - GRAPH_HEIGHT;
+	float scale = GRAPH_HEIGHT / GRAPH_MAX_MS;
+
+	batch.AddRect(topLeft, (float)WINDOW, GRAPH_HEIGHT, glm::vec4(0.1f, 0.1f, 0.1f, 0.3f));
+
+	// one bar per frame, newest on the right
+	for (int i = 0; i < mNumFrames; i++) {
+		float ms = mFrameMs[(mNextFrame - mNumFrames + i + WINDOW) % WINDOW];
+		float h = std::min(ms * scale, GRAPH_HEIGHT);
+
+		glm::vec4 color;
+		if (ms <= BUDGET_MS) {
+			color = glm::vec4(0.2f, 0.9f, 0.3f, 1.0f);
+		} else if (ms <= 2.0f * BUDGET_MS) {
+			color = glm::vec4(0.9f, 0.8f, 0.2f, 1.0f);
+		} else {
+			color = glm::vec4(0.9f, 0.2f, 0.2f, 1.0f);
+		}
+
+		batch.AddRect(glm::vec2(topLeft.x + (WINDOW - mNumFrames + i), bottom + h), 1.0f, h, color);
+	}
+
+	// 60 Hz budget
+	batch.AddRect(glm::vec2(topLeft.x, bottom + BUDGET_MS * scale), (float)WINDOW, 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.5f));
+
+	mOverheadNs += glsh::Profiler::Now() - start;
+}
+
+void PerfHUD::AddSubmitCost(uint64_t ns, size_t uploadBytes)
+{
+	mOverheadNs += ns;
+	mOverheadBytes += uploadBytes;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "GLSH.h"
+
+#include <vector>
+
+// what the game has alive this frame
+struct PerfEntityCounts
+{
+	int				asteroids;
+	int				missiles;
+	int				enemyMissiles;
+	int				effects;
+};
+
+// Frame statistics overlay (F3).
+// Frame times are kept for a rolling window of frames; percentiles and the text are only
+// recomputed a few times a second, so the overlay costs a few microseconds a frame and can
+// stay on during soak runs. Phase times come from the profiler zones of the main thread.
+// The overlay's own cost covers its bookkeeping, queueing and the UI flush that submits it.
+class PerfHUD
+{
+public:
+	static const int	WINDOW = 240;			// frames in the rolling window, one graph bar each
+
+	PerfHUD();
+
+	void Toggle();
+	bool IsVisible() const				{ return mVisible; }
+
+	// once per frame, before anything is queued for drawing; the frame time is the time since the last call
+	void BeginFrame(const glsh::Font* font, const PerfEntityCounts& counts);
+
+	const glsh::TextBatch& GetText() const	{ return mText; }
+
+	// frame-time graph, WINDOW pixels wide with the oldest frame on the left
+	void QueueGraph(glsh::UIBatch& batch, const glm::vec2& topLeft);
+
+	// time and bytes uploaded by the UI flush that drew the overlay, counted in its own cost
+	void AddSubmitCost(uint64_t ns, size_t uploadBytes);
+
+private:
+	void RefreshText(const glsh::Font* font, const PerfEntityCounts& counts);
+
+	bool						mVisible;
+
+	float						mFrameMs[WINDOW];		// ring of frame times
+	int							mNextFrame;
+	int							mNumFrames;
+	uint64_t					mLastFrameNs;
+
+	// per-phase totals since the last text refresh
+	uint64_t					mEventCursor;
+	std::vector<glsh::ProfileEvent> mEvents;
+	std::vector<uint64_t>		mPhaseNs;
+	int							mPhaseFrames;
+
+	uint64_t					mOverheadNs;			// the overlay's own time since the last text refresh
+	size_t						mOverheadBytes;			// and what it uploaded
+	uint64_t					mLastRefreshNs;
+
+	glsh::TextBatch				mText;
+};
@@ -1,37 +1,156 @@
 #include "TextureAnimation.h"
 
-TextureSheet* TextureSheet::Create(const std::string& path, int numFrames)
-{
-    int width, height;
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
 
-    GLuint tex = glsh::CreateTexture2D(path, false, &width, &height);
+TextureSheet* TextureSheet::Create(TextureManager& textures, const std::string& fname, int numFrames)
+{
+    TextureManager::Handle h = textures.Intern(fname, numFrames);
+    GLuint tex = textures.Acquire(h);
     if (!tex) {
         return NULL;
     }
 
     TextureSheet* texsheet = new TextureSheet();
-    texsheet->mTex = tex;
-    texsheet->mWidth = width;
-    texsheet->mHeight = height;
+    texsheet->mTextures = &textures;
+    texsheet->mHandle = h;
+    texsheet->mArrayTex = tex;
+    texsheet->mNumFrames = numFrames;
+    return texsheet;
+}
+
+TextureSheet::~TextureSheet()
+{
+    if (mTextures) {
+        mTextures->Release(mHandle);
+    }
+}
+
+
+// the shader's times are floats, so the clock is wound back before it gets large
+static const float EFFECT_CLOCK_REBASE = 60.0f;
+
+EffectRenderer::EffectRenderer()
+    : mVAO(0)
+    , mVBO(0)
+    , mGPUCapacity(0)
+    , mDirtyFrom(0)
+    , mClock(0.0f)
+{
+}
 
-    int frameWidth = width / numFrames;         // assumes frames are of equal width with no padding
-    float uTexelWidth = 1.0f / width;
-    float uStep = (frameWidth - 1) * uTexelWidth;
+EffectRenderer::~EffectRenderer()
+{
+    if (mVBO) {
+        glsh::UntrackGPUMemory(glsh::GPU_VERTEX_BUFFER, mVBO);
+        glDeleteBuffers(1, &mVBO);
+    }
+    if (mVAO) {
+        glDeleteVertexArrays(1, &mVAO);
+    }
+}
 
-    float u1 = 0.5f * uTexelWidth;
-    float u2 = u1 + uStep;
+void EffectRenderer::Add(const AnimatedEffect& effect)
+{
+    EffectInstance inst;
+    inst.pos = effect.mPos;
+    inst.angle = effect.mAngle;
+    inst.startTime = mClock - effect.GetTime();
+    inst.duration = effect.GetDuration();
+    mInstances.push_back(inst);
+}
 
-    for (int i = 0; i < numFrames; i++) {
-        std::vector<glsh::VPT> rect(4);
-        // FIXME: this code assumes that the frames are square
-        rect[0].pos = glm::vec3(-0.5f, -0.5f, 0.0f);    rect[0].texcoord = glm::vec2(u1, 0.0f);
-        rect[1].pos = glm::vec3( 0.5f, -0.5f, 0.0f);    rect[1].texcoord = glm::vec2(u2, 0.0f);
-        rect[2].pos = glm::vec3(-0.5f,  0.5f, 0.0f);    rect[2].texcoord = glm::vec2(u1, 1.0f);
-        rect[3].pos = glm::vec3( 0.5f,  0.5f, 0.0f);    rect[3].texcoord = glm::vec2(u2, 1.0f);
-        texsheet->mFrames.push_back(rect);
-        u1 = u2 + uTexelWidth;
-        u2 = u1 + uStep;
+void EffectRenderer::Remove(size_t index)
+{
+    if (index >= mInstances.size()) {
+        return;
     }
+    mInstances.erase(mInstances.begin() + index);
+    mDirtyFrom = std::min(mDirtyFrom, index);
+}
 
-    return texsheet;
+void EffectRenderer::Clear()
+{
+    mInstances.clear();
+    mDirtyFrom = 0;
+    mClock = 0.0f;
+}
+
+void EffectRenderer::AddTime(float dt)
+{
+    mClock += dt;
+
+    if (mInstances.empty()) {
+        mClock = 0.0f;
+    } else if (mClock >= EFFECT_CLOCK_REBASE) {
+        for (EffectInstance& inst : mInstances) {
+            inst.startTime -= mClock;
+        }
+        mClock = 0.0f;
+        mDirtyFrom = 0;
+    }
+}
+
+void EffectRenderer::upload()
+{
+    if (!mVAO) {
+        glGenVertexArrays(1, &mVAO);
+        glGenBuffers(1, &mVBO);
+
+        glsh::BindVertexArray(mVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+
+        // x, y, angle, start time in one attribute and the duration in another; corners come from gl_VertexID
+        glEnableVertexAttribArray(glsh::VA_POSITION);
+        glVertexAttribPointer(glsh::VA_POSITION, 4, GL_FLOAT, GL_FALSE, sizeof(EffectInstance), GLSH_BUFFER_OFFSET(offsetof(EffectInstance, pos)));
+        glVertexAttribDivisor(glsh::VA_POSITION, 1);
+
+        glEnableVertexAttribArray(glsh::VA_TEXCOORD);
+        glVertexAttribPointer(glsh::VA_TEXCOORD, 1, GL_FLOAT, GL_FALSE, sizeof(EffectInstance), GLSH_BUFFER_OFFSET(offsetof(EffectInstance, duration)));
+        glVertexAttribDivisor(glsh::VA_TEXCOORD, 1);
+
+        glsh::BindVertexArray(0);
+    }
+
+    if (mDirtyFrom >= mInstances.size()) {
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+
+    if (mInstances.size() > mGPUCapacity) {
+        mGPUCapacity = std::max<size_t>(64, mInstances.size() * 2);
+        glBufferData(GL_ARRAY_BUFFER, mGPUCapacity * sizeof(EffectInstance), NULL, GL_DYNAMIC_DRAW);
+        glsh::TrackGPUMemory(glsh::GPU_VERTEX_BUFFER, mVBO, mGPUCapacity * sizeof(EffectInstance));
+        mDirtyFrom = 0;
+    }
+
+    GLsizeiptr size = (mInstances.size() - mDirtyFrom) * sizeof(EffectInstance);
+    glBufferSubData(GL_ARRAY_BUFFER, mDirtyFrom * sizeof(EffectInstance), size, &mInstances[mDirtyFrom]);
+    glsh::CountBufferUpload(size);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mDirtyFrom = mInstances.size();
+}
+
+void EffectRenderer::Draw(const TextureSheet* sheet)
+{
+    if (!sheet || !sheet->GetArrayHandle() || mInstances.empty()) {
+        return;
+    }
+
+    upload();
+
+    glsh::BindVertexArray(mVAO);
+
+    glsh::SetShaderUniform("u_Time", mClock);
+    glsh::SetShaderUniformInt("u_NumFrames", sheet->NumFrames());
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, sheet->GetArrayHandle());
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)mInstances.size());
+    glsh::CountDrawCall();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glsh::BindVertexArray(0);
 }
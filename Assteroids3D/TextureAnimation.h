@@ -2,52 +2,44 @@
 #define TEXTURE_ANIMATION_H_
 
 #include "GLSH.h"
+#include "TextureManager.h"
+
+#include <list>
+#include <vector>
 
 class TextureSheet
 {
-    GLuint mTex;
-
-    int mWidth, mHeight;
-
-    std::vector<std::vector<glsh::VPT>> mFrames;        // each frame is a VPT quad
+    TextureManager* mTextures;
+    TextureManager::Handle mHandle;
+    GLuint mArrayTex;       // one frame per layer of a GL_TEXTURE_2D_ARRAY, held by the manager
+    int mNumFrames;
 
     // private constructor, use Create method to instantiate
     TextureSheet()
-        : mTex(0)
-        , mWidth(0)
-        , mHeight(0)
+        : mTextures(NULL)
+        , mHandle(TextureManager::InvalidHandle)
+        , mArrayTex(0)
+        , mNumFrames(0)
     { }
 
-public:
+    TextureSheet(const TextureSheet&) = delete;
+    TextureSheet& operator=(const TextureSheet&) = delete;
 
-    static TextureSheet* Create(const std::string& path, int numFrames);
+public:
 
-    GLuint GetHandle() const
-    {
-        return mTex;
-    }
+    // fname is relative to the manager's root; the texture is resident until the sheet is deleted
+    static TextureSheet* Create(TextureManager& textures, const std::string& fname, int numFrames);
 
-    int NumFrames() const
-    {
-        return (int)mFrames.size();
-    }
+    ~TextureSheet();
 
-    const std::vector<glsh::VPT>& GetFrameRect(int frameNo) const
+    GLuint GetArrayHandle() const
     {
-        // assumes there's at least one frame
-        if (frameNo <= 0) {
-            return mFrames.front();
-        } else if (frameNo >= NumFrames()) {
-            return mFrames.back();
-        } else {
-            return mFrames[frameNo];
-        }
+        return mArrayTex;
     }
 
-    void DrawFrame(int frameNo) const
+    int NumFrames() const
     {
-        glBindTexture(GL_TEXTURE_2D, mTex);
-        glsh::DrawGeometry(GL_TRIANGLE_STRIP, GetFrameRect(frameNo));
+        return mNumFrames;
     }
 };
 
@@ -76,25 +68,68 @@ public:
         mTime += dt;
     }
 
+    float GetTime() const
+    {
+        return mTime;
+    }
+
+    float GetDuration() const
+    {
+        return mDuration;
+    }
+
     bool FinishedPlaying() const
     {
         return mTime >= mDuration;
     }
+};
 
-    void DrawCurrentFrame() const
+
+//
+// Draws every live effect of one texture sheet with a single instanced call.
+// The frame index is picked in shaders/EffectInstanced-vs.glsl from u_Time and each
+// instance's start time, so the instance data doesn't change as the animations play.
+// It stays in a buffer of its own; only the instances added or moved since the last
+// draw are uploaded.
+//
+class EffectRenderer
+{
+    struct EffectInstance
     {
-        int numCells = mTextureSheet->NumFrames();
-        int cellIndex;
-        if (mTime <= 0.0f) {
-            cellIndex = 0;
-        } else if (mTime >= mDuration) {
-            cellIndex = numCells - 1;
-        } else {
-            cellIndex = (int)(mTime / mDuration * numCells);
-        }
-
-        mTextureSheet->DrawFrame(cellIndex);
-    }
+        glm::vec2 pos;
+        float angle;
+        float startTime;
+        float duration;
+    };
+
+    GLuint mVAO;
+    GLuint mVBO;
+    size_t mGPUCapacity;        // instances the buffer has room for
+    size_t mDirtyFrom;          // the instances from here on aren't uploaded yet
+
+    std::vector<EffectInstance> mInstances;     // in the order the effects were added
+
+    float mClock;               // what the start times are measured against; rebased before it loses precision
+
+    void upload();
+
+    EffectRenderer(const EffectRenderer&) = delete;
+    EffectRenderer& operator=(const EffectRenderer&) = delete;
+
+public:
+    EffectRenderer();
+    ~EffectRenderer();
+
+    // keep the instances in the order of the effects: add one when an effect starts,
+    // and remove it by its position when the effect ends
+    void Add(const AnimatedEffect& effect);
+    void Remove(size_t index);
+    void Clear();
+
+    void AddTime(float dt);
+
+    // expects the effect program to be current
+    void Draw(const TextureSheet* sheet);
 };
 
 #endif
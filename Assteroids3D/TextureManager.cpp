@@ -1,6 +1,14 @@
 #include "TextureManager.h"
+#include "GLSH_GLDebug.h"
+#include "GLSH_Memory.h"
+#include "GLSH_Image.h"
 
-TextureManager::TextureManager(const std::string& rootDir)
+#include <iomanip>
+#include <iostream>
+
+TextureManager::TextureManager(const std::string& rootDir, bool compress, size_t budgetBytes)
+    : mBudgetBytes(budgetBytes)
+    , mCompress(compress)
 {
     if (rootDir.empty()) {
         mRootDir = "./";
@@ -15,19 +23,213 @@ TextureManager::TextureManager(const std::string& rootDir)
 
 TextureManager::~TextureManager()
 {
-    // FIXME: cleanup!
+    for (unsigned i = 0; i < mEntries.size(); i++) {
+        if (mEntries[i].refCount > 0) {
+            std::cerr << "*** Texture " << mEntries[i].path << " still has " << mEntries[i].refCount << " references" << std::endl;
+        }
+        unload(mEntries[i]);
+    }
 }
 
-GLuint TextureManager::GetTexture(const std::string& fname)
+TextureManager::Handle TextureManager::Intern(const std::string& fname, int layers)
 {
-    std::string path = mRootDir + fname;
-
-    std::map<std::string, GLuint>::iterator it = mTextures.find(path);
-    if (it != mTextures.end()) {
+    std::map<std::string, Handle>::iterator it = mNames.find(fname);
+    if (it != mNames.end()) {
         return it->second;
+    }
+
+    Handle h = (Handle)mEntries.size();
+
+    Entry e;
+    e.path = mRootDir + fname;
+    e.layers = layers;
+    e.tex = 0;
+    e.bytes = 0;
+    e.refCount = 0;
+    e.inLRU = false;
+    mEntries.push_back(e);
+
+    mNames[fname] = h;
+    return h;
+}
+
+bool TextureManager::load(Entry& e)
+{
+    GLSH_MEMORY_SCOPE(glsh::MEMORY_TAG_LOADING);
+
+    glsh::TextureUploadStats stats;
+
+    if (e.layers > 0) {
+        glsh::Image img;
+        if (img.LoadTarga(e.path)) {
+            e.tex = glsh::CreateTexture2DArray(img, e.layers, mCompress, &stats);
+            if (e.tex) {
+                glsh::ReportTextureUpload(e.path, stats);
+            }
+        } else {
+            std::cerr << "*** Failed to load texture sheet from " << e.path << std::endl;
+        }
+        e.bytes = stats.uploadedBytes;
+    } else if (mCompress) {
+        e.tex = glsh::CreateCompressedTexture2D(e.path, true, NULL, NULL, &stats);
+        e.bytes = stats.uploadedBytes;
     } else {
-        GLuint tex = glsh::CreateTexture2D(path, true);
-        mTextures[path] = tex;
-        return tex;
+        glsh::Image img;
+        if (img.LoadTarga(e.path)) {
+            e.tex = glsh::CreateTexture2D(img, true, &stats);
+        } else {
+            std::cerr << "*** Failed to load texture from " << e.path << std::endl;
+        }
+        // the mip chain is generated by the driver and adds about a third
+        e.bytes = stats.uploadedBytes + stats.uploadedBytes / 3;
+    }
+
+    if (!e.tex) {
+        e.bytes = 0;
+        return false;
+    }
+    glsh::LabelGLObject(GL_TEXTURE, e.tex, e.path);
+
+    mStats.residentBytes += e.bytes;
+    mStats.residentCount++;
+    if (mStats.residentBytes > mStats.peakBytes) {
+        mStats.peakBytes = mStats.residentBytes;
+    }
+    return true;
+}
+
+void TextureManager::unload(Entry& e)
+{
+    if (e.inLRU) {
+        mLRU.erase(e.lruPos);
+        e.inLRU = false;
+    }
+
+    if (e.tex) {
+        glsh::UntrackGPUMemory(glsh::GPU_TEXTURE, e.tex);
+        glDeleteTextures(1, &e.tex);
+        e.tex = 0;
+        mStats.residentBytes -= e.bytes;
+        mStats.residentCount--;
+    }
+}
+
+void TextureManager::touch(Handle h)
+{
+    Entry& e = mEntries[h];
+    if (e.refCount > 0 || !e.tex) {
+        return;
+    }
+
+    if (e.inLRU) {
+        mLRU.splice(mLRU.begin(), mLRU, e.lruPos);
+    } else {
+        mLRU.push_front(h);
+        e.lruPos = mLRU.begin();
+        e.inLRU = true;
+    }
+}
+
+void TextureManager::evict()
+{
+    if (!mBudgetBytes) {
+        return;
+    }
+
+    // the LRU only holds unreferenced textures, so anything we pop is safe to delete
+    while (mStats.residentBytes > mBudgetBytes && !mLRU.empty()) {
+        unload(mEntries[mLRU.back()]);
+        mStats.evictions++;
+    }
+}
+
+GLuint TextureManager::Acquire(Handle h)
+{
+    if (h < 0 || h >= (Handle)mEntries.size()) {
+        return 0;
+    }
+
+    Entry& e = mEntries[h];
+
+    if (e.tex) {
+        mStats.hits++;
+    } else {
+        mStats.misses++;
+        if (!load(e)) {
+            return 0;
+        }
+    }
+
+    if (e.inLRU) {
+        mLRU.erase(e.lruPos);
+        e.inLRU = false;
+    }
+    e.refCount++;
+
+    return e.tex;
+}
+
+void TextureManager::Release(Handle h)
+{
+    if (h < 0 || h >= (Handle)mEntries.size() || mEntries[h].refCount <= 0) {
+        std::cerr << "*** Unbalanced texture release" << std::endl;
+        return;
+    }
+
+    if (--mEntries[h].refCount == 0) {
+        touch(h);
+    }
+}
+
+GLuint TextureManager::GetTexture(Handle h)
+{
+    if (h < 0 || h >= (Handle)mEntries.size()) {
+        return 0;
+    }
+
+    Entry& e = mEntries[h];
+
+    if (e.tex) {
+        mStats.hits++;
+    } else {
+        mStats.misses++;
+        if (!load(e)) {
+            return 0;
+        }
+    }
+
+    touch(h);
+
+    return e.tex;
+}
+
+void TextureManager::EndFrame()
+{
+    evict();
+}
+
+void TextureManager::SetBudget(size_t budgetBytes)
+{
+    mBudgetBytes = budgetBytes;
+    evict();
+}
+
+void TextureManager::EvictUnused()
+{
+    while (!mLRU.empty()) {
+        unload(mEntries[mLRU.back()]);
+        mStats.evictions++;
+    }
+}
+
+void TextureManager::ReportStats() const
+{
+    std::cout << std::fixed << std::setprecision(1)
+              << "Textures: " << mStats.residentCount << " resident, "
+              << mStats.residentBytes / 1024.0 << " KB (peak " << mStats.peakBytes / 1024.0 << " KB";
+    if (mBudgetBytes) {
+        std::cout << ", budget " << mBudgetBytes / 1024.0 << " KB";
     }
+    std::cout << "), " << mStats.hits << " hits, " << mStats.misses << " misses, "
+              << mStats.evictions << " evictions" << std::endl;
 }
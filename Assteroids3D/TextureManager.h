@@ -3,20 +3,95 @@
 
 #include "GLSH_Texture.h"
 
+#include <list>
 #include <map>
 #include <string>
+#include <vector>
 
+//
+// Loads textures on demand and keeps them resident within a VRAM budget.
+//
+// Names are interned once into integer handles, so per-frame lookups don't touch strings.
+// Acquire/Release keep a texture resident; unreferenced textures stay cached until the
+// budget is exceeded, then the least recently used ones are evicted at the end of the frame.
+//
 class TextureManager {
+public:
+    typedef int                     Handle;
+    static const Handle             InvalidHandle = -1;
+
+    struct Stats {
+        unsigned                    hits;
+        unsigned                    misses;         // lookups that had to load the texture
+        unsigned                    evictions;
+        size_t                      residentBytes;  // estimated, including the mip chain
+        size_t                      peakBytes;
+        int                         residentCount;
+
+        Stats()
+            : hits(0), misses(0), evictions(0), residentBytes(0), peakBytes(0), residentCount(0)
+        { }
+    };
+
+private:
+    struct Entry {
+        std::string                 path;           // mRootDir + fname, built once when interned
+        int                         layers;         // > 0 for a sheet of frames loaded as a 2D array texture
+        GLuint                      tex;
+        size_t                      bytes;
+        int                         refCount;
+        bool                        inLRU;
+        std::list<Handle>::iterator lruPos;
+    };
 
     std::string                     mRootDir;
-    std::map<std::string, GLuint>   mTextures;
+    std::map<std::string, Handle>   mNames;         // fname -> handle
+    std::vector<Entry>              mEntries;       // indexed by handle
+    std::list<Handle>               mLRU;           // resident and unreferenced, most recently used first
+    size_t                          mBudgetBytes;   // 0 means unlimited
+    bool                            mCompress;      // block-compress textures on load
+    Stats                           mStats;
+
+    bool                            load(Entry& e);
+    void                            unload(Entry& e);
+    void                            touch(Handle h);
+    void                            evict();
 
 public:
 
-                                    TextureManager(const std::string& rootDir);
+                                    TextureManager(const std::string& rootDir, bool compress = false, size_t budgetBytes = 0);
                                     ~TextureManager();
-                                    
-    GLuint                          GetTexture(const std::string& fname);
+
+    // map a file name (relative to the root dir) to a handle, without loading anything;
+    // with layers set, the image is a sheet of that many equal-width frames, loaded as a 2D array
+    // texture (the first Intern of a name decides)
+    Handle                          Intern(const std::string& fname, int layers = 0);
+
+    // load if needed and hold a reference, so the texture won't be evicted until Release
+    GLuint                          Acquire(Handle h);
+    void                            Release(Handle h);
+
+    // load if needed without holding a reference; the id is only valid until EndFrame,
+    // so Acquire anything kept longer
+    GLuint                          GetTexture(Handle h);
+    GLuint                          GetTexture(const std::string& fname)   { return GetTexture(Intern(fname)); }
+
+    int                             GetRefCount(Handle h) const             { return mEntries[h].refCount; }
+    bool                            IsResident(Handle h) const              { return mEntries[h].tex != 0; }
+
+    // evict the least recently used unreferenced textures until the budget is met;
+    // call once per frame after the last draw
+    void                            EndFrame();
+
+    // these evict right away, so call them between frames
+    void                            SetBudget(size_t budgetBytes);
+    size_t                          GetBudget() const                       { return mBudgetBytes; }
+
+    // drop every unreferenced texture
+    void                            EvictUnused();
+
+    const Stats&                    GetStats() const                        { return mStats; }
+    void                            ReportStats() const;
 };
 
 #endif
@@ -7,7 +7,63 @@
 #include <iostream>
 #include <fstream>
 
-glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
+// print per-mesh optimization and LOD stats while loading
+#ifndef WAVEFRONT_VERBOSE
+#define WAVEFRONT_VERBOSE 0
+#endif
+
+// reorder for the vertex cache (and front-to-back-ish cluster order)
+template <typename VertexType>
+static glsh::MeshBounds OptimizeLoadedMesh(std::vector<VertexType>& vertices, std::vector<unsigned int>& indices)
+{
+	glsh::MeshOptimizeStats stats;
+	glsh::MeshBounds bounds = glsh::OptimizeMesh(vertices, indices, true, &stats);
+
+#if WAVEFRONT_VERBOSE
+	std::cout << "  " << stats.numVertices << " vertices, " << stats.numTriangles << " triangles, ACMR "
+		<< stats.acmrBefore << " -> " << stats.acmrAfter << ", radius " << bounds.radius << std::endl;
+#endif
+
+	return bounds;
+}
+
+// put packed vertices in the arena; the quantization is set before any LODs so they share it
+template <typename VertexType>
+static glsh::ArenaMesh* AddPackedMesh(glsh::MeshArena* arena, const std::vector<VertexType>& vertices, const std::vector<unsigned int>& indices)
+{
+	std::vector<glsh::VertexPackedPositionNormalTexture> packedVerts;
+	glsh::PositionQuantization quant;
+	glsh::PackVertices(vertices, packedVerts, &quant);
+
+	glsh::ArenaMesh* mesh = arena->AddMesh(GL_TRIANGLES, packedVerts, indices);
+	if (mesh)
+	{
+		mesh->setQuantization(quant);
+	}
+	return mesh;
+}
+
+// add simplified levels of detail after a mesh that was just put in the arena
+template <typename VertexType>
+static void AddLODs(glsh::MeshArena* arena, glsh::ArenaMesh* mesh, const std::vector<VertexType>& vertices, const std::vector<unsigned int>& indices, int numLODs)
+{
+	std::vector<glsh::MeshLOD> lods;
+	glsh::BuildLODs(vertices, indices, numLODs, lods);
+
+	for (auto & lod : lods)
+	{
+		arena->AddLOD(mesh, &lod.indices[0], lod.indices.size(), lod.error);
+#if WAVEFRONT_VERBOSE
+		std::cout << "  LOD: " << lod.indices.size() / 3 << " triangles, error " << lod.error << std::endl;
+#endif
+	}
+}
+
+// read the faces as triangle soup: vpn when the faces have no texcoords, vpnt otherwise
+static bool ReadWavefront(const std::string& path,
+	std::vector<glsh::VertexPositionNormal>& vpn,
+	std::vector<glsh::VertexPositionNormalTexture>& vpnt,
+	bool& missingNormals)
 {
 	std::cout << "Loading '" << path << "'" << std::endl;
 
@@ -17,7 +73,7 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 	// make sure the file opened correctly
 	if (!file) {
 		std::cerr << "ERROR: Failed to open " << path << std::endl;
-		return NULL;
+		return false;
 	}
 
 	std::string line;                   // storage for a line of text
@@ -29,9 +85,8 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 	std::vector<glm::vec3> positions = std::vector<glm::vec3>();
 	std::vector<glm::vec2> texcoords = std::vector<glm::vec2>();
 	std::vector<glm::vec3> normals = std::vector<glm::vec3>();
-	// will contain final array of vertices
-	std::vector<glsh::VertexPositionNormalTexture> vpnt = std::vector<glsh::VertexPositionNormalTexture>();
-	std::vector<glsh::VertexPositionNormal> vpn = std::vector<glsh::VertexPositionNormal>();
+
+	missingNormals = false;     // set when some face vertex has no normal index
 	
 	// go through the file one line at a time until the end
 	for (;;) {
@@ -49,7 +104,7 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 			}
 			else {
 				std::cerr << "ERROR: Failed to read from " << path << " at line " << lineno << std::endl;
-				return NULL;
+				return false;
 			}
 		}
 
@@ -76,7 +131,7 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 			// make sure we have three coordinates following the "v"
 			if (lineTok.size() != 4) {
 				std::cerr << "ERROR: Incorrect number of vertex position coordinates on line " << lineno << std::endl;
-				return NULL;
+				return false;
 			}
 
 			// convert the coordinates to floats
@@ -95,7 +150,7 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 			// make sure we have three coordinates following the "vn"
 			if (lineTok.size() != 4) {
 				std::cerr << "ERROR: Incorrect number of normal coordinates on line " << lineno << std::endl;
-				return NULL;
+				return false;
 			}
 
 			// convert the coordinates to floats
@@ -122,7 +177,7 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 			// make sure we have at least two coordinates following the "vt"
 			if (lineTok.size() < 3) {
 				std::cerr << "ERROR: Incorrect number of uv coordinates on line " << lineno << std::endl;
-				return NULL;
+				return false;
 			}
 
 			// convert the coordinates to floats
@@ -140,7 +195,7 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 			// need at least 3 vertices per face
 			if (lineTok.size() < 4) {
 				std::cerr << "ERROR: Insufficient number of face elements on line " << lineno << std::endl;
-				return NULL;
+				return false;
 			}
 			
 			//std::cout << "Face with " << lineTok.size() - 1 << " vertices" << std::endl;
@@ -154,10 +209,10 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 				// split into three parts (v/vt/vn)
 				vertexTok = glsh::Split(lineTok[i], '/');
 
-				// make sure there are three parts
-				if (vertexTok.size() != 3) {
+				// make sure there are one to three parts (v, v/vt, v//vn or v/vt/vn)
+				if (vertexTok.empty() || vertexTok.size() > 3) {
 					std::cerr << "ERROR: Incorrect number of vertex tokens for vertex " << i << " on line " << lineno << std::endl;
-					return NULL;
+					return false;
 				}
 
 				// convert the index strings to ints
@@ -171,20 +226,19 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 				}
 				else {
 					std::cerr << "ERROR: Vertex position index not given for vertex " << i << " on line " << lineno << std::endl;
-					return NULL;
+					return false;
 				}
 
-				// get normal index (required)
-				if (!vertexTok[2].empty()) {
+				// get normal index (optional, generated from the faces if missing)
+				if (vertexTok.size() > 2 && !vertexTok[2].empty()) {
 					normalIndex = glsh::FromString<int>(vertexTok[2]);
 				}
 				else {
-					std::cerr << "ERROR: Vertex normal index not given for vertex " << i << " on line " << lineno << std::endl;
-					return NULL;
+					missingNormals = true;
 				}
 
 				// get texcoord index (optional)
-				if (!vertexTok[1].empty()) {
+				if (vertexTok.size() > 1 && !vertexTok[1].empty()) {
 					texcoordIndex = glsh::FromString<int>(vertexTok[1]);
 				}
 				else {
@@ -216,9 +270,9 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 			{
 				for (auto & v : vpnSub)
 				{
-					for (int i = 0; i < v.size() - 2; i++)
+					for (unsigned i = 0; i + 2 < v.size(); i++)
 					{
-						for (int j = i; j < i + 3; j++)
+						for (unsigned j = i; j < i + 3; j++)
 						{
 							int pIdx = 0;
 							int nIdx = 0;
@@ -233,13 +287,15 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 								nIdx = v[j].y - 1;
 							}
 
+							glm::vec3 normal = nIdx >= 0 ? normals[nIdx] : glm::vec3(0.0f);
+
 							vpn.push_back(glsh::VertexPositionNormal(
 								positions[pIdx].x,
 								positions[pIdx].y,
 								positions[pIdx].z,
-								normals[nIdx].x,
-								normals[nIdx].y,
-								normals[nIdx].z
+								normal.x,
+								normal.y,
+								normal.z
 							));
 						}
 					}
@@ -249,9 +305,9 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 			{
 				for (auto & v : vpntSub)
 				{
-					for (int i = 0; i < v.size() - 2; i++)
+					for (unsigned i = 0; i + 2 < v.size(); i++)
 					{
-						for (int j = i; j < i + 3; j++)
+						for (unsigned j = i; j < i + 3; j++)
 						{
 							int pIdx = 0;
 							int nIdx = 0;
@@ -269,13 +325,15 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 								tIdx = v[j].z - 1;
 							}
 
+							glm::vec3 normal = nIdx >= 0 ? normals[nIdx] : glm::vec3(0.0f);
+
 							vpnt.push_back(glsh::VertexPositionNormalTexture(
 								positions[pIdx].x,
 								positions[pIdx].y,
 								positions[pIdx].z,
-								normals[nIdx].x,
-								normals[nIdx].y,
-								normals[nIdx].z,
+								normal.x,
+								normal.y,
+								normal.z,
 								texcoords[tIdx].x,
 								texcoords[tIdx].y
 							));
@@ -287,56 +345,126 @@ glsh::Mesh* LoadWavefrontOBJ(const std::string& path)
 		}
 	}
 
-	if (!vpn.empty())
+	return true;
+}
+
+// weld identical soup vertices into an indexed mesh, fill in missing normals and optimize it
+template <typename VertexType>
+static glsh::MeshBounds IndexVertices(const std::vector<VertexType>& soup, bool missingNormals,
+	std::vector<VertexType>& vertices, std::vector<unsigned int>& indices)
+{
+	for (auto & v : soup)
 	{
-		std::vector<glsh::VertexPositionNormal> finalVPN = std::vector<glsh::VertexPositionNormal>();
-		std::vector<unsigned int> indices = std::vector<unsigned int>();
-		// for each vertex in vpn
-		for (auto & v : vpn)
-		{
-			int pos = std::find(finalVPN.begin(), finalVPN.end(), v) - finalVPN.begin();
+		size_t pos = std::find(vertices.begin(), vertices.end(), v) - vertices.begin();
 
-			// does not exist
-			if (pos >= finalVPN.size())
-			{
-				finalVPN.push_back(v);
-				indices.push_back(finalVPN.size() - 1);
-			}
-			// does exist
-			else
-			{
-				indices.push_back(pos);
-			}
+		// does not exist
+		if (pos >= vertices.size())
+		{
+			vertices.push_back(v);
+			indices.push_back(vertices.size() - 1);
 		}
+		// does exist
+		else
+		{
+			indices.push_back(pos);
+		}
+	}
+
+	// faces that gave normals keep them, even where they share a position with faces that didn't
+	if (missingNormals)
+	{
+		glsh::GenerateMissingNormals(vertices, indices);
+	}
+
+	return OptimizeLoadedMesh(vertices, indices);
+}
+
+template <typename VertexType>
+static glsh::Mesh* CreateLoadedMesh(const std::vector<VertexType>& vertices, const std::vector<unsigned int>& indices,
+	const glsh::MeshBounds& bounds, bool packed)
+{
+	glsh::Mesh* mesh = packed ? glsh::CreatePackedMesh(GL_TRIANGLES, vertices, indices) : glsh::CreateMesh(GL_TRIANGLES, vertices, indices);
+	if (mesh)
+	{
+		mesh->setBounds(bounds);
+	}
+	return mesh;
+}
 
-		glsh::IndexedMesh* mesh = glsh::CreateMesh(GL_TRIANGLES, finalVPN, indices);
-		return mesh;
+template <typename ArenaVertexType, typename VertexType>
+static glsh::ArenaMesh* AddLoadedMesh(glsh::MeshArena& arena, const std::vector<ArenaVertexType>& arenaVertices,
+	const std::vector<VertexType>& vertices, const std::vector<unsigned int>& indices,
+	const glsh::MeshBounds& bounds, int numLODs, bool packed)
+{
+	glsh::ArenaMesh* mesh = packed ? AddPackedMesh(&arena, vertices, indices) : arena.AddMesh(GL_TRIANGLES, arenaVertices, indices);
+	if (mesh)
+	{
+		mesh->setBounds(bounds);
+		AddLODs(&arena, mesh, vertices, indices, numLODs);
+	}
+	return mesh;
+}
+
+glsh::Mesh* LoadWavefrontOBJ(const std::string& path, bool packed)
+{
+	std::vector<glsh::VertexPositionNormal> vpn;
+	std::vector<glsh::VertexPositionNormalTexture> vpnt;
+	bool missingNormals;
+	if (!ReadWavefront(path, vpn, vpnt, missingNormals))
+	{
+		return nullptr;
+	}
+
+	std::vector<unsigned int> indices;
+	if (!vpn.empty())
+	{
+		std::vector<glsh::VertexPositionNormal> vertices;
+		glsh::MeshBounds bounds = IndexVertices(vpn, missingNormals, vertices, indices);
+		return CreateLoadedMesh(vertices, indices, bounds, packed);
 	}
 	else if (!vpnt.empty())
 	{
-		std::vector<glsh::VertexPositionNormalTexture> finalVPNT = std::vector<glsh::VertexPositionNormalTexture>();
-		std::vector<unsigned int> indices = std::vector<unsigned int>();
-		// for each vertex in vpn
-		for (auto & v : vpnt)
-		{
-			int pos = std::find(finalVPNT.begin(), finalVPNT.end(), v) - finalVPNT.begin();
+		std::vector<glsh::VertexPositionNormalTexture> vertices;
+		glsh::MeshBounds bounds = IndexVertices(vpnt, missingNormals, vertices, indices);
+		return CreateLoadedMesh(vertices, indices, bounds, packed);
+	}
 
-			// does not exist
-			if (pos >= finalVPNT.size())
-			{
-				finalVPNT.push_back(v);
-				indices.push_back(finalVPNT.size() - 1);
-			}
-			// does exist
-			else
+	return nullptr;
+}
+
+glsh::ArenaMesh* LoadWavefrontOBJ(const std::string& path, glsh::MeshArena& arena, int numLODs, bool packed)
+{
+	std::vector<glsh::VertexPositionNormal> vpn;
+	std::vector<glsh::VertexPositionNormalTexture> vpnt;
+	bool missingNormals;
+	if (!ReadWavefront(path, vpn, vpnt, missingNormals))
+	{
+		return nullptr;
+	}
+
+	std::vector<unsigned int> indices;
+	if (!vpn.empty())
+	{
+		std::vector<glsh::VertexPositionNormal> vertices;
+		glsh::MeshBounds bounds = IndexVertices(vpn, missingNormals, vertices, indices);
+
+		// an arena holds a single vertex format, so unpacked meshes without texcoords get (0, 0)
+		std::vector<glsh::VertexPositionNormalTexture> widened;
+		if (!packed)
+		{
+			widened.reserve(vertices.size());
+			for (auto & v : vertices)
 			{
-				indices.push_back(pos);
+				widened.push_back(glsh::VertexPositionNormalTexture(v.pos.x, v.pos.y, v.pos.z, v.normal.x, v.normal.y, v.normal.z, 0.0f, 0.0f));
 			}
 		}
-
-		glsh::IndexedMesh* mesh = glsh::CreateMesh(GL_TRIANGLES, finalVPNT, indices);
-
-		return mesh;
+		return AddLoadedMesh(arena, widened, vertices, indices, bounds, numLODs, packed);
+	}
+	else if (!vpnt.empty())
+	{
+		std::vector<glsh::VertexPositionNormalTexture> vertices;
+		glsh::MeshBounds bounds = IndexVertices(vpnt, missingNormals, vertices, indices);
+		return AddLoadedMesh(arena, vertices, vertices, indices, bounds, numLODs, packed);
 	}
 
 	return nullptr;
@@ -3,6 +3,12 @@
 
 #include "GLSH.h"
 
-glsh::Mesh* LoadWavefrontOBJ(const std::string& path);
+// with packed set, vertices are stored as VertexPackedPositionNormalTexture (see Mesh::getQuantization)
+glsh::Mesh* LoadWavefrontOBJ(const std::string& path, bool packed = false);
+
+// loads into a shared arena instead of a mesh with its own buffers; the arena must use VertexPositionNormalTexture,
+// or VertexPackedPositionNormalTexture if packed is set.
+// With numLODs > 1, simplified levels of detail are added after the mesh (see ArenaMesh::getLOD).
+glsh::ArenaMesh* LoadWavefrontOBJ(const std::string& path, glsh::MeshArena& arena, int numLODs = 1, bool packed = false);
 
 #endif
@@ -4,14 +4,27 @@
 // for the lazy people
 #include "GLSH_Math.h"
 #include "GLSH_Mesh.h"
+#include "GLSH_MeshArena.h"
+#include "GLSH_MeshOptimize.h"
+#include "GLSH_MeshSimplify.h"
+#include "GLSH_DynamicBuffer.h"
 #include "GLSH_Shaders.h"
 #include "GLSH_System.h"
 #include "GLSH_Util.h"
 #include "GLSH_Vertex.h"
 #include "GLSH_Prefabs.h"
+#include "GLSH_Profiler.h"
+#include "GLSH_GLStats.h"
+#include "GLSH_GLTrace.h"
+#include "GLSH_GLDebug.h"
+#include "GLSH_Memory.h"
+#include "GLSH_Telemetry.h"
+#include "GLSH_InputLog.h"
 #include "GLSH_Camera.h"
 #include "GLSH_Image.h"
 #include "GLSH_Texture.h"
+#include "GLSH_Atlas.h"
 #include "GLSH_Text.h"
+#include "GLSH_UIBatch.h"
 
 #endif
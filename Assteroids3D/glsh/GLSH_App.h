@@ -3,6 +3,8 @@
 
 #include "GLSH_Event.h"
 
+#include <cstdint>
+
 namespace glsh {
 
 // forward declarations
@@ -39,6 +41,10 @@ public:
     virtual void        onMouseMotion(const MouseMotionEvent& mbe)  {}
     virtual void        onMouseScroll(const MouseScrollEvent& mbe)  {}
 
+    // a hash of the simulation state, logged after each update while recording or replaying input
+    // (GLSH_InputLog.h) so a replay can tell when it stopped following the recording
+    virtual uint32_t    getStateChecksum() const    { return 0; }
+
 
     //
     // some useful stuff
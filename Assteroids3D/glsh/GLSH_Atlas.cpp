@@ -0,0 +1,487 @@
+#include "GLSH_Atlas.h"
+#include "GLSH_GLDebug.h"
+#include "GLSH_Memory.h"
+
+#include "tinyxml2.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace glsh {
+
+//
+// SkylinePacker
+//
+
+SkylinePacker::SkylinePacker(int width, int height, int padding)
+    : mWidth(width)
+    , mHeight(height)
+    , mPadding(padding)
+    , mUsedArea(0)
+{
+    Reset();
+}
+
+void SkylinePacker::Reset()
+{
+    mSkyline.clear();
+
+    // the bin is one padding wider and taller so rectangles can touch the far edges
+    Segment seg = { 0, 0, mWidth + mPadding };
+    mSkyline.push_back(seg);
+
+    mUsedArea = 0;
+}
+
+int SkylinePacker::fitSegment(int index, int w, int h) const
+{
+    int x = mSkyline[index].x;
+    if (x + w > mWidth + mPadding) {
+        return -1;
+    }
+
+    // the rectangle rests on the highest segment it spans
+    int y = 0;
+    int widthLeft = w;
+    for (int i = index; widthLeft > 0; i++) {
+        y = std::max(y, mSkyline[i].y);
+        if (y + h > mHeight + mPadding) {
+            return -1;
+        }
+        widthLeft -= mSkyline[i].w;
+    }
+
+    return y;
+}
+
+void SkylinePacker::addSegment(int index, int x, int y, int w, int h)
+{
+    Segment seg = { x, y + h, w };
+    mSkyline.insert(mSkyline.begin() + index, seg);
+
+    // trim the segments now covered by the new one
+    for (int i = index + 1; i < (int)mSkyline.size(); ) {
+        Segment& prev = mSkyline[i - 1];
+        Segment& cur = mSkyline[i];
+
+        int overlap = prev.x + prev.w - cur.x;
+        if (overlap <= 0) {
+            break;
+        }
+
+        cur.x += overlap;
+        cur.w -= overlap;
+        if (cur.w <= 0) {
+            mSkyline.erase(mSkyline.begin() + i);
+        } else {
+            break;
+        }
+    }
+
+    // merge neighbours at the same height
+    for (int i = 0; i + 1 < (int)mSkyline.size(); ) {
+        if (mSkyline[i].y == mSkyline[i + 1].y) {
+            mSkyline[i].w += mSkyline[i + 1].w;
+            mSkyline.erase(mSkyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+}
+
+bool SkylinePacker::Pack(int w, int h, int* x_ret, int* y_ret)
+{
+    // rectangles are kept mPadding texels apart
+    int pw = w + mPadding;
+    int ph = h + mPadding;
+
+    int bestIndex = -1;
+    int bestBottom = mHeight + mPadding + 1;
+    int bestWidth = mWidth + mPadding + 1;
+    int bestY = 0;
+
+    // bottom-left heuristic: lowest resulting top edge, then the narrowest segment
+    for (int i = 0; i < (int)mSkyline.size(); i++) {
+        int y = fitSegment(i, pw, ph);
+        if (y < 0) {
+            continue;
+        }
+        int bottom = y + ph;
+        if (bottom < bestBottom || (bottom == bestBottom && mSkyline[i].w < bestWidth)) {
+            bestIndex = i;
+            bestBottom = bottom;
+            bestWidth = mSkyline[i].w;
+            bestY = y;
+        }
+    }
+
+    if (bestIndex < 0) {
+        return false;
+    }
+
+    int x = mSkyline[bestIndex].x;
+    addSegment(bestIndex, x, bestY, pw, ph);
+
+    mUsedArea += w * h;
+
+    *x_ret = x;
+    *y_ret = bestY;
+    return true;
+}
+
+
+//
+// TextureAtlas
+//
+
+TextureAtlas::TextureAtlas(int padding)
+    : mTex(0)
+    , mPadding(padding)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    clearSources();
+
+    if (mTex) {
+        UntrackGPUMemory(GPU_TEXTURE, mTex);
+        glDeleteTextures(1, &mTex);
+    }
+}
+
+void TextureAtlas::clearSources()
+{
+    for (unsigned i = 0; i < mSources.size(); i++) {
+        delete mSources[i].img;
+    }
+    mSources.clear();
+}
+
+bool TextureAtlas::AddImage(const std::string& name, const Image& img)
+{
+    if (!img.isGood()) {
+        std::cerr << "*** Can't add empty image " << name << " to atlas" << std::endl;
+        return false;
+    }
+
+    int bpp = img.getBytesPerPixel();
+    int w = img.getWidth();
+    int h = img.getHeight();
+
+    // store the source as RGBA so Build can blit without caring about the format
+    Source src;
+    src.name = name;
+    src.img = new Image;
+    src.img->Allocate(w, h, 4);
+
+    const unsigned char* p = img.getData();
+    unsigned char* q = src.img->getData();
+    for (int i = 0; i < w * h; i++, p += bpp, q += 4) {
+        switch (bpp) {
+        case 1:     q[0] = q[1] = q[2] = p[0];  q[3] = 255;     break;
+        case 2:     q[0] = q[1] = q[2] = p[0];  q[3] = p[1];    break;
+        case 3:     q[0] = p[0]; q[1] = p[1]; q[2] = p[2]; q[3] = 255;  break;
+        default:    q[0] = p[0]; q[1] = p[1]; q[2] = p[2]; q[3] = p[3]; break;
+        }
+    }
+
+    mSources.push_back(src);
+    return true;
+}
+
+bool TextureAtlas::AddImageFile(const std::string& name, const std::string& path)
+{
+    Image img;
+    if (!img.LoadTarga(path)) {
+        std::cerr << "*** Failed to load " << path << " for atlas" << std::endl;
+        return false;
+    }
+    return AddImage(name, img);
+}
+
+bool TextureAtlas::Build(int maxSize)
+{
+    if (mSources.empty()) {
+        std::cerr << "*** Nothing to pack in atlas" << std::endl;
+        return false;
+    }
+
+    // tallest first packs best with a skyline
+    std::vector<int> order(mSources.size());
+    int area = 0;
+    int minWidth = 1, minHeight = 1;
+    for (unsigned i = 0; i < mSources.size(); i++) {
+        order[i] = i;
+        const Image* img = mSources[i].img;
+        area += (img->getWidth() + mPadding) * (img->getHeight() + mPadding);
+        minWidth = std::max(minWidth, img->getWidth());
+        minHeight = std::max(minHeight, img->getHeight());
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        const Image* ia = mSources[a].img;
+        const Image* ib = mSources[b].img;
+        if (ia->getHeight() != ib->getHeight()) {
+            return ia->getHeight() > ib->getHeight();
+        }
+        return ia->getWidth() > ib->getWidth();
+    });
+
+    // candidate power-of-two sizes that can hold the largest image and the total area,
+    // smallest area first and squarest first within the same area
+    std::vector<std::pair<int, int> > sizes;
+    for (int width = 1; width <= maxSize; width *= 2) {
+        for (int height = 1; height <= maxSize; height *= 2) {
+            if (width >= minWidth && height >= minHeight && width * height >= area) {
+                sizes.push_back(std::make_pair(width, height));
+            }
+        }
+    }
+    std::sort(sizes.begin(), sizes.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        if (a.first * a.second != b.first * b.second) {
+            return a.first * a.second < b.first * b.second;
+        }
+        return std::abs(a.first - a.second) < std::abs(b.first - b.second);
+    });
+
+    std::vector<Entry> entries(mSources.size());
+
+    int width = 0, height = 0;
+    for (unsigned k = 0; k < sizes.size() && !width; k++) {
+        SkylinePacker packer(sizes[k].first, sizes[k].second, mPadding);
+        bool fits = true;
+        for (unsigned i = 0; i < order.size() && fits; i++) {
+            const Source& src = mSources[order[i]];
+            Entry& e = entries[order[i]];
+            e.name = src.name;
+            e.w = src.img->getWidth();
+            e.h = src.img->getHeight();
+            fits = packer.Pack(e.w, e.h, &e.x, &e.y);
+        }
+
+        if (fits) {
+            width = packer.getWidth();
+            height = packer.getHeight();
+            std::cout << "Packed " << entries.size() << " images into " << width << "x" << height
+                      << " atlas (" << (int)(100 * packer.getOccupancy()) << "% used)" << std::endl;
+        }
+    }
+
+    if (!width) {
+        std::cerr << "*** Atlas doesn't fit in " << maxSize << "x" << maxSize << std::endl;
+        return false;
+    }
+
+    mImage.Allocate(width, height, 4);
+    std::fill(mImage.getData(), mImage.getData() + width * height * 4, 0);
+
+    // blit each entry and replicate its border into the gutter to avoid bleeding when filtering
+    int gutter = mPadding / 2;
+    unsigned char* dst = mImage.getData();
+    for (unsigned i = 0; i < entries.size(); i++) {
+        const Entry& e = entries[i];
+        const unsigned char* src = mSources[i].img->getData();
+
+        int y0 = std::max(e.y - gutter, 0);
+        int y1 = std::min(e.y + e.h + gutter, height);
+        int x0 = std::max(e.x - gutter, 0);
+        int x1 = std::min(e.x + e.w + gutter, width);
+
+        for (int y = y0; y < y1; y++) {
+            // both images store rows bottom-up, entry coordinates are top-down
+            int sy = std::min(std::max(y - e.y, 0), e.h - 1);
+            const unsigned char* srcRow = src + (e.h - 1 - sy) * e.w * 4;
+            unsigned char* dstRow = dst + (height - 1 - y) * width * 4;
+
+            for (int x = x0; x < x1; x++) {
+                int sx = std::min(std::max(x - e.x, 0), e.w - 1);
+                const unsigned char* p = srcRow + sx * 4;
+                unsigned char* q = dstRow + x * 4;
+                q[0] = p[0];
+                q[1] = p[1];
+                q[2] = p[2];
+                q[3] = p[3];
+            }
+        }
+    }
+
+    mEntries = entries;
+    mEntryIndex.clear();
+    for (unsigned i = 0; i < mEntries.size(); i++) {
+        mEntryIndex[mEntries[i].name] = i;
+    }
+
+    clearSources();
+    return true;
+}
+
+bool TextureAtlas::Save(const std::string& name) const
+{
+    if (!mImage.isGood()) {
+        std::cerr << "*** Atlas has not been built" << std::endl;
+        return false;
+    }
+
+    std::string textureFilename = name + ".tga";
+    std::string entriesFilename = name + ".xml";
+
+    if (!mImage.SaveTarga(textureFilename)) {
+        std::cerr << "*** Failed to save " << textureFilename << std::endl;
+        return false;
+    }
+
+    using namespace tinyxml2;
+
+    XMLDocument doc;
+    doc.InsertEndChild(doc.NewDeclaration());
+
+    XMLElement* root = doc.NewElement("textureAtlas");
+    root->SetAttribute("width", mImage.getWidth());
+    root->SetAttribute("height", mImage.getHeight());
+    root->SetAttribute("padding", mPadding);
+    doc.InsertEndChild(root);
+
+    for (unsigned i = 0; i < mEntries.size(); i++) {
+        const Entry& e = mEntries[i];
+        XMLElement* elem = doc.NewElement("entry");
+        elem->SetAttribute("name", e.name.c_str());
+        elem->SetAttribute("x", e.x);
+        elem->SetAttribute("y", e.y);
+        elem->SetAttribute("w", e.w);
+        elem->SetAttribute("h", e.h);
+        root->InsertEndChild(elem);
+    }
+
+    if (doc.SaveFile(entriesFilename.c_str()) != XML_NO_ERROR) {
+        std::cerr << "*** Failed to save " << entriesFilename << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool TextureAtlas::Load(const std::string& name)
+{
+    std::string textureFilename = name + ".tga";
+    std::string entriesFilename = name + ".xml";
+
+    using namespace tinyxml2;
+
+    XMLDocument doc;
+    if (doc.LoadFile(entriesFilename.c_str()) != XML_NO_ERROR) {
+        return false;
+    }
+
+    XMLElement* root = doc.FirstChildElement("textureAtlas");
+    if (!root) {
+        std::cerr << "*** No textureAtlas element in " << entriesFilename << std::endl;
+        return false;
+    }
+
+    if (!mImage.LoadTarga(textureFilename)) {
+        std::cerr << "*** Failed to load " << textureFilename << std::endl;
+        return false;
+    }
+
+    if (mImage.getWidth() != root->IntAttribute("width") || mImage.getHeight() != root->IntAttribute("height")) {
+        std::cerr << "*** " << textureFilename << " doesn't match " << entriesFilename << std::endl;
+        return false;
+    }
+
+    root->QueryIntAttribute("padding", &mPadding);
+
+    mEntries.clear();
+    mEntryIndex.clear();
+
+    XMLElement* elem = root->FirstChildElement("entry");
+    for ( ; elem; elem = elem->NextSiblingElement("entry")) {
+        Entry e;
+        const char* namestr = elem->Attribute("name");
+        e.name = namestr ? namestr : "";
+        e.x = elem->IntAttribute("x");
+        e.y = elem->IntAttribute("y");
+        e.w = elem->IntAttribute("w");
+        e.h = elem->IntAttribute("h");
+
+        mEntryIndex[e.name] = (int)mEntries.size();
+        mEntries.push_back(e);
+    }
+
+    std::cout << "Loaded atlas " << name << " with " << mEntries.size() << " entries" << std::endl;
+    return true;
+}
+
+GLuint TextureAtlas::CreateTexture(bool genMipmaps, bool compress)
+{
+    if (mTex) {
+        return mTex;
+    }
+
+    if (!mImage.isGood()) {
+        std::cerr << "*** Atlas has not been built" << std::endl;
+        return 0;
+    }
+
+    if (genMipmaps && !mImage.GenerateMipmaps(1)) {
+        std::cerr << "*** Oops, not generating atlas mipmaps" << std::endl;
+    }
+
+    CompressedImage cimg;
+    if (compress && mImage.Compress(&cimg, COMPRESSED_BC3)) {
+        TextureUploadStats stats;
+        mTex = CreateTexture2D(cimg, &stats);
+        stats.uncompressedBytes = GetImageSizeInBytes(mImage);
+        if (mTex) {
+            ReportTextureUpload("atlas", stats);
+        }
+    } else {
+        mTex = CreateTexture2D(mImage, genMipmaps);
+    }
+    LabelGLObject(GL_TEXTURE, mTex, "atlas");
+
+    return mTex;
+}
+
+const TextureAtlas::Entry* TextureAtlas::findEntry(const std::string& name) const
+{
+    std::map<std::string, int>::const_iterator it = mEntryIndex.find(name);
+    if (it == mEntryIndex.end()) {
+        return NULL;
+    }
+    return &mEntries[it->second];
+}
+
+glm::vec2 TextureAtlas::RemapTexCoord(const Entry& e, const glm::vec2& uv) const
+{
+    // uv is relative to the entry's source image; v runs bottom-up as in GL
+    float width = (float)mImage.getWidth();
+    float height = (float)mImage.getHeight();
+    float bottom = height - (e.y + e.h);
+
+    return glm::vec2((e.x + uv.x * e.w) / width, (bottom + uv.y * e.h) / height);
+}
+
+TexRect TextureAtlas::RemapTexRect(const Entry& e, const TexRect& r) const
+{
+    glm::vec2 bottomLeft = RemapTexCoord(e, glm::vec2(r.uLeft, r.vBottom));
+    glm::vec2 topRight = RemapTexCoord(e, glm::vec2(r.uRight, r.vTop));
+
+    TexRect ret;
+    ret.w = r.w;
+    ret.h = r.h;
+    ret.uLeft = bottomLeft.x;
+    ret.vBottom = bottomLeft.y;
+    ret.uRight = topRight.x;
+    ret.vTop = topRight.y;
+    return ret;
+}
+
+void TextureAtlas::RemapTexCoords(const Entry& e, std::vector<VPT>& verts) const
+{
+    for (unsigned i = 0; i < verts.size(); i++) {
+        verts[i].texcoord = RemapTexCoord(e, verts[i].texcoord);
+    }
+}
+
+} // end of namespace
@@ -0,0 +1,112 @@
+#ifndef GLSH_ATLAS_H_
+#define GLSH_ATLAS_H_
+
+#include "GLSH_Image.h"
+#include "GLSH_Texture.h"
+#include "GLSH_Vertex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glsh {
+
+//
+// Skyline bottom-left rectangle packer.
+// Coordinates are in texels with the origin at the top-left corner, same as TextureSpace.
+// Packed rectangles are kept at least padding texels apart, but may touch the bin edges.
+//
+class SkylinePacker {
+
+    struct Segment {
+        int x, y, w;    // a horizontal span of the skyline at height y
+    };
+
+    int                     mWidth, mHeight;
+    int                     mPadding;
+    int                     mUsedArea;
+    std::vector<Segment>    mSkyline;
+
+    int                     fitSegment(int index, int w, int h) const;     // returns y, or -1 if it doesn't fit
+    void                    addSegment(int index, int x, int y, int w, int h);
+
+public:
+                            SkylinePacker(int width, int height, int padding = 1);
+
+    void                    Reset();
+
+    // find room for a w x h rectangle, returns false if the packer is full
+    bool                    Pack(int w, int h, int* x_ret, int* y_ret);
+
+    int                     getWidth() const            { return mWidth; }
+    int                     getHeight() const           { return mHeight; }
+    float                   getOccupancy() const        { return mUsedArea / (float)(mWidth * mHeight); }
+};
+
+
+//
+// A set of images packed into one texture.
+//
+// Build at runtime from images (AddImage/AddImageFile + Build), or build offline,
+// Save to <name>.tga/<name>.xml, and Load the result at startup.
+//
+class TextureAtlas {
+public:
+    struct Entry {
+        std::string     name;
+        int             x, y;       // top-left corner in the atlas, in texels
+        int             w, h;       // size in texels (same as the source image)
+    };
+
+private:
+    struct Source {
+        std::string     name;
+        Image*          img;
+    };
+
+    std::vector<Source>             mSources;       // images waiting for Build
+    std::vector<Entry>              mEntries;
+    std::map<std::string, int>      mEntryIndex;
+
+    Image                           mImage;         // RGBA
+    GLuint                          mTex;
+    int                             mPadding;       // texels between entries, half of it is filled with edge texels
+
+    void                            clearSources();
+
+public:
+                                    TextureAtlas(int padding = 2);
+                                    ~TextureAtlas();
+
+    // queue images for packing (the atlas makes its own copy)
+    bool                            AddImage(const std::string& name, const Image& img);
+    bool                            AddImageFile(const std::string& name, const std::string& path);
+
+    // pack all queued images into the smallest power-of-two atlas up to maxSize
+    bool                            Build(int maxSize = 2048);
+
+    // offline cooking: <name>.tga holds the texels and <name>.xml the entries
+    bool                            Save(const std::string& name) const;
+    bool                            Load(const std::string& name);
+
+    // create the GL texture (the atlas owns it)
+    GLuint                          CreateTexture(bool genMipmaps, bool compress = false);
+    GLuint                          getTex() const              { return mTex; }
+
+    int                             getWidth() const            { return mImage.getWidth(); }
+    int                             getHeight() const           { return mImage.getHeight(); }
+    const Image&                    getImage() const            { return mImage; }
+
+    int                             numEntries() const          { return (int)mEntries.size(); }
+    const Entry&                    getEntry(int i) const       { return mEntries[i]; }
+    const Entry*                    findEntry(const std::string& name) const;
+
+    // map coordinates relative to an entry's source image into atlas coordinates
+    glm::vec2                       RemapTexCoord(const Entry& e, const glm::vec2& uv) const;
+    TexRect                         RemapTexRect(const Entry& e, const TexRect& r) const;
+    void                            RemapTexCoords(const Entry& e, std::vector<VPT>& verts) const;
+};
+
+} // end of namespace
+
+#endif
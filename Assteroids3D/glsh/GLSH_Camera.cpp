@@ -18,12 +18,12 @@ FreeLookCamera::FreeLookCamera(App* app)
     , mOrthographic(false)
     , mNear(0.1f)
     , mFar(1000.0f)
-    , mFOV(50.0f)
     , mViewWidth(0) // ??
     , mViewHeight(0)
     , mSpeed(5)                         // world units / second
     , mMouseSpeed(PI / 1000.0f)         // radians / pixel
     , mOrientationChanged(false)
+    , mFOV(50.0f)
 {
     updateOrientation();
 }
@@ -178,6 +178,12 @@ glm::mat4 FreeLookCamera::getProjectionMatrix() const
     }
 }
 
+float FreeLookCamera::getProjectionScale(float screenHeight) const
+{
+    // [1][1] maps view-space y to NDC, which spans two units across the viewport height
+    return 0.5f * screenHeight * getProjectionMatrix()[1][1];
+}
+
 glm::mat4 FreeLookCamera::getViewMatrix() const
 {
     return glm::lookAt(mPosition, mPosition + mForward, mUp);
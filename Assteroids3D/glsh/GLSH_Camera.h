@@ -115,6 +115,13 @@ public:
     virtual glm::mat4   getViewMatrix() const override;
     virtual glm::mat4   getProjectionMatrix() const override;
 
+    // pixels covered by one world unit at distance 1 (perspective) or anywhere (orthographic),
+    // for a viewport screenHeight pixels tall; compute once per frame for getScreenRadius
+    float               getProjectionScale(float screenHeight) const;
+
+    // approximate radius in pixels of a sphere's projection
+    float               getScreenRadius(const glm::vec3& center, float radius, float projectionScale) const;
+
     virtual void        update(float deltaT) override;
 
 	// useful in perspective mode
@@ -122,6 +129,17 @@ public:
 };
 
 
+inline float FreeLookCamera::getScreenRadius(const glm::vec3& center, float radius, float projectionScale) const
+{
+    if (mOrthographic) {
+        return radius * projectionScale;
+    }
+
+    // spheres reaching the near plane are as big as they get
+    float depth = glm::dot(center - mPosition, mForward);
+    return radius * projectionScale / glm::max(depth, mNear);
+}
+
 inline glm::vec3 FreeLookCamera::getPosition() const
 {
     return mPosition;
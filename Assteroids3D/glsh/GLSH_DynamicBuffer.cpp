@@ -0,0 +1,212 @@
+#include "GLSH_DynamicBuffer.h"
+#include "GLSH_GLDebug.h"
+#include "GLSH_GLStats.h"
+#include "GLSH_Memory.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace glsh {
+
+DynamicBuffer::DynamicBuffer(GLenum target)
+    : mTarget(target)
+    , mBuffer(0)
+    , mRegionSize(0)
+    , mNumRegions(0)
+    , mRegion(0)
+    , mOffset(0)
+    , mMapped(NULL)
+    , mPersistent(false)
+    , mNeedOrphan(true)
+{
+    for (int i = 0; i < 4; i++) {
+        mFences[i] = 0;
+    }
+}
+
+DynamicBuffer::~DynamicBuffer()
+{
+    Destroy();
+}
+
+bool DynamicBuffer::Create(GLsizeiptr regionSize, int numRegions)
+{
+    Destroy();
+
+    if (numRegions < 1) {
+        numRegions = 1;
+    } else if (numRegions > 4) {
+        numRegions = 4;
+    }
+
+    return create(regionSize, numRegions);
+}
+
+bool DynamicBuffer::create(GLsizeiptr regionSize, int numRegions)
+{
+    mPersistent = GLEW_ARB_buffer_storage != 0;
+    mNumRegions = mPersistent ? numRegions : 1;
+    mRegionSize = regionSize;
+    mRegion = 0;
+    mOffset = 0;
+    mNeedOrphan = true;
+
+    glGenBuffers(1, &mBuffer);
+    if (!mBuffer) {
+        std::cerr << "*** Failed to create dynamic buffer" << std::endl;
+        return false;
+    }
+
+    glBindBuffer(mTarget, mBuffer);
+
+    GLsizeiptr totalSize = mRegionSize * mNumRegions;
+
+    if (mPersistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(mTarget, totalSize, NULL, flags);
+        mMapped = (unsigned char*)glMapBufferRange(mTarget, 0, totalSize, flags);
+        if (!mMapped) {
+            // some drivers advertise the extension but refuse the mapping
+            std::cerr << "*** Persistent mapping failed, falling back to orphaning" << std::endl;
+            glDeleteBuffers(1, &mBuffer);
+            glGenBuffers(1, &mBuffer);
+            glBindBuffer(mTarget, mBuffer);
+            mPersistent = false;
+            mNumRegions = 1;
+            totalSize = mRegionSize;
+        }
+    }
+
+    if (!mPersistent) {
+        glBufferData(mTarget, totalSize, NULL, GL_STREAM_DRAW);
+    }
+
+    TrackGPUMemory(GPU_STREAM_BUFFER, mBuffer, totalSize);
+    LabelGLObject(GL_BUFFER, mBuffer, mTarget == GL_DRAW_INDIRECT_BUFFER ? "dynamic indirect buffer" : "dynamic buffer");
+
+    return true;
+}
+
+void DynamicBuffer::Destroy()
+{
+    for (int i = 0; i < 4; i++) {
+        if (mFences[i]) {
+            glDeleteSync(mFences[i]);
+            mFences[i] = 0;
+        }
+    }
+
+    if (mBuffer) {
+        if (mMapped) {
+            glBindBuffer(mTarget, mBuffer);
+            glUnmapBuffer(mTarget);
+            mMapped = NULL;
+        }
+        UntrackGPUMemory(GPU_STREAM_BUFFER, mBuffer);
+        glDeleteBuffers(1, &mBuffer);
+        mBuffer = 0;
+    }
+
+    mRegionSize = 0;
+    mOffset = 0;
+}
+
+void DynamicBuffer::waitForRegion(int region)
+{
+    GLsync fence = mFences[region];
+    if (!fence) {
+        return;
+    }
+
+    // the first wait flushes so the fence is guaranteed to signal
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;) {
+        GLenum status = glClientWaitSync(fence, flags, 1000000);    // 1 ms
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) {
+            break;
+        }
+        flags = 0;
+    }
+
+    glDeleteSync(fence);
+    mFences[region] = 0;
+}
+
+bool DynamicBuffer::grow(GLsizeiptr minRegionSize)
+{
+    GLsizeiptr newSize = mRegionSize ? mRegionSize : 4096;
+    while (newSize < minRegionSize) {
+        newSize *= 2;
+    }
+
+    std::cout << "Growing dynamic buffer to " << newSize / 1024 << " KB per frame" << std::endl;
+
+    // the old storage can't be resized, and every region may still be in use
+    for (int i = 0; i < mNumRegions; i++) {
+        waitForRegion(i);
+    }
+
+    int numRegions = mNumRegions;
+    Destroy();
+    return create(newSize, numRegions);
+}
+
+GLintptr DynamicBuffer::Write(const void* data, GLsizeiptr size, GLsizeiptr alignment)
+{
+    if (!mBuffer || size <= 0) {
+        return -1;
+    }
+
+    GLsizeiptr start = (mOffset + alignment - 1) / alignment * alignment;
+    if (start + size > mRegionSize) {
+        if (!grow(start + size)) {
+            return -1;
+        }
+        start = 0;
+    }
+
+    GLintptr offset = mRegion * mRegionSize + start;
+
+    glBindBuffer(mTarget, mBuffer);
+
+    if (mPersistent) {
+        std::memcpy(mMapped + offset, data, size);
+        TraceMappedWrite(mTarget, offset, data, size);
+    } else {
+        if (mNeedOrphan) {
+            // give the driver fresh storage instead of stalling on last frame's draws
+            glBufferData(mTarget, mRegionSize, NULL, GL_STREAM_DRAW);
+            mNeedOrphan = false;
+        }
+        glBufferSubData(mTarget, offset, size, data);
+    }
+    CountBufferUpload(size);
+
+    mOffset = start + size;
+    return offset;
+}
+
+void DynamicBuffer::EndFrame()
+{
+    if (!mBuffer) {
+        return;
+    }
+
+    if (mPersistent) {
+        if (mFences[mRegion]) {
+            glDeleteSync(mFences[mRegion]);
+        }
+        mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        mRegion = (mRegion + 1) % mNumRegions;
+
+        // normally long signaled, since the GPU is at most mNumRegions - 1 frames behind
+        waitForRegion(mRegion);
+    } else {
+        mNeedOrphan = true;
+    }
+
+    mOffset = 0;
+}
+
+} // end of namespace
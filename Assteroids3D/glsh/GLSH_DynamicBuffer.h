@@ -0,0 +1,66 @@
+#ifndef GLSH_DYNAMICBUFFER_H_
+#define GLSH_DYNAMICBUFFER_H_
+
+#include <GL/glew.h>
+#include "GLSH_GLTrace.h"
+
+namespace glsh {
+
+//
+// A ring buffer for geometry that is rewritten every frame.
+//
+// With ARB_buffer_storage the buffer is persistently mapped and split into regions (three by default),
+// one per frame in flight; a fence per region keeps the CPU from overwriting data the GPU is still
+// reading. Without it, the buffer is orphaned at the start of each frame and written with glBufferSubData.
+// Either way, writing doesn't allocate anything in the driver.
+//
+// Write returns the byte offset of the data in getBuffer(); point the attributes there and draw right
+// away, because a Write that doesn't fit grows the buffer and invalidates earlier offsets.
+//
+class DynamicBuffer {
+
+    GLenum                  mTarget;
+    GLuint                  mBuffer;
+
+    GLsizeiptr              mRegionSize;
+    int                     mNumRegions;
+    int                     mRegion;            // region written this frame
+    GLsizeiptr              mOffset;            // next free byte in the current region
+
+    unsigned char*          mMapped;            // persistent mapping, NULL when orphaning
+    GLsync                  mFences[4];
+
+    bool                    mPersistent;
+    bool                    mNeedOrphan;
+
+    bool                    create(GLsizeiptr regionSize, int numRegions);
+    void                    waitForRegion(int region);
+    bool                    grow(GLsizeiptr minRegionSize);
+
+                            DynamicBuffer(const DynamicBuffer&) = delete;
+    DynamicBuffer&          operator=(const DynamicBuffer&) = delete;
+
+public:
+                            DynamicBuffer(GLenum target = GL_ARRAY_BUFFER);
+                            ~DynamicBuffer();
+
+    // size is per frame; numRegions is clamped to 1..4 (1 when orphaning)
+    bool                    Create(GLsizeiptr regionSize, int numRegions = 3);
+    void                    Destroy();
+
+    // copy data into the current frame's region and return its offset in the buffer, or -1 on failure;
+    // leaves the buffer bound to its target
+    GLintptr                Write(const void* data, GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    // fence the current region and move to the next one; call once per frame after the last draw
+    void                    EndFrame();
+
+    GLuint                  getBuffer() const           { return mBuffer; }
+    GLsizeiptr              getRegionSize() const       { return mRegionSize; }
+    GLsizeiptr              getBytesWritten() const     { return mOffset; }        // this frame
+    bool                    isPersistent() const        { return mPersistent; }
+};
+
+} // end of namespace
+
+#endif
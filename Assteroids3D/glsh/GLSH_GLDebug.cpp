@@ -0,0 +1,135 @@
+#include "GLSH_GLDebug.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace glsh {
+
+namespace {
+
+bool                        gInstalled = false;
+
+// the groups open on the GL thread, to say where a message came from
+std::vector<const char*>    gGroupStack;
+
+// the spec guarantees at least this much (GL_MAX_LABEL_LENGTH includes the terminator)
+const size_t                MAX_LABEL_LENGTH = 255;
+
+const char* SourceName(GLenum source)
+{
+    switch (source) {
+    case GL_DEBUG_SOURCE_API:               return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:     return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER:   return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:       return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION:       return "application";
+    default:                                return "other";
+    }
+}
+
+const char* TypeName(GLenum type)
+{
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR:               return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated behavior";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+    case GL_DEBUG_TYPE_MARKER:              return "marker";
+    default:                                return "message";
+    }
+}
+
+const char* SeverityName(GLenum severity)
+{
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH:            return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM:          return "medium";
+    case GL_DEBUG_SEVERITY_LOW:             return "low";
+    default:                                return "note";
+    }
+}
+
+void GLAPIENTRY DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                     GLsizei length, const GLchar* message, const void* userParam)
+{
+    std::cerr << "*** GL " << TypeName(type) << " (" << SeverityName(severity) << ", " << SourceName(source) << " " << id << "): ";
+    if (length >= 0) {
+        std::cerr.write(message, length);
+    } else {
+        std::cerr << message;
+    }
+
+    // only meaningful when messages are synchronous
+    if (GLSH_GL_DEBUG && !gGroupStack.empty()) {
+        std::cerr << "\n    in";
+        for (size_t i = 0; i < gGroupStack.size(); i++) {
+            std::cerr << (i ? " > " : " ") << gGroupStack[i];
+        }
+    }
+    std::cerr << std::endl;
+}
+
+} // end of anonymous namespace
+
+bool InstallGLDebugOutput()
+{
+    if (!GLEW_KHR_debug && !GLEW_VERSION_4_3) {
+        return false;
+    }
+
+    glDebugMessageCallback(DebugMessageCallback, NULL);
+    glEnable(GL_DEBUG_OUTPUT);
+
+    // notifications include every group push and pop, and some drivers describe each buffer placement
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+
+#if GLSH_GL_DEBUG
+    // report from inside the offending call, so a breakpoint in the callback has the culprit on the stack
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+
+    gInstalled = true;
+    return true;
+}
+
+bool HasGLDebugOutput()
+{
+    return gInstalled;
+}
+
+void LabelGLObject(GLenum identifier, GLuint name, const std::string& label)
+{
+#if GLSH_GL_DEBUG
+    if (!gInstalled || !name) {
+        return;
+    }
+
+    // keep the end of long labels; that's where file names differ
+    size_t length = std::min(label.size(), MAX_LABEL_LENGTH);
+    glObjectLabel(identifier, name, (GLsizei)length, label.c_str() + label.size() - length);
+#endif
+}
+
+void PushGLDebugGroup(const char* name)
+{
+#if GLSH_GL_DEBUG
+    if (gInstalled) {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+        gGroupStack.push_back(name);
+    }
+#endif
+}
+
+void PopGLDebugGroup()
+{
+#if GLSH_GL_DEBUG
+    if (gInstalled && !gGroupStack.empty()) {
+        glPopDebugGroup();
+        gGroupStack.pop_back();
+    }
+#endif
+}
+
+} // end of namespace
@@ -0,0 +1,74 @@
+#ifndef GLSH_GLDEBUG_H_
+#define GLSH_GLDEBUG_H_
+
+#include <GL/glew.h>
+#include "GLSH_GLTrace.h"
+
+#include <string>
+
+//
+// GL debug output (GL_KHR_debug)
+//
+//     System::Run installs a message callback as soon as GLEW is up, so the driver reports errors
+//     and warnings when they happen. Polling glGetError instead makes the driver catch up with all
+//     the work queued so far before it can answer.
+//
+//     GLSH_GL_DEBUG_GROUP("name") puts the rest of the enclosing scope in a named debug group, and
+//     LabelGLObject names a buffer, texture, program etc., so frame captures (RenderDoc, Nsight,
+//     apitrace) show draw passes and asset names instead of bare object numbers.
+//
+//     GLSH_GL_DEBUG is 0 in release builds (NDEBUG) unless defined otherwise. Then groups, labels and
+//     glGetError polling (GLSH_CHECK_GL_ERRORS, the checks in mesh and program creation) compile out,
+//     and no debug context is requested. The callback is still installed, for drivers that report
+//     errors on regular contexts, but messages arrive asynchronously there.
+//
+#ifndef GLSH_GL_DEBUG
+#  ifdef NDEBUG
+#    define GLSH_GL_DEBUG 0
+#  else
+#    define GLSH_GL_DEBUG 1
+#  endif
+#endif
+
+namespace glsh {
+
+// returns false if the driver doesn't have GL_KHR_debug (or GL 4.3)
+bool InstallGLDebugOutput();
+
+bool HasGLDebugOutput();
+
+// identifier is GL_BUFFER, GL_TEXTURE, GL_PROGRAM, GL_SHADER, GL_VERTEX_ARRAY, GL_FRAMEBUFFER, ...;
+// the object must have been bound or created already
+void LabelGLObject(GLenum identifier, GLuint name, const std::string& label);
+
+// name must outlive the group (string literals do)
+void PushGLDebugGroup(const char* name);
+void PopGLDebugGroup();
+
+class GLDebugGroup {
+                            GLDebugGroup(const GLDebugGroup&) = delete;
+    GLDebugGroup&           operator=(const GLDebugGroup&) = delete;
+
+public:
+    explicit                GLDebugGroup(const char* name)
+    {
+        PushGLDebugGroup(name);
+    }
+
+                            ~GLDebugGroup()
+    {
+        PopGLDebugGroup();
+    }
+};
+
+} // end of namespace
+
+#if GLSH_GL_DEBUG
+#define GLSH_GL_DEBUG_CONCAT_(a, b)     a##b
+#define GLSH_GL_DEBUG_CONCAT(a, b)      GLSH_GL_DEBUG_CONCAT_(a, b)
+#define GLSH_GL_DEBUG_GROUP(name)       ::glsh::GLDebugGroup GLSH_GL_DEBUG_CONCAT(glshGLDebugGroup, __LINE__)(name)
+#else
+#define GLSH_GL_DEBUG_GROUP(name)       ((void)0)
+#endif
+
+#endif
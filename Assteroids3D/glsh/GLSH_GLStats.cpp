@@ -0,0 +1,143 @@
+#include "GLSH_GLStats.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <unordered_map>
+
+namespace glsh {
+
+GLFrameStats    gCurrentGLFrameStats;
+
+namespace {
+
+GLFrameStats    gLastGLFrameStats;
+unsigned        gFrameNumber = 0;
+
+// a fresh context has both bound to 0
+GLuint          gCurrentProgram = 0;
+GLuint          gCurrentVAO = 0;
+
+// (program, location) -> hash of the last value uploaded
+std::unordered_map<uint64_t, uint64_t>  gUniformValues;
+
+FILE*           gLogFile = NULL;
+
+uint64_t HashBytes(const void* data, size_t size)
+{
+    // FNV-1a
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+} // end of anonymous namespace
+
+void TrackUniform(GLint location, const void* value, size_t size)
+{
+    GLFrameStats& s = gCurrentGLFrameStats;
+    ++s.uniformUploads;
+
+    // uploads to location -1 (optimized out or misspelled) change nothing
+    if (location < 0) {
+        ++s.redundantUniforms;
+        return;
+    }
+
+    uint64_t key = ((uint64_t)gCurrentProgram << 32) | (uint32_t)location;
+    uint64_t hash = HashBytes(value, size) ^ size;
+
+    // only allocates the first time a uniform is seen
+    std::pair<std::unordered_map<uint64_t, uint64_t>::iterator, bool> ins = gUniformValues.insert(std::make_pair(key, hash));
+    if (!ins.second) {
+        if (ins.first->second == hash) {
+            ++s.redundantUniforms;
+        } else {
+            ins.first->second = hash;
+        }
+    }
+}
+
+void TrackProgramBind(GLuint program)
+{
+    GLFrameStats& s = gCurrentGLFrameStats;
+    ++s.programBinds;
+    if (program == gCurrentProgram) {
+        ++s.redundantProgramBinds;
+    }
+    gCurrentProgram = program;
+}
+
+void TrackVAOBind(GLuint vao)
+{
+    GLFrameStats& s = gCurrentGLFrameStats;
+    ++s.vaoBinds;
+    if (vao == gCurrentVAO) {
+        ++s.redundantVAOBinds;
+    }
+    gCurrentVAO = vao;
+}
+
+void EndGLStatsFrame()
+{
+    const GLFrameStats& s = gCurrentGLFrameStats;
+
+    if (gLogFile) {
+        std::fprintf(gLogFile, "%u,%u,%u,%u,%u,%lu,%u,%lu,%u,%u,%u,%u\n", gFrameNumber,
+                     s.drawCalls, s.uniformUploads, s.redundantUniforms,
+                     s.bufferUploads, (unsigned long)s.bufferBytes,
+                     s.textureUploads, (unsigned long)s.textureBytes,
+                     s.programBinds, s.redundantProgramBinds,
+                     s.vaoBinds, s.redundantVAOBinds);
+    }
+
+    gLastGLFrameStats = s;
+    gCurrentGLFrameStats = GLFrameStats();
+    ++gFrameNumber;
+}
+
+const GLFrameStats& GetLastFrameGLStats()
+{
+    return gLastGLFrameStats;
+}
+
+unsigned GetGLStatsFrameNumber()
+{
+    return gFrameNumber;
+}
+
+bool StartGLStatsLog(const std::string& path)
+{
+    StopGLStatsLog();
+
+    gLogFile = std::fopen(path.c_str(), "w");
+    if (!gLogFile) {
+        std::cerr << "*** Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    std::fprintf(gLogFile, "frame,draw_calls,uniform_uploads,redundant_uniforms,buffer_uploads,buffer_bytes,"
+                           "texture_uploads,texture_bytes,program_binds,redundant_program_binds,vao_binds,redundant_vao_binds\n");
+
+    std::cout << "Logging GL stats to " << path << std::endl;
+    return true;
+}
+
+void StopGLStatsLog()
+{
+    if (gLogFile) {
+        std::fclose(gLogFile);
+        gLogFile = NULL;
+    }
+}
+
+bool IsGLStatsLogOpen()
+{
+    return gLogFile != NULL;
+}
+
+} // end of namespace
@@ -0,0 +1,118 @@
+#ifndef GLSH_GLSTATS_H_
+#define GLSH_GLSTATS_H_
+
+#include <GL/glew.h>
+#include "GLSH_GLTrace.h"
+
+#include <cstddef>
+#include <string>
+
+//
+// Per-frame GL call statistics
+//
+//     The glsh draw paths, buffer and texture uploads, and SetShaderUniform count what they submit.
+//     Program and VAO binds go through UseProgram and BindVertexArray, which remember the current
+//     binding; uniforms remember a hash of the last value set per program and location. Calls that
+//     set state to the value it already has are counted as redundant. They are still issued, so a
+//     stale record (a deleted and reused object name, GL calls made behind glsh's back) can only
+//     skew the counts.
+//
+//     System::DisplayCallback closes the frame after swapping buffers, so GetLastFrameGLStats always
+//     describes the last complete frame, and an open CSV log gets one row per frame.
+//     GL calls only come from the thread that owns the context, so nothing here is synchronized.
+//
+//     Build with GLSH_GL_STATS defined to 0 to compile the counting out.
+//
+#ifndef GLSH_GL_STATS
+#define GLSH_GL_STATS 1
+#endif
+
+namespace glsh {
+
+struct GLFrameStats {
+    unsigned    drawCalls;
+    unsigned    uniformUploads;
+    unsigned    redundantUniforms;      // same value as the program already had, or no such uniform
+    unsigned    bufferUploads;
+    size_t      bufferBytes;
+    unsigned    textureUploads;
+    size_t      textureBytes;
+    unsigned    programBinds;
+    unsigned    redundantProgramBinds;
+    unsigned    vaoBinds;
+    unsigned    redundantVAOBinds;
+
+    GLFrameStats()
+        : drawCalls(0), uniformUploads(0), redundantUniforms(0)
+        , bufferUploads(0), bufferBytes(0), textureUploads(0), textureBytes(0)
+        , programBinds(0), redundantProgramBinds(0), vaoBinds(0), redundantVAOBinds(0)
+    { }
+};
+
+extern GLFrameStats     gCurrentGLFrameStats;     // the frame being drawn
+
+void TrackUniform(GLint location, const void* value, size_t size);
+void TrackProgramBind(GLuint program);
+void TrackVAOBind(GLuint vao);
+
+inline void CountDrawCall()
+{
+#if GLSH_GL_STATS
+    ++gCurrentGLFrameStats.drawCalls;
+#endif
+}
+
+inline void CountUniformUpload(GLint location, const void* value, size_t size)
+{
+#if GLSH_GL_STATS
+    TrackUniform(location, value, size);
+#endif
+}
+
+inline void CountBufferUpload(size_t bytes)
+{
+#if GLSH_GL_STATS
+    ++gCurrentGLFrameStats.bufferUploads;
+    gCurrentGLFrameStats.bufferBytes += bytes;
+#endif
+}
+
+inline void CountTextureUpload(size_t bytes)
+{
+#if GLSH_GL_STATS
+    ++gCurrentGLFrameStats.textureUploads;
+    gCurrentGLFrameStats.textureBytes += bytes;
+#endif
+}
+
+// glUseProgram and glBindVertexArray with bookkeeping; use these instead of the raw calls
+inline void UseProgram(GLuint program)
+{
+#if GLSH_GL_STATS
+    TrackProgramBind(program);
+#endif
+    glUseProgram(program);
+}
+
+inline void BindVertexArray(GLuint vao)
+{
+#if GLSH_GL_STATS
+    TrackVAOBind(vao);
+#endif
+    glBindVertexArray(vao);
+}
+
+// start counting a new frame
+void EndGLStatsFrame();
+
+const GLFrameStats& GetLastFrameGLStats();
+unsigned GetGLStatsFrameNumber();           // frames ended so far
+
+// append one CSV row per frame to path (overwritten), until StopGLStatsLog
+bool StartGLStatsLog(const std::string& path);
+void StopGLStatsLog();
+bool IsGLStatsLogOpen();
+
+} // end of namespace
+
+#endif
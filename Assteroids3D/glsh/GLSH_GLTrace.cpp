@@ -0,0 +1,755 @@
+// the wrappers below call the real entry points
+#define GLSH_GL_TRACE_IMPL
+
+#include "GLSH_GLTrace.h"
+#include "GLSH_GLTraceFormat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace glsh {
+
+namespace {
+
+FILE*                       gTraceFile = NULL;
+std::vector<unsigned char>  gTraceBuf;              // written out in large chunks
+int                         gFramesLeft = 0;
+unsigned                    gNumCalls = 0;
+bool                        gRecording = false;
+
+// state needed to size payloads
+GLint                       gUnpackAlignment = 4;
+GLuint                      gArrayBuffer = 0;
+bool                        gWarnedClientArrays = false;
+
+const size_t                FLUSH_SIZE = 1 << 20;
+
+void Flush()
+{
+    if (gTraceFile && !gTraceBuf.empty()) {
+        std::fwrite(&gTraceBuf[0], 1, gTraceBuf.size(), gTraceFile);
+    }
+    gTraceBuf.clear();
+}
+
+void PutBytes(const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    gTraceBuf.insert(gTraceBuf.end(), p, p + size);
+}
+
+// little-endian, like every platform this runs on
+void Put32(uint32_t v)      { PutBytes(&v, 4); }
+void Put64(uint64_t v)      { PutBytes(&v, 8); }
+void PutF(GLfloat v)        { uint32_t u; std::memcpy(&u, &v, 4); Put32(u); }
+
+void PutBlob(const void* data, size_t size)
+{
+    if (!data) {
+        size = 0;
+    }
+    Put32((uint32_t)size);
+    if (size) {
+        PutBytes(data, size);
+    }
+}
+
+void Begin(GLTraceOp op)
+{
+    uint16_t v = (uint16_t)op;
+    PutBytes(&v, 2);
+    ++gNumCalls;
+}
+
+void End()
+{
+    if (gTraceBuf.size() >= FLUSH_SIZE) {
+        Flush();
+    }
+}
+
+// bytes glTexImage reads for one image, following GL_UNPACK_ALIGNMENT
+size_t ImageSize(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type)
+{
+    int components;
+    switch (format) {
+    case GL_RED: case GL_GREEN: case GL_BLUE: case GL_ALPHA: case GL_LUMINANCE:
+    case GL_DEPTH_COMPONENT: case GL_RED_INTEGER:
+        components = 1; break;
+    case GL_RG: case GL_LUMINANCE_ALPHA: case GL_DEPTH_STENCIL: case GL_RG_INTEGER:
+        components = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+        components = 3; break;
+    default:
+        components = 4; break;
+    }
+
+    int componentSize;
+    switch (type) {
+    case GL_UNSIGNED_BYTE: case GL_BYTE:                        componentSize = 1; break;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:  componentSize = 2; break;
+    case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_2_10_10_10_REV:
+        components = 1; componentSize = 4; break;
+    default:                                                    componentSize = 4; break;
+    }
+
+    size_t rowSize = (size_t)width * components * componentSize;
+    size_t align = gUnpackAlignment > 0 ? gUnpackAlignment : 1;
+    rowSize = (rowSize + align - 1) / align * align;
+    return rowSize * height * depth;
+}
+
+void PutNames(GLsizei n, const GLuint* names)
+{
+    Put32((uint32_t)n);
+    PutBlob(names, n > 0 ? n * sizeof(GLuint) : 0);
+}
+
+} // end of anonymous namespace
+
+
+bool StartGLTrace(const std::string& path, int numFrames)
+{
+#if GLSH_GL_TRACE
+    StopGLTrace();
+
+    gTraceFile = std::fopen(path.c_str(), "wb");
+    if (!gTraceFile) {
+        std::cerr << "*** Failed to open GL trace " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    gTraceBuf.reserve(FLUSH_SIZE + 64 * 1024);
+    PutBytes(GL_TRACE_MAGIC, sizeof(GL_TRACE_MAGIC));
+    Put32(GL_TRACE_VERSION);
+    Put32(0);
+
+    gFramesLeft = numFrames > 0 ? numFrames : 1;
+    gNumCalls = 0;
+    gRecording = true;
+
+    std::cout << "Recording " << gFramesLeft << " frames of GL calls to " << path << std::endl;
+    return true;
+#else
+    std::cerr << "*** GL tracing isn't compiled in (build with GLSH_GL_TRACE=1), not recording " << path << std::endl;
+    return false;
+#endif
+}
+
+void StopGLTrace()
+{
+    if (!gTraceFile) {
+        return;
+    }
+
+    Flush();
+    bool ok = std::ferror(gTraceFile) == 0;
+    ok = std::fclose(gTraceFile) == 0 && ok;
+    if (!ok) {
+        std::cerr << "*** Error writing GL trace" << std::endl;
+    } else {
+        std::cout << "GL trace done, " << gNumCalls << " calls" << std::endl;
+    }
+
+    gTraceFile = NULL;
+    gRecording = false;
+    std::vector<unsigned char>().swap(gTraceBuf);
+}
+
+bool IsGLTraceRecording()
+{
+    return gRecording;
+}
+
+void GLTraceEndFrame()
+{
+    if (!gRecording) {
+        return;
+    }
+
+    Begin(GL_TRACE_FrameEnd);
+    End();
+
+    if (--gFramesLeft <= 0) {
+        StopGLTrace();
+    }
+}
+
+void TraceMappedWrite(GLenum target, GLintptr offset, const void* data, GLsizeiptr size)
+{
+    if (!gRecording) {
+        return;
+    }
+
+    Begin(GL_TRACE_MappedWrite); Put32(target); Put64(offset); PutBlob(data, size); End();
+}
+
+
+namespace trace {
+
+//
+// state
+//
+
+void Enable(GLenum cap)
+{
+    glEnable(cap);
+    if (gRecording) { Begin(GL_TRACE_Enable); Put32(cap); End(); }
+}
+
+void Disable(GLenum cap)
+{
+    glDisable(cap);
+    if (gRecording) { Begin(GL_TRACE_Disable); Put32(cap); End(); }
+}
+
+void BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    glBlendFunc(sfactor, dfactor);
+    if (gRecording) { Begin(GL_TRACE_BlendFunc); Put32(sfactor); Put32(dfactor); End(); }
+}
+
+void Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    glViewport(x, y, width, height);
+    if (gRecording) { Begin(GL_TRACE_Viewport); Put32(x); Put32(y); Put32(width); Put32(height); End(); }
+}
+
+void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    glClearColor(r, g, b, a);
+    if (gRecording) { Begin(GL_TRACE_ClearColor); PutF(r); PutF(g); PutF(b); PutF(a); End(); }
+}
+
+void Clear(GLbitfield mask)
+{
+    glClear(mask);
+    if (gRecording) { Begin(GL_TRACE_Clear); Put32(mask); End(); }
+}
+
+void Hint(GLenum target, GLenum mode)
+{
+    glHint(target, mode);
+    if (gRecording) { Begin(GL_TRACE_Hint); Put32(target); Put32(mode); End(); }
+}
+
+void PixelStorei(GLenum pname, GLint param)
+{
+    glPixelStorei(pname, param);
+    if (pname == GL_UNPACK_ALIGNMENT) {
+        gUnpackAlignment = param;
+    }
+    if (gRecording) { Begin(GL_TRACE_PixelStorei); Put32(pname); Put32(param); End(); }
+}
+
+// queries are recorded because they can stall the driver, not for their results
+GLenum GetError()
+{
+    GLenum err = glGetError();
+    if (gRecording) { Begin(GL_TRACE_GetError); End(); }
+    return err;
+}
+
+void GetIntegerv(GLenum pname, GLint* data)
+{
+    glGetIntegerv(pname, data);
+    if (gRecording) { Begin(GL_TRACE_GetIntegerv); Put32(pname); End(); }
+}
+
+//
+// textures
+//
+
+void GenTextures(GLsizei n, GLuint* textures)
+{
+    glGenTextures(n, textures);
+    if (gRecording) { Begin(GL_TRACE_GenTextures); PutNames(n, textures); End(); }
+}
+
+void DeleteTextures(GLsizei n, const GLuint* textures)
+{
+    glDeleteTextures(n, textures);
+    if (gRecording) { Begin(GL_TRACE_DeleteTextures); PutNames(n, textures); End(); }
+}
+
+void BindTexture(GLenum target, GLuint texture)
+{
+    glBindTexture(target, texture);
+    if (gRecording) { Begin(GL_TRACE_BindTexture); Put32(target); Put32(texture); End(); }
+}
+
+void TexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    glTexParameteri(target, pname, param);
+    if (gRecording) { Begin(GL_TRACE_TexParameteri); Put32(target); Put32(pname); Put32(param); End(); }
+}
+
+void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+    if (gRecording) {
+        Begin(GL_TRACE_TexImage2D);
+        Put32(target); Put32(level); Put32(internalFormat); Put32(width); Put32(height);
+        Put32(border); Put32(format); Put32(type);
+        PutBlob(pixels, ImageSize(width, height, 1, format, type));
+        End();
+    }
+}
+
+void TexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth,
+                GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    glTexImage3D(target, level, internalFormat, width, height, depth, border, format, type, pixels);
+    if (gRecording) {
+        Begin(GL_TRACE_TexImage3D);
+        Put32(target); Put32(level); Put32(internalFormat); Put32(width); Put32(height); Put32(depth);
+        Put32(border); Put32(format); Put32(type);
+        PutBlob(pixels, ImageSize(width, height, depth, format, type));
+        End();
+    }
+}
+
+void CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                          GLint border, GLsizei imageSize, const void* data)
+{
+    glCompressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data);
+    if (gRecording) {
+        Begin(GL_TRACE_CompressedTexImage2D);
+        Put32(target); Put32(level); Put32(internalFormat); Put32(width); Put32(height); Put32(border);
+        PutBlob(data, imageSize);
+        End();
+    }
+}
+
+void CompressedTexImage3D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth,
+                          GLint border, GLsizei imageSize, const void* data)
+{
+    glCompressedTexImage3D(target, level, internalFormat, width, height, depth, border, imageSize, data);
+    if (gRecording) {
+        Begin(GL_TRACE_CompressedTexImage3D);
+        Put32(target); Put32(level); Put32(internalFormat); Put32(width); Put32(height); Put32(depth); Put32(border);
+        PutBlob(data, imageSize);
+        End();
+    }
+}
+
+void GenerateMipmap(GLenum target)
+{
+    glGenerateMipmap(target);
+    if (gRecording) { Begin(GL_TRACE_GenerateMipmap); Put32(target); End(); }
+}
+
+void GenSamplers(GLsizei n, GLuint* samplers)
+{
+    glGenSamplers(n, samplers);
+    if (gRecording) { Begin(GL_TRACE_GenSamplers); PutNames(n, samplers); End(); }
+}
+
+void DeleteSamplers(GLsizei n, const GLuint* samplers)
+{
+    glDeleteSamplers(n, samplers);
+    if (gRecording) { Begin(GL_TRACE_DeleteSamplers); PutNames(n, samplers); End(); }
+}
+
+void BindSampler(GLuint unit, GLuint sampler)
+{
+    glBindSampler(unit, sampler);
+    if (gRecording) { Begin(GL_TRACE_BindSampler); Put32(unit); Put32(sampler); End(); }
+}
+
+void SamplerParameteri(GLuint sampler, GLenum pname, GLint param)
+{
+    glSamplerParameteri(sampler, pname, param);
+    if (gRecording) { Begin(GL_TRACE_SamplerParameteri); Put32(sampler); Put32(pname); Put32(param); End(); }
+}
+
+void SamplerParameterf(GLuint sampler, GLenum pname, GLfloat param)
+{
+    glSamplerParameterf(sampler, pname, param);
+    if (gRecording) { Begin(GL_TRACE_SamplerParameterf); Put32(sampler); Put32(pname); PutF(param); End(); }
+}
+
+//
+// buffers
+//
+
+void GenBuffers(GLsizei n, GLuint* buffers)
+{
+    glGenBuffers(n, buffers);
+    if (gRecording) { Begin(GL_TRACE_GenBuffers); PutNames(n, buffers); End(); }
+}
+
+void DeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    glDeleteBuffers(n, buffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (buffers[i] == gArrayBuffer) {
+            gArrayBuffer = 0;
+        }
+    }
+    if (gRecording) { Begin(GL_TRACE_DeleteBuffers); PutNames(n, buffers); End(); }
+}
+
+void BindBuffer(GLenum target, GLuint buffer)
+{
+    glBindBuffer(target, buffer);
+    if (target == GL_ARRAY_BUFFER) {
+        gArrayBuffer = buffer;
+    }
+    if (gRecording) { Begin(GL_TRACE_BindBuffer); Put32(target); Put32(buffer); End(); }
+}
+
+void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    glBufferData(target, size, data, usage);
+    if (gRecording) { Begin(GL_TRACE_BufferData); Put32(target); Put64(size); PutBlob(data, size); Put32(usage); End(); }
+}
+
+void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    glBufferSubData(target, offset, size, data);
+    if (gRecording) { Begin(GL_TRACE_BufferSubData); Put32(target); Put64(offset); PutBlob(data, size); End(); }
+}
+
+void BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    glBufferStorage(target, size, data, flags);
+    if (gRecording) { Begin(GL_TRACE_BufferStorage); Put32(target); Put64(size); PutBlob(data, size); Put32(flags); End(); }
+}
+
+void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    void* ptr = glMapBufferRange(target, offset, length, access);
+    if (gRecording) { Begin(GL_TRACE_MapBufferRange); Put32(target); Put64(offset); Put64(length); Put32(access); End(); }
+    return ptr;
+}
+
+GLboolean UnmapBuffer(GLenum target)
+{
+    GLboolean ok = glUnmapBuffer(target);
+    if (gRecording) { Begin(GL_TRACE_UnmapBuffer); Put32(target); End(); }
+    return ok;
+}
+
+void CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+    glCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+    if (gRecording) {
+        Begin(GL_TRACE_CopyBufferSubData);
+        Put32(readTarget); Put32(writeTarget); Put64(readOffset); Put64(writeOffset); Put64(size);
+        End();
+    }
+}
+
+//
+// vertex arrays
+//
+
+void GenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    glGenVertexArrays(n, arrays);
+    if (gRecording) { Begin(GL_TRACE_GenVertexArrays); PutNames(n, arrays); End(); }
+}
+
+void DeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    glDeleteVertexArrays(n, arrays);
+    if (gRecording) { Begin(GL_TRACE_DeleteVertexArrays); PutNames(n, arrays); End(); }
+}
+
+void BindVertexArray(GLuint array)
+{
+    glBindVertexArray(array);
+    if (gRecording) { Begin(GL_TRACE_BindVertexArray); Put32(array); End(); }
+}
+
+void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    if (gRecording) {
+        // without a bound buffer the pointer is a client address, which can't be replayed
+        bool client = gArrayBuffer == 0 && pointer != NULL;
+        if (client && !gWarnedClientArrays) {
+            std::cerr << "*** GL trace: client-side vertex arrays are not captured" << std::endl;
+            gWarnedClientArrays = true;
+        }
+        Begin(GL_TRACE_VertexAttribPointer);
+        Put32(index); Put32(size); Put32(type); Put32(normalized); Put32(stride);
+        Put64(client ? 0 : (uint64_t)(uintptr_t)pointer); Put32(client);
+        End();
+    }
+}
+
+void EnableVertexAttribArray(GLuint index)
+{
+    glEnableVertexAttribArray(index);
+    if (gRecording) { Begin(GL_TRACE_EnableVertexAttribArray); Put32(index); End(); }
+}
+
+void DisableVertexAttribArray(GLuint index)
+{
+    glDisableVertexAttribArray(index);
+    if (gRecording) { Begin(GL_TRACE_DisableVertexAttribArray); Put32(index); End(); }
+}
+
+void VertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    glVertexAttribDivisor(index, divisor);
+    if (gRecording) { Begin(GL_TRACE_VertexAttribDivisor); Put32(index); Put32(divisor); End(); }
+}
+
+//
+// shaders
+//
+
+GLuint CreateShader(GLenum type)
+{
+    GLuint shader = glCreateShader(type);
+    if (gRecording) { Begin(GL_TRACE_CreateShader); Put32(type); Put32(shader); End(); }
+    return shader;
+}
+
+void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+{
+    glShaderSource(shader, count, strings, lengths);
+    if (gRecording) {
+        std::string source;
+        for (GLsizei i = 0; i < count; i++) {
+            if (lengths && lengths[i] >= 0) {
+                source.append(strings[i], lengths[i]);
+            } else {
+                source.append(strings[i]);
+            }
+        }
+        Begin(GL_TRACE_ShaderSource); Put32(shader); PutBlob(source.data(), source.size()); End();
+    }
+}
+
+void CompileShader(GLuint shader)
+{
+    glCompileShader(shader);
+    if (gRecording) { Begin(GL_TRACE_CompileShader); Put32(shader); End(); }
+}
+
+void DeleteShader(GLuint shader)
+{
+    glDeleteShader(shader);
+    if (gRecording) { Begin(GL_TRACE_DeleteShader); Put32(shader); End(); }
+}
+
+GLuint CreateProgram()
+{
+    GLuint program = glCreateProgram();
+    if (gRecording) { Begin(GL_TRACE_CreateProgram); Put32(program); End(); }
+    return program;
+}
+
+void AttachShader(GLuint program, GLuint shader)
+{
+    glAttachShader(program, shader);
+    if (gRecording) { Begin(GL_TRACE_AttachShader); Put32(program); Put32(shader); End(); }
+}
+
+void LinkProgram(GLuint program)
+{
+    glLinkProgram(program);
+    if (gRecording) { Begin(GL_TRACE_LinkProgram); Put32(program); End(); }
+}
+
+void DeleteProgram(GLuint program)
+{
+    glDeleteProgram(program);
+    if (gRecording) { Begin(GL_TRACE_DeleteProgram); Put32(program); End(); }
+}
+
+void ProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+    glProgramParameteri(program, pname, value);
+    if (gRecording) { Begin(GL_TRACE_ProgramParameteri); Put32(program); Put32(pname); Put32(value); End(); }
+}
+
+void ProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length)
+{
+    glProgramBinary(program, binaryFormat, binary, length);
+    if (gRecording) { Begin(GL_TRACE_ProgramBinary); Put32(program); Put32(binaryFormat); PutBlob(binary, length); End(); }
+}
+
+void UseProgram(GLuint program)
+{
+    glUseProgram(program);
+    if (gRecording) { Begin(GL_TRACE_UseProgram); Put32(program); End(); }
+}
+
+GLint GetUniformLocation(GLuint program, const GLchar* name)
+{
+    GLint location = glGetUniformLocation(program, name);
+    if (gRecording) { Begin(GL_TRACE_GetUniformLocation); Put32(program); Put32(location); PutBlob(name, std::strlen(name)); End(); }
+    return location;
+}
+
+void Uniform1f(GLint location, GLfloat v)
+{
+    glUniform1f(location, v);
+    if (gRecording) { Begin(GL_TRACE_Uniform1f); Put32(location); PutF(v); End(); }
+}
+
+void Uniform1i(GLint location, GLint v)
+{
+    glUniform1i(location, v);
+    if (gRecording) { Begin(GL_TRACE_Uniform1i); Put32(location); Put32(v); End(); }
+}
+
+void Uniform2fv(GLint location, GLsizei count, const GLfloat* v)
+{
+    glUniform2fv(location, count, v);
+    if (gRecording) { Begin(GL_TRACE_Uniform2fv); Put32(location); Put32(count); PutBlob(v, count * 2 * sizeof(GLfloat)); End(); }
+}
+
+void Uniform3fv(GLint location, GLsizei count, const GLfloat* v)
+{
+    glUniform3fv(location, count, v);
+    if (gRecording) { Begin(GL_TRACE_Uniform3fv); Put32(location); Put32(count); PutBlob(v, count * 3 * sizeof(GLfloat)); End(); }
+}
+
+void Uniform4fv(GLint location, GLsizei count, const GLfloat* v)
+{
+    glUniform4fv(location, count, v);
+    if (gRecording) { Begin(GL_TRACE_Uniform4fv); Put32(location); Put32(count); PutBlob(v, count * 4 * sizeof(GLfloat)); End(); }
+}
+
+void UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* v)
+{
+    glUniformMatrix3fv(location, count, transpose, v);
+    if (gRecording) {
+        Begin(GL_TRACE_UniformMatrix3fv); Put32(location); Put32(count); Put32(transpose); PutBlob(v, count * 9 * sizeof(GLfloat)); End();
+    }
+}
+
+void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* v)
+{
+    glUniformMatrix4fv(location, count, transpose, v);
+    if (gRecording) {
+        Begin(GL_TRACE_UniformMatrix4fv); Put32(location); Put32(count); Put32(transpose); PutBlob(v, count * 16 * sizeof(GLfloat)); End();
+    }
+}
+
+//
+// framebuffers
+//
+
+void GenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+    glGenFramebuffers(n, framebuffers);
+    if (gRecording) { Begin(GL_TRACE_GenFramebuffers); PutNames(n, framebuffers); End(); }
+}
+
+void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+    glDeleteFramebuffers(n, framebuffers);
+    if (gRecording) { Begin(GL_TRACE_DeleteFramebuffers); PutNames(n, framebuffers); End(); }
+}
+
+void BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    glBindFramebuffer(target, framebuffer);
+    if (gRecording) { Begin(GL_TRACE_BindFramebuffer); Put32(target); Put32(framebuffer); End(); }
+}
+
+void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+{
+    glFramebufferTexture2D(target, attachment, textarget, texture, level);
+    if (gRecording) {
+        Begin(GL_TRACE_FramebufferTexture2D); Put32(target); Put32(attachment); Put32(textarget); Put32(texture); Put32(level); End();
+    }
+}
+
+//
+// sync
+//
+
+GLsync FenceSync(GLenum condition, GLbitfield flags)
+{
+    GLsync sync = glFenceSync(condition, flags);
+    if (gRecording) { Begin(GL_TRACE_FenceSync); Put32(condition); Put32(flags); Put64((uint64_t)(uintptr_t)sync); End(); }
+    return sync;
+}
+
+GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    GLenum result = glClientWaitSync(sync, flags, timeout);
+    if (gRecording) { Begin(GL_TRACE_ClientWaitSync); Put64((uint64_t)(uintptr_t)sync); Put32(flags); Put64(timeout); End(); }
+    return result;
+}
+
+void DeleteSync(GLsync sync)
+{
+    glDeleteSync(sync);
+    if (gRecording) { Begin(GL_TRACE_DeleteSync); Put64((uint64_t)(uintptr_t)sync); End(); }
+}
+
+//
+// draws
+//
+
+void DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    glDrawArrays(mode, first, count);
+    if (gRecording) { Begin(GL_TRACE_DrawArrays); Put32(mode); Put32(first); Put32(count); End(); }
+}
+
+void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+{
+    glDrawArraysInstanced(mode, first, count, instanceCount);
+    if (gRecording) { Begin(GL_TRACE_DrawArraysInstanced); Put32(mode); Put32(first); Put32(count); Put32(instanceCount); End(); }
+}
+
+void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    glDrawElements(mode, count, type, indices);
+    if (gRecording) { Begin(GL_TRACE_DrawElements); Put32(mode); Put32(count); Put32(type); Put64((uint64_t)(uintptr_t)indices); End(); }
+}
+
+void DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint baseVertex)
+{
+    glDrawElementsBaseVertex(mode, count, type, indices, baseVertex);
+    if (gRecording) {
+        Begin(GL_TRACE_DrawElementsBaseVertex);
+        Put32(mode); Put32(count); Put32(type); Put64((uint64_t)(uintptr_t)indices); Put32(baseVertex);
+        End();
+    }
+}
+
+void DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                     GLsizei instanceCount, GLint baseVertex)
+{
+    glDrawElementsInstancedBaseVertex(mode, count, type, indices, instanceCount, baseVertex);
+    if (gRecording) {
+        Begin(GL_TRACE_DrawElementsInstancedBaseVertex);
+        Put32(mode); Put32(count); Put32(type); Put64((uint64_t)(uintptr_t)indices); Put32(instanceCount); Put32(baseVertex);
+        End();
+    }
+}
+
+void MultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride)
+{
+    glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+    if (gRecording) {
+        Begin(GL_TRACE_MultiDrawElementsIndirect);
+        Put32(mode); Put32(type); Put64((uint64_t)(uintptr_t)indirect); Put32(drawCount); Put32(stride);
+        End();
+    }
+}
+
+void MaxShaderCompilerThreadsKHR(GLuint count)
+{
+    glMaxShaderCompilerThreadsKHR(count);
+    if (gRecording) { Begin(GL_TRACE_MaxShaderCompilerThreadsKHR); Put32(count); End(); }
+}
+
+} // end of namespace trace
+
+} // end of namespace
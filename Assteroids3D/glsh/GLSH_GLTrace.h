@@ -0,0 +1,294 @@
+#ifndef GLSH_GLTRACE_H_
+#define GLSH_GLTRACE_H_
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <string>
+
+//
+// GL call trace recorder
+//
+//     With GLSH_GL_TRACE enabled, the GL entry points glsh and the game use are routed through thin
+//     wrappers (the macros at the bottom of this header). While a trace is recording, each call is
+//     written with its arguments and payloads (buffer and texture data, shader sources, uniform values)
+//     to a compact binary file; see GLSH_GLTraceFormat.h. tools/GLReplay re-issues a trace against an
+//     offscreen context and reports the CPU time spent submitting each frame.
+//
+//     Start recording before the window is created: the replayer needs every object to be created
+//     inside the trace. Programs are built from source while recording, never from the binary cache.
+//
+//     Queries that only return information (glGetString, glGetShaderiv, info logs, ...) are not
+//     recorded. Client-side vertex arrays can't be captured; their pointer calls are marked as such.
+//
+//     The wrappers cost a branch per call, so they're off by default and GL is called directly;
+//     capture builds define GLSH_GL_TRACE to 1 for every translation unit.
+//
+#ifndef GLSH_GL_TRACE
+#define GLSH_GL_TRACE 0
+#endif
+
+namespace glsh {
+
+// record every GL call for the next numFrames frames into path (overwritten), then stop
+bool StartGLTrace(const std::string& path, int numFrames);
+void StopGLTrace();
+bool IsGLTraceRecording();
+
+// called by System::DisplayCallback after each swap
+void GLTraceEndFrame();
+
+// a write into persistently mapped storage of the buffer bound to target (offset from the start of the mapping)
+void TraceMappedWrite(GLenum target, GLintptr offset, const void* data, GLsizeiptr size);
+
+namespace trace {
+
+void            Enable(GLenum cap);
+void            Disable(GLenum cap);
+void            BlendFunc(GLenum sfactor, GLenum dfactor);
+void            Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void            ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+void            Clear(GLbitfield mask);
+void            Hint(GLenum target, GLenum mode);
+void            PixelStorei(GLenum pname, GLint param);
+GLenum          GetError();
+void            GetIntegerv(GLenum pname, GLint* data);
+
+void            GenTextures(GLsizei n, GLuint* textures);
+void            DeleteTextures(GLsizei n, const GLuint* textures);
+void            BindTexture(GLenum target, GLuint texture);
+void            TexParameteri(GLenum target, GLenum pname, GLint param);
+void            TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+                           GLint border, GLenum format, GLenum type, const void* pixels);
+void            TexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth,
+                           GLint border, GLenum format, GLenum type, const void* pixels);
+void            CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                                     GLint border, GLsizei imageSize, const void* data);
+void            CompressedTexImage3D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth,
+                                     GLint border, GLsizei imageSize, const void* data);
+void            GenerateMipmap(GLenum target);
+void            GenSamplers(GLsizei n, GLuint* samplers);
+void            DeleteSamplers(GLsizei n, const GLuint* samplers);
+void            BindSampler(GLuint unit, GLuint sampler);
+void            SamplerParameteri(GLuint sampler, GLenum pname, GLint param);
+void            SamplerParameterf(GLuint sampler, GLenum pname, GLfloat param);
+
+void            GenBuffers(GLsizei n, GLuint* buffers);
+void            DeleteBuffers(GLsizei n, const GLuint* buffers);
+void            BindBuffer(GLenum target, GLuint buffer);
+void            BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+void            BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+void            BufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+void*           MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+GLboolean       UnmapBuffer(GLenum target);
+void            CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+
+void            GenVertexArrays(GLsizei n, GLuint* arrays);
+void            DeleteVertexArrays(GLsizei n, const GLuint* arrays);
+void            BindVertexArray(GLuint array);
+void            VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+void            EnableVertexAttribArray(GLuint index);
+void            DisableVertexAttribArray(GLuint index);
+void            VertexAttribDivisor(GLuint index, GLuint divisor);
+
+GLuint          CreateShader(GLenum type);
+void            ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths);
+void            CompileShader(GLuint shader);
+void            DeleteShader(GLuint shader);
+GLuint          CreateProgram();
+void            AttachShader(GLuint program, GLuint shader);
+void            LinkProgram(GLuint program);
+void            DeleteProgram(GLuint program);
+void            ProgramParameteri(GLuint program, GLenum pname, GLint value);
+void            ProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+void            UseProgram(GLuint program);
+GLint           GetUniformLocation(GLuint program, const GLchar* name);
+void            Uniform1f(GLint location, GLfloat v);
+void            Uniform1i(GLint location, GLint v);
+void            Uniform2fv(GLint location, GLsizei count, const GLfloat* v);
+void            Uniform3fv(GLint location, GLsizei count, const GLfloat* v);
+void            Uniform4fv(GLint location, GLsizei count, const GLfloat* v);
+void            UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* v);
+void            UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* v);
+
+void            GenFramebuffers(GLsizei n, GLuint* framebuffers);
+void            DeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+void            BindFramebuffer(GLenum target, GLuint framebuffer);
+void            FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+
+GLsync          FenceSync(GLenum condition, GLbitfield flags);
+GLenum          ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+void            DeleteSync(GLsync sync);
+
+void            DrawArrays(GLenum mode, GLint first, GLsizei count);
+void            DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+void            DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void            DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint baseVertex);
+void            DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                                GLsizei instanceCount, GLint baseVertex);
+void            MultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride);
+void            MaxShaderCompilerThreadsKHR(GLuint count);
+
+} // end of namespace trace
+
+} // end of namespace
+
+//
+// Route the GL calls of everything that includes this header through the wrappers.
+// GLSH_GLTrace.cpp defines GLSH_GL_TRACE_IMPL to reach the real entry points.
+//
+#if GLSH_GL_TRACE && !defined(GLSH_GL_TRACE_IMPL)
+
+#define GLSH_GL_TRACE_ROUTE(name)   ::glsh::trace::name
+
+#undef glEnable
+#undef glDisable
+#undef glBlendFunc
+#undef glViewport
+#undef glClearColor
+#undef glClear
+#undef glHint
+#undef glPixelStorei
+#undef glGetError
+#undef glGetIntegerv
+#undef glGenTextures
+#undef glDeleteTextures
+#undef glBindTexture
+#undef glTexParameteri
+#undef glTexImage2D
+#undef glTexImage3D
+#undef glCompressedTexImage2D
+#undef glCompressedTexImage3D
+#undef glGenerateMipmap
+#undef glGenSamplers
+#undef glDeleteSamplers
+#undef glBindSampler
+#undef glSamplerParameteri
+#undef glSamplerParameterf
+#undef glGenBuffers
+#undef glDeleteBuffers
+#undef glBindBuffer
+#undef glBufferData
+#undef glBufferSubData
+#undef glBufferStorage
+#undef glMapBufferRange
+#undef glUnmapBuffer
+#undef glCopyBufferSubData
+#undef glGenVertexArrays
+#undef glDeleteVertexArrays
+#undef glBindVertexArray
+#undef glVertexAttribPointer
+#undef glEnableVertexAttribArray
+#undef glDisableVertexAttribArray
+#undef glVertexAttribDivisor
+#undef glCreateShader
+#undef glShaderSource
+#undef glCompileShader
+#undef glDeleteShader
+#undef glCreateProgram
+#undef glAttachShader
+#undef glLinkProgram
+#undef glDeleteProgram
+#undef glProgramParameteri
+#undef glProgramBinary
+#undef glUseProgram
+#undef glGetUniformLocation
+#undef glUniform1f
+#undef glUniform1i
+#undef glUniform2fv
+#undef glUniform3fv
+#undef glUniform4fv
+#undef glUniformMatrix3fv
+#undef glUniformMatrix4fv
+#undef glGenFramebuffers
+#undef glDeleteFramebuffers
+#undef glBindFramebuffer
+#undef glFramebufferTexture2D
+#undef glFenceSync
+#undef glClientWaitSync
+#undef glDeleteSync
+#undef glDrawArrays
+#undef glDrawArraysInstanced
+#undef glDrawElements
+#undef glDrawElementsBaseVertex
+#undef glDrawElementsInstancedBaseVertex
+#undef glMultiDrawElementsIndirect
+#undef glMaxShaderCompilerThreadsKHR
+
+#define glEnable                            GLSH_GL_TRACE_ROUTE(Enable)
+#define glDisable                           GLSH_GL_TRACE_ROUTE(Disable)
+#define glBlendFunc                         GLSH_GL_TRACE_ROUTE(BlendFunc)
+#define glViewport                          GLSH_GL_TRACE_ROUTE(Viewport)
+#define glClearColor                        GLSH_GL_TRACE_ROUTE(ClearColor)
+#define glClear                             GLSH_GL_TRACE_ROUTE(Clear)
+#define glHint                              GLSH_GL_TRACE_ROUTE(Hint)
+#define glPixelStorei                       GLSH_GL_TRACE_ROUTE(PixelStorei)
+#define glGetError                          GLSH_GL_TRACE_ROUTE(GetError)
+#define glGetIntegerv                       GLSH_GL_TRACE_ROUTE(GetIntegerv)
+#define glGenTextures                       GLSH_GL_TRACE_ROUTE(GenTextures)
+#define glDeleteTextures                    GLSH_GL_TRACE_ROUTE(DeleteTextures)
+#define glBindTexture                       GLSH_GL_TRACE_ROUTE(BindTexture)
+#define glTexParameteri                     GLSH_GL_TRACE_ROUTE(TexParameteri)
+#define glTexImage2D                        GLSH_GL_TRACE_ROUTE(TexImage2D)
+#define glTexImage3D                        GLSH_GL_TRACE_ROUTE(TexImage3D)
+#define glCompressedTexImage2D              GLSH_GL_TRACE_ROUTE(CompressedTexImage2D)
+#define glCompressedTexImage3D              GLSH_GL_TRACE_ROUTE(CompressedTexImage3D)
+#define glGenerateMipmap                    GLSH_GL_TRACE_ROUTE(GenerateMipmap)
+#define glGenSamplers                       GLSH_GL_TRACE_ROUTE(GenSamplers)
+#define glDeleteSamplers                    GLSH_GL_TRACE_ROUTE(DeleteSamplers)
+#define glBindSampler                       GLSH_GL_TRACE_ROUTE(BindSampler)
+#define glSamplerParameteri                 GLSH_GL_TRACE_ROUTE(SamplerParameteri)
+#define glSamplerParameterf                 GLSH_GL_TRACE_ROUTE(SamplerParameterf)
+#define glGenBuffers                        GLSH_GL_TRACE_ROUTE(GenBuffers)
+#define glDeleteBuffers                     GLSH_GL_TRACE_ROUTE(DeleteBuffers)
+#define glBindBuffer                        GLSH_GL_TRACE_ROUTE(BindBuffer)
+#define glBufferData                        GLSH_GL_TRACE_ROUTE(BufferData)
+#define glBufferSubData                     GLSH_GL_TRACE_ROUTE(BufferSubData)
+#define glBufferStorage                     GLSH_GL_TRACE_ROUTE(BufferStorage)
+#define glMapBufferRange                    GLSH_GL_TRACE_ROUTE(MapBufferRange)
+#define glUnmapBuffer                       GLSH_GL_TRACE_ROUTE(UnmapBuffer)
+#define glCopyBufferSubData                 GLSH_GL_TRACE_ROUTE(CopyBufferSubData)
+#define glGenVertexArrays                   GLSH_GL_TRACE_ROUTE(GenVertexArrays)
+#define glDeleteVertexArrays                GLSH_GL_TRACE_ROUTE(DeleteVertexArrays)
+#define glBindVertexArray                   GLSH_GL_TRACE_ROUTE(BindVertexArray)
+#define glVertexAttribPointer               GLSH_GL_TRACE_ROUTE(VertexAttribPointer)
+#define glEnableVertexAttribArray           GLSH_GL_TRACE_ROUTE(EnableVertexAttribArray)
+#define glDisableVertexAttribArray          GLSH_GL_TRACE_ROUTE(DisableVertexAttribArray)
+#define glVertexAttribDivisor               GLSH_GL_TRACE_ROUTE(VertexAttribDivisor)
+#define glCreateShader                      GLSH_GL_TRACE_ROUTE(CreateShader)
+#define glShaderSource                      GLSH_GL_TRACE_ROUTE(ShaderSource)
+#define glCompileShader                     GLSH_GL_TRACE_ROUTE(CompileShader)
+#define glDeleteShader                      GLSH_GL_TRACE_ROUTE(DeleteShader)
+#define glCreateProgram                     GLSH_GL_TRACE_ROUTE(CreateProgram)
+#define glAttachShader                      GLSH_GL_TRACE_ROUTE(AttachShader)
+#define glLinkProgram                       GLSH_GL_TRACE_ROUTE(LinkProgram)
+#define glDeleteProgram                     GLSH_GL_TRACE_ROUTE(DeleteProgram)
+#define glProgramParameteri                 GLSH_GL_TRACE_ROUTE(ProgramParameteri)
+#define glProgramBinary                     GLSH_GL_TRACE_ROUTE(ProgramBinary)
+#define glUseProgram                        GLSH_GL_TRACE_ROUTE(UseProgram)
+#define glGetUniformLocation                GLSH_GL_TRACE_ROUTE(GetUniformLocation)
+#define glUniform1f                         GLSH_GL_TRACE_ROUTE(Uniform1f)
+#define glUniform1i                         GLSH_GL_TRACE_ROUTE(Uniform1i)
+#define glUniform2fv                        GLSH_GL_TRACE_ROUTE(Uniform2fv)
+#define glUniform3fv                        GLSH_GL_TRACE_ROUTE(Uniform3fv)
+#define glUniform4fv                        GLSH_GL_TRACE_ROUTE(Uniform4fv)
+#define glUniformMatrix3fv                  GLSH_GL_TRACE_ROUTE(UniformMatrix3fv)
+#define glUniformMatrix4fv                  GLSH_GL_TRACE_ROUTE(UniformMatrix4fv)
+#define glGenFramebuffers                   GLSH_GL_TRACE_ROUTE(GenFramebuffers)
+#define glDeleteFramebuffers                GLSH_GL_TRACE_ROUTE(DeleteFramebuffers)
+#define glBindFramebuffer                   GLSH_GL_TRACE_ROUTE(BindFramebuffer)
+#define glFramebufferTexture2D              GLSH_GL_TRACE_ROUTE(FramebufferTexture2D)
+#define glFenceSync                         GLSH_GL_TRACE_ROUTE(FenceSync)
+#define glClientWaitSync                    GLSH_GL_TRACE_ROUTE(ClientWaitSync)
+#define glDeleteSync                        GLSH_GL_TRACE_ROUTE(DeleteSync)
+#define glDrawArrays                        GLSH_GL_TRACE_ROUTE(DrawArrays)
+#define glDrawArraysInstanced               GLSH_GL_TRACE_ROUTE(DrawArraysInstanced)
+#define glDrawElements                      GLSH_GL_TRACE_ROUTE(DrawElements)
+#define glDrawElementsBaseVertex            GLSH_GL_TRACE_ROUTE(DrawElementsBaseVertex)
+#define glDrawElementsInstancedBaseVertex   GLSH_GL_TRACE_ROUTE(DrawElementsInstancedBaseVertex)
+#define glMultiDrawElementsIndirect         GLSH_GL_TRACE_ROUTE(MultiDrawElementsIndirect)
+#define glMaxShaderCompilerThreadsKHR       GLSH_GL_TRACE_ROUTE(MaxShaderCompilerThreadsKHR)
+
+#endif
+
+#endif
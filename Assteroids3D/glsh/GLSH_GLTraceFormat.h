@@ -0,0 +1,124 @@
+#ifndef GLSH_GLTRACEFORMAT_H_
+#define GLSH_GLTRACEFORMAT_H_
+
+//
+// GL trace file layout, shared by the recorder (GLSH_GLTrace) and tools/GLReplay
+//
+//     header:  "GLSHTRC1", uint32 version, uint32 reserved
+//     calls:   uint16 op, then the op's arguments in the order of its signature
+//
+//     Signature letters:
+//         u   32 bits: enums, ints, names, and floats (bit pattern)
+//         q   64 bits: sizes, offsets, sync handles
+//         b   uint32 byte count + payload (at most one per call; a count of 0 stands for NULL)
+//
+//     Everything is little-endian. Object names are the recorder's; the replayer maps them to its own.
+//     FrameEnd is written after each swap, MappedWrite records a memcpy into persistently mapped storage
+//     (offset relative to the start of the mapping of the buffer bound to 'target').
+//
+#include <cstdint>
+
+namespace glsh {
+
+const char          GL_TRACE_MAGIC[8]   = { 'G', 'L', 'S', 'H', 'T', 'R', 'C', '1' };
+const uint32_t      GL_TRACE_VERSION    = 2;
+
+#define GLSH_GL_TRACE_OPS(X)                                                                \
+    X(FrameEnd,                         "")                                                 \
+    X(MappedWrite,                      "uqb")      /* target, offset, data */              \
+    X(Enable,                           "u")                                                \
+    X(Disable,                          "u")                                                \
+    X(BlendFunc,                        "uu")                                               \
+    X(Viewport,                         "uuuu")                                             \
+    X(ClearColor,                       "uuuu")                                             \
+    X(Clear,                            "u")                                                \
+    X(Hint,                             "uu")                                               \
+    X(PixelStorei,                      "uu")                                               \
+    X(GetError,                         "")                                                 \
+    X(GetIntegerv,                      "u")                                                \
+    X(GenTextures,                      "ub")       /* n, names */                          \
+    X(DeleteTextures,                   "ub")                                               \
+    X(BindTexture,                      "uu")                                               \
+    X(TexParameteri,                    "uuu")                                              \
+    X(TexImage2D,                       "uuuuuuuub")                                        \
+    X(TexImage3D,                       "uuuuuuuuub")                                       \
+    X(CompressedTexImage2D,             "uuuuuub")                                          \
+    X(CompressedTexImage3D,             "uuuuuuub")                                         \
+    X(GenerateMipmap,                   "u")                                                \
+    X(GenSamplers,                      "ub")                                               \
+    X(DeleteSamplers,                   "ub")                                               \
+    X(BindSampler,                      "uu")                                               \
+    X(SamplerParameteri,                "uuu")                                              \
+    X(SamplerParameterf,                "uuu")                                              \
+    X(GenBuffers,                       "ub")                                               \
+    X(DeleteBuffers,                    "ub")                                               \
+    X(BindBuffer,                       "uu")                                               \
+    X(BufferData,                       "uqbu")     /* target, size, data, usage */         \
+    X(BufferSubData,                    "uqb")                                              \
+    X(BufferStorage,                    "uqbu")                                             \
+    X(MapBufferRange,                   "uqqu")                                             \
+    X(UnmapBuffer,                      "u")                                                \
+    X(CopyBufferSubData,                "uuqqq")                                            \
+    X(GenVertexArrays,                  "ub")                                               \
+    X(DeleteVertexArrays,               "ub")                                               \
+    X(BindVertexArray,                  "u")                                                \
+    X(VertexAttribPointer,              "uuuuuqu")  /* ..., offset, client memory */        \
+    X(EnableVertexAttribArray,          "u")                                                \
+    X(DisableVertexAttribArray,         "u")                                                \
+    X(VertexAttribDivisor,              "uu")                                               \
+    X(CreateShader,                     "uu")       /* type, name */                        \
+    X(ShaderSource,                     "ub")       /* shader, concatenated strings */      \
+    X(CompileShader,                    "u")                                                \
+    X(DeleteShader,                     "u")                                                \
+    X(CreateProgram,                    "u")        /* name */                              \
+    X(AttachShader,                     "uu")                                               \
+    X(LinkProgram,                      "u")                                                \
+    X(DeleteProgram,                    "u")                                                \
+    X(ProgramParameteri,                "uuu")                                              \
+    X(ProgramBinary,                    "uub")                                              \
+    X(UseProgram,                       "u")                                                \
+    X(GetUniformLocation,               "uub")      /* program, location, name */           \
+    X(Uniform1f,                        "uu")                                               \
+    X(Uniform1i,                        "uu")                                               \
+    X(Uniform2fv,                       "uub")      /* location, count, values */           \
+    X(Uniform3fv,                       "uub")                                              \
+    X(Uniform4fv,                       "uub")                                              \
+    X(UniformMatrix3fv,                 "uuub")     /* location, count, transpose, values */\
+    X(UniformMatrix4fv,                 "uuub")                                             \
+    X(GenFramebuffers,                  "ub")                                               \
+    X(DeleteFramebuffers,               "ub")                                               \
+    X(BindFramebuffer,                  "uu")                                               \
+    X(FramebufferTexture2D,             "uuuuu")                                            \
+    X(FenceSync,                        "uuq")      /* condition, flags, sync */            \
+    X(ClientWaitSync,                   "quq")                                              \
+    X(DeleteSync,                       "q")                                                \
+    X(DrawArrays,                       "uuu")                                              \
+    X(DrawArraysInstanced,              "uuuu")                                             \
+    X(DrawElements,                     "uuuq")                                             \
+    X(DrawElementsBaseVertex,           "uuuqu")                                            \
+    X(DrawElementsInstancedBaseVertex,  "uuuquu")                                           \
+    X(MultiDrawElementsIndirect,        "uuquu")                                            \
+    X(MaxShaderCompilerThreadsKHR,      "u")
+
+enum GLTraceOp {
+#define GLSH_GL_TRACE_ENUM(name, sig)   GL_TRACE_##name,
+    GLSH_GL_TRACE_OPS(GLSH_GL_TRACE_ENUM)
+#undef GLSH_GL_TRACE_ENUM
+    GL_TRACE_NUM_OPS
+};
+
+const char* const   GL_TRACE_SIGNATURES[] = {
+#define GLSH_GL_TRACE_SIG(name, sig)    sig,
+    GLSH_GL_TRACE_OPS(GLSH_GL_TRACE_SIG)
+#undef GLSH_GL_TRACE_SIG
+};
+
+const char* const   GL_TRACE_NAMES[] = {
+#define GLSH_GL_TRACE_NAME(name, sig)   #name,
+    GLSH_GL_TRACE_OPS(GLSH_GL_TRACE_NAME)
+#undef GLSH_GL_TRACE_NAME
+};
+
+} // end of namespace
+
+#endif
@@ -1,8 +1,11 @@
 #include "GLSH_Image.h"
 #include "GLSH_Util.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
+#include <thread>
 
 namespace glsh {
 
@@ -163,6 +166,67 @@ bool Image::LoadTarga(const std::string& path)
     return true;
 }
 
+bool Image::SaveTarga(const std::string& path) const
+{
+    if (!isGood()) {
+        std::cerr << "*** Can't save an empty image to '" << path << "'" << std::endl;
+        return false;
+    }
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file.good()) {
+        std::cerr << "*** Failed to open file '" << path << "' for writing" << std::endl;
+        return false;
+    }
+
+    TargaHeader hdr = {};
+    hdr.imageTypeCode = (mBytesPerPixel <= 2) ? TARGA_GRAYSCALE : TARGA_RGB;
+    hdr.width = (unsigned short)mWidth;
+    hdr.height = (unsigned short)mHeight;
+    hdr.bpp = (unsigned char)(8 * mBytesPerPixel);
+    hdr.imageDesc = (mBytesPerPixel == 4 || mBytesPerPixel == 2) ? 8 : 0;   // alpha bits; rows stored bottom-to-top
+
+    // write the header field by field, the struct may be padded
+    file.write((const char*)&hdr.idLength, 1);
+    file.write((const char*)&hdr.colorMapType, 1);
+    file.write((const char*)&hdr.imageTypeCode, 1);
+    file.write((const char*)hdr.colorMapSpec, 5);
+    file.write((const char*)&hdr.xOrigin, 2);
+    file.write((const char*)&hdr.yOrigin, 2);
+    file.write((const char*)&hdr.width, 2);
+    file.write((const char*)&hdr.height, 2);
+    file.write((const char*)&hdr.bpp, 1);
+    file.write((const char*)&hdr.imageDesc, 1);
+
+    // TGA stores color as BGR(A)
+    std::vector<unsigned char> row(mWidth * mBytesPerPixel);
+    for (int j = 0; j < mHeight; j++) {
+        const unsigned char* p = mData + j * mWidth * mBytesPerPixel;
+        for (int i = 0; i < mWidth * mBytesPerPixel; i += mBytesPerPixel) {
+            if (mBytesPerPixel >= 3) {
+                row[i + 0] = p[i + 2];
+                row[i + 1] = p[i + 1];
+                row[i + 2] = p[i + 0];
+                if (mBytesPerPixel == 4) {
+                    row[i + 3] = p[i + 3];
+                }
+            } else {
+                for (int k = 0; k < mBytesPerPixel; k++) {
+                    row[i + k] = p[i + k];
+                }
+            }
+        }
+        file.write((const char*)&row[0], row.size());
+    }
+
+    if (!file.good()) {
+        std::cerr << "*** Failed to write file '" << path << "'" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 void Image::LoadTargaUncompressed(const TargaHeader* hdr, const unsigned char* imgData)
 {
     int rowlen = (hdr->bpp / 8) * hdr->width;  // bytes per row
@@ -437,4 +501,554 @@ bool Image::GenerateMipmaps(int minSize)
     return true;
 }
 
+
+//
+// Block compression (BC1/BC3)
+//
+
+// fetch a 4x4 block of texels as RGBA, clamping at the image edges
+static void FetchBlock(const unsigned char* data, int width, int height, int bpp, int bx, int by, unsigned char block[16][4])
+{
+    for (int j = 0; j < 4; j++) {
+        int y = std::min(4 * by + j, height - 1);
+        for (int i = 0; i < 4; i++) {
+            int x = std::min(4 * bx + i, width - 1);
+            const unsigned char* p = data + (y * width + x) * bpp;
+            unsigned char* q = block[4 * j + i];
+            switch (bpp) {
+            case 1:
+                q[0] = q[1] = q[2] = p[0];
+                q[3] = 255;
+                break;
+            case 2:
+                q[0] = q[1] = q[2] = p[0];
+                q[3] = p[1];
+                break;
+            case 3:
+                q[0] = p[0];
+                q[1] = p[1];
+                q[2] = p[2];
+                q[3] = 255;
+                break;
+            default:
+                q[0] = p[0];
+                q[1] = p[1];
+                q[2] = p[2];
+                q[3] = p[3];
+                break;
+            }
+        }
+    }
+}
+
+static unsigned short PackRGB565(float r, float g, float b)
+{
+    int ri = (int)(std::min(std::max(r, 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+    int gi = (int)(std::min(std::max(g, 0.0f), 255.0f) * (63.0f / 255.0f) + 0.5f);
+    int bi = (int)(std::min(std::max(b, 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+    return (unsigned short)((ri << 11) | (gi << 5) | bi);
+}
+
+static void UnpackRGB565(unsigned short c, int rgb[3])
+{
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// build the 4-entry palette for a pair of endpoints
+static void BuildColorPalette(unsigned short c0, unsigned short c1, bool allowThreeColor, int palette[4][4])
+{
+    UnpackRGB565(c0, palette[0]);
+    UnpackRGB565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+
+    if (c0 > c1 || !allowThreeColor) {
+        for (int k = 0; k < 3; k++) {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        }
+        palette[2][3] = palette[3][3] = 255;
+    } else {
+        // three-color mode with transparent black (BC1 only)
+        for (int k = 0; k < 3; k++) {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+            palette[3][k] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 0;
+    }
+}
+
+// pick the closest palette entry for each texel, returns the total squared error
+static int PickColorIndices(const unsigned char block[16][4], const int palette[4][4], unsigned* indices_ret)
+{
+    unsigned indices = 0;
+    int totalErr = 0;
+    for (int t = 0; t < 16; t++) {
+        int bestErr = 0x7fffffff;
+        unsigned best = 0;
+        for (unsigned k = 0; k < 4; k++) {
+            int dr = block[t][0] - palette[k][0];
+            int dg = block[t][1] - palette[k][1];
+            int db = block[t][2] - palette[k][2];
+            int err = dr * dr + dg * dg + db * db;
+            if (err < bestErr) {
+                bestErr = err;
+                best = k;
+            }
+        }
+        indices |= best << (2 * t);
+        totalErr += bestErr;
+    }
+    *indices_ret = indices;
+    return totalErr;
+}
+
+// choose endpoints for the given texel-to-palette assignment using least squares
+static bool RefineEndpoints(const unsigned char block[16][4], unsigned indices, unsigned short* c0_ret, unsigned short* c1_ret)
+{
+    // palette weights of endpoint 0 for indices 0..3 (4-color mode)
+    static const float w0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0, ab = 0, bb = 0;
+    float ax[3] = { 0, 0, 0 };
+    float bx[3] = { 0, 0, 0 };
+
+    for (int t = 0; t < 16; t++) {
+        float a = w0[(indices >> (2 * t)) & 3];
+        float b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int k = 0; k < 3; k++) {
+            ax[k] += a * block[t][k];
+            bx[k] += b * block[t][k];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) {
+        return false;
+    }
+
+    float inv = 1.0f / det;
+    float e0[3], e1[3];
+    for (int k = 0; k < 3; k++) {
+        e0[k] = (ax[k] * bb - bx[k] * ab) * inv;
+        e1[k] = (bx[k] * aa - ax[k] * ab) * inv;
+    }
+
+    *c0_ret = PackRGB565(e0[0], e0[1], e0[2]);
+    *c1_ret = PackRGB565(e1[0], e1[1], e1[2]);
+    return true;
+}
+
+static void WriteColorBlock(unsigned short c0, unsigned short c1, unsigned indices, unsigned char* dst)
+{
+    dst[0] = (unsigned char)(c0 & 0xff);
+    dst[1] = (unsigned char)(c0 >> 8);
+    dst[2] = (unsigned char)(c1 & 0xff);
+    dst[3] = (unsigned char)(c1 >> 8);
+    dst[4] = (unsigned char)(indices & 0xff);
+    dst[5] = (unsigned char)((indices >> 8) & 0xff);
+    dst[6] = (unsigned char)((indices >> 16) & 0xff);
+    dst[7] = (unsigned char)(indices >> 24);
+}
+
+// encode the color part of a block (8 bytes), always in 4-color mode
+static void EncodeColorBlock(const unsigned char block[16][4], unsigned char* dst)
+{
+    // mean and covariance of the block colors
+    float mean[3] = { 0, 0, 0 };
+    for (int t = 0; t < 16; t++) {
+        for (int k = 0; k < 3; k++) {
+            mean[k] += block[t][k];
+        }
+    }
+    for (int k = 0; k < 3; k++) {
+        mean[k] *= 1.0f / 16.0f;
+    }
+
+    float cov[6] = { 0, 0, 0, 0, 0, 0 };    // rr, rg, rb, gg, gb, bb
+    for (int t = 0; t < 16; t++) {
+        float r = block[t][0] - mean[0];
+        float g = block[t][1] - mean[1];
+        float b = block[t][2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    // principal axis by power iteration
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iter = 0; iter < 8; iter++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float m = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (m < 1e-6f) {
+            break;
+        }
+        axis[0] = x / m;
+        axis[1] = y / m;
+        axis[2] = z / m;
+    }
+
+    float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    if (len2 < 1e-6f) {
+        len2 = 1.0f;
+    }
+
+    // project texels onto the axis to find the extremes
+    float minT = 1e30f, maxT = -1e30f;
+    for (int t = 0; t < 16; t++) {
+        float d = (block[t][0] - mean[0]) * axis[0] + (block[t][1] - mean[1]) * axis[1] + (block[t][2] - mean[2]) * axis[2];
+        minT = std::min(minT, d);
+        maxT = std::max(maxT, d);
+    }
+    minT /= len2;
+    maxT /= len2;
+
+    unsigned short c0 = PackRGB565(mean[0] + maxT * axis[0], mean[1] + maxT * axis[1], mean[2] + maxT * axis[2]);
+    unsigned short c1 = PackRGB565(mean[0] + minT * axis[0], mean[1] + minT * axis[1], mean[2] + minT * axis[2]);
+
+    int palette[4][4];
+    unsigned indices = 0;
+
+    if (c0 == c1) {
+        // solid block
+        WriteColorBlock(c0, c1, 0, dst);
+        return;
+    }
+
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    BuildColorPalette(c0, c1, false, palette);
+    int err = PickColorIndices(block, palette, &indices);
+
+    // one round of least-squares refinement; keep it only if it helps
+    unsigned short r0, r1;
+    if (RefineEndpoints(block, indices, &r0, &r1) && r0 != r1) {
+        if (r0 < r1) {
+            std::swap(r0, r1);
+        }
+        int refinedPalette[4][4];
+        unsigned refinedIndices;
+        BuildColorPalette(r0, r1, false, refinedPalette);
+        int refinedErr = PickColorIndices(block, refinedPalette, &refinedIndices);
+        if (refinedErr < err) {
+            c0 = r0;
+            c1 = r1;
+            indices = refinedIndices;
+        }
+    }
+
+    WriteColorBlock(c0, c1, indices, dst);
+}
+
+// encode the alpha part of a BC3 block (8 bytes), using the 8-value interpolation mode
+static void EncodeAlphaBlock(const unsigned char block[16][4], unsigned char* dst)
+{
+    int a0 = 0, a1 = 255;
+    for (int t = 0; t < 16; t++) {
+        a0 = std::max(a0, (int)block[t][3]);
+        a1 = std::min(a1, (int)block[t][3]);
+    }
+
+    dst[0] = (unsigned char)a0;
+    dst[1] = (unsigned char)a1;
+
+    unsigned long long bits = 0;
+
+    if (a0 > a1) {
+        int palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        for (int k = 1; k < 7; k++) {
+            palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        }
+
+        for (int t = 0; t < 16; t++) {
+            int bestErr = 256;
+            unsigned long long best = 0;
+            for (int k = 0; k < 8; k++) {
+                int err = std::abs(block[t][3] - palette[k]);
+                if (err < bestErr) {
+                    bestErr = err;
+                    best = k;
+                }
+            }
+            bits |= best << (3 * t);
+        }
+    }
+
+    for (int i = 0; i < 6; i++) {
+        dst[2 + i] = (unsigned char)((bits >> (8 * i)) & 0xff);
+    }
+}
+
+static void DecodeColorBlock(const unsigned char* src, bool allowThreeColor, unsigned char block[16][4])
+{
+    unsigned short c0 = (unsigned short)(src[0] | (src[1] << 8));
+    unsigned short c1 = (unsigned short)(src[2] | (src[3] << 8));
+    unsigned indices = src[4] | (src[5] << 8) | (src[6] << 16) | ((unsigned)src[7] << 24);
+
+    int palette[4][4];
+    BuildColorPalette(c0, c1, allowThreeColor, palette);
+
+    for (int t = 0; t < 16; t++) {
+        const int* c = palette[(indices >> (2 * t)) & 3];
+        block[t][0] = (unsigned char)c[0];
+        block[t][1] = (unsigned char)c[1];
+        block[t][2] = (unsigned char)c[2];
+        block[t][3] = (unsigned char)c[3];
+    }
+}
+
+static void DecodeAlphaBlock(const unsigned char* src, unsigned char block[16][4])
+{
+    int a0 = src[0];
+    int a1 = src[1];
+
+    int palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int k = 1; k < 7; k++) {
+            palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        }
+    } else {
+        for (int k = 1; k < 5; k++) {
+            palette[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    unsigned long long bits = 0;
+    for (int i = 0; i < 6; i++) {
+        bits |= (unsigned long long)src[2 + i] << (8 * i);
+    }
+
+    for (int t = 0; t < 16; t++) {
+        block[t][3] = (unsigned char)palette[(bits >> (3 * t)) & 7];
+    }
+}
+
+// encode rows of blocks [firstRow, endRow) of one image level
+static void EncodeBlockRows(const unsigned char* data, int width, int height, int bpp, CompressedFormat fmt,
+                            int firstRow, int endRow, unsigned char* dst)
+{
+    int blocksWide = (width + 3) / 4;
+    int blockSize = (fmt == COMPRESSED_BC1) ? 8 : 16;
+
+    unsigned char block[16][4];
+
+    for (int by = firstRow; by < endRow; by++) {
+        unsigned char* q = dst + by * blocksWide * blockSize;
+        for (int bx = 0; bx < blocksWide; bx++) {
+            FetchBlock(data, width, height, bpp, bx, by, block);
+            if (fmt == COMPRESSED_BC3) {
+                EncodeAlphaBlock(block, q);
+                EncodeColorBlock(block, q + 8);
+            } else {
+                EncodeColorBlock(block, q);
+            }
+            q += blockSize;
+        }
+    }
+}
+
+bool Image::Compress(CompressedImage* pRet, CompressedFormat fmt, int numThreads) const
+{
+    if (!pRet || !isGood() || (fmt != COMPRESSED_BC1 && fmt != COMPRESSED_BC3)) {
+        return false;
+    }
+
+    if (numThreads <= 0) {
+        numThreads = (int)std::thread::hardware_concurrency();
+        if (numThreads <= 0) {
+            numThreads = 1;
+        }
+    }
+
+    pRet->Clear();
+    pRet->mFormat = fmt;
+    pRet->mLevels.resize(mMipmaps.size());
+
+    int blockSize = pRet->getBlockSize();
+
+    for (unsigned i = 0; i < mMipmaps.size(); i++) {
+        const Mipmap& mip = mMipmaps[i];
+        CompressedImage::Level& level = pRet->mLevels[i];
+
+        int blocksWide = (mip.width + 3) / 4;
+        int blocksHigh = (mip.height + 3) / 4;
+
+        level.width = mip.width;
+        level.height = mip.height;
+        level.blocks.resize(blocksWide * blocksHigh * blockSize);
+
+        // split the block rows among worker threads; small levels aren't worth the thread startup
+        int n = std::min(numThreads, blocksHigh);
+        if (blocksWide * blocksHigh < 256) {
+            n = 1;
+        }
+
+        if (n <= 1) {
+            EncodeBlockRows(mip.data, mip.width, mip.height, mBytesPerPixel, fmt, 0, blocksHigh, &level.blocks[0]);
+        } else {
+            std::vector<std::thread> workers;
+            int rowsPerThread = (blocksHigh + n - 1) / n;
+            for (int t = 0; t < n; t++) {
+                int first = t * rowsPerThread;
+                int end = std::min(first + rowsPerThread, blocksHigh);
+                if (first >= end) {
+                    break;
+                }
+                workers.push_back(std::thread(EncodeBlockRows, mip.data, mip.width, mip.height, mBytesPerPixel, fmt,
+                                              first, end, &level.blocks[0]));
+            }
+            for (auto& w : workers) {
+                w.join();
+            }
+        }
+    }
+
+    return true;
+}
+
+
+CompressedImage::CompressedImage()
+    : mFormat(COMPRESSED_NONE)
+{
+}
+
+void CompressedImage::Clear()
+{
+    mFormat = COMPRESSED_NONE;
+    mLevels.clear();
+}
+
+size_t CompressedImage::getSizeInBytes() const
+{
+    size_t size = 0;
+    for (const Level& level : mLevels) {
+        size += level.blocks.size();
+    }
+    return size;
+}
+
+bool CompressedImage::Decompress(Image* pRet, int level) const
+{
+    if (!pRet || !isGood() || level < 0 || level >= numLevels()) {
+        return false;
+    }
+
+    const Level& src = mLevels[level];
+
+    if (!pRet->Allocate(src.width, src.height, 4)) {
+        return false;
+    }
+
+    int blocksWide = (src.width + 3) / 4;
+    int blocksHigh = (src.height + 3) / 4;
+    int blockSize = getBlockSize();
+
+    unsigned char* dstData = pRet->getData();
+    unsigned char block[16][4];
+
+    for (int by = 0; by < blocksHigh; by++) {
+        for (int bx = 0; bx < blocksWide; bx++) {
+            const unsigned char* p = &src.blocks[(by * blocksWide + bx) * blockSize];
+            if (mFormat == COMPRESSED_BC3) {
+                DecodeColorBlock(p + 8, false, block);
+                DecodeAlphaBlock(p, block);
+            } else {
+                DecodeColorBlock(p, true, block);
+            }
+
+            // copy the texels that fall inside the image
+            for (int j = 0; j < 4; j++) {
+                int y = 4 * by + j;
+                if (y >= src.height) {
+                    break;
+                }
+                for (int i = 0; i < 4; i++) {
+                    int x = 4 * bx + i;
+                    if (x >= src.width) {
+                        break;
+                    }
+                    unsigned char* q = dstData + 4 * (y * src.width + x);
+                    q[0] = block[4 * j + i][0];
+                    q[1] = block[4 * j + i][1];
+                    q[2] = block[4 * j + i][2];
+                    q[3] = block[4 * j + i][3];
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+double ComputePSNR(const Image& a, const Image& b)
+{
+    if (!a.isGood() || !b.isGood() || a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight()) {
+        return -1.0;
+    }
+
+    // compare in RGBA so images with different channel counts can be compared
+    int width = a.getWidth();
+    int height = a.getHeight();
+    int blocksWide = (width + 3) / 4;
+    int blocksHigh = (height + 3) / 4;
+
+    unsigned char blockA[16][4];
+    unsigned char blockB[16][4];
+
+    double sumSq = 0.0;
+
+    for (int by = 0; by < blocksHigh; by++) {
+        for (int bx = 0; bx < blocksWide; bx++) {
+            FetchBlock(a.getData(), width, height, a.getBytesPerPixel(), bx, by, blockA);
+            FetchBlock(b.getData(), width, height, b.getBytesPerPixel(), bx, by, blockB);
+            for (int t = 0; t < 16; t++) {
+                if (4 * bx + t % 4 >= width || 4 * by + t / 4 >= height) {
+                    continue;   // clamped texel outside the image
+                }
+                for (int k = 0; k < 4; k++) {
+                    double d = (double)blockA[t][k] - (double)blockB[t][k];
+                    sumSq += d * d;
+                }
+            }
+        }
+    }
+
+    double mse = sumSq / (4.0 * width * height);
+    if (mse <= 0.0) {
+        return 99.0;    // identical
+    }
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+size_t GetImageSizeInBytes(const Image& img)
+{
+    size_t size = 0;
+    for (int i = 0; i < img.numMipmaps(); i++) {
+        size += (size_t)img.getMipmapWidth(i) * img.getMipmapHeight(i) * img.getBytesPerPixel();
+    }
+    return size;
+}
+
 } // end of namespace
@@ -8,6 +8,16 @@ namespace glsh {
 
 // a forward declaration
 struct TargaHeader;
+class CompressedImage;
+
+//
+// Block compression formats supported by the CPU encoder
+//
+enum CompressedFormat {
+    COMPRESSED_NONE,
+    COMPRESSED_BC1,         // 4x4 blocks, 8 bytes each, RGB with no alpha (S3TC DXT1)
+    COMPRESSED_BC3,         // 4x4 blocks, 16 bytes each, RGB with interpolated alpha (S3TC DXT5)
+};
 
 
 class Image {
@@ -32,6 +42,7 @@ public:
     unsigned char*          getData()                   { return mData; }
 
     bool                    LoadTarga(const std::string& path);
+    bool                    SaveTarga(const std::string& path) const;     // uncompressed, top level only
 
 private:
 
@@ -74,8 +85,60 @@ public:
     int                     getMipmapHeight(int level) const    { return mMipmaps[level].height; }
     const unsigned char*    getMipmapData(int level) const      { return mMipmaps[level].data; }
     unsigned char*          getMipmapData(int level)            { return mMipmaps[level].data; }
+
+    //
+    // block compression
+    //
+
+    // encode all mipmap levels; numThreads <= 0 means use all hardware threads
+    bool                    Compress(CompressedImage* pRet, CompressedFormat fmt, int numThreads = 0) const;
+};
+
+
+//
+// Block-compressed image data, ready for glCompressedTexImage2D
+//
+class CompressedImage {
+public:
+    struct Level {
+        int                         width, height;
+        std::vector<unsigned char>  blocks;
+    };
+
+private:
+    CompressedFormat        mFormat;
+    std::vector<Level>      mLevels;
+
+    friend class            Image;
+
+public:
+                            CompressedImage();
+
+    void                    Clear();
+
+    bool                    isGood() const                      { return mFormat != COMPRESSED_NONE && !mLevels.empty(); }
+    CompressedFormat        getFormat() const                   { return mFormat; }
+    int                     getWidth() const                    { return mLevels.empty() ? 0 : mLevels[0].width; }
+    int                     getHeight() const                   { return mLevels.empty() ? 0 : mLevels[0].height; }
+
+    int                     numLevels() const                   { return (int)mLevels.size(); }
+    const Level&            getLevel(int level) const           { return mLevels[level]; }
+
+    int                     getBlockSize() const                { return mFormat == COMPRESSED_BC1 ? 8 : 16; }
+    size_t                  getSizeInBytes() const;             // total size of all levels
+
+    // software decoder, always produces a 4 bytes-per-pixel RGBA image
+    bool                    Decompress(Image* pRet, int level = 0) const;
 };
 
+//
+// Image comparison (useful for checking compression quality without a GL context)
+//
+double ComputePSNR(const Image& a, const Image& b);
+
+// size of an uncompressed image including all of its mipmaps
+size_t GetImageSizeInBytes(const Image& img);
+
 } // end of namespace
 
 #endif
@@ -0,0 +1,460 @@
+#include "GLSH_InputLog.h"
+#include "GLSH_Profiler.h"
+#include "GLSH_Util.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <iostream>
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace glsh {
+
+namespace {
+
+const char                  INPUT_LOG_MAGIC[8]  = { 'G', 'L', 'S', 'H', 'I', 'N', 'P', '1' };
+const uint32_t              INPUT_LOG_VERSION   = 1;
+const size_t                INPUT_LOG_HEADER    = 8 + 4 + 4 + 2 + 2;
+
+std::string                 gPath;
+bool                        gRecording = false;
+bool                        gReplaying = false;
+int                         gWidth = 0;
+int                         gHeight = 0;
+
+// recording
+FILE*                       gFile = NULL;
+int                         gFd = -1;               // gFile's descriptor, for the crash handlers
+std::vector<unsigned char>  gBuf;                   // the current tick's records, written out when it ends
+uint32_t                    gSeedState = 0;         // where the tick seeds come from
+uint64_t                    gTickStartNs = 0;
+size_t                      gBytesWritten = 0;
+
+// replaying; logs are small enough to read whole
+std::vector<unsigned char>  gLog;
+size_t                      gPos = 0;
+unsigned                    gMismatches = 0;
+unsigned                    gFirstMismatch = 0;
+
+unsigned                    gTicks = 0;
+
+void Flush()
+{
+    if (gFile && !gBuf.empty()) {
+        std::fwrite(&gBuf[0], 1, gBuf.size(), gFile);
+        gBytesWritten += gBuf.size();
+    }
+    gBuf.clear();
+}
+
+// a crash can still write what the current tick recorded; everything before it is already in the
+// file. Only calls that are safe in a signal handler, so no stdio.
+void WritePending()
+{
+    if (gFd >= 0 && !gBuf.empty()) {
+#ifdef _WIN32
+        _write(gFd, &gBuf[0], (unsigned)gBuf.size());
+#else
+        ssize_t written = write(gFd, &gBuf[0], gBuf.size());
+        (void)written;
+#endif
+    }
+    gFd = -1;
+}
+
+void OnCrash(int sig)
+{
+    if (gRecording) {
+        WritePending();
+    }
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+void OnTerminate()
+{
+    if (gRecording) {
+        WritePending();
+    }
+    std::abort();
+}
+
+// exit() without the app shutting down
+void OnExit()
+{
+    StopInputLog();
+}
+
+void InstallCrashHandlers()
+{
+    static bool installed = false;
+    if (installed) {
+        return;
+    }
+    installed = true;
+
+    std::atexit(OnExit);
+    std::set_terminate(OnTerminate);
+    std::signal(SIGSEGV, OnCrash);
+    std::signal(SIGABRT, OnCrash);
+    std::signal(SIGFPE, OnCrash);
+    std::signal(SIGILL, OnCrash);
+}
+
+void PutBytes(const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    gBuf.insert(gBuf.end(), p, p + size);
+}
+
+// little-endian, like every platform this runs on
+void Put8(uint8_t v)        { PutBytes(&v, 1); }
+void Put16(uint16_t v)      { PutBytes(&v, 2); }
+void Put32(uint32_t v)      { PutBytes(&v, 4); }
+void PutF(float v)          { uint32_t u; std::memcpy(&u, &v, 4); Put32(u); }
+
+int16_t Clamp16(int v)
+{
+    return (int16_t)(v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+}
+
+bool GetBytes(void* data, size_t size)
+{
+    if (gPos + size > gLog.size()) {
+        return false;
+    }
+    std::memcpy(data, &gLog[gPos], size);
+    gPos += size;
+    return true;
+}
+
+template <typename T>
+bool Get(T& v)
+{
+    return GetBytes(&v, sizeof(T));
+}
+
+// a new seed for every tick (xorshift32), so a tick's randomness doesn't depend on the ticks before it
+uint32_t NextSeed()
+{
+    uint32_t x = gSeedState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gSeedState = x;
+    return x;
+}
+
+bool ReadRecord(InputRecord& r)
+{
+    uint8_t type;
+    if (!Get(type) || type >= NUM_INPUT_RECORD_TYPES) {
+        return false;
+    }
+    r.type = (InputRecordType)type;
+    r.ms = 0;
+    r.code = 0;
+    r.x = r.y = 0;
+
+    uint16_t ms;
+    uint8_t code;
+    int8_t delta;
+    int16_t x, y;
+
+    switch (r.type) {
+    case INPUT_KEY_DOWN:
+    case INPUT_KEY_UP:
+        if (!Get(ms) || !Get(code)) return false;
+        r.ms = ms;
+        r.code = code;
+        return true;
+    case INPUT_BUTTON_DOWN:
+    case INPUT_BUTTON_UP:
+        if (!Get(ms) || !Get(code) || !Get(x) || !Get(y)) return false;
+        r.ms = ms;
+        r.code = code;
+        r.x = x;
+        r.y = y;
+        return true;
+    case INPUT_CURSOR:
+        if (!Get(ms) || !Get(x) || !Get(y)) return false;
+        r.ms = ms;
+        r.x = x;
+        r.y = y;
+        return true;
+    case INPUT_WHEEL:
+        if (!Get(ms) || !Get(delta)) return false;
+        r.ms = ms;
+        r.code = delta;
+        return true;
+    case INPUT_FOCUS_LOST:
+        if (!Get(ms)) return false;
+        r.ms = ms;
+        return true;
+    default:
+        // tick and check records are read by the tick functions
+        return false;
+    }
+}
+
+} // end of anonymous namespace
+
+bool StartInputRecording(const std::string& path, int width, int height)
+{
+    StopInputLog();
+
+    gFile = std::fopen(path.c_str(), "wb");
+    if (!gFile) {
+        std::cerr << "*** Failed to open input log " << path << " for writing" << std::endl;
+        return false;
+    }
+#ifdef _WIN32
+    gFd = _fileno(gFile);
+#else
+    gFd = fileno(gFile);
+#endif
+
+    gSeedState = (uint32_t)time(NULL) ^ (uint32_t)Profiler::Now();
+    if (!gSeedState) {
+        gSeedState = 1;
+    }
+    uint32_t seed = NextSeed();
+
+    gBuf.reserve(4 * 1024);
+    PutBytes(INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC));
+    Put32(INPUT_LOG_VERSION);
+    Put32(seed);
+    Put16((uint16_t)width);
+    Put16((uint16_t)height);
+
+    // for what the app randomizes before its first update
+    InitRandom(seed);
+
+    gPath = path;
+    gWidth = width;
+    gHeight = height;
+    gTicks = 0;
+    gBytesWritten = 0;
+    gTickStartNs = Profiler::Now();
+    gRecording = true;
+
+    InstallCrashHandlers();
+
+    std::cout << "Recording input to " << path << std::endl;
+    return true;
+}
+
+bool StartInputReplay(const std::string& path)
+{
+    StopInputLog();
+
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        std::cerr << "*** Failed to open input log " << path << std::endl;
+        return false;
+    }
+    gLog.clear();
+    unsigned char chunk[64 * 1024];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        gLog.insert(gLog.end(), chunk, chunk + n);
+    }
+    std::fclose(f);
+
+    gPos = 0;
+    char magic[8];
+    uint32_t version = 0, seed = 0;
+    uint16_t width = 0, height = 0;
+    if (gLog.size() < INPUT_LOG_HEADER || !GetBytes(magic, 8) || std::memcmp(magic, INPUT_LOG_MAGIC, 8) != 0
+        || !Get(version) || version != INPUT_LOG_VERSION || !Get(seed) || !Get(width) || !Get(height)) {
+        std::cerr << "*** " << path << " isn't an input log of this version" << std::endl;
+        gLog.clear();
+        return false;
+    }
+
+    InitRandom(seed);
+
+    gPath = path;
+    gWidth = width;
+    gHeight = height;
+    gTicks = 0;
+    gMismatches = 0;
+    gFirstMismatch = 0;
+    gReplaying = true;
+
+    std::cout << "Replaying input from " << path << std::endl;
+    return true;
+}
+
+void StopInputLog()
+{
+    if (gRecording) {
+        gRecording = false;
+        if (gFile) {
+            Flush();
+            gFd = -1;
+            std::fclose(gFile);
+            gFile = NULL;
+        }
+
+        std::cout << "Recorded " << gTicks << " ticks of input to " << gPath << " (" << (gBytesWritten + 1023) / 1024 << " KB)" << std::endl;
+    }
+
+    if (gReplaying) {
+        gReplaying = false;
+        gLog.clear();
+
+        if (gMismatches) {
+            std::cerr << "*** Replayed " << gTicks << " ticks from " << gPath << "; the state differed from the recording in "
+                      << gMismatches << " of them, first after tick " << gFirstMismatch << std::endl;
+        } else {
+            std::cout << "Replayed " << gTicks << " ticks from " << gPath << "; the state matched the recording" << std::endl;
+        }
+    }
+}
+
+bool IsInputRecording()
+{
+    return gRecording;
+}
+
+bool IsInputReplaying()
+{
+    return gReplaying;
+}
+
+int GetInputReplayWidth()
+{
+    return gWidth;
+}
+
+int GetInputReplayHeight()
+{
+    return gHeight;
+}
+
+unsigned GetInputReplayMismatches()
+{
+    return gMismatches;
+}
+
+void RecordInput(InputRecordType type, int code, int x, int y)
+{
+    if (!gRecording) {
+        return;
+    }
+
+    uint64_t ms = (Profiler::Now() - gTickStartNs) / 1000000;
+    Put8((uint8_t)type);
+    Put16((uint16_t)(ms < 65535 ? ms : 65535));
+
+    switch (type) {
+    case INPUT_KEY_DOWN:
+    case INPUT_KEY_UP:
+        Put8((uint8_t)code);
+        break;
+    case INPUT_BUTTON_DOWN:
+    case INPUT_BUTTON_UP:
+        Put8((uint8_t)code);
+        Put16((uint16_t)Clamp16(x));
+        Put16((uint16_t)Clamp16(y));
+        break;
+    case INPUT_CURSOR:
+        Put16((uint16_t)Clamp16(x));
+        Put16((uint16_t)Clamp16(y));
+        break;
+    case INPUT_WHEEL:
+        Put8((uint8_t)(int8_t)(code < -128 ? -128 : code > 127 ? 127 : code));
+        break;
+    default:
+        break;
+    }
+}
+
+bool BeginInputTick(float& dt, std::vector<InputRecord>& events)
+{
+    events.clear();
+
+    if (gRecording) {
+        uint32_t seed = NextSeed();
+        Put8(INPUT_TICK);
+        PutF(dt);
+        Put32(seed);
+
+        InitRandom(seed);
+        gTickStartNs = Profiler::Now();
+        ++gTicks;
+        return true;
+    }
+
+    if (gReplaying) {
+        while (gPos < gLog.size()) {
+            uint8_t type = gLog[gPos];
+
+            if (type == INPUT_TICK) {
+                uint32_t seed;
+                gPos += 1;
+                if (!Get(dt) || !Get(seed)) {
+                    return false;
+                }
+                InitRandom(seed);
+                ++gTicks;
+                return true;
+            }
+
+            if (type == INPUT_CHECK) {
+                // a tick that wasn't checked here
+                uint32_t checksum;
+                gPos += 1;
+                if (!Get(checksum)) {
+                    return false;
+                }
+                continue;
+            }
+
+            InputRecord r;
+            if (!ReadRecord(r)) {
+                return false;
+            }
+            events.push_back(r);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+void EndInputTick(uint32_t checksum)
+{
+    if (gRecording) {
+        Put8(INPUT_CHECK);
+        Put32(checksum);
+
+        // a crash or a killed process loses at most the tick it happened in
+        Flush();
+        std::fflush(gFile);
+        return;
+    }
+
+    if (gReplaying && gPos < gLog.size() && gLog[gPos] == INPUT_CHECK) {
+        uint32_t recorded;
+        gPos += 1;
+        if (Get(recorded) && recorded != checksum) {
+            if (!gMismatches) {
+                gFirstMismatch = gTicks;
+                std::cerr << "*** The replay left the recording after tick " << gTicks << std::endl;
+            }
+            ++gMismatches;
+        }
+    }
+}
+
+} // end of namespace
@@ -0,0 +1,94 @@
+#ifndef GLSH_INPUTLOG_H_
+#define GLSH_INPUTLOG_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// Input recording and replay
+//
+//     While recording, System writes every key, mouse button, cursor and wheel input a window gets
+//     to a compact binary log, stamped with the milliseconds since the tick began. Each update then
+//     gets a tick record with its time step and a fresh seed, which is passed to InitRandom before
+//     the update runs, and after the update a checksum of the app's state (App::getStateChecksum).
+//
+//     Replaying feeds the log back instead of the live input: each tick gets the same input, time
+//     step and seed, so the app makes the same decisions. The checksums are compared as it goes and
+//     the first tick that differs is reported. The app is asked to quit when the log runs out.
+//
+//     The log is flushed after every tick. If the app crashes or exits without stopping the log,
+//     the input of the tick that was running is written out as well.
+//
+//     Start either before the app is initialized; the log also has the seed for what initialize()
+//     randomizes and the window size, which the app's simulation may depend on (a window resized
+//     while recording won't replay the same).
+//
+//     file:    "GLSHINP1", uint32 version, uint32 seed, uint16 width, uint16 height
+//     records: uint8 type, then
+//              key down/up         uint16 ms, uint8 key
+//              button down/up      uint16 ms, uint8 button, int16 x, int16 y
+//              cursor              uint16 ms, int16 x, int16 y
+//              wheel               uint16 ms, int8 delta
+//              focus lost          uint16 ms
+//              tick                float dt, uint32 seed       (after the tick's input)
+//              check               uint32 checksum             (after the tick's update)
+//
+namespace glsh {
+
+enum InputRecordType {
+    INPUT_KEY_DOWN,
+    INPUT_KEY_UP,
+    INPUT_BUTTON_DOWN,
+    INPUT_BUTTON_UP,
+    INPUT_CURSOR,
+    INPUT_WHEEL,
+    INPUT_FOCUS_LOST,
+    INPUT_TICK,
+    INPUT_CHECK,
+    NUM_INPUT_RECORD_TYPES
+};
+
+struct InputRecord {
+    InputRecordType     type;
+    unsigned            ms;         // since the start of the tick
+    int                 code;       // key, button or wheel delta
+    int                 x, y;       // cursor
+};
+
+// path is overwritten; returns false if it can't be created
+bool StartInputRecording(const std::string& path, int width, int height);
+
+// returns false if path isn't an input log
+bool StartInputReplay(const std::string& path);
+
+// ends a recording or a replay and reports the ticks, and any checksums that differed
+void StopInputLog();
+
+bool IsInputRecording();
+bool IsInputReplaying();
+
+// the window size of the log being replayed
+int GetInputReplayWidth();
+int GetInputReplayHeight();
+
+// ticks of the last replay whose checksum differed from the recording
+unsigned GetInputReplayMismatches();
+
+//
+// called by System
+//
+
+// input arriving while recording
+void RecordInput(InputRecordType type, int code, int x, int y);
+
+// the start of a tick: writes or reads its time step and seed, and seeds the random numbers.
+// When replaying, the tick's input is returned in events; false once the log has ended
+bool BeginInputTick(float& dt, std::vector<InputRecord>& events);
+
+// after the update
+void EndInputTick(uint32_t checksum);
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,326 @@
+#include "GLSH_Memory.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <unordered_map>
+
+namespace glsh {
+
+namespace {
+
+// heap counters; constant-initialized, so they work for allocations made before main
+std::atomic<unsigned>       gFrameAllocs[NUM_MEMORY_TAGS];
+std::atomic<size_t>         gFrameAllocBytes[NUM_MEMORY_TAGS];
+std::atomic<unsigned>       gFrameFrees;
+std::atomic<size_t>         gHeapBytes[NUM_MEMORY_TAGS];
+std::atomic<size_t>         gTotalHeapBytes;
+std::atomic<size_t>         gPeakHeapBytes;
+
+// the first allocation of the frame, for the zero-allocation report
+std::atomic<unsigned>       gFrameAllocCount;
+std::atomic<size_t>         gFirstAllocSize;
+std::atomic<int>            gFirstAllocTag;
+
+thread_local MemoryTag      tMemoryTag = MEMORY_TAG_OTHER;
+
+// GPU memory is only tracked on the GL thread
+std::unordered_map<uint64_t, size_t>    gGPUObjects;
+size_t                      gGPUBytes[NUM_GPU_RESOURCE_TYPES];
+
+MemoryFrameStats            gLastFrameStats;
+
+bool                        gZeroAllocationCheck = false;
+bool                        gSteadyStateFrame = false;
+
+const char* const           TAG_NAMES[NUM_MEMORY_TAGS] = { "other", "update", "draw", "text", "loading" };
+const char* const           GPU_TYPE_NAMES[NUM_GPU_RESOURCE_TYPES] = { "vertex buffers", "index buffers", "stream buffers", "textures", "framebuffers" };
+
+#if GLSH_MEMORY_TRACKING
+
+// keeps the user pointer aligned like malloc's
+struct BlockHeader {
+    uint64_t    size;
+    uint32_t    tag;
+    uint32_t    magic;
+};
+
+const uint32_t              BLOCK_MAGIC = 0x6c6c6f63;
+const size_t                HEADER_SIZE = 16;
+
+static_assert(sizeof(BlockHeader) <= HEADER_SIZE, "block header doesn't fit");
+
+void* Allocate(size_t size)
+{
+    BlockHeader* h = static_cast<BlockHeader*>(std::malloc(size + HEADER_SIZE));
+    if (!h) {
+        return NULL;
+    }
+
+    MemoryTag tag = tMemoryTag;
+    h->size = size;
+    h->tag = tag;
+    h->magic = BLOCK_MAGIC;
+
+    gFrameAllocs[tag].fetch_add(1, std::memory_order_relaxed);
+    gFrameAllocBytes[tag].fetch_add(size, std::memory_order_relaxed);
+    gHeapBytes[tag].fetch_add(size, std::memory_order_relaxed);
+
+    if (gFrameAllocCount.fetch_add(1, std::memory_order_relaxed) == 0) {
+        gFirstAllocSize.store(size, std::memory_order_relaxed);
+        gFirstAllocTag.store(tag, std::memory_order_relaxed);
+    }
+
+    size_t total = gTotalHeapBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = gPeakHeapBytes.load(std::memory_order_relaxed);
+    while (total > peak && !gPeakHeapBytes.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+
+    return reinterpret_cast<char*>(h) + HEADER_SIZE;
+}
+
+void Free(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    BlockHeader* h = reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - HEADER_SIZE);
+    if (h->magic != BLOCK_MAGIC || h->tag >= NUM_MEMORY_TAGS) {
+        // not ours (or a double delete): can't be freed safely
+        std::fputs("*** glsh: operator delete on a block operator new didn't return\n", stderr);
+        std::abort();
+    }
+    h->magic = 0;
+
+    gFrameFrees.fetch_add(1, std::memory_order_relaxed);
+    gHeapBytes[h->tag].fetch_sub((size_t)h->size, std::memory_order_relaxed);
+    gTotalHeapBytes.fetch_sub((size_t)h->size, std::memory_order_relaxed);
+
+    std::free(h);
+}
+
+#endif
+
+void ReportSteadyStateAllocations(const MemoryFrameStats& stats)
+{
+    std::cerr << "*** " << stats.totalAllocs() << " allocations (" << stats.totalAllocBytes()
+              << " bytes) in a steady-state frame:";
+    for (int t = 0; t < NUM_MEMORY_TAGS; t++) {
+        if (stats.allocs[t]) {
+            std::cerr << " " << TAG_NAMES[t] << " " << stats.allocs[t] << " (" << stats.allocBytes[t] << " bytes)";
+        }
+    }
+    std::cerr << "\n    the first one was " << gFirstAllocSize.load() << " bytes, tagged " << TAG_NAMES[gFirstAllocTag.load()] << std::endl;
+}
+
+} // end of anonymous namespace
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+    return tag >= 0 && tag < NUM_MEMORY_TAGS ? TAG_NAMES[tag] : "?";
+}
+
+const char* GetGPUResourceTypeName(GPUResourceType type)
+{
+    return type >= 0 && type < NUM_GPU_RESOURCE_TYPES ? GPU_TYPE_NAMES[type] : "?";
+}
+
+MemoryFrameStats::MemoryFrameStats()
+    : frees(0)
+    , peakHeapBytes(0)
+{
+    for (int t = 0; t < NUM_MEMORY_TAGS; t++) {
+        allocs[t] = 0;
+        allocBytes[t] = 0;
+        heapBytes[t] = 0;
+    }
+    for (int r = 0; r < NUM_GPU_RESOURCE_TYPES; r++) {
+        gpuBytes[r] = 0;
+    }
+}
+
+unsigned MemoryFrameStats::totalAllocs() const
+{
+    unsigned n = 0;
+    for (int t = 0; t < NUM_MEMORY_TAGS; t++) {
+        n += allocs[t];
+    }
+    return n;
+}
+
+size_t MemoryFrameStats::totalAllocBytes() const
+{
+    size_t n = 0;
+    for (int t = 0; t < NUM_MEMORY_TAGS; t++) {
+        n += allocBytes[t];
+    }
+    return n;
+}
+
+size_t MemoryFrameStats::totalHeapBytes() const
+{
+    size_t n = 0;
+    for (int t = 0; t < NUM_MEMORY_TAGS; t++) {
+        n += heapBytes[t];
+    }
+    return n;
+}
+
+size_t MemoryFrameStats::totalGPUBytes() const
+{
+    size_t n = 0;
+    for (int r = 0; r < NUM_GPU_RESOURCE_TYPES; r++) {
+        n += gpuBytes[r];
+    }
+    return n;
+}
+
+MemoryTag SetMemoryTag(MemoryTag tag)
+{
+    MemoryTag prev = tMemoryTag;
+    tMemoryTag = tag;
+    return prev;
+}
+
+void TrackGPUMemory(GPUResourceType type, unsigned name, size_t bytes)
+{
+    if (!name) {
+        return;
+    }
+
+    size_t& tracked = gGPUObjects[((uint64_t)type << 32) | name];
+    gGPUBytes[type] += bytes - tracked;
+    tracked = bytes;
+}
+
+void UntrackGPUMemory(GPUResourceType type, unsigned name)
+{
+    std::unordered_map<uint64_t, size_t>::iterator it = gGPUObjects.find(((uint64_t)type << 32) | name);
+    if (it != gGPUObjects.end()) {
+        gGPUBytes[type] -= it->second;
+        gGPUObjects.erase(it);
+    }
+}
+
+void EndMemoryFrame()
+{
+    MemoryFrameStats stats;
+    for (int t = 0; t < NUM_MEMORY_TAGS; t++) {
+        stats.allocs[t] = gFrameAllocs[t].exchange(0, std::memory_order_relaxed);
+        stats.allocBytes[t] = gFrameAllocBytes[t].exchange(0, std::memory_order_relaxed);
+        stats.heapBytes[t] = gHeapBytes[t].load(std::memory_order_relaxed);
+    }
+    stats.frees = gFrameFrees.exchange(0, std::memory_order_relaxed);
+    stats.peakHeapBytes = gPeakHeapBytes.load(std::memory_order_relaxed);
+    for (int r = 0; r < NUM_GPU_RESOURCE_TYPES; r++) {
+        stats.gpuBytes[r] = gGPUBytes[r];
+    }
+
+    if (gZeroAllocationCheck && gSteadyStateFrame && stats.totalAllocs() > 0) {
+        ReportSteadyStateAllocations(stats);
+        std::abort();
+    }
+
+    gFrameAllocCount.store(0, std::memory_order_relaxed);
+    gSteadyStateFrame = false;
+    gLastFrameStats = stats;
+}
+
+const MemoryFrameStats& GetLastFrameMemoryStats()
+{
+    return gLastFrameStats;
+}
+
+void SetZeroAllocationCheck(bool enabled)
+{
+#if GLSH_MEMORY_TRACKING
+    gZeroAllocationCheck = enabled;
+#else
+    if (enabled) {
+        std::cerr << "*** Can't check for allocations, glsh was built without GLSH_MEMORY_TRACKING" << std::endl;
+    }
+#endif
+}
+
+bool IsZeroAllocationCheckEnabled()
+{
+    return gZeroAllocationCheck;
+}
+
+void MarkSteadyStateFrame()
+{
+    gSteadyStateFrame = true;
+}
+
+} // end of namespace
+
+
+#if GLSH_MEMORY_TRACKING
+
+//
+// Replacement global allocation functions (the aligned overloads keep the library's)
+//
+
+void* operator new(size_t size)
+{
+    void* p = glsh::Allocate(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    void* p = glsh::Allocate(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return glsh::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return glsh::Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    glsh::Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    glsh::Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    glsh::Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    glsh::Free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    glsh::Free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    glsh::Free(ptr);
+}
+
+#endif
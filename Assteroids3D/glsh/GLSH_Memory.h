@@ -0,0 +1,113 @@
+#ifndef GLSH_MEMORY_H_
+#define GLSH_MEMORY_H_
+
+#include <cstddef>
+
+//
+// Heap and GPU memory telemetry
+//
+//     glsh replaces the global operator new and delete and counts every allocation, per frame and
+//     per tag. GLSH_MEMORY_SCOPE(tag) tags what the calling thread allocates for the rest of the
+//     enclosing scope; scopes nest and the innermost one wins. Each block carries a 16-byte header
+//     with its size and tag, so frees are attributed too and the live bytes per tag are known.
+//     malloc and allocations inside the GL driver are not seen.
+//
+//     GPU memory is reported by the glsh code that creates and deletes buffers and textures, as the
+//     bytes requested from the driver (its padding and shadow copies aren't known).
+//
+//     System::DisplayCallback closes the frame after swapping buffers, like the GL stats. With the
+//     zero-allocation check on, a frame the app marked as steady-state that allocated anyway is
+//     reported with its counts per tag and the program aborts.
+//
+//     Build with GLSH_MEMORY_TRACKING defined to 0 to leave operator new alone.
+//
+#ifndef GLSH_MEMORY_TRACKING
+#define GLSH_MEMORY_TRACKING 1
+#endif
+
+namespace glsh {
+
+enum MemoryTag {
+    MEMORY_TAG_OTHER,           // untagged, and other threads
+    MEMORY_TAG_UPDATE,
+    MEMORY_TAG_DRAW,
+    MEMORY_TAG_TEXT,
+    MEMORY_TAG_LOADING,
+    NUM_MEMORY_TAGS
+};
+
+enum GPUResourceType {
+    GPU_VERTEX_BUFFER,
+    GPU_INDEX_BUFFER,
+    GPU_STREAM_BUFFER,          // DynamicBuffer storage
+    GPU_TEXTURE,
+    GPU_FRAMEBUFFER,            // render target attachments
+    NUM_GPU_RESOURCE_TYPES
+};
+
+const char* GetMemoryTagName(MemoryTag tag);
+const char* GetGPUResourceTypeName(GPUResourceType type);
+
+struct MemoryFrameStats {
+    unsigned    allocs[NUM_MEMORY_TAGS];
+    size_t      allocBytes[NUM_MEMORY_TAGS];
+    unsigned    frees;
+    size_t      heapBytes[NUM_MEMORY_TAGS];         // live at the end of the frame
+    size_t      peakHeapBytes;                      // since startup
+    size_t      gpuBytes[NUM_GPU_RESOURCE_TYPES];   // resident at the end of the frame
+
+                MemoryFrameStats();
+
+    unsigned    totalAllocs() const;
+    size_t      totalAllocBytes() const;
+    size_t      totalHeapBytes() const;
+    size_t      totalGPUBytes() const;
+};
+
+// tag the calling thread's allocations from now on; returns the previous tag
+MemoryTag SetMemoryTag(MemoryTag tag);
+
+class MemoryScope {
+    MemoryTag               mPrevTag;
+
+                            MemoryScope(const MemoryScope&) = delete;
+    MemoryScope&            operator=(const MemoryScope&) = delete;
+
+public:
+    explicit                MemoryScope(MemoryTag tag)
+        : mPrevTag(SetMemoryTag(tag))
+    { }
+
+                            ~MemoryScope()
+    {
+        SetMemoryTag(mPrevTag);
+    }
+};
+
+// resident GPU memory of a GL object; tracking the same object again replaces its size
+void TrackGPUMemory(GPUResourceType type, unsigned name, size_t bytes);
+void UntrackGPUMemory(GPUResourceType type, unsigned name);
+
+// start counting a new frame
+void EndMemoryFrame();
+
+const MemoryFrameStats& GetLastFrameMemoryStats();
+
+// abort when a frame passed to MarkSteadyStateFrame allocates
+void SetZeroAllocationCheck(bool enabled);
+bool IsZeroAllocationCheckEnabled();
+
+// the frame being run shouldn't allocate: nothing was created or destroyed and containers have warmed up
+void MarkSteadyStateFrame();
+
+} // end of namespace
+
+#if GLSH_MEMORY_TRACKING
+#define GLSH_MEMORY_CONCAT_(a, b)       a##b
+#define GLSH_MEMORY_CONCAT(a, b)        GLSH_MEMORY_CONCAT_(a, b)
+#define GLSH_MEMORY_SCOPE(tag)          ::glsh::MemoryScope GLSH_MEMORY_CONCAT(glshMemoryScope, __LINE__)(tag)
+#else
+#define GLSH_MEMORY_SCOPE(tag)          ((void)0)
+#endif
+
+#endif
@@ -1,10 +1,13 @@
 #include "GLSH_Mesh.h"
+#include "GLSH_GLDebug.h"
 
 #include <iostream>
 
 namespace glsh {
 
-VertexMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts, const VertexFormat& vertexFormat)
+// the attribute pointers come from setupAttribs if it's given, otherwise from vertexFormat
+static VertexMesh* CreateVertexMesh(GLenum drawingMode, const void* verts, unsigned numVerts, GLsizei vertexSize,
+                                    const VertexFormat* vertexFormat, VertexAttribSetupFunc setupAttribs)
 {
     // create a vertex array object (VAO)
     GLuint vao = 0;
@@ -15,14 +18,14 @@ VertexMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts,
     }
 
     // bind the VAO (subsequent vertex attribute info will be stored in this VAO)
-    glBindVertexArray(vao);
+    BindVertexArray(vao);
 
     // create a vertex buffer object (VBO)
     GLuint vbo = 0;
     glGenBuffers(1, &vbo);
     if (!vbo) {
         std::cerr << "*** Poop: Failed to create VBO" << std::endl;
-        glBindVertexArray(0);
+        BindVertexArray(0);
         glDeleteVertexArrays(1, &vao);
         return NULL;
     }
@@ -32,34 +35,43 @@ VertexMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts,
 
     // resize and fill the buffer (copy the vertex data into it)
     glBufferData(GL_ARRAY_BUFFER,               // the buffer to resize and fill
-                 vertexFormat.getVertexSizeInBytes() * numVerts,  // total size in bytes
+                 vertexSize * numVerts,         // total size in bytes
                  verts,                         // address of data in RAM
                  GL_STATIC_DRAW);               // buffer usage drawingMode (GL_STATIC_DRAW == read-only == fast drawing)
+    CountBufferUpload(vertexSize * numVerts);
 
     // describe how the vertex positions are layed out in the active buffer
-    for (unsigned i = 0; i < vertexFormat.numAttribs(); i++) {
-        const VertexAttrib& a = vertexFormat.getAttrib(i);
-        glVertexAttribPointer(a.index, a.size, a.type, GL_FALSE, a.stride, a.offset);
-        glEnableVertexAttribArray(a.index);
+    if (setupAttribs) {
+        setupAttribs(NULL);
+    } else {
+        for (unsigned i = 0; i < vertexFormat->numAttribs(); i++) {
+            const VertexAttrib& a = vertexFormat->getAttrib(i);
+            glVertexAttribPointer(a.index, a.size, a.type, a.normalized, a.stride, a.offset);
+            glEnableVertexAttribArray(a.index);
+        }
     }
 
+#if GLSH_GL_DEBUG
     // check for GL errors
     GLenum err = glGetError();
     if (err != GL_NO_ERROR) {
-        std::cout << "*** Poop: GL Error in function " __FUNCTION__ " on line " << __LINE__ << ": " << gluErrorString(err) << std::endl;
-        glBindVertexArray(0);
+        std::cout << "*** Poop: GL Error in function " << __FUNCTION__ << " on line " << __LINE__ << ": " << gluErrorString(err) << std::endl;
+        BindVertexArray(0);
         glDeleteVertexArrays(1, &vao);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glDeleteBuffers(1, &vbo);
         return NULL;
     }
+#endif
 
     // unbind the VAO, for now
-    glBindVertexArray(0);
+    BindVertexArray(0);
 
     // unbind the VBO
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+    TrackGPUMemory(GPU_VERTEX_BUFFER, vbo, vertexSize * numVerts);
+
     //
     // all good, create and return a new Mesh object
     //
@@ -68,7 +80,9 @@ VertexMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts,
 }
 
 
-IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts, const VertexFormat& vertexFormat, const void* indices, unsigned numIndices, GLenum indexType)
+static IndexedMesh* CreateIndexedMesh(GLenum drawingMode, const void* verts, unsigned numVerts, GLsizei vertexSize,
+                                      const VertexFormat* vertexFormat, VertexAttribSetupFunc setupAttribs,
+                                      const void* indices, unsigned numIndices, GLenum indexType)
 {
     // create a vertex array object (VAO)
     GLuint vao = 0;
@@ -79,14 +93,14 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts
     }
 
     // bind the VAO (subsequent vertex attribute info will be stored in this VAO)
-    glBindVertexArray(vao);
+    BindVertexArray(vao);
 
     // create a vertex buffer object (VBO)
     GLuint vbo = 0;
     glGenBuffers(1, &vbo);
     if (!vbo) {
         std::cerr << "*** Poop: Failed to create VBO" << std::endl;
-        glBindVertexArray(0);
+        BindVertexArray(0);
         glDeleteVertexArrays(1, &vao);
         return NULL;
     }
@@ -96,15 +110,20 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts
 
     // resize and fill the buffer (copy the vertex data into it)
     glBufferData(GL_ARRAY_BUFFER,               // the buffer to resize and fill
-                 vertexFormat.getVertexSizeInBytes() * numVerts,  // total size in bytes
+                 vertexSize * numVerts,         // total size in bytes
                  verts,                         // address of data in RAM
                  GL_STATIC_DRAW);               // buffer usage drawingMode (GL_STATIC_DRAW == read-only == fast drawing)
+    CountBufferUpload(vertexSize * numVerts);
 
     // describe how the vertex positions are layed out in the active buffer
-    for (unsigned i = 0; i < vertexFormat.numAttribs(); i++) {
-        const VertexAttrib& a = vertexFormat.getAttrib(i);
-        glVertexAttribPointer(a.index, a.size, a.type, GL_FALSE, a.stride, a.offset);
-        glEnableVertexAttribArray(a.index);
+    if (setupAttribs) {
+        setupAttribs(NULL);
+    } else {
+        for (unsigned i = 0; i < vertexFormat->numAttribs(); i++) {
+            const VertexAttrib& a = vertexFormat->getAttrib(i);
+            glVertexAttribPointer(a.index, a.size, a.type, a.normalized, a.stride, a.offset);
+            glEnableVertexAttribArray(a.index);
+        }
     }
 
     //
@@ -115,7 +134,7 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts
     glGenBuffers(1, &ibo);
     if (!ibo) {
         std::cerr << "*** Poop: Failed to create IBO" << std::endl;
-        return false;
+        return NULL;
     }
 
     // bind the IBO
@@ -126,13 +145,15 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts
                  GetGLTypeSize(indexType) * numIndices,     // total size in bytes
                  indices,                   // address of data in RAM
                  GL_STATIC_DRAW);           // buffer usage drawingMode (GL_STATIC_DRAW == read-only == fast drawing)
+    CountBufferUpload(GetGLTypeSize(indexType) * numIndices);
 
 
+#if GLSH_GL_DEBUG
     // check for GL errors
     GLenum err = glGetError();
     if (err != GL_NO_ERROR) {
-        std::cout << "*** Poop: GL Error in function " __FUNCTION__ " on line " << __LINE__ << ": " << gluErrorString(err) << std::endl;
-        glBindVertexArray(0);
+        std::cout << "*** Poop: GL Error in function " << __FUNCTION__ << " on line " << __LINE__ << ": " << gluErrorString(err) << std::endl;
+        BindVertexArray(0);
         glDeleteVertexArrays(1, &vao);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glDeleteBuffers(1, &vbo);
@@ -140,9 +161,10 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts
         glDeleteBuffers(1, &ibo);
         return NULL;
     }
+#endif
 
     // unbind the VAO, for now
-    glBindVertexArray(0);
+    BindVertexArray(0);
 
     // unbind the VBO
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -150,6 +172,9 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts
     // unbind the IBO
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
+    TrackGPUMemory(GPU_VERTEX_BUFFER, vbo, vertexSize * numVerts);
+    TrackGPUMemory(GPU_INDEX_BUFFER, ibo, GetGLTypeSize(indexType) * numIndices);
+
     //
     // all good, create and return a new Mesh object
     //
@@ -158,4 +183,57 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts
     return mesh;
 }
 
+
+VertexMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts, const VertexFormat& vertexFormat)
+{
+    return CreateVertexMesh(drawingMode, verts, numVerts, vertexFormat.getVertexSizeInBytes(), &vertexFormat, NULL);
+}
+
+IndexedMesh* CreateMesh(GLenum drawingMode, const void* verts, unsigned numVerts, const VertexFormat& vertexFormat, const void* indices, unsigned numIndices, GLenum indexType)
+{
+    return CreateIndexedMesh(drawingMode, verts, numVerts, vertexFormat.getVertexSizeInBytes(), &vertexFormat, NULL,
+                             indices, numIndices, indexType);
+}
+
+VertexMesh* CreateMeshFromLayout(GLenum drawingMode, const void* verts, unsigned numVerts,
+                                 GLsizei vertexSize, VertexAttribSetupFunc setupAttribs)
+{
+    return CreateVertexMesh(drawingMode, verts, numVerts, vertexSize, NULL, setupAttribs);
+}
+
+IndexedMesh* CreateMeshFromLayout(GLenum drawingMode, const void* verts, unsigned numVerts,
+                                  GLsizei vertexSize, VertexAttribSetupFunc setupAttribs,
+                                  const void* indices, unsigned numIndices, GLenum indexType)
+{
+    return CreateIndexedMesh(drawingMode, verts, numVerts, vertexSize, NULL, setupAttribs, indices, numIndices, indexType);
+}
+
+template <typename VertexType>
+static IndexedMesh* CreatePackedMeshImpl(GLenum drawingMode, const std::vector<VertexType>& vertices, const std::vector<GLuint>& indices)
+{
+    if (vertices.empty() || indices.empty()) {
+        return NULL;
+    }
+
+    std::vector<VertexPackedPositionNormalTexture> packed;
+    PositionQuantization quant;
+    PackVertices(vertices, packed, &quant);
+
+    IndexedMesh* mesh = CreateMesh(drawingMode, packed, indices);
+    if (mesh) {
+        mesh->setQuantization(quant);
+    }
+    return mesh;
+}
+
+IndexedMesh* CreatePackedMesh(GLenum drawingMode, const std::vector<VertexPositionNormalTexture>& vertices, const std::vector<GLuint>& indices)
+{
+    return CreatePackedMeshImpl(drawingMode, vertices, indices);
+}
+
+IndexedMesh* CreatePackedMesh(GLenum drawingMode, const std::vector<VertexPositionNormal>& vertices, const std::vector<GLuint>& indices)
+{
+    return CreatePackedMeshImpl(drawingMode, vertices, indices);
+}
+
 }
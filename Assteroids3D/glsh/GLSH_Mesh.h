@@ -2,9 +2,13 @@
 #define GLSH_MESH_H_
 
 #include <GL/glew.h>
+#include "GLSH_GLTrace.h"
+#include <glm/glm.hpp>
 
 #include <vector>
 
+#include "GLSH_GLStats.h"
+#include "GLSH_Memory.h"
 #include "GLSH_Vertex.h"
 
 // a macro that casts an integer offset to a pointer
@@ -12,13 +16,29 @@
 
 namespace glsh {
 
+//
+// Object-space bounds of a mesh (see ComputeBounds in GLSH_MeshOptimize.h)
+//
+struct MeshBounds {
+    glm::vec3   aabbMin;
+    glm::vec3   aabbMax;
+    glm::vec3   center;     // bounding sphere
+    float       radius;
+
+    MeshBounds()
+        : aabbMin(0.0f), aabbMax(0.0f), center(0.0f), radius(0.0f)
+    { }
+};
+
 //
 // An abstract base class for meshes that use a VAO
 //
 class Mesh {
 protected:
-    GLuint  mVAO;            // the VAO describes the data sources and format
-    GLenum  mDrawingMode;    // geometric primitive type (GL_TRIANGLES, etc.)
+    GLuint      mVAO;            // the VAO describes the data sources and format
+    GLenum      mDrawingMode;    // geometric primitive type (GL_TRIANGLES, etc.)
+    MeshBounds  mBounds;         // zero unless whoever created the mesh computed them
+    PositionQuantization mQuantization;    // identity unless the vertices are packed
 
     Mesh(GLuint vao, GLenum drawingMode)
         : mVAO(vao)
@@ -35,13 +55,20 @@ public:
 
     void draw() const
     {
-        glBindVertexArray(mVAO);
+        BindVertexArray(mVAO);
 
         this->drawImpl();
 
-        glBindVertexArray(0);
+        BindVertexArray(0);
     }
 
+    void setBounds(const MeshBounds& bounds)    { mBounds = bounds; }
+    const MeshBounds& getBounds() const         { return mBounds; }
+
+    // packed meshes are drawn with getQuantization().getMatrix() appended to their model matrix
+    void setQuantization(const PositionQuantization& q)     { mQuantization = q; }
+    const PositionQuantization& getQuantization() const     { return mQuantization; }
+
 protected:
 
     virtual void drawImpl() const = 0;    // subclasses must implement their own draw call(s)
@@ -67,6 +94,7 @@ public:
     virtual ~VertexMesh() override
     {
         if (mVBO) {
+            UntrackGPUMemory(GPU_VERTEX_BUFFER, mVBO);
             glDeleteBuffers(1, &mVBO);
         }
     }
@@ -76,6 +104,7 @@ protected:
     virtual void drawImpl() const override
     {
         glDrawArrays(mDrawingMode, 0, mVertexCount);
+        CountDrawCall();
     }
 };
 
@@ -104,9 +133,11 @@ public:
     virtual ~IndexedMesh() override
     {
         if (mIBO) {
+            UntrackGPUMemory(GPU_INDEX_BUFFER, mIBO);
             glDeleteBuffers(1, &mIBO);
         }
         if (mVBO) {
+            UntrackGPUMemory(GPU_VERTEX_BUFFER, mVBO);
             glDeleteBuffers(1, &mVBO);
         }
     }
@@ -116,6 +147,7 @@ protected:
     virtual void drawImpl() const override
     {
         glDrawElements(mDrawingMode, mIndexCount, mIndexType, GLSH_BUFFER_OFFSET(0));
+        CountDrawCall();
     }
 };
 
@@ -128,6 +160,19 @@ VertexMesh* CreateMesh(GLenum drawingMode,                  // GL_TRIANGLES, etc
                        unsigned numVertices,                // number of vertices in the array
                        const VertexFormat& vertexFormat);   // vertex format (attributes and their layout)
 
+//
+// Mesh creation for vertex types with a compile-time layout: setupAttribs is called with the new VAO
+// and VBO bound, and sets the attribute pointers (normally SetVertexAttribPointers<VertexType>).
+//
+typedef void (*VertexAttribSetupFunc)(const void* base);
+
+VertexMesh* CreateMeshFromLayout(GLenum drawingMode, const void* vertices, unsigned numVertices,
+                                 GLsizei vertexSize, VertexAttribSetupFunc setupAttribs);
+
+IndexedMesh* CreateMeshFromLayout(GLenum drawingMode, const void* vertices, unsigned numVertices,
+                                  GLsizei vertexSize, VertexAttribSetupFunc setupAttribs,
+                                  const void* indices, unsigned numIndices, GLenum indexType);
+
 //
 // Some overloads for creating unindexed meshes from vertices of specific types.
 //
@@ -136,7 +181,7 @@ VertexMesh* CreateMesh(GLenum drawingMode,                  // GL_TRIANGLES, etc
 //
 // Note that VertexType needs to be one of the VertexXXX types from Vertex.h,
 // such as VertexPosition, VertexPositionColor, VertexPositionNormalTexture, etc.
-// These types have a static GetFormat method that the template relies on.
+// These types have a VertexLayout that the template relies on.
 //
 /*
 VertexMesh* CreateMesh(GLenum drawingMode, const VertexPosition* vertices, unsigned numVertices);
@@ -149,7 +194,7 @@ VertexMesh* CreateMesh(GLenum drawingMode, const VertexPositionNormalTexture* ve
 template <typename VertexType>
 VertexMesh* CreateMesh(GLenum drawingMode, const VertexType* vertices, unsigned numVertices)
 {
-    return CreateMesh(drawingMode, vertices, numVertices, VertexType::GetFormat());
+    return CreateMeshFromLayout(drawingMode, vertices, numVertices, sizeof(VertexType), &SetVertexAttribPointers<VertexType>);
 }
 
 /*
@@ -163,7 +208,7 @@ VertexMesh* CreateMesh(GLenum drawingMode, const std::vector<VertexPositionNorma
 template <typename VertexType>
 VertexMesh* CreateMesh(GLenum drawingMode, const std::vector<VertexType>& vertices)
 {
-    return CreateMesh(drawingMode, &vertices[0], vertices.size(), VertexType::GetFormat());
+    return CreateMesh(drawingMode, &vertices[0], vertices.size());
 }
 
 //
@@ -184,7 +229,7 @@ IndexedMesh* CreateMesh(GLenum drawingMode,             // GL_TRIANGLES, etc.
 // and an array of IndexType elements.
 // - VertexType needs to be one of the VertexXXX types from Vertex.h,
 //   such as VertexPosition, VertexPositionColor, VertexPositionNormalTexture, etc.
-//   These types have a static GetFormat method that the template relies on.
+//   These types have a VertexLayout that the template relies on.
 // - IndexType should be one of unsigned char, unsigned short, or unsigned int.
 //
 template <typename VertexType, typename IndexType>
@@ -198,7 +243,8 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const VertexType* vertices, unsigned
     case 4: indexType = GL_UNSIGNED_INT; break;
     default: return NULL; // error, invalid index size
     }
-    return CreateMesh(drawingMode, vertices, numVertices, VertexType::GetFormat(), indices, numIndices, indexType);
+    return CreateMeshFromLayout(drawingMode, vertices, numVertices, sizeof(VertexType), &SetVertexAttribPointers<VertexType>,
+                                indices, numIndices, indexType);
 }
 
 template <typename VertexType, typename IndexType>
@@ -207,6 +253,13 @@ IndexedMesh* CreateMesh(GLenum drawingMode, const std::vector<VertexType>& verti
     return CreateMesh(drawingMode, &vertices[0], vertices.size(), &indices[0], indices.size());
 }
 
+//
+// Indexed meshes with VertexPackedPositionNormalTexture vertices. The quantization of the positions
+// is set on the mesh; see Mesh::getQuantization.
+//
+IndexedMesh* CreatePackedMesh(GLenum drawingMode, const std::vector<VertexPositionNormalTexture>& vertices, const std::vector<GLuint>& indices);
+IndexedMesh* CreatePackedMesh(GLenum drawingMode, const std::vector<VertexPositionNormal>& vertices, const std::vector<GLuint>& indices);
+
 //
 // Draw immediate geometry (from RAM)
 //
@@ -215,24 +268,14 @@ template <typename VertexType>
 void DrawGeometry(GLenum drawingMode, const VertexType* verts, unsigned numVerts)
 {
     // unbind any active VAO
-    glBindVertexArray(0);
+    BindVertexArray(0);
 
-    const VertexFormat& fmt = VertexType::GetFormat();
-
-    const char* ptr = (const char*)verts;  // need a byte-sized pointer for offset arithmetic to work properly
-
-    for (unsigned i = 0; i < fmt.numAttribs(); i++) {
-        const VertexAttrib& a = fmt.getAttrib(i);
-        glVertexAttribPointer(a.index, a.size, a.type, GL_FALSE, a.stride, ptr + (size_t)a.offset);  // I... fucking... love... this... language
-        glEnableVertexAttribArray(a.index);
-    }
+    SetVertexAttribPointers<VertexType>(verts);
 
     glDrawArrays(drawingMode, 0, numVerts);
+    CountDrawCall();
 
-    for (unsigned i = 0; i < fmt.numAttribs(); i++) {
-        const VertexAttrib& a = fmt.getAttrib(i);
-        glDisableVertexAttribArray(a.index);
-    }
+    DisableVertexAttribs<VertexType>();
 }
 
 template <typename VertexType>
@@ -0,0 +1,346 @@
+#include "GLSH_MeshArena.h"
+#include "GLSH_GLDebug.h"
+#include "GLSH_Memory.h"
+
+#include <iostream>
+
+namespace glsh {
+
+int ArenaMesh::getLODCount() const
+{
+    int count = 1;
+    for (const ArenaMesh* lod = mCoarser; lod; lod = lod->mCoarser) {
+        ++count;
+    }
+    return count;
+}
+
+const ArenaMesh* ArenaMesh::getLOD(int level) const
+{
+    const ArenaMesh* lod = this;
+    while (level-- > 0 && lod->mCoarser) {
+        lod = lod->mCoarser;
+    }
+    return lod;
+}
+
+int ArenaMesh::selectLOD(float screenRadius, float maxPixelError) const
+{
+    if (mBounds.radius <= 0.0f) {
+        return 0;
+    }
+
+    // errors are in object space, the same units as the bounding radius
+    float pixelsPerUnit = screenRadius / mBounds.radius;
+
+    int level = 0;
+    for (const ArenaMesh* lod = mCoarser; lod && lod->mLODError * pixelsPerUnit <= maxPixelError; lod = lod->mCoarser) {
+        ++level;
+    }
+    return level;
+}
+
+
+MeshArena::MeshArena(const VertexFormat& format)
+    : mFormat(format)
+    , mInstanceStride(0)
+    , mVAO(0)
+    , mVBO(0)
+    , mIBO(0)
+    , mVertexCapacity(0)
+    , mVertexCount(0)
+    , mIndexCapacity(0)
+    , mIndexCount(0)
+    , mBatchMode(GL_TRIANGLES)
+    , mLastDrawCount(0)
+{
+}
+
+MeshArena::~MeshArena()
+{
+    for (unsigned i = 0; i < mMeshes.size(); i++) {
+        delete mMeshes[i];
+    }
+
+    if (mVAO) {
+        glDeleteVertexArrays(1, &mVAO);
+    }
+    if (mVBO) {
+        UntrackGPUMemory(GPU_VERTEX_BUFFER, mVBO);
+        glDeleteBuffers(1, &mVBO);
+    }
+    if (mIBO) {
+        UntrackGPUMemory(GPU_INDEX_BUFFER, mIBO);
+        glDeleteBuffers(1, &mIBO);
+    }
+}
+
+bool MeshArena::HasMultiDrawIndirect()
+{
+    // baseInstance in the commands is only honored with ARB_base_instance (core in 4.2)
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+bool MeshArena::Reserve(GLsizei numVertices, GLsizei numIndices)
+{
+    return reserve(numVertices - mVertexCount, numIndices - mIndexCount);
+}
+
+bool MeshArena::reserve(GLsizei numVertices, GLsizei numIndices)
+{
+    GLsizei vertexCapacity = mVertexCapacity;
+    while (vertexCapacity < mVertexCount + numVertices) {
+        vertexCapacity = vertexCapacity ? vertexCapacity * 2 : 4096;
+    }
+
+    GLsizei indexCapacity = mIndexCapacity;
+    while (indexCapacity < mIndexCount + numIndices) {
+        indexCapacity = indexCapacity ? indexCapacity * 2 : 16384;
+    }
+
+    if (vertexCapacity == mVertexCapacity && indexCapacity == mIndexCapacity) {
+        return true;
+    }
+
+    if (!mVAO) {
+        glGenVertexArrays(1, &mVAO);
+        if (!mVAO) {
+            std::cerr << "*** Failed to create mesh arena VAO" << std::endl;
+            return false;
+        }
+    }
+
+    GLsizei vertexSize = mFormat.getVertexSizeInBytes();
+
+    // new storage, with the old contents copied over on the GPU
+    GLuint vbo = 0;
+    GLuint ibo = 0;
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    if (!vbo || !ibo) {
+        std::cerr << "*** Failed to create mesh arena buffers" << std::endl;
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ibo);
+        return false;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * vertexSize, NULL, GL_STATIC_DRAW);
+    if (mVBO && mVertexCount) {
+        glBindBuffer(GL_COPY_READ_BUFFER, mVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mVertexCount * vertexSize);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+    if (mIBO && mIndexCount) {
+        glBindBuffer(GL_COPY_READ_BUFFER, mIBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mIndexCount * sizeof(GLuint));
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (mVBO) {
+        UntrackGPUMemory(GPU_VERTEX_BUFFER, mVBO);
+        glDeleteBuffers(1, &mVBO);
+    }
+    if (mIBO) {
+        UntrackGPUMemory(GPU_INDEX_BUFFER, mIBO);
+        glDeleteBuffers(1, &mIBO);
+    }
+    mVBO = vbo;
+    mIBO = ibo;
+    TrackGPUMemory(GPU_VERTEX_BUFFER, mVBO, vertexCapacity * vertexSize);
+    TrackGPUMemory(GPU_INDEX_BUFFER, mIBO, indexCapacity * sizeof(GLuint));
+    mVertexCapacity = vertexCapacity;
+    mIndexCapacity = indexCapacity;
+
+    // point the VAO at the new buffers
+    BindVertexArray(mVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    for (unsigned i = 0; i < mFormat.numAttribs(); i++) {
+        const VertexAttrib& a = mFormat.getAttrib(i);
+        glVertexAttribPointer(a.index, a.size, a.type, a.normalized, a.stride, a.offset);
+        glEnableVertexAttribArray(a.index);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIBO);
+    BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    LabelGLObject(GL_VERTEX_ARRAY, mVAO, "mesh arena");
+    LabelGLObject(GL_BUFFER, mVBO, "mesh arena vertices");
+    LabelGLObject(GL_BUFFER, mIBO, "mesh arena indices");
+
+#if GLSH_GL_DEBUG
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        std::cerr << "*** GL Error while growing mesh arena: " << gluErrorString(err) << std::endl;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+ArenaMesh* MeshArena::AddMesh(GLenum drawingMode,
+                              const void* vertices, unsigned numVertices, GLsizei vertexSize,
+                              const GLuint* indices, unsigned numIndices)
+{
+    if (!vertices || !numVertices || !indices || !numIndices) {
+        return NULL;
+    }
+
+    if (vertexSize != mFormat.getVertexSizeInBytes()) {
+        std::cerr << "*** Mesh vertex size " << vertexSize << " doesn't match the arena's format ("
+                  << mFormat.getVertexSizeInBytes() << ")" << std::endl;
+        return NULL;
+    }
+
+    if (!reserve(numVertices, numIndices)) {
+        return NULL;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mVBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, mVertexCount * vertexSize, numVertices * vertexSize, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mIBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, mIndexCount * sizeof(GLuint), numIndices * sizeof(GLuint), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    CountBufferUpload(numVertices * vertexSize);
+    CountBufferUpload(numIndices * sizeof(GLuint));
+
+    ArenaMesh* mesh = new ArenaMesh(mVAO, drawingMode, numIndices, mIndexCount, mVertexCount);
+    mMeshes.push_back(mesh);
+
+    mVertexCount += numVertices;
+    mIndexCount += numIndices;
+
+    return mesh;
+}
+
+ArenaMesh* MeshArena::AddLOD(ArenaMesh* mesh, const GLuint* indices, unsigned numIndices, float error)
+{
+    if (!mesh || !indices || !numIndices) {
+        return NULL;
+    }
+
+    if (!reserve(0, numIndices)) {
+        return NULL;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mIBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, mIndexCount * sizeof(GLuint), numIndices * sizeof(GLuint), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    CountBufferUpload(numIndices * sizeof(GLuint));
+
+    ArenaMesh* lod = new ArenaMesh(mVAO, mesh->mDrawingMode, numIndices, mIndexCount, mesh->mBaseVertex);
+    lod->mLODError = error;
+    lod->setBounds(mesh->getBounds());
+    lod->setQuantization(mesh->getQuantization());
+    mMeshes.push_back(lod);
+
+    mIndexCount += numIndices;
+
+    ArenaMesh* last = mesh;
+    while (last->mCoarser) {
+        last = last->mCoarser;
+    }
+    last->mCoarser = lod;
+
+    return lod;
+}
+
+void MeshArena::SetInstanceFormat(const VertexFormat& format)
+{
+    mInstanceFormat = format;
+    mInstanceStride = format.numAttribs() ? format.getAttrib(0).stride : 0;
+}
+
+void MeshArena::AddDraw(const ArenaMesh* mesh, GLuint instanceCount, GLuint baseInstance)
+{
+    if (!mesh || !instanceCount) {
+        return;
+    }
+
+    if (mBatch.empty()) {
+        mBatchMode = mesh->mDrawingMode;
+    } else if (mesh->mDrawingMode != mBatchMode) {
+        std::cerr << "*** Mesh arena batches can't mix drawing modes" << std::endl;
+        return;
+    }
+
+    DrawElementsIndirectCommand cmd;
+    cmd.count = mesh->mIndexCount;
+    cmd.instanceCount = instanceCount;
+    cmd.firstIndex = mesh->mFirstIndex;
+    cmd.baseVertex = mesh->mBaseVertex;
+    cmd.baseInstance = baseInstance;
+    mBatch.push_back(cmd);
+}
+
+void MeshArena::setInstancePointers(GLuint buffer, GLintptr offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (unsigned i = 0; i < mInstanceFormat.numAttribs(); i++) {
+        const VertexAttrib& a = mInstanceFormat.getAttrib(i);
+        glVertexAttribPointer(a.index, a.size, a.type, a.normalized, a.stride, GLSH_BUFFER_OFFSET(offset + (GLintptr)a.offset));
+        glVertexAttribDivisor(a.index, 1);
+        glEnableVertexAttribArray(a.index);
+    }
+}
+
+void MeshArena::disableInstanceAttribs()
+{
+    // plain draw() calls from this VAO must not fetch from a stream buffer that may be gone by then
+    for (unsigned i = 0; i < mInstanceFormat.numAttribs(); i++) {
+        const VertexAttrib& a = mInstanceFormat.getAttrib(i);
+        glDisableVertexAttribArray(a.index);
+        glVertexAttribDivisor(a.index, 0);
+    }
+}
+
+void MeshArena::SubmitBatch(GLuint instanceBuffer, GLintptr instanceOffset, DynamicBuffer& indirectStream)
+{
+    mLastDrawCount = 0;
+
+    if (mBatch.empty() || !mVAO) {
+        mBatch.clear();
+        return;
+    }
+
+    BindVertexArray(mVAO);
+
+    GLintptr cmdOffset = -1;
+    if (HasMultiDrawIndirect()) {
+        cmdOffset = indirectStream.Write(&mBatch[0], mBatch.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+    }
+
+    if (cmdOffset >= 0) {
+        // the whole batch in one call; baseInstance selects each mesh's instances
+        setInstancePointers(instanceBuffer, instanceOffset);
+        glMultiDrawElementsIndirect(mBatchMode, GL_UNSIGNED_INT, GLSH_BUFFER_OFFSET(cmdOffset), (GLsizei)mBatch.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        mLastDrawCount = 1;
+        CountDrawCall();
+    } else {
+        // still one VAO, but the instance attributes are moved to each mesh's first instance
+        for (unsigned i = 0; i < mBatch.size(); i++) {
+            const DrawElementsIndirectCommand& cmd = mBatch[i];
+            setInstancePointers(instanceBuffer, instanceOffset + cmd.baseInstance * mInstanceStride);
+            glDrawElementsInstancedBaseVertex(mBatchMode, cmd.count, GL_UNSIGNED_INT,
+                                              GLSH_BUFFER_OFFSET(cmd.firstIndex * sizeof(GLuint)),
+                                              cmd.instanceCount, cmd.baseVertex);
+            mLastDrawCount++;
+            CountDrawCall();
+        }
+    }
+
+    disableInstanceAttribs();
+
+    BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mBatch.clear();
+}
+
+} // end of namespace
@@ -0,0 +1,170 @@
+#ifndef GLSH_MESHARENA_H_
+#define GLSH_MESHARENA_H_
+
+#include "GLSH_DynamicBuffer.h"
+#include "GLSH_Mesh.h"
+#include "GLSH_Vertex.h"
+
+#include <vector>
+
+namespace glsh {
+
+class MeshArena;
+
+//
+// A mesh that lives in a MeshArena: a range of indices and a base vertex in the arena's shared buffers.
+// Drawing it on its own still works (one glDrawElementsBaseVertex), but the point is to batch it with
+// everything else in the arena through MeshArena::AddDraw.
+//
+// Coarser levels of detail added with MeshArena::AddLOD hang off the full mesh and share its vertices.
+//
+class ArenaMesh : public Mesh {
+
+    friend class MeshArena;
+
+    GLsizei     mIndexCount;
+    GLuint      mFirstIndex;    // offset into the arena's IBO, in indices
+    GLint       mBaseVertex;    // added to every index
+
+    ArenaMesh*  mCoarser;       // next level of detail, NULL for the coarsest
+    float       mLODError;      // object-space error against the full mesh
+
+    ArenaMesh(GLuint vao, GLenum drawingMode, GLsizei indexCount, GLuint firstIndex, GLint baseVertex)
+        : Mesh(vao, drawingMode)
+        , mIndexCount(indexCount)
+        , mFirstIndex(firstIndex)
+        , mBaseVertex(baseVertex)
+        , mCoarser(NULL)
+        , mLODError(0.0f)
+    { }
+
+public:
+    virtual ~ArenaMesh() override
+    {
+        mVAO = 0;   // the VAO belongs to the arena
+    }
+
+    GLsizei     getIndexCount() const       { return mIndexCount; }
+    GLuint      getFirstIndex() const       { return mFirstIndex; }
+    GLint       getBaseVertex() const       { return mBaseVertex; }
+
+    float       getLODError() const         { return mLODError; }
+    int         getLODCount() const;        // this level and every coarser one
+    const ArenaMesh* getLOD(int level) const;   // 0 is this mesh; clamped to the coarsest level
+
+    // the coarsest level whose error stays under maxPixelError when the bounding sphere
+    // covers screenRadius pixels; needs the mesh bounds
+    int         selectLOD(float screenRadius, float maxPixelError) const;
+
+protected:
+
+    virtual void drawImpl() const override
+    {
+        glDrawElementsBaseVertex(mDrawingMode, mIndexCount, GL_UNSIGNED_INT,
+                                 GLSH_BUFFER_OFFSET(mFirstIndex * sizeof(GLuint)), mBaseVertex);
+        CountDrawCall();
+    }
+};
+
+
+//
+// The layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+//
+struct DrawElementsIndirectCommand {
+    GLuint      count;
+    GLuint      instanceCount;
+    GLuint      firstIndex;
+    GLint       baseVertex;
+    GLuint      baseInstance;
+};
+
+
+//
+// Suballocates static meshes that share a vertex format out of one VBO/IBO pair, so they all draw from a single VAO.
+//
+// Indices are always 32-bit and relative to the mesh's own vertices; the base vertex takes care of the rest.
+// The buffers grow (by copying on the GPU) when a mesh doesn't fit, so reserve enough up front to avoid it.
+//
+// For batched drawing, give the arena a per-instance format (attributes with divisor 1), queue one AddDraw
+// per mesh with the range of instances it uses, and SubmitBatch with the buffer holding the instance data.
+// With ARB_multi_draw_indirect the whole batch is one glMultiDrawElementsIndirect call; otherwise it falls
+// back to one instanced draw per mesh from the same VAO.
+//
+class MeshArena {
+
+    VertexFormat                mFormat;
+    VertexFormat                mInstanceFormat;
+    GLsizei                     mInstanceStride;
+
+    GLuint                      mVAO;
+    GLuint                      mVBO;
+    GLuint                      mIBO;
+
+    GLsizei                     mVertexCapacity;
+    GLsizei                     mVertexCount;
+    GLsizei                     mIndexCapacity;
+    GLsizei                     mIndexCount;
+
+    std::vector<ArenaMesh*>     mMeshes;
+    std::vector<DrawElementsIndirectCommand> mBatch;
+    GLenum                      mBatchMode;
+
+    int                         mLastDrawCount;
+
+    bool                        reserve(GLsizei numVertices, GLsizei numIndices);
+    void                        setInstancePointers(GLuint buffer, GLintptr offset);
+    void                        disableInstanceAttribs();
+
+                                MeshArena(const MeshArena&) = delete;
+    MeshArena&                  operator=(const MeshArena&) = delete;
+
+public:
+                                MeshArena(const VertexFormat& format);
+                                ~MeshArena();     // deletes every mesh it handed out
+
+    // size the buffers for everything that will be added; optional, the arena grows as needed
+    bool                        Reserve(GLsizei numVertices, GLsizei numIndices);
+
+    // copy a mesh into the arena; returns NULL on failure (vertexSize must match the arena's format)
+    ArenaMesh*                  AddMesh(GLenum drawingMode,
+                                        const void* vertices, unsigned numVertices, GLsizei vertexSize,
+                                        const GLuint* indices, unsigned numIndices);
+
+    template <typename VertexType>
+    ArenaMesh*                  AddMesh(GLenum drawingMode, const std::vector<VertexType>& vertices, const std::vector<GLuint>& indices)
+    {
+        if (vertices.empty() || indices.empty()) {
+            return NULL;
+        }
+        return AddMesh(drawingMode, &vertices[0], vertices.size(), sizeof(VertexType), &indices[0], indices.size());
+    }
+
+    // add a coarser level of detail to a mesh: new indices into the same vertices (see SimplifyMesh);
+    // it goes after the mesh's current coarsest level
+    ArenaMesh*                  AddLOD(ArenaMesh* mesh, const GLuint* indices, unsigned numIndices, float error);
+
+    // attributes read once per instance during SubmitBatch; offsets are relative to the start of an instance
+    void                        SetInstanceFormat(const VertexFormat& format);
+
+    // queue instances [baseInstance, baseInstance + instanceCount) of a mesh; all meshes in a batch share a drawing mode
+    void                        AddDraw(const ArenaMesh* mesh, GLuint instanceCount, GLuint baseInstance);
+
+    // draw everything queued with the current program, reading instance 0 at instanceOffset in instanceBuffer;
+    // the commands are streamed through indirectStream, which must target GL_DRAW_INDIRECT_BUFFER
+    void                        SubmitBatch(GLuint instanceBuffer, GLintptr instanceOffset, DynamicBuffer& indirectStream);
+
+    // drop everything queued since the last submit
+    void                        CancelBatch()               { mBatch.clear(); }
+
+    static bool                 HasMultiDrawIndirect();
+
+    GLuint                      getVAO() const              { return mVAO; }
+    GLsizei                     getVertexCount() const      { return mVertexCount; }
+    GLsizei                     getIndexCount() const       { return mIndexCount; }
+    int                         getMeshCount() const        { return (int)mMeshes.size(); }
+    int                         getLastDrawCount() const    { return mLastDrawCount; }  // draw calls made by the last SubmitBatch
+};
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,281 @@
+#include "GLSH_MeshOptimize.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace glsh {
+
+float ComputeACMR(const GLuint* indices, unsigned numIndices, unsigned numVertices, unsigned cacheSize)
+{
+    if (numIndices < 3) {
+        return 0.0f;
+    }
+
+    // FIFO cache: a vertex is resident if it entered the cache less than cacheSize misses ago
+    std::vector<unsigned> entered(numVertices, 0);
+    unsigned misses = 0;
+
+    for (unsigned i = 0; i < numIndices; i++) {
+        GLuint v = indices[i];
+        if (!entered[v] || misses - entered[v] >= cacheSize) {
+            ++misses;
+            entered[v] = misses;
+        }
+    }
+
+    return misses / (float)(numIndices / 3);
+}
+
+//
+// Tipsify: fan around one vertex at a time, choosing the next fanning vertex among the ones just emitted
+// so that it's still in the cache once its remaining triangles are drawn.
+//
+void OptimizeVertexCache(GLuint* indices, unsigned numIndices, unsigned numVertices,
+                         unsigned cacheSize, std::vector<unsigned>* clusters_ret)
+{
+    unsigned numTris = numIndices / 3;
+    if (!numTris || !numVertices) {
+        return;
+    }
+
+    // vertex -> triangle adjacency, in one array
+    std::vector<unsigned> live(numVertices, 0);     // triangles not yet emitted, per vertex
+    for (unsigned i = 0; i < numTris * 3; i++) {
+        live[indices[i]]++;
+    }
+
+    std::vector<unsigned> adjStart(numVertices + 1, 0);
+    for (unsigned v = 0; v < numVertices; v++) {
+        adjStart[v + 1] = adjStart[v] + live[v];
+    }
+
+    std::vector<unsigned> adj(numTris * 3);
+    std::vector<unsigned> fill(adjStart.begin(), adjStart.end() - 1);
+    for (unsigned t = 0; t < numTris; t++) {
+        for (unsigned k = 0; k < 3; k++) {
+            adj[fill[indices[3 * t + k]]++] = t;
+        }
+    }
+
+    std::vector<int> cacheTime(numVertices, 0);
+    std::vector<bool> emitted(numTris, false);
+    std::vector<GLuint> deadEnd;
+    std::vector<GLuint> candidates;
+    std::vector<GLuint> result;
+    result.reserve(numTris * 3);
+
+    int time = cacheSize + 1;
+    unsigned cursor = 1;    // next vertex to try in input order once the dead-end stack runs dry
+    int fanning = 0;
+
+    if (clusters_ret) {
+        clusters_ret->clear();
+        clusters_ret->push_back(0);
+    }
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        // emit every remaining triangle around the fanning vertex
+        for (unsigned a = adjStart[fanning]; a < adjStart[fanning + 1]; a++) {
+            unsigned t = adj[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (unsigned k = 0; k < 3; k++) {
+                GLuint v = indices[3 * t + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > (int)cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // the candidate that would still be cached after fanning, preferring the one that entered the cache first
+        int next = -1;
+        int best = -1;
+        for (unsigned c = 0; c < candidates.size(); c++) {
+            GLuint v = candidates[c];
+            if (live[v] > 0) {
+                int priority = 0;
+                if (time - cacheTime[v] + 2 * (int)live[v] <= (int)cacheSize) {
+                    priority = time - cacheTime[v];
+                }
+                if (priority > best) {
+                    best = priority;
+                    next = v;
+                }
+            }
+        }
+
+        if (next < 0) {
+            // dead end: back up through recently emitted vertices, then fall back to input order
+            while (!deadEnd.empty()) {
+                GLuint v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                    break;
+                }
+            }
+            while (next < 0 && cursor < numVertices) {
+                if (live[cursor] > 0) {
+                    next = cursor;
+                }
+                ++cursor;
+            }
+
+            // a dead end is a hard cluster boundary, which is where OptimizeOverdraw may cut
+            if (next >= 0 && clusters_ret && result.size() / 3 > clusters_ret->back()) {
+                clusters_ret->push_back(result.size() / 3);
+            }
+        }
+
+        fanning = next;
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void OptimizeOverdraw(GLuint* indices, unsigned numIndices, const glm::vec3* positions, unsigned numVertices,
+                      const std::vector<unsigned>& clusters)
+{
+    unsigned numTris = numIndices / 3;
+    if (clusters.size() < 2 || !numTris) {
+        return;
+    }
+
+    // area-weighted mesh centroid
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for (unsigned t = 0; t < numTris; t++) {
+        const glm::vec3& p0 = positions[indices[3 * t + 0]];
+        const glm::vec3& p1 = positions[indices[3 * t + 1]];
+        const glm::vec3& p2 = positions[indices[3 * t + 2]];
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCenter += area * (p0 + p1 + p2) / 3.0f;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) {
+        meshCenter /= meshArea;
+    }
+
+    // how much each cluster faces away from the center
+    struct ClusterKey {
+        float       sortKey;
+        unsigned    first;
+        unsigned    count;
+    };
+
+    std::vector<ClusterKey> keys(clusters.size());
+    for (unsigned c = 0; c < clusters.size(); c++) {
+        unsigned first = clusters[c];
+        unsigned end = c + 1 < clusters.size() ? clusters[c + 1] : numTris;
+
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (unsigned t = first; t < end; t++) {
+            const glm::vec3& p0 = positions[indices[3 * t + 0]];
+            const glm::vec3& p1 = positions[indices[3 * t + 1]];
+            const glm::vec3& p2 = positions[indices[3 * t + 2]];
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);     // length is twice the area
+            float a = glm::length(n);
+            center += a * (p0 + p1 + p2) / 3.0f;
+            normal += n;
+            area += a;
+        }
+        if (area > 0.0f) {
+            center /= area;
+        }
+        float len = glm::length(normal);
+        if (len > 0.0f) {
+            normal /= len;
+        }
+
+        keys[c].sortKey = glm::dot(center - meshCenter, normal);
+        keys[c].first = first;
+        keys[c].count = end - first;
+    }
+
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const ClusterKey& a, const ClusterKey& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<GLuint> sorted;
+    sorted.reserve(numTris * 3);
+    for (unsigned c = 0; c < keys.size(); c++) {
+        sorted.insert(sorted.end(), indices + 3 * keys[c].first, indices + 3 * (keys[c].first + keys[c].count));
+    }
+
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+unsigned OptimizeVertexFetch(GLuint* indices, unsigned numIndices, unsigned numVertices, std::vector<GLuint>& remap_ret)
+{
+    remap_ret.assign(numVertices, ~0u);
+
+    unsigned next = 0;
+    for (unsigned i = 0; i < numIndices; i++) {
+        GLuint& remapped = remap_ret[indices[i]];
+        if (remapped == ~0u) {
+            remapped = next++;
+        }
+        indices[i] = remapped;
+    }
+
+    return next;
+}
+
+void GenerateNormals(const glm::vec3* positions, unsigned numVertices, const GLuint* indices, unsigned numIndices, glm::vec3* normals_ret)
+{
+    for (unsigned v = 0; v < numVertices; v++) {
+        normals_ret[v] = glm::vec3(0.0f);
+    }
+
+    // unnormalized face normals are twice the triangle area long, so big faces count for more
+    for (unsigned i = 0; i + 2 < numIndices; i += 3) {
+        GLuint i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+        glm::vec3 n = glm::cross(positions[i1] - positions[i0], positions[i2] - positions[i0]);
+        normals_ret[i0] += n;
+        normals_ret[i1] += n;
+        normals_ret[i2] += n;
+    }
+
+    for (unsigned v = 0; v < numVertices; v++) {
+        float len = glm::length(normals_ret[v]);
+        normals_ret[v] = len > 0.0f ? normals_ret[v] / len : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+}
+
+MeshBounds ComputeBounds(const glm::vec3* positions, unsigned numVertices)
+{
+    MeshBounds b;
+    if (!numVertices) {
+        return b;
+    }
+
+    b.aabbMin = glm::vec3(FLT_MAX);
+    b.aabbMax = glm::vec3(-FLT_MAX);
+    for (unsigned v = 0; v < numVertices; v++) {
+        b.aabbMin = glm::min(b.aabbMin, positions[v]);
+        b.aabbMax = glm::max(b.aabbMax, positions[v]);
+    }
+
+    // sphere around the box center; not minimal, but cheap and stable
+    b.center = 0.5f * (b.aabbMin + b.aabbMax);
+    float radiusSq = 0.0f;
+    for (unsigned v = 0; v < numVertices; v++) {
+        glm::vec3 d = positions[v] - b.center;
+        radiusSq = std::max(radiusSq, glm::dot(d, d));
+    }
+    b.radius = std::sqrt(radiusSq);
+
+    return b;
+}
+
+} // end of namespace
@@ -0,0 +1,172 @@
+#ifndef GLSH_MESHOPTIMIZE_H_
+#define GLSH_MESHOPTIMIZE_H_
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GLSH_Mesh.h"
+
+namespace glsh {
+
+//
+// Mesh processing for indexed triangle lists, run once when a mesh is loaded or cooked.
+//
+// The core functions work on raw index arrays and positions; the templates at the bottom apply them to
+// vectors of VertexXXX types (anything with a 'pos' member, plus 'normal' for GenerateNormals).
+//
+
+const unsigned DEFAULT_VERTEX_CACHE_SIZE = 16;  // a conservative post-transform cache size for current GPUs
+
+//
+// Average cache miss ratio: transformed vertices per triangle with a FIFO cache of the given size.
+// 3.0 is the worst case, around 0.6 - 0.7 is typical for well ordered meshes.
+//
+float ComputeACMR(const GLuint* indices, unsigned numIndices, unsigned numVertices, unsigned cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+//
+// Reorder triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007).
+// If clusters_ret is given, it receives the first triangle of every cluster the algorithm produced,
+// which is what OptimizeOverdraw sorts.
+//
+void OptimizeVertexCache(GLuint* indices, unsigned numIndices, unsigned numVertices,
+                         unsigned cacheSize = DEFAULT_VERTEX_CACHE_SIZE, std::vector<unsigned>* clusters_ret = NULL);
+
+//
+// Reorder the clusters from OptimizeVertexCache so triangles that face away from the mesh center,
+// and so are likely to occlude the rest, are drawn first. Triangle order within a cluster is kept,
+// so the cache efficiency barely changes.
+//
+void OptimizeOverdraw(GLuint* indices, unsigned numIndices, const glm::vec3* positions, unsigned numVertices,
+                      const std::vector<unsigned>& clusters);
+
+//
+// Number vertices in the order they are first referenced, so vertex fetches walk memory forward.
+// Rewrites the indices and fills remap_ret (old index -> new index, ~0u for unused vertices).
+// Returns the number of vertices that are referenced.
+//
+unsigned OptimizeVertexFetch(GLuint* indices, unsigned numIndices, unsigned numVertices, std::vector<GLuint>& remap_ret);
+
+//
+// Smooth normals, weighted by triangle area
+//
+void GenerateNormals(const glm::vec3* positions, unsigned numVertices, const GLuint* indices, unsigned numIndices, glm::vec3* normals_ret);
+
+MeshBounds ComputeBounds(const glm::vec3* positions, unsigned numVertices);
+
+
+struct MeshOptimizeStats {
+    float       acmrBefore;
+    float       acmrAfter;
+    unsigned    numVertices;
+    unsigned    numTriangles;
+};
+
+//
+// Templates for vertex arrays
+//
+
+template <typename VertexType>
+std::vector<glm::vec3> GetPositions(const std::vector<VertexType>& vertices)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].pos;
+    }
+    return positions;
+}
+
+template <typename VertexType>
+MeshBounds ComputeBounds(const std::vector<VertexType>& vertices)
+{
+    std::vector<glm::vec3> positions = GetPositions(vertices);
+    return ComputeBounds(positions.empty() ? NULL : &positions[0], positions.size());
+}
+
+template <typename VertexType>
+void GenerateNormals(std::vector<VertexType>& vertices, const std::vector<GLuint>& indices)
+{
+    if (vertices.empty() || indices.empty()) {
+        return;
+    }
+
+    std::vector<glm::vec3> positions = GetPositions(vertices);
+    std::vector<glm::vec3> normals(vertices.size());
+    GenerateNormals(&positions[0], positions.size(), &indices[0], indices.size(), &normals[0]);
+
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        vertices[i].normal = normals[i];
+    }
+}
+
+// like GenerateNormals, but only for vertices whose normal is zero; the rest keep theirs
+template <typename VertexType>
+void GenerateMissingNormals(std::vector<VertexType>& vertices, const std::vector<GLuint>& indices)
+{
+    if (vertices.empty() || indices.empty()) {
+        return;
+    }
+
+    std::vector<glm::vec3> positions = GetPositions(vertices);
+    std::vector<glm::vec3> normals(vertices.size());
+    GenerateNormals(&positions[0], positions.size(), &indices[0], indices.size(), &normals[0]);
+
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        if (vertices[i].normal == glm::vec3(0.0f)) {
+            vertices[i].normal = normals[i];
+        }
+    }
+}
+
+//
+// Cache-optimize, optionally sort for overdraw, then reorder the vertices for fetch.
+// Unreferenced vertices are dropped. Returns the bounds of the result.
+//
+template <typename VertexType>
+MeshBounds OptimizeMesh(std::vector<VertexType>& vertices, std::vector<GLuint>& indices,
+                        bool sortForOverdraw = false, MeshOptimizeStats* stats_ret = NULL)
+{
+    unsigned numVertices = vertices.size();
+    unsigned numIndices = indices.size();
+
+    if (!numVertices || numIndices < 3) {
+        return ComputeBounds(vertices);
+    }
+
+    MeshOptimizeStats stats;
+    stats.acmrBefore = ComputeACMR(&indices[0], numIndices, numVertices);
+
+    std::vector<unsigned> clusters;
+    OptimizeVertexCache(&indices[0], numIndices, numVertices, DEFAULT_VERTEX_CACHE_SIZE, sortForOverdraw ? &clusters : NULL);
+
+    if (sortForOverdraw) {
+        std::vector<glm::vec3> positions = GetPositions(vertices);
+        OptimizeOverdraw(&indices[0], numIndices, &positions[0], numVertices, clusters);
+    }
+
+    stats.acmrAfter = ComputeACMR(&indices[0], numIndices, numVertices);
+
+    std::vector<GLuint> remap;
+    unsigned numUsed = OptimizeVertexFetch(&indices[0], numIndices, numVertices, remap);
+
+    std::vector<VertexType> reordered(numUsed);
+    for (unsigned i = 0; i < numVertices; i++) {
+        if (remap[i] != ~0u) {
+            reordered[remap[i]] = vertices[i];
+        }
+    }
+    vertices.swap(reordered);
+
+    stats.numVertices = numUsed;
+    stats.numTriangles = numIndices / 3;
+    if (stats_ret) {
+        *stats_ret = stats;
+    }
+
+    return ComputeBounds(vertices);
+}
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,329 @@
+#include "GLSH_MeshSimplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace glsh {
+
+//
+// Symmetric 4x4 error quadric: the sum of squared distances to a set of planes
+//
+struct Quadric {
+    double  a2, ab, ac, ad;
+    double          b2, bc, bd;
+    double                  c2, cd;
+    double                          d2;
+
+    Quadric()
+        : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0)
+    { }
+
+    // plane n.p + d = 0, n unit length
+    Quadric(const glm::vec3& n, float d, double w)
+        : a2(w * n.x * n.x), ab(w * n.x * n.y), ac(w * n.x * n.z), ad(w * n.x * d)
+        , b2(w * n.y * n.y), bc(w * n.y * n.z), bd(w * n.y * d)
+        , c2(w * n.z * n.z), cd(w * n.z * d)
+        , d2(w * d * d)
+    { }
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        return *this;
+    }
+
+    double eval(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+             + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+             + c2 * z * z + 2 * cd * z
+             + d2;
+    }
+};
+
+struct Collapse {
+    double      cost;
+    unsigned    from;           // removed
+    unsigned    to;             // kept
+    unsigned    fromVersion;
+    unsigned    toVersion;
+
+    bool operator<(const Collapse& other) const
+    { return cost > other.cost; }       // smallest cost on top of the priority queue
+};
+
+// weight of the planes that hold open borders in place, relative to face planes
+const double BOUNDARY_WEIGHT = 10.0;
+
+// smallest cosine allowed between a triangle's normal before and after a collapse
+const float MIN_NORMAL_COS = 0.25f;
+
+float SimplifyMesh(const glm::vec3* positions, const glm::vec3* normals, unsigned numVertices,
+                   const GLuint* indices, unsigned numIndices,
+                   unsigned targetIndexCount, std::vector<GLuint>& indices_ret)
+{
+    unsigned numTris = numIndices / 3;
+    indices_ret.clear();
+    if (!numTris || !numVertices) {
+        return -1.0f;
+    }
+
+    //
+    // weld vertices that share a position
+    //
+    std::vector<unsigned> order(numVertices);
+    for (unsigned v = 0; v < numVertices; v++) {
+        order[v] = v;
+    }
+    std::sort(order.begin(), order.end(), [positions](unsigned a, unsigned b) {
+        const glm::vec3& p = positions[a];
+        const glm::vec3& q = positions[b];
+        if (p.x != q.x) return p.x < q.x;
+        if (p.y != q.y) return p.y < q.y;
+        return p.z < q.z;
+    });
+
+    std::vector<unsigned> weld(numVertices);       // vertex -> welded point
+    std::vector<unsigned> wedgeStart;               // welded point -> its vertices in 'order'
+    for (unsigned i = 0; i < numVertices; i++) {
+        if (i == 0 || positions[order[i]] != positions[order[i - 1]]) {
+            wedgeStart.push_back(i);
+        }
+        weld[order[i]] = wedgeStart.size() - 1;
+    }
+    unsigned numPoints = wedgeStart.size();
+    wedgeStart.push_back(numVertices);
+
+    std::vector<glm::vec3> points(numPoints);
+    for (unsigned p = 0; p < numPoints; p++) {
+        points[p] = positions[order[wedgeStart[p]]];
+    }
+
+    std::vector<unsigned> tris(numTris * 3);
+    for (unsigned i = 0; i < numTris * 3; i++) {
+        tris[i] = weld[indices[i]];
+    }
+
+    //
+    // point -> triangle adjacency (lists grow as points merge) and initial quadrics
+    //
+    std::vector<std::vector<unsigned> > pointTris(numPoints);
+    std::vector<Quadric> quadrics(numPoints);
+    std::vector<bool> triAlive(numTris, true);
+    unsigned aliveTris = numTris;
+
+    for (unsigned t = 0; t < numTris; t++) {
+        unsigned p0 = tris[3 * t], p1 = tris[3 * t + 1], p2 = tris[3 * t + 2];
+        if (p0 == p1 || p1 == p2 || p2 == p0) {
+            triAlive[t] = false;
+            --aliveTris;
+            continue;
+        }
+
+        glm::vec3 n = glm::cross(points[p1] - points[p0], points[p2] - points[p0]);
+        float len = glm::length(n);
+        if (len > 0.0f) {
+            n /= len;
+            Quadric q(n, -glm::dot(n, points[p0]), 1.0);
+            quadrics[p0] += q;
+            quadrics[p1] += q;
+            quadrics[p2] += q;
+        }
+
+        pointTris[p0].push_back(t);
+        pointTris[p1].push_back(t);
+        pointTris[p2].push_back(t);
+    }
+
+    // open borders: planes through each border edge, perpendicular to its face
+    for (unsigned t = 0; t < numTris; t++) {
+        if (!triAlive[t]) {
+            continue;
+        }
+        for (unsigned k = 0; k < 3; k++) {
+            unsigned a = tris[3 * t + k];
+            unsigned b = tris[3 * t + (k + 1) % 3];
+
+            // the edge is shared if another triangle around 'a' also uses 'b'
+            bool shared = false;
+            for (unsigned i = 0; i < pointTris[a].size() && !shared; i++) {
+                unsigned u = pointTris[a][i];
+                shared = u != t && (tris[3 * u] == b || tris[3 * u + 1] == b || tris[3 * u + 2] == b);
+            }
+            if (shared) {
+                continue;
+            }
+
+            unsigned c = tris[3 * t + (k + 2) % 3];
+            glm::vec3 faceN = glm::cross(points[b] - points[a], points[c] - points[a]);
+            glm::vec3 n = glm::cross(points[b] - points[a], faceN);
+            float len = glm::length(n);
+            if (len > 0.0f) {
+                n /= len;
+                Quadric q(n, -glm::dot(n, points[a]), BOUNDARY_WEIGHT);
+                quadrics[a] += q;
+                quadrics[b] += q;
+            }
+        }
+    }
+
+    //
+    // greedy edge collapses, cheapest first
+    //
+    std::vector<unsigned> version(numPoints, 0);
+    std::vector<unsigned> mergedInto(numPoints);
+    for (unsigned p = 0; p < numPoints; p++) {
+        mergedInto[p] = p;
+    }
+
+    std::priority_queue<Collapse> heap;
+
+    auto pushEdge = [&](unsigned a, unsigned b) {
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+        double costAB = q.eval(points[b]);     // a moves onto b
+        double costBA = q.eval(points[a]);
+        Collapse c;
+        if (costAB <= costBA) {
+            c.cost = costAB; c.from = a; c.to = b;
+        } else {
+            c.cost = costBA; c.from = b; c.to = a;
+        }
+        c.fromVersion = version[c.from];
+        c.toVersion = version[c.to];
+        heap.push(c);
+    };
+
+    for (unsigned t = 0; t < numTris; t++) {
+        if (triAlive[t]) {
+            for (unsigned k = 0; k < 3; k++) {
+                // shared edges get queued twice, which only costs a stale heap entry
+                pushEdge(tris[3 * t + k], tris[3 * t + (k + 1) % 3]);
+            }
+        }
+    }
+
+    double maxCost = 0.0;
+    bool collapsed = false;
+    unsigned targetTris = targetIndexCount / 3;
+
+    while (aliveTris > targetTris && !heap.empty()) {
+        Collapse c = heap.top();
+        heap.pop();
+
+        if (mergedInto[c.from] != c.from || mergedInto[c.to] != c.to ||
+            version[c.from] != c.fromVersion || version[c.to] != c.toVersion) {
+            continue;   // stale
+        }
+
+        // reject collapses that would flip a triangle
+        bool flips = false;
+        const std::vector<unsigned>& fromTris = pointTris[c.from];
+        for (unsigned i = 0; i < fromTris.size() && !flips; i++) {
+            unsigned t = fromTris[i];
+            if (!triAlive[t]) {
+                continue;
+            }
+            unsigned p0 = tris[3 * t], p1 = tris[3 * t + 1], p2 = tris[3 * t + 2];
+            if (p0 == c.to || p1 == c.to || p2 == c.to) {
+                continue;   // this one collapses away
+            }
+            glm::vec3 q0 = points[p0 == c.from ? c.to : p0];
+            glm::vec3 q1 = points[p1 == c.from ? c.to : p1];
+            glm::vec3 q2 = points[p2 == c.from ? c.to : p2];
+            glm::vec3 before = glm::cross(points[p1] - points[p0], points[p2] - points[p0]);
+            glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+            // also refuse steep rotations, which add up to flips over several collapses
+            flips = glm::dot(before, after) <= MIN_NORMAL_COS * glm::length(before) * glm::length(after);
+        }
+        if (flips) {
+            continue;
+        }
+
+        // merge 'from' into 'to'
+        mergedInto[c.from] = c.to;
+        quadrics[c.to] += quadrics[c.from];
+        version[c.to]++;
+        maxCost = std::max(maxCost, c.cost);
+        collapsed = true;
+
+        for (unsigned i = 0; i < fromTris.size(); i++) {
+            unsigned t = fromTris[i];
+            if (!triAlive[t]) {
+                continue;
+            }
+            for (unsigned k = 0; k < 3; k++) {
+                if (tris[3 * t + k] == c.from) {
+                    tris[3 * t + k] = c.to;
+                }
+            }
+            unsigned p0 = tris[3 * t], p1 = tris[3 * t + 1], p2 = tris[3 * t + 2];
+            if (p0 == p1 || p1 == p2 || p2 == p0) {
+                triAlive[t] = false;
+                --aliveTris;
+            } else {
+                pointTris[c.to].push_back(t);
+            }
+        }
+        std::vector<unsigned>().swap(pointTris[c.from]);
+
+        // drop dead triangles from the survivor's list and requeue its edges with the new quadric
+        std::vector<unsigned>& toTris = pointTris[c.to];
+        unsigned kept = 0;
+        for (unsigned i = 0; i < toTris.size(); i++) {
+            unsigned t = toTris[i];
+            if (triAlive[t]) {
+                toTris[kept++] = t;
+                for (unsigned k = 0; k < 3; k++) {
+                    unsigned n = tris[3 * t + k];
+                    if (n != c.to) {
+                        pushEdge(c.to, n);
+                    }
+                }
+            }
+        }
+        toTris.resize(kept);
+    }
+
+    if (!collapsed) {
+        return -1.0f;
+    }
+
+    //
+    // back to the original vertices: a corner that moved takes the best matching vertex at its new position
+    //
+    indices_ret.reserve(aliveTris * 3);
+    for (unsigned t = 0; t < numTris; t++) {
+        if (!triAlive[t]) {
+            continue;
+        }
+        for (unsigned k = 0; k < 3; k++) {
+            GLuint v = indices[3 * t + k];
+            unsigned p = tris[3 * t + k];
+            if (weld[v] != p) {
+                GLuint best = order[wedgeStart[p]];
+                if (normals) {
+                    float bestDot = -2.0f;
+                    for (unsigned i = wedgeStart[p]; i < wedgeStart[p + 1]; i++) {
+                        float d = glm::dot(normals[v], normals[order[i]]);
+                        if (d > bestDot) {
+                            bestDot = d;
+                            best = order[i];
+                        }
+                    }
+                }
+                v = best;
+            }
+            indices_ret.push_back(v);
+        }
+    }
+
+    return (float)std::sqrt(std::max(maxCost, 0.0));
+}
+
+} // end of namespace
@@ -0,0 +1,79 @@
+#ifndef GLSH_MESHSIMPLIFY_H_
+#define GLSH_MESHSIMPLIFY_H_
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GLSH_MeshOptimize.h"
+
+namespace glsh {
+
+//
+// Quadric error mesh simplification (Garland & Heckbert), restricted to collapsing vertices onto
+// existing vertices so the result indexes the original vertex array. Every LOD of a mesh can then
+// share one vertex range and differ only in its indices.
+//
+// Vertices with the same position (split by normals or texcoords) are welded while simplifying;
+// when a corner moves to another position, it picks the vertex there whose normal matches best.
+//
+// Returns the geometric error of the result, roughly the largest distance (in object space) between
+// the simplified surface and the original, or a negative value if nothing could be removed.
+//
+float SimplifyMesh(const glm::vec3* positions, const glm::vec3* normals, unsigned numVertices,
+                   const GLuint* indices, unsigned numIndices,
+                   unsigned targetIndexCount, std::vector<GLuint>& indices_ret);
+
+
+struct MeshLOD {
+    std::vector<GLuint>     indices;
+    float                   error;      // object-space error relative to the full mesh
+};
+
+//
+// Build up to numLevels - 1 coarser levels, each with about half the triangles of the previous one.
+// Levels that don't get meaningfully smaller are skipped, so fewer may come back.
+// Indices of each level are ordered for the vertex cache.
+//
+template <typename VertexType>
+int BuildLODs(const std::vector<VertexType>& vertices, const std::vector<GLuint>& indices, int numLevels,
+              std::vector<MeshLOD>& lods_ret)
+{
+    lods_ret.clear();
+    if (vertices.empty() || indices.size() < 3) {
+        return 0;
+    }
+
+    std::vector<glm::vec3> positions(vertices.size());
+    std::vector<glm::vec3> normals(vertices.size());
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].pos;
+        normals[i] = vertices[i].normal;
+    }
+
+    unsigned prevCount = indices.size();
+    for (int level = 1; level < numLevels; level++) {
+        unsigned target = (indices.size() >> level) / 3 * 3;
+        if (target < 3 * 8) {
+            break;      // nothing left worth drawing
+        }
+
+        MeshLOD lod;
+        lod.error = SimplifyMesh(&positions[0], &normals[0], positions.size(), &indices[0], indices.size(), target, lod.indices);
+        if (lod.error < 0.0f || lod.indices.size() > prevCount * 9 / 10) {
+            break;      // stuck, further levels won't do better
+        }
+
+        OptimizeVertexCache(&lod.indices[0], lod.indices.size(), positions.size());
+
+        prevCount = lod.indices.size();
+        lods_ret.push_back(lod);
+    }
+
+    return (int)lods_ret.size();
+}
+
+} // end of namespace
+
+#endif
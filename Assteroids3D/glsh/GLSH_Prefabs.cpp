@@ -214,8 +214,6 @@ Mesh* CreateWireframePlane(float xSize, float zSize, int xSegments, int zSegment
     }
 
     float y = 0;
-    float x = -0.5f * xSize;
-    float z = -0.5f * zSize;
 
     float x1 = -0.5f * xSize;
     float x2 =  0.5f * xSize;
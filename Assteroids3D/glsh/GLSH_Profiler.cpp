@@ -0,0 +1,192 @@
+#include "GLSH_Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace glsh {
+
+namespace {
+
+//
+// One ring of events per thread. Only the owning thread writes; 'count' is published after each event,
+// so readers can tell which slots may have been overwritten while they were copying.
+//
+struct ThreadBuffer {
+    ProfileEvent            events[Profiler::EVENTS_PER_THREAD];
+    std::atomic<uint64_t>   count;          // events ever recorded; event i lives in slot i % EVENTS_PER_THREAD
+    unsigned                index;
+    std::string             name;           // guarded by gRegistryMutex
+};
+
+std::mutex                  gRegistryMutex;
+std::vector<ThreadBuffer*>  gThreadBuffers;     // never freed, so events of finished threads can still be written
+
+thread_local ThreadBuffer*  tlsBuffer = nullptr;
+
+ThreadBuffer* GetThreadBuffer()
+{
+    ThreadBuffer* buf = tlsBuffer;
+    if (!buf) {
+        // once per thread, the only lock on the recording path
+        buf = new ThreadBuffer;
+        buf->count.store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        buf->index = gThreadBuffers.size();
+        gThreadBuffers.push_back(buf);
+        tlsBuffer = buf;
+    }
+    return buf;
+}
+
+// copy the events that are certainly intact
+void SnapshotEvents(const ThreadBuffer& buf, std::vector<ProfileEvent>& events_ret)
+{
+    const uint64_t capacity = Profiler::EVENTS_PER_THREAD;
+
+    uint64_t end = buf.count.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity ? end - capacity : 0;
+
+    events_ret.clear();
+    for (uint64_t i = begin; i < end; i++) {
+        events_ret.push_back(buf.events[i % capacity]);
+    }
+
+    // the writer may have reused the oldest slots meanwhile (including the one it's writing now)
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t endAfter = buf.count.load(std::memory_order_relaxed);
+    uint64_t firstIntact = endAfter + 1 > capacity ? endAfter + 1 - capacity : 0;
+    if (firstIntact > begin) {
+        uint64_t drop = std::min<uint64_t>(firstIntact - begin, events_ret.size());
+        events_ret.erase(events_ret.begin(), events_ret.begin() + (size_t)drop);
+    }
+}
+
+void WriteJSONString(FILE* f, const char* str)
+{
+    std::fputc('"', f);
+    for (const char* p = str ? str : ""; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            std::fputc('\\', f);
+            std::fputc(*p, f);
+        } else if ((unsigned char)*p < 0x20) {
+            std::fprintf(f, "\\u%04x", (unsigned)*p);
+        } else {
+            std::fputc(*p, f);
+        }
+    }
+    std::fputc('"', f);
+}
+
+} // end of anonymous namespace
+
+uint64_t Profiler::Now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::Record(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+    ThreadBuffer* buf = GetThreadBuffer();
+
+    uint64_t n = buf->count.load(std::memory_order_relaxed);
+    ProfileEvent& e = buf->events[n % EVENTS_PER_THREAD];
+    e.name = name;
+    e.beginNs = beginNs;
+    e.endNs = endNs;
+
+    buf->count.store(n + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+    ThreadBuffer* buf = GetThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    buf->name = name;
+}
+
+void Profiler::GetThreadEvents(uint64_t& cursor, std::vector<ProfileEvent>& events_ret)
+{
+    // only this thread writes its buffer, so nothing can change underneath
+    const ThreadBuffer* buf = GetThreadBuffer();
+
+    uint64_t end = buf->count.load(std::memory_order_relaxed);
+    uint64_t begin = end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0;
+    if (cursor > begin && cursor <= end) {
+        begin = cursor;
+    }
+
+    events_ret.clear();
+    for (uint64_t i = begin; i < end; i++) {
+        events_ret.push_back(buf->events[i % EVENTS_PER_THREAD]);
+    }
+    cursor = end;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) {
+        std::cerr << "*** Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    // buffers are never removed, so the list only needs the lock while it's copied
+    std::vector<ThreadBuffer*> buffers;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        buffers = gThreadBuffers;
+        for (unsigned i = 0; i < buffers.size(); i++) {
+            names.push_back(buffers[i]->name);
+        }
+    }
+
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    bool first = true;
+    std::vector<ProfileEvent> events;
+    unsigned numEvents = 0;
+
+    for (unsigned t = 0; t < buffers.size(); t++) {
+        if (!names[t].empty()) {
+            std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", t);
+            WriteJSONString(f, names[t].c_str());
+            std::fprintf(f, "}}");
+            first = false;
+        }
+
+        SnapshotEvents(*buffers[t], events);
+        for (unsigned i = 0; i < events.size(); i++) {
+            const ProfileEvent& e = events[i];
+            // complete events in microseconds; nesting is implied by the time ranges
+            std::fprintf(f, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                         first ? "" : ",\n", t, e.beginNs / 1000.0, (e.endNs - e.beginNs) / 1000.0);
+            WriteJSONString(f, e.name);
+            std::fputc('}', f);
+            first = false;
+        }
+        numEvents += events.size();
+    }
+
+    std::fprintf(f, "\n]}\n");
+
+    bool ok = std::ferror(f) == 0;
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        std::cerr << "*** Error writing " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote " << numEvents << " profile events from " << buffers.size() << " threads to " << path << std::endl;
+    return true;
+}
+
+} // end of namespace
@@ -1,9 +1,22 @@
 #include "GLSH_Shaders.h"
+#include "GLSH_GLDebug.h"
 #include "GLSH_Util.h"
 
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <set>
+#include <vector>
+
+#if _WIN32
+#include <direct.h>     // _mkdir
+#else
+#include <sys/stat.h>   // mkdir
+#endif
 
 namespace glsh {
 
@@ -12,12 +25,18 @@ GLuint CompileShader(GLenum shaderType, const std::string& path)
     // load shader source code from a text file
     std::string source = glsh::ReadTextFile(path);
 
+    return CompileShaderSource(shaderType, source, path);
+}
+
+GLuint CompileShaderSource(GLenum shaderType, const std::string& source, const std::string& name)
+{
     // create shader object of the appropriate type
     GLuint so = glCreateShader(shaderType);
     if (!so) {
         std::cerr << "*** Poop: Failed to create shader object" << std::endl;
         return GL_NONE;
     }
+    LabelGLObject(GL_SHADER, so, name);
 
     // attach shader source code
     const char* cSource = source.c_str();
@@ -30,7 +49,7 @@ GLuint CompileShader(GLenum shaderType, const std::string& path)
     GLint result;
     glGetShaderiv(so, GL_COMPILE_STATUS, &result);
     if (!result) {
-        std::cerr << "*** Poop: failed to compile shader " << path << ":\n";
+        std::cerr << "*** Poop: failed to compile shader " << name << ":\n";
 
         GLint infoLogLength = 0;
         glGetShaderiv(so, GL_INFO_LOG_LENGTH, &infoLogLength);
@@ -42,6 +61,7 @@ GLuint CompileShader(GLenum shaderType, const std::string& path)
             delete [] infoLog;
         }
 
+        glDeleteShader(so);
         return GL_NONE;
     }
 
@@ -49,59 +69,391 @@ GLuint CompileShader(GLenum shaderType, const std::string& path)
     return so;
 }
 
-GLuint BuildShaderProgram(const std::string& vsPath, const std::string& fsPath)
+
+//
+// Program binary cache
+//
+
+static std::string          gProgramCacheDir;
+static ProgramCacheStats    gProgramCacheStats;
+
+static const char           PROGRAM_CACHE_MAGIC[8] = { 'G', 'L', 'S', 'H', 'P', 'R', 'G', '1' };
+
+struct ProgramCacheHeader {
+    char        magic[8];
+    uint64_t    key;            // repeated here in case two keys ever share a file name
+    GLenum      format;
+    GLint       length;
+};
+
+void SetProgramCacheDirectory(const std::string& dir)
+{
+    gProgramCacheDir = dir;
+    if (!dir.empty()) {
+        // fails harmlessly if it already exists; if it can't be created, saving reports it
+#if _WIN32
+        _mkdir(dir.c_str());
+#else
+        mkdir(dir.c_str(), 0755);
+#endif
+    }
+}
+
+const ProgramCacheStats& GetProgramCacheStats()
+{
+    return gProgramCacheStats;
+}
+
+static bool ProgramCacheAvailable()
+{
+    if (gProgramCacheDir.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+        return false;
+    }
+
+    // traces carry shader sources; driver binaries wouldn't replay anywhere else
+    if (IsGLTraceRecording()) {
+        return false;
+    }
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+}
+
+// 64-bit FNV-1a
+static uint64_t HashBytes(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t HashString(uint64_t h, const char* str)
 {
-    // load and compile vertex shader
-    GLuint vs = CompileVertexShader(vsPath);
-    if (!vs)
+    // include the terminator so "ab" + "c" and "a" + "bc" differ
+    return str ? HashBytes(h, str, std::strlen(str) + 1) : HashBytes(h, "", 1);
+}
+
+static uint64_t ProgramCacheKey(const std::string& vsSource, const std::string& fsSource)
+{
+    uint64_t h = 14695981039346656037ull;
+    h = HashString(h, vsSource.c_str());
+    h = HashString(h, fsSource.c_str());
+    h = HashString(h, (const char*)glGetString(GL_VENDOR));
+    h = HashString(h, (const char*)glGetString(GL_RENDERER));
+    h = HashString(h, (const char*)glGetString(GL_VERSION));
+    return h;
+}
+
+static std::string ProgramCachePath(uint64_t key)
+{
+    char name[32];
+    std::sprintf(name, "%016llx.bin", (unsigned long long)key);
+    return gProgramCacheDir + "/" + name;
+}
+
+static GLuint LoadCachedProgram(uint64_t key)
+{
+    std::string path = ProgramCachePath(key);
+    std::ifstream f(path.c_str(), std::ios::binary);
+    if (!f.good()) {
         return GL_NONE;
+    }
+
+    ProgramCacheHeader header;
+    if (!f.read((char*)&header, sizeof(header)) ||
+        std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.key != key || header.length <= 0) {
+        return GL_NONE;
+    }
 
-    // load and compile fragment shader
-    GLuint fs = CompileFragmentShader(fsPath);
-    if (!fs) {
-        glDeleteShader(vs);   // cleanup
+    std::vector<char> binary(header.length);
+    if (!f.read(&binary[0], binary.size())) {
         return GL_NONE;
     }
 
-    // create shader program object
     GLuint prog = glCreateProgram();
     if (!prog) {
-        std::cerr << "*** Poop: Failed to create program object" << std::endl;
-        glDeleteShader(vs);
-        glDeleteShader(fs);
         return GL_NONE;
     }
 
-    // attach vertex and fragment shaders to the program object
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
+    glProgramBinary(prog, header.format, &binary[0], header.length);
 
-    // link program
-    glLinkProgram(prog);
-
-    // shader objects no longer needed once program is linked
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-
-    // check link status
-    GLint linkStatus;
+    // drivers may refuse binaries from older builds of themselves, even when the version string didn't change
+    GLint linkStatus = 0;
     glGetProgramiv(prog, GL_LINK_STATUS, &linkStatus);
     if (!linkStatus) {
-        std::cerr << "*** Poop: Failed to link vertex shader " << vsPath << " with fragment shader " << fsPath << std::endl;
         glDeleteProgram(prog);
+#if GLSH_GL_DEBUG
+        glGetError();   // a rejected binary may leave GL_INVALID_ENUM behind
+#endif
+        gProgramCacheStats.rejected++;
         return GL_NONE;
     }
 
+    return prog;
+}
+
+static void StoreCachedProgram(uint64_t key, GLuint prog)
+{
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    ProgramCacheHeader header;
+    std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.key = key;
+    header.format = GL_NONE;
+    header.length = 0;
+    glGetProgramBinary(prog, length, &header.length, &header.format, &binary[0]);
+    if (header.length <= 0) {
+        return;
+    }
+
+    std::string path = ProgramCachePath(key);
+    std::ofstream f(path.c_str(), std::ios::binary | std::ios::trunc);
+    f.write((const char*)&header, sizeof(header));
+    f.write(&binary[0], header.length);
+    if (!f.good()) {
+        std::cerr << "*** Failed to write program cache file " << path << std::endl;
+        return;
+    }
+
+    gProgramCacheStats.stored++;
+}
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool HasParallelShaderCompile()
+{
+    return GLEW_KHR_parallel_shader_compile != GL_FALSE;
+}
+
+// print and return false if the shader didn't compile
+static bool CheckShaderStatus(GLuint so, const std::string& name)
+{
+    GLint result = 0;
+    glGetShaderiv(so, GL_COMPILE_STATUS, &result);
+    if (result) {
+        return true;
+    }
+
+    std::cerr << "*** Poop: failed to compile shader " << name << ":\n";
+
+    GLint infoLogLength = 0;
+    glGetShaderiv(so, GL_INFO_LOG_LENGTH, &infoLogLength);
+    if (infoLogLength > 0) {
+        std::vector<char> infoLog(infoLogLength);
+        glGetShaderInfoLog(so, infoLogLength, NULL, &infoLog[0]);
+        std::cerr << &infoLog[0] << std::endl;
+    }
+    return false;
+}
+
+ShaderProgramBatch::ShaderProgramBatch()
+    : mNumSubmitted(0)
+    , mUseCache(false)
+{
+}
+
+ShaderProgramBatch::~ShaderProgramBatch()
+{
+    for (unsigned i = 0; i < mEntries.size(); i++) {
+        Entry& e = mEntries[i];
+        if (!e.resolved) {
+            glDeleteShader(e.vs);
+            glDeleteShader(e.fs);
+            glDeleteProgram(e.prog);
+        }
+    }
+}
+
+int ShaderProgramBatch::add(const std::string& vsPath, const std::string& fsPath)
+{
+    Entry e;
+    e.vsPath = vsPath;
+    e.fsPath = fsPath;
+    e.cacheKey = 0;
+    e.vs = e.fs = e.prog = GL_NONE;
+    e.fromCache = false;
+    e.resolved = false;
+    mEntries.push_back(e);
+    return (int)mEntries.size() - 1;
+}
+
+void ShaderProgramBatch::submit()
+{
+    auto submitStart = std::chrono::steady_clock::now();
+
+    if (mNumSubmitted == 0) {
+        mUseCache = ProgramCacheAvailable();
+
+        // let the driver use as many compiler threads as it likes
+        static bool threadsSet = false;
+        if (HasParallelShaderCompile() && !threadsSet) {
+            glMaxShaderCompilerThreadsKHR(0xffffffff);
+            threadsSet = true;
+        }
+    }
+
+    for (; mNumSubmitted < mEntries.size(); mNumSubmitted++) {
+        Entry& e = mEntries[mNumSubmitted];
+
+        std::string vsSource = glsh::ReadTextFile(e.vsPath);
+        std::string fsSource = glsh::ReadTextFile(e.fsPath);
+
+        if (mUseCache) {
+            e.cacheKey = ProgramCacheKey(vsSource, fsSource);
+            e.prog = LoadCachedProgram(e.cacheKey);
+            if (e.prog) {
+                LabelGLObject(GL_PROGRAM, e.prog, e.vsPath + " + " + e.fsPath);
+                e.fromCache = true;
+                continue;
+            }
+        }
+
+        // no status queries here, they would wait for the compiler
+        const char* cSource = vsSource.c_str();
+        e.vs = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(e.vs, 1, &cSource, NULL);
+        glCompileShader(e.vs);
+
+        cSource = fsSource.c_str();
+        e.fs = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(e.fs, 1, &cSource, NULL);
+        glCompileShader(e.fs);
+
+        e.prog = glCreateProgram();
+        if (!e.vs || !e.fs || !e.prog) {
+            std::cerr << "*** Poop: Failed to create shader objects for " << e.vsPath << " and " << e.fsPath << std::endl;
+            continue;   // reported as a failure by getProgram
+        }
+
+        LabelGLObject(GL_SHADER, e.vs, e.vsPath);
+        LabelGLObject(GL_SHADER, e.fs, e.fsPath);
+        LabelGLObject(GL_PROGRAM, e.prog, e.vsPath + " + " + e.fsPath);
+
+        glAttachShader(e.prog, e.vs);
+        glAttachShader(e.prog, e.fs);
+
+        // some drivers only keep what glGetProgramBinary needs if asked before linking
+        if (mUseCache) {
+            glProgramParameteri(e.prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        glLinkProgram(e.prog);
+    }
+
+    gProgramCacheStats.buildMs += ElapsedMs(submitStart);
+}
+
+bool ShaderProgramBatch::isReady(int handle) const
+{
+    if (handle < 0 || handle >= (int)mNumSubmitted) {
+        return false;
+    }
+
+    const Entry& e = mEntries[handle];
+    if (e.resolved || e.fromCache || !e.prog || !HasParallelShaderCompile()) {
+        return true;
+    }
+
+    GLint done = GL_FALSE;
+    glGetProgramiv(e.prog, GL_COMPLETION_STATUS_KHR, &done);
+    return done != GL_FALSE;
+}
+
+GLuint ShaderProgramBatch::getProgram(int handle)
+{
+    if (handle < 0 || handle >= (int)mEntries.size()) {
+        return GL_NONE;
+    }
+
+    if (handle >= (int)mNumSubmitted) {
+        submit();
+    }
+
+    Entry& e = mEntries[handle];
+    if (!e.resolved) {
+        auto resolveStart = std::chrono::steady_clock::now();
+        resolve(e);
+        gProgramCacheStats.buildMs += ElapsedMs(resolveStart);
+    }
+    return e.prog;
+}
+
+void ShaderProgramBatch::resolve(Entry& e)
+{
+    e.resolved = true;
+
+    if (e.fromCache) {
+        gProgramCacheStats.loaded++;
+        return;
+    }
+
+    bool ok = e.vs && e.fs && e.prog;
+    ok = ok && CheckShaderStatus(e.vs, e.vsPath);
+    ok = ok && CheckShaderStatus(e.fs, e.fsPath);
+
+    if (ok) {
+        GLint linkStatus = 0;
+        glGetProgramiv(e.prog, GL_LINK_STATUS, &linkStatus);
+        if (!linkStatus) {
+            std::cerr << "*** Poop: Failed to link vertex shader " << e.vsPath << " with fragment shader " << e.fsPath << std::endl;
+
+            GLint infoLogLength = 0;
+            glGetProgramiv(e.prog, GL_INFO_LOG_LENGTH, &infoLogLength);
+            if (infoLogLength > 0) {
+                std::vector<char> infoLog(infoLogLength);
+                glGetProgramInfoLog(e.prog, infoLogLength, NULL, &infoLog[0]);
+                std::cerr << &infoLog[0] << std::endl;
+            }
+            ok = false;
+        }
+    }
+
+    // shader objects no longer needed once program is linked
+    glDeleteShader(e.vs);
+    glDeleteShader(e.fs);
+    e.vs = e.fs = GL_NONE;
+
+#if GLSH_GL_DEBUG
     // check for GL errors
     GLenum err = glGetError();
-    if (err != GL_NO_ERROR) {
-        std::cout << "*** Poop: GL Error in function " __FUNCTION__ " on line " << __LINE__ << ": " << gluErrorString(err) << std::endl;
-        glDeleteProgram(prog);
-        return GL_NONE;
+    if (ok && err != GL_NO_ERROR) {
+        std::cout << "*** Poop: GL Error while building " << e.vsPath << " + " << e.fsPath << ": " << gluErrorString(err) << std::endl;
+        ok = false;
     }
+#endif
 
-    // return program id
-    return prog;
+    if (!ok) {
+        glDeleteProgram(e.prog);
+        e.prog = GL_NONE;
+        return;
+    }
+
+    gProgramCacheStats.compiled++;
+
+    if (mUseCache) {
+        StoreCachedProgram(e.cacheKey, e.prog);
+    }
+}
+
+GLuint BuildShaderProgram(const std::string& vsPath, const std::string& fsPath)
+{
+    ShaderProgramBatch batch;
+    int handle = batch.add(vsPath, fsPath);
+    batch.submit();
+    return batch.getProgram(handle);
 }
 
 
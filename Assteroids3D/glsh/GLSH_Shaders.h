@@ -2,18 +2,99 @@
 #define GLSH_SHADERS_H_
 
 #include <GL/glew.h>
+#include "GLSH_GLTrace.h"
 #include <glm/glm.hpp>                      // glm::vec3, glm::vec4, glm::ivec4, glm::mat4, ...
 #include <glm/gtc/type_ptr.hpp>             // glm::value_ptr
+#include "GLSH_GLStats.h"
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace glsh {
 
 GLuint CompileShader(GLenum shaderType, const std::string& path);
+GLuint CompileShaderSource(GLenum shaderType, const std::string& source, const std::string& name);  // name is for error messages
 GLuint CompileVertexShader(const std::string& path);
 GLuint CompileFragmentShader(const std::string& path);
 
 GLuint BuildShaderProgram(const std::string& vsPath, const std::string& fsPath);
 
+//
+// Program binary cache
+//
+//     When a cache directory is set, BuildShaderProgram saves linked programs there with glGetProgramBinary
+//     and loads them with glProgramBinary on later runs. Entries are keyed by a hash of both sources and the
+//     GL vendor, renderer, and version strings, so an edited shader or a different driver just compiles again.
+//     Binaries the driver rejects are recompiled and replaced. Without ARB_get_program_binary, or with no
+//     binary formats (older Mesa software rasterizers), everything compiles from source as before.
+//
+void SetProgramCacheDirectory(const std::string& dir);     // empty (the default) disables the cache
+
+struct ProgramCacheStats {
+    unsigned    loaded;         // programs that came from the cache
+    unsigned    compiled;       // programs built from source
+    unsigned    stored;         // binaries written to the cache
+    unsigned    rejected;       // cached binaries the driver refused
+    double      buildMs;        // total time spent in BuildShaderProgram
+
+    ProgramCacheStats()
+        : loaded(0), compiled(0), stored(0), rejected(0), buildMs(0.0)
+    { }
+};
+
+const ProgramCacheStats& GetProgramCacheStats();
+
+//
+// ShaderProgramBatch
+//
+//     Builds several programs without stalling on each one. submit() issues every glCompileShader and
+//     glLinkProgram up front; compile and link status are only queried when a program is fetched with
+//     getProgram. With KHR_parallel_shader_compile the driver compiles on its own threads in the meantime,
+//     so queue the programs early, load other assets, and fetch them right before they're needed.
+//     Programs found in the binary cache are loaded at submit time.
+//
+class ShaderProgramBatch {
+
+    struct Entry {
+        std::string         vsPath;
+        std::string         fsPath;
+        uint64_t            cacheKey;
+        GLuint              vs;
+        GLuint              fs;
+        GLuint              prog;
+        bool                fromCache;
+        bool                resolved;       // status checked, ownership passed to the caller
+    };
+
+    std::vector<Entry>      mEntries;
+    unsigned                mNumSubmitted;
+    bool                    mUseCache;
+
+    void                    resolve(Entry& e);
+
+                            ShaderProgramBatch(const ShaderProgramBatch&) = delete;
+    ShaderProgramBatch&     operator=(const ShaderProgramBatch&) = delete;
+
+public:
+                            ShaderProgramBatch();
+                            ~ShaderProgramBatch();          // deletes programs that were never fetched
+
+    // queue a program, returns its handle for getProgram
+    int                     add(const std::string& vsPath, const std::string& fsPath);
+
+    // issue the compiles and links of everything added since the last submit
+    void                    submit();
+
+    // true when the driver has finished the program, so getProgram won't block (never blocks itself)
+    bool                    isReady(int handle) const;
+
+    // wait for the program if needed and check its status; returns GL_NONE if it failed to build.
+    // The caller owns the program afterwards.
+    GLuint                  getProgram(int handle);
+
+    unsigned                size() const                { return mEntries.size(); }
+};
+
 //
 // GetActiveShaderUniformLocation
 //
@@ -59,36 +140,43 @@ inline GLuint CompileFragmentShader(const std::string& path)
 
 inline void SetShaderUniform(GLint location, GLfloat scalar)
 {
+    CountUniformUpload(location, &scalar, sizeof(scalar));
     glUniform1f(location, scalar);
 }
 
 inline void SetShaderUniform(GLint location, const glm::vec2& vec)
 {
+    CountUniformUpload(location, glm::value_ptr(vec), sizeof(vec));
     glUniform2fv(location, 1, glm::value_ptr(vec));
 }
 
 inline void SetShaderUniform(GLint location, const glm::vec3& vec)
 {
+    CountUniformUpload(location, glm::value_ptr(vec), sizeof(vec));
     glUniform3fv(location, 1, glm::value_ptr(vec));
 }
 
 inline void SetShaderUniform(GLint location, const glm::vec4& vec)
 {
+    CountUniformUpload(location, glm::value_ptr(vec), sizeof(vec));
     glUniform4fv(location, 1, glm::value_ptr(vec));
 }
 
 inline void SetShaderUniform(GLint location, const glm::mat3& mat)
 {
+    CountUniformUpload(location, glm::value_ptr(mat), sizeof(mat));
     glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 inline void SetShaderUniform(GLint location, const glm::mat4& mat)
 {
+    CountUniformUpload(location, glm::value_ptr(mat), sizeof(mat));
     glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 inline void SetShaderUniformInt(GLint location, GLint scalar)
 {
+    CountUniformUpload(location, &scalar, sizeof(scalar));
     glUniform1i(location, scalar);
 }
 
@@ -1,4 +1,8 @@
 #include "GLSH_System.h"
+#include "GLSH_GLStats.h"
+#include "GLSH_Memory.h"
+#include "GLSH_Profiler.h"
+#include "GLSH_Telemetry.h"
 
 #include <iostream>
 #include <fstream>
@@ -23,6 +27,8 @@ std::vector<KeyCode>        System::smSpecialKeys(256, KC_UNKNOWN);
 
 std::vector<MouseButton>    System::smMouseButtons(8, MOUSE_BUTTON_UNKNOWN);
 
+std::vector<InputRecord>    System::smReplayInput;
+
 
 Keyboard::Keyboard()
     : mCurrKeyState(KC_NUM_KEYS, false)
@@ -51,6 +57,9 @@ void Keyboard::_injectKeyDown(KeyCode kc)
     case KC_ALT_R:
         mCurrKeyState[KC_ALT] = true;
         break;
+
+    default:
+        break;
     }
 }
 
@@ -82,6 +91,9 @@ void Keyboard::_injectKeyUp(KeyCode kc)
     case KC_ALT_R:
         mCurrKeyState[KC_ALT] = mCurrKeyState[KC_ALT_L];
         break;
+
+    default:
+        break;
     }
 }
 
@@ -212,6 +224,9 @@ void Mouse::_clear()
 Window::Window(App& app, int windowId)
     : mApp(app)
     , mWindowId(windowId)
+    , mHeadless(false)
+    , mHeadlessWidth(0)
+    , mHeadlessHeight(0)
     , mKeyboard()
     , mMouse()
     , mStartTimeMS(glutGet(GLUT_ELAPSED_TIME))
@@ -220,17 +235,36 @@ Window::Window(App& app, int windowId)
     mApp._setWindow(this);
 }
 
+Window::Window(App& app, int width, int height)
+    : mApp(app)
+    , mWindowId(0)
+    , mHeadless(true)
+    , mHeadlessWidth(width)
+    , mHeadlessHeight(height)
+    , mKeyboard()
+    , mMouse()
+    , mStartTimeMS(0)
+    , mTime(0)
+{
+    mApp._setWindow(this);
+}
+
 Window::~Window()
 {
     mApp._setWindow(NULL);
 }
 
-bool Window::update()
+float Window::advanceTime()
 {
     float now = 0.001f * (glutGet(GLUT_ELAPSED_TIME) - mStartTimeMS);
     float dt = now - mTime;
     mTime = now;
 
+    return dt;
+}
+
+bool Window::step(float dt)
+{
     if (mApp.isQuitting()) {
         return false;
     }
@@ -248,6 +282,12 @@ bool Window::update()
 
 void Window::lostFocus()
 {
+    // a replay only loses focus where the recording did
+    if (IsInputReplaying()) {
+        return;
+    }
+    RecordInput(INPUT_FOCUS_LOST, 0, 0, 0);
+
     // clear input device states when window is not in focus
     mKeyboard._clear();
     mMouse._clear();
@@ -297,6 +337,170 @@ void Window::_dispatchEvents()
 }
 
 
+Window* System::CreateHeadlessWindow(App& app, int width, int height)
+{
+    return new Window(app, width, height);
+}
+
+void System::DestroyHeadlessWindow(Window* wnd)
+{
+    try {
+        wnd->getApp().shutdown();
+    } catch (const std::exception& e) {
+        std::cerr << "*** Exception\n" << e.what() << "\n*** End of Exception" << std::endl;
+    }
+
+    delete wnd;
+}
+
+bool System::StepHeadless(Window* wnd, float dt)
+{
+    // same as a GLUT frame, minus the redisplay
+    try {
+        return StepWindow(wnd, dt);
+
+    } catch (const std::exception& e) {
+        std::cerr << "*** Exception\n" << e.what() << "\n*** End of Exception" << std::endl;
+        return false;
+    }
+}
+
+void System::PostHeadlessEvent(Window* wnd, const InputEvent& e)
+{
+    const Mouse& mouse = wnd->getMouse();
+
+    // there's no cursor motion between clicks, so buttons move the cursor first
+    switch (e.type) {
+    case KEY_DOWN_EVENT:
+    case KEY_UP_EVENT:
+        InjectKey(wnd, e.ke.key, e.type == KEY_DOWN_EVENT);
+        break;
+    case MOUSE_DOWN_EVENT:
+    case MOUSE_UP_EVENT:
+        InjectMousePos(wnd, e.mbe.x, e.mbe.y);
+        InjectMouseButton(wnd, e.mbe.button, e.type == MOUSE_DOWN_EVENT, e.mbe.x, e.mbe.y);
+        break;
+    case MOUSE_MOTION_EVENT:
+        InjectMousePos(wnd, mouse.getX() + e.mme.dx, mouse.getY() + e.mme.dy);
+        break;
+    case MOUSE_SCROLL_EVENT:
+        InjectWheel(wnd, e.mse.delta);
+        break;
+    }
+}
+
+bool System::StepWindow(Window* wnd, float dt)
+{
+    if (!BeginInputTick(dt, smReplayInput)) {
+        // the replay is over
+        StopInputLog();
+        wnd->getApp().quit();
+        return false;
+    }
+    for (size_t i = 0; i < smReplayInput.size(); i++) {
+        ReplayInput(wnd, smReplayInput[i]);
+    }
+
+    wnd->_dispatchEvents();
+    if (wnd->mHeadless) {
+        wnd->mTime += dt;
+    }
+
+    bool keepRunning = wnd->step(dt);
+
+    if (keepRunning && (IsInputRecording() || IsInputReplaying())) {
+        EndInputTick(wnd->getApp().getStateChecksum());
+    }
+    return keepRunning;
+}
+
+void System::InjectKey(Window* wnd, KeyCode kc, bool down)
+{
+    RecordInput(down ? INPUT_KEY_DOWN : INPUT_KEY_UP, kc, 0, 0);
+
+    InputEvent e;
+    if (down) {
+        wnd->getKeyboard()._injectKeyDown(kc);
+        e.type = KEY_DOWN_EVENT;
+    } else {
+        wnd->getKeyboard()._injectKeyUp(kc);
+        e.type = KEY_UP_EVENT;
+    }
+    e.ke.key = kc;
+    wnd->_postEvent(e);
+}
+
+void System::InjectMouseButton(Window* wnd, MouseButton mb, bool down, int x, int y)
+{
+    RecordInput(down ? INPUT_BUTTON_DOWN : INPUT_BUTTON_UP, mb, x, y);
+
+    InputEvent e;
+    if (down) {
+        wnd->getMouse()._injectButtonDown(mb);
+        e.type = MOUSE_DOWN_EVENT;
+    } else {
+        wnd->getMouse()._injectButtonUp(mb);
+        e.type = MOUSE_UP_EVENT;
+    }
+    e.mbe.button = mb;
+    e.mbe.x = x;
+    e.mbe.y = y;
+    wnd->_postEvent(e);
+}
+
+void System::InjectMousePos(Window* wnd, int x, int y)
+{
+    RecordInput(INPUT_CURSOR, 0, x, y);
+
+    Mouse& mouse = wnd->getMouse();
+
+    mouse._injectMousePos(x, y);
+
+    InputEvent e;
+    e.type = MOUSE_MOTION_EVENT;
+    e.mme.dx = x - mouse.getX();
+    e.mme.dy = y - mouse.getY();
+    wnd->_postEvent(e);
+}
+
+void System::InjectWheel(Window* wnd, int dir)
+{
+    RecordInput(INPUT_WHEEL, dir, 0, 0);
+
+    wnd->getMouse()._injectWheelDelta(dir);
+
+    InputEvent e;
+    e.type = MOUSE_SCROLL_EVENT;
+    e.mse.delta = dir;
+    wnd->_postEvent(e);
+}
+
+void System::ReplayInput(Window* wnd, const InputRecord& r)
+{
+    switch (r.type) {
+    case INPUT_KEY_DOWN:
+    case INPUT_KEY_UP:
+        InjectKey(wnd, (KeyCode)r.code, r.type == INPUT_KEY_DOWN);
+        break;
+    case INPUT_BUTTON_DOWN:
+    case INPUT_BUTTON_UP:
+        InjectMouseButton(wnd, (MouseButton)r.code, r.type == INPUT_BUTTON_DOWN, r.x, r.y);
+        break;
+    case INPUT_CURSOR:
+        InjectMousePos(wnd, r.x, r.y);
+        break;
+    case INPUT_WHEEL:
+        InjectWheel(wnd, r.code);
+        break;
+    case INPUT_FOCUS_LOST:
+        wnd->getKeyboard()._clear();
+        wnd->getMouse()._clear();
+        break;
+    default:
+        break;
+    }
+}
+
 void System::Initialize()
 {
     if (!glutGet(GLUT_INIT_STATE)) {
@@ -465,6 +669,9 @@ void System::InitializeMouseButtons()
 int System::CreateWindow(const std::string& title, int width, int height)
 {
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_MULTISAMPLE);
+#if GLSH_GL_DEBUG
+    glutInitContextFlags(GLUT_DEBUG);   // most drivers only say much on debug contexts
+#endif
     glutInitWindowSize(width, height);
 
     int windowId = glutCreateWindow(title.c_str());
@@ -517,6 +724,11 @@ void System::Run(App& app, const std::string& title, int width, int height)
         return;
     }
 
+    // GL errors and warnings are printed as they happen
+    if (!InstallGLDebugOutput()) {
+        std::cerr << "*** GL_KHR_debug is not available, the driver won't report GL errors as they happen" << std::endl;
+    }
+
     // don't let any application exceptions escape this point
     try {
         // during app initialization, time should always be 0
@@ -623,126 +835,105 @@ void System::WindowCloseCallback()
 
 void System::KeyDownCallback(unsigned char key, int x, int y)
 {
+    // a replay gets its input from the log
+    if (IsInputReplaying()) {
+        return;
+    }
+
     Window* wnd = static_cast<Window*>(glutGetWindowData());
 
     KeyCode kc = key < smAsciiKeys.size() ? smAsciiKeys[key] : KC_UNKNOWN;
 
-    wnd->getKeyboard()._injectKeyDown(kc);
-
-    InputEvent e;
-    e.type = KEY_DOWN_EVENT;
-    e.ke.key = kc;
-    wnd->_postEvent(e);
+    InjectKey(wnd, kc, true);
 }
 
 void System::KeyUpCallback(unsigned char key, int x, int y)
 {
+    if (IsInputReplaying()) {
+        return;
+    }
+
     Window* wnd = static_cast<Window*>(glutGetWindowData());
 
     KeyCode kc = key < smAsciiKeys.size() ? smAsciiKeys[key] : KC_UNKNOWN;
 
-    wnd->getKeyboard()._injectKeyUp(kc);
-
-    InputEvent e;
-    e.type = KEY_UP_EVENT;
-    e.ke.key = kc;
-    wnd->_postEvent(e);
+    InjectKey(wnd, kc, false);
 }
 
 void System::SpecialDownCallback(int key, int x, int y)
 {
+    if (IsInputReplaying()) {
+        return;
+    }
+
     Window* wnd = static_cast<Window*>(glutGetWindowData());
 
     KeyCode kc = (unsigned)key < smSpecialKeys.size() ? smSpecialKeys[key] : KC_UNKNOWN;
 
-    wnd->getKeyboard()._injectKeyDown(kc);
-
-    InputEvent e;
-    e.type = KEY_DOWN_EVENT;
-    e.ke.key = kc;
-    wnd->_postEvent(e);
+    InjectKey(wnd, kc, true);
 }
 
 void System::SpecialUpCallback(int key, int x, int y)
 {
+    if (IsInputReplaying()) {
+        return;
+    }
+
     Window* wnd = static_cast<Window*>(glutGetWindowData());
 
     KeyCode kc = (unsigned)key < smSpecialKeys.size() ? smSpecialKeys[key] : KC_UNKNOWN;
 
-    wnd->getKeyboard()._injectKeyUp(kc);
-
-    InputEvent e;
-    e.type = KEY_UP_EVENT;
-    e.ke.key = kc;
-    wnd->_postEvent(e);
+    InjectKey(wnd, kc, false);
 }
 
 void System::MouseButtonCallback(int button, int state, int x, int y)
 {
     //std::cout << "--- button " << button << " state " << state << std::endl;
 
+    if (IsInputReplaying()) {
+        return;
+    }
+
     Window* wnd = static_cast<Window*>(glutGetWindowData());
 
     MouseButton mb = (unsigned)button < smMouseButtons.size() ? smMouseButtons[button] : MOUSE_BUTTON_UNKNOWN;
 
-    InputEvent e;
-
-    if (state == GLUT_DOWN) {
-        wnd->getMouse()._injectButtonDown(mb);
-        e.type = MOUSE_DOWN_EVENT;
-    } else if (state = GLUT_UP) {
-        wnd->getMouse()._injectButtonUp(mb);
-        e.type = MOUSE_UP_EVENT;
-    }
-
-    e.mbe.button = mb;
-    e.mbe.x = x;
-    e.mbe.y = y;
-    wnd->_postEvent(e);
+    InjectMouseButton(wnd, mb, state == GLUT_DOWN, x, y);
 }
 
 void System::MouseMotionCallback(int x, int y)
 {
-    Window* wnd = static_cast<Window*>(glutGetWindowData());
+    if (IsInputReplaying()) {
+        return;
+    }
 
-    Mouse& mouse = wnd->getMouse();
+    Window* wnd = static_cast<Window*>(glutGetWindowData());
 
-    mouse._injectMousePos(x, y);
-    
-    InputEvent e;
-    e.type = MOUSE_MOTION_EVENT;
-    e.mme.dx = x - mouse.getX();
-    e.mme.dy = y - mouse.getY();
-    wnd->_postEvent(e);
+    InjectMousePos(wnd, x, y);
 }
 
 void System::MouseDragCallback(int x, int y)
 {
-    Window* wnd = static_cast<Window*>(glutGetWindowData());
+    if (IsInputReplaying()) {
+        return;
+    }
 
-    Mouse& mouse = wnd->getMouse();
+    Window* wnd = static_cast<Window*>(glutGetWindowData());
 
-    mouse._injectMousePos(x, y);
-    
-    InputEvent e;
-    e.type = MOUSE_MOTION_EVENT;
-    e.mme.dx = x - mouse.getX();
-    e.mme.dy = y - mouse.getY();
-    wnd->_postEvent(e);
+    InjectMousePos(wnd, x, y);
 }
 
 void System::MouseWheelCallback(int wheel, int dir, int x, int y)
 {
     //std::cout << "--- wheel dir = " << dir << std::endl;
 
-    Window* wnd = static_cast<Window*>(glutGetWindowData());
+    if (IsInputReplaying()) {
+        return;
+    }
 
-    wnd->getMouse()._injectWheelDelta(dir);
+    Window* wnd = static_cast<Window*>(glutGetWindowData());
 
-    InputEvent e;
-    e.type = MOUSE_SCROLL_EVENT;
-    e.mse.delta = dir;
-    wnd->_postEvent(e);
+    InjectWheel(wnd, dir);
 }
 
 void System::MouseEntryCallback(int state)
@@ -760,6 +951,8 @@ void System::MouseEntryCallback(int state)
 
 void System::DisplayCallback()
 {
+    GLSH_PROFILE_ZONE("System::display");
+
     Window* wnd = static_cast<Window*>(glutGetWindowData());
 
     // don't let any application exceptions escape this callback
@@ -772,13 +965,21 @@ void System::DisplayCallback()
         return;
     }
 
+    GLSH_PROFILE_ZONE("glutSwapBuffers");
     glutSwapBuffers();
+
+    EndGLStatsFrame();
+    EndMemoryFrame();
+    EndTelemetryFrame();
+    GLTraceEndFrame();
 }
 
 void System::UpdateCallback()
 {
     // global callback (not associated with any particular window)
 
+    GLSH_PROFILE_ZONE("System::update");
+
     for (unsigned i = 0; i < smWindows.size(); i++) {
         Window* wnd = smWindows[i];
         int windowId = wnd->getWindowId();
@@ -790,9 +991,7 @@ void System::UpdateCallback()
         // don't let any application exceptions escape this callback
         try {
 
-            wnd->_dispatchEvents();
-
-            keepRunning = wnd->update();
+            keepRunning = StepWindow(wnd, wnd->advanceTime());
 
         } catch (const std::exception& e) {
             std::cerr << "*** Exception\n" << e.what() << "\n*** End of Exception" << std::endl;
@@ -810,6 +1009,7 @@ void System::UpdateCallback()
 
 void CheckGLErrors(const char* label, const char* function, const char* file, long line)
 {
+#if GLSH_GL_DEBUG
 	GLenum errCode;
 	if ((errCode = glGetError()) != GL_NO_ERROR) {
 		const GLubyte* errStr = gluErrorString(errCode);
@@ -826,6 +1026,7 @@ void CheckGLErrors(const char* label, const char* function, const char* file, lo
 
         throw std::runtime_error(errmsg.str());
     }
+#endif
 }
 
 void CheckGLShader(GLuint shaderId, const char* label, const char* function, const char* file, long line)
@@ -841,15 +1042,15 @@ void CheckGLShader(GLuint shaderId, const char* label, const char* function, con
         glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &length);
         CheckGLErrors(label, function, file, line);
         
-        std::auto_ptr<char> infoLog(new char[length]);
-        glGetShaderInfoLog(shaderId, length, NULL, infoLog.get());
+        std::vector<char> infoLog(length + 1, '\0');
+        glGetShaderInfoLog(shaderId, length, NULL, &infoLog[0]);
         CheckGLErrors(label, function, file, line);
 
         std::stringstream errmsg;
         if (label)
             errmsg << label << ": ";
         errmsg << "GLSL shader compile error in function " << function << " (" << file << ":" << line << ").\n";
-        errmsg << "Shader info log says:\n" << infoLog.get();
+        errmsg << "Shader info log says:\n" << &infoLog[0];
 
         throw std::runtime_error(errmsg.str());
     }
@@ -867,15 +1068,15 @@ void CheckGLProgram(GLuint progId, const char* label, const char* function, cons
         glGetProgramiv(progId, GL_INFO_LOG_LENGTH, &length);
         CheckGLErrors(label, function, file, line);
     
-        std::auto_ptr<char> infoLog(new char[length]);
-        glGetProgramInfoLog(progId, length, NULL, infoLog.get());
+        std::vector<char> infoLog(length + 1, '\0');
+        glGetProgramInfoLog(progId, length, NULL, &infoLog[0]);
         CheckGLErrors(label, function, file, line);
 
         std::stringstream errmsg;
         if (label)
             errmsg << label << ": ";
         errmsg << "GLSL program link error in function " << function << " (" << file << ":" << line << ").\n";
-        errmsg << "Program info log says:\n" << infoLog.get();
+        errmsg << "Program info log says:\n" << &infoLog[0];
 
         throw std::runtime_error(errmsg.str());
     }
@@ -2,6 +2,8 @@
 #define GLSH_SYSTEM_H_
 
 #include <GL/glew.h>
+#include "GLSH_GLTrace.h"
+#include "GLSH_GLDebug.h"
 
 // link with glew32.lib (compiler-specific cheat)
 #if _WIN32
@@ -35,6 +37,7 @@
 
 #include "GLSH_App.h"
 #include "GLSH_Event.h"
+#include "GLSH_InputLog.h"
 
 namespace glsh {
 
@@ -388,6 +391,7 @@ private:
     friend class        System;
 
                         Window(App& app, int windowId);
+                        Window(App& app, int width, int height);    // headless
 
                         ~Window();
 
@@ -398,7 +402,8 @@ private:
     Keyboard&           getKeyboard();
     Mouse&              getMouse();
 
-    bool                update();
+    float               advanceTime();      // seconds since the last call
+    bool                step(float dt);
 
     void                lostFocus();
     void                gainFocus();
@@ -416,6 +421,9 @@ private:
     App&                mApp;
     int                 mWindowId;
 
+    bool                mHeadless;
+    int                 mHeadlessWidth, mHeadlessHeight;
+
     Keyboard            mKeyboard;
     Mouse               mMouse;
 
@@ -431,7 +439,32 @@ public:
 
     static float        GetTime();   // total time since glshell was initialized
 
+    //
+    // Headless windows run an app without GLUT or a window (benchmarks, stress tests, replays).
+    // The size is fixed and the clock only moves when the window is stepped. Nothing is drawn, so
+    // the app has to be set up without initialize(); DestroyHeadlessWindow still calls shutdown().
+    //
+    static Window*      CreateHeadlessWindow(App& app, int width, int height);
+    static void         DestroyHeadlessWindow(Window* wnd);
+
+    // dispatch the pending input events and update the app, like a frame of the main loop; false once the app quit
+    static bool         StepHeadless(Window* wnd, float dt);
+
+    // input for a headless window as GLUT would report it: the keyboard and mouse state change now,
+    // the app's handlers see the event on the next step
+    static void         PostHeadlessEvent(Window* wnd, const InputEvent& e);
+
 private:
+    // one update of a window: the tick's input and seed (replayed or recorded, see GLSH_InputLog.h), its events, then the app
+    static bool         StepWindow(Window* wnd, float dt);
+
+    // device input reaching a window: record it, update the keyboard or mouse, and queue the event
+    static void         InjectKey(Window* wnd, KeyCode kc, bool down);
+    static void         InjectMouseButton(Window* wnd, MouseButton mb, bool down, int x, int y);
+    static void         InjectMousePos(Window* wnd, int x, int y);
+    static void         InjectWheel(Window* wnd, int dir);
+    static void         ReplayInput(Window* wnd, const InputRecord& r);
+
     static void         Initialize();
     static void         InitializeKeys();
     static void         InitializeMouseButtons();
@@ -471,6 +504,8 @@ private:
     static std::vector<KeyCode>     smSpecialKeys;
 
     static std::vector<MouseButton> smMouseButtons;
+
+    static std::vector<InputRecord> smReplayInput;      // the input of the tick being replayed
 };
 
 inline float System::GetTime()
@@ -502,12 +537,12 @@ inline int Window::getWindowId() const
 
 inline int Window::getWidth() const
 {
-    return glutGet(GLUT_WINDOW_WIDTH);
+    return mHeadless ? mHeadlessWidth : glutGet(GLUT_WINDOW_WIDTH);
 }
 
 inline int Window::getHeight() const
 {
-    return glutGet(GLUT_WINDOW_HEIGHT);
+    return mHeadless ? mHeadlessHeight : glutGet(GLUT_WINDOW_HEIGHT);
 }
 
 inline void Window::setTitle(const std::string& title) const
@@ -564,7 +599,12 @@ void CheckGLErrors(const char* label, const char* function, const char* file, lo
 void CheckGLShader(GLuint shaderId, const char* label, const char* function, const char* file, long line);
 void CheckGLProgram(GLuint progId, const char* label, const char* function, const char* file, long line);
 
+// glGetError stalls until the driver has caught up; release builds rely on the debug callback (GLSH_GLDebug.h)
+#if GLSH_GL_DEBUG
 #define GLSH_CHECK_GL_ERRORS(label)              ::glsh::CheckGLErrors(label, __FUNCTION__, __FILE__, __LINE__)
+#else
+#define GLSH_CHECK_GL_ERRORS(label)              ((void)0)
+#endif
 #define GLSH_CHECK_GL_SHADER(shader_id, label)   ::glsh::CheckGLShader(shader_id, label, __FUNCTION__, __FILE__, __LINE__)
 #define GLSH_CHECK_GL_PROGRAM(prog_id, label)    ::glsh::CheckGLProgram(prog_id, label, __FUNCTION__, __FILE__, __LINE__)
 
@@ -0,0 +1,245 @@
+#include "GLSH_Telemetry.h"
+#include "GLSH_TelemetryFormat.h"
+#include "GLSH_GLStats.h"
+#include "GLSH_Memory.h"
+#include "GLSH_Profiler.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+namespace glsh {
+
+namespace {
+
+TelemetryBlock*             gBlock = NULL;
+std::string                 gName;
+#ifdef _WIN32
+HANDLE                      gMapping = NULL;
+#endif
+
+// what the next frame publishes; names and counters are kept here between frames
+TelemetryData               gStaged;
+
+const char*                 gPhaseZones[TELEMETRY_MAX_PHASES];
+uint64_t                    gPhaseNs[TELEMETRY_MAX_PHASES];
+
+uint64_t                    gEventCursor = 0;
+std::vector<ProfileEvent>   gEvents;
+uint64_t                    gLastFrameNs = 0;
+
+void CopyName(char* dst, const char* src)
+{
+    std::strncpy(dst, src, TELEMETRY_NAME_LENGTH - 1);
+    dst[TELEMETRY_NAME_LENGTH - 1] = '\0';
+}
+
+TelemetryBlock* MapBlock(const char* name)
+{
+#ifdef _WIN32
+    // file mappings have no leading slash; "Local\" keeps the name to the session
+    std::string mappingName = std::string("Local\\") + (name[0] == '/' ? name + 1 : name);
+    gMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(TelemetryBlock), mappingName.c_str());
+    if (!gMapping) {
+        return NULL;
+    }
+    void* p = MapViewOfFile(gMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(TelemetryBlock));
+    if (!p) {
+        CloseHandle(gMapping);
+        gMapping = NULL;
+        return NULL;
+    }
+    return static_cast<TelemetryBlock*>(p);
+#else
+    // a block left over by a crashed run is reused
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(TelemetryBlock)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(TelemetryBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+    return static_cast<TelemetryBlock*>(p);
+#endif
+}
+
+void UnmapBlock()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(gBlock);
+    CloseHandle(gMapping);
+    gMapping = NULL;
+#else
+    munmap(gBlock, sizeof(TelemetryBlock));
+    shm_unlink(gName.c_str());
+#endif
+    gBlock = NULL;
+}
+
+void Publish()
+{
+    // readers retry while the sequence number is odd or has moved on
+    uint32_t seq = gBlock->sequence.load(std::memory_order_relaxed);
+    gBlock->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&gBlock->data, &gStaged, sizeof(TelemetryData));
+
+    gBlock->sequence.store(seq + 2, std::memory_order_release);
+}
+
+} // end of anonymous namespace
+
+bool StartTelemetry(const char* name)
+{
+    if (gBlock) {
+        StopTelemetry();
+    }
+
+    gBlock = MapBlock(name);
+    if (!gBlock) {
+        std::cerr << "*** Can't create the telemetry block " << name << std::endl;
+        return false;
+    }
+    gName = name;
+
+    // the header is written before the first frame is, so readers that find the magic see a whole block
+    gBlock->sequence.store(0, std::memory_order_relaxed);
+    std::memset(&gBlock->data, 0, sizeof(TelemetryData));
+    gBlock->version = TELEMETRY_VERSION;
+    gBlock->size = sizeof(TelemetryBlock);
+#ifdef _WIN32
+    gBlock->pid = (uint32_t)GetCurrentProcessId();
+#else
+    gBlock->pid = (uint32_t)getpid();
+#endif
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(gBlock->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+
+    gStaged.frame = 0;
+    gStaged.running = 1;
+
+    // skip the zones recorded so far, and have room for a frame's worth
+    gEvents.reserve(1024);
+    Profiler::GetThreadEvents(gEventCursor, gEvents);
+    gLastFrameNs = 0;
+
+    return true;
+}
+
+void StopTelemetry()
+{
+    if (!gBlock) {
+        return;
+    }
+
+    gStaged.running = 0;
+    Publish();
+    UnmapBlock();
+}
+
+bool IsTelemetryOpen()
+{
+    return gBlock != NULL;
+}
+
+void SetTelemetryPhases(const char* const* zones, int count)
+{
+    if (count > TELEMETRY_MAX_PHASES) {
+        std::cerr << "*** Only the first " << TELEMETRY_MAX_PHASES << " telemetry phases are published" << std::endl;
+        count = TELEMETRY_MAX_PHASES;
+    }
+
+    for (int i = 0; i < count; i++) {
+        gPhaseZones[i] = zones[i];
+        CopyName(gStaged.phaseNames[i], zones[i]);
+    }
+    gStaged.numPhases = count;
+}
+
+int AddTelemetryCounter(const char* name)
+{
+    if (gStaged.numCounters >= (uint32_t)TELEMETRY_MAX_COUNTERS) {
+        std::cerr << "*** No telemetry slot left for " << name << std::endl;
+        return -1;
+    }
+
+    int slot = gStaged.numCounters++;
+    CopyName(gStaged.counterNames[slot], name);
+    gStaged.counters[slot] = 0;
+    return slot;
+}
+
+void SetTelemetryCounter(int slot, int64_t value)
+{
+    if (slot >= 0 && slot < (int)gStaged.numCounters) {
+        gStaged.counters[slot] = value;
+    }
+}
+
+void EndTelemetryFrame()
+{
+    if (!gBlock) {
+        return;
+    }
+
+    uint64_t now = Profiler::Now();
+
+    gStaged.frame++;
+    gStaged.timeNs = now;
+    gStaged.frameMs = gLastFrameNs ? (now - gLastFrameNs) * 1e-6f : 0.0f;
+    gLastFrameNs = now;
+
+    const GLFrameStats& gl = GetLastFrameGLStats();
+    gStaged.drawCalls = gl.drawCalls;
+    gStaged.bufferUploads = gl.bufferUploads;
+    gStaged.bufferBytes = gl.bufferBytes;
+    gStaged.textureUploads = gl.textureUploads;
+    gStaged.programBinds = gl.programBinds;
+
+    const MemoryFrameStats& mem = GetLastFrameMemoryStats();
+    gStaged.heapAllocs = mem.totalAllocs();
+    gStaged.heapFrees = mem.frees;
+    gStaged.heapAllocBytes = mem.totalAllocBytes();
+    gStaged.heapBytes = mem.totalHeapBytes();
+    gStaged.peakHeapBytes = mem.peakHeapBytes;
+    gStaged.gpuBytes = mem.totalGPUBytes();
+
+    // zones completed since the last frame; an enclosing zone that is still open shows up next frame
+    std::memset(gPhaseNs, 0, sizeof(gPhaseNs));
+    Profiler::GetThreadEvents(gEventCursor, gEvents);
+    for (size_t i = 0; i < gEvents.size(); i++) {
+        const ProfileEvent& e = gEvents[i];
+        for (uint32_t p = 0; p < gStaged.numPhases; p++) {
+            if (e.name == gPhaseZones[p] || std::strcmp(e.name, gPhaseZones[p]) == 0) {
+                gPhaseNs[p] += e.endNs - e.beginNs;
+                break;
+            }
+        }
+    }
+    for (uint32_t p = 0; p < gStaged.numPhases; p++) {
+        gStaged.phaseMs[p] = gPhaseNs[p] * 1e-6f;
+    }
+
+    Publish();
+}
+
+} // end of namespace
@@ -0,0 +1,40 @@
+#ifndef GLSH_TELEMETRY_H_
+#define GLSH_TELEMETRY_H_
+
+#include <cstdint>
+
+//
+// Live telemetry in shared memory
+//
+//     StartTelemetry creates a named shared memory block (layout in GLSH_TelemetryFormat.h) that
+//     System::DisplayCallback fills in after every frame: frame time, the main thread's time in the
+//     profiler zones passed to SetTelemetryPhases, the GL call counts, heap and GPU memory, and the
+//     app's own counters. Outside tools map the block and sample it as often as they like
+//     (tools/TelemetryReader writes CSV); publishing is a copy of about 1.5 KB and never waits on them.
+//
+//     Phases and counters can be set up before or after the block is opened. Counter values are kept
+//     until they're set again, so only what changed needs to be set each frame.
+//
+namespace glsh {
+
+// name is like "/assteroids" (POSIX shm names start with a slash); returns false if the block can't be created
+bool StartTelemetry(const char* name);
+
+// clears the running flag, so readers stop, and removes the name
+void StopTelemetry();
+
+bool IsTelemetryOpen();
+
+// profiler zones to time each frame, at most TELEMETRY_MAX_PHASES; the names must outlive publishing
+void SetTelemetryPhases(const char* const* zones, int count);
+
+// returns the counter's slot, or -1 when all TELEMETRY_MAX_COUNTERS are taken
+int AddTelemetryCounter(const char* name);
+void SetTelemetryCounter(int slot, int64_t value);
+
+// publish the frame that was just presented
+void EndTelemetryFrame();
+
+} // end of namespace
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef GLSH_TELEMETRYFORMAT_H_
+#define GLSH_TELEMETRYFORMAT_H_
+
+//
+// Shared-memory telemetry layout, shared by the publisher (GLSH_Telemetry) and tools/TelemetryReader
+//
+//     The block is a TelemetryBlock at offset 0 of a POSIX shared memory object (shm_open) or, on
+//     Windows, a named file mapping ("Local\<name>" with the leading '/' dropped).
+//
+//     'data' is guarded by a sequence lock: the publisher makes 'sequence' odd, writes, and makes it
+//     even again. A reader copies 'data' between two loads of 'sequence' and keeps the copy only if
+//     both loads returned the same even value; otherwise it tries again. The publisher never waits
+//     for readers, and readers never see a frame half-written.
+//
+//     Everything is in the byte order of the machine; reader and game run on the same one.
+//
+#include <atomic>
+#include <cstdint>
+
+namespace glsh {
+
+const char          TELEMETRY_MAGIC[8]      = { 'G', 'L', 'S', 'H', 'T', 'E', 'L', '1' };
+const uint32_t      TELEMETRY_VERSION       = 1;
+
+const int           TELEMETRY_MAX_PHASES    = 16;
+const int           TELEMETRY_MAX_COUNTERS  = 16;
+const int           TELEMETRY_NAME_LENGTH   = 32;       // including the terminator
+
+struct TelemetryData {
+    uint64_t        frame;                  // frames published since the block was opened
+    uint64_t        timeNs;                 // Profiler::Now when the frame was published
+    uint32_t        running;                // cleared when the game closes the block
+    float           frameMs;                // since the previous frame
+
+    // GL calls of the frame
+    uint32_t        drawCalls;
+    uint32_t        bufferUploads;
+    uint64_t        bufferBytes;
+    uint32_t        textureUploads;
+    uint32_t        programBinds;
+
+    // heap (operator new) and GPU memory, see GLSH_Memory
+    uint32_t        heapAllocs;             // this frame
+    uint32_t        heapFrees;
+    uint64_t        heapAllocBytes;
+    uint64_t        heapBytes;              // live
+    uint64_t        peakHeapBytes;
+    uint64_t        gpuBytes;
+
+    // main-thread profiler zones, summed over the frame
+    uint32_t        numPhases;
+    char            phaseNames[TELEMETRY_MAX_PHASES][TELEMETRY_NAME_LENGTH];
+    float           phaseMs[TELEMETRY_MAX_PHASES];
+
+    // whatever the app publishes (entity counts, state, score, ...)
+    uint32_t        numCounters;
+    char            counterNames[TELEMETRY_MAX_COUNTERS][TELEMETRY_NAME_LENGTH];
+    int64_t         counters[TELEMETRY_MAX_COUNTERS];
+};
+
+struct TelemetryBlock {
+    char                    magic[8];
+    uint32_t                version;
+    uint32_t                size;           // sizeof(TelemetryBlock) of the publisher
+    std::atomic<uint32_t>   sequence;       // odd while 'data' is being written
+    uint32_t                pid;
+    TelemetryData           data;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "sequence counter must be a plain 32-bit word");
+
+} // end of namespace
+
+#endif
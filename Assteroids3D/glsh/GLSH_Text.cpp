@@ -1,9 +1,12 @@
 #include "GLSH_Text.h"
+#include "GLSH_GLDebug.h"
 #include "GLSH_Image.h"
+#include "GLSH_Memory.h"
 #include "GLSH_Mesh.h"
 
 #include "tinyxml2.h"
 
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
@@ -11,6 +14,7 @@ namespace glsh {
 
 Font::Font()
     : mTex(0)
+    , mOwnsTex(false)
     , mHeight(0)
     , mWidth(0)
 {
@@ -24,8 +28,12 @@ Font::~Font()
 void Font::Unload()
 {
     if (IsLoaded()) {
-        glDeleteTextures(1, &mTex);
+        if (mOwnsTex) {
+            UntrackGPUMemory(GPU_TEXTURE, mTex);
+            glDeleteTextures(1, &mTex);
+        }
         mTex = 0;
+        mOwnsTex = false;
         mChars = std::vector<TexRect>();
         mHeight = 0;
         mWidth = 0;
@@ -115,11 +123,37 @@ bool Font::Load(const std::string& name)
         std::cerr << "*** Failed to create font texture" << std::endl;
         return false;
     }
+    LabelGLObject(GL_TEXTURE, mTex, textureFilename);
+    mOwnsTex = true;
 
     // yay
     return true;
 }
 
+bool Font::MoveToAtlas(const TextureAtlas& atlas, const std::string& entryName)
+{
+    const TextureAtlas::Entry* e = atlas.findEntry(entryName);
+    if (!e || !atlas.getTex() || !IsLoaded()) {
+        std::cerr << "*** Can't move font to atlas entry " << entryName << std::endl;
+        return false;
+    }
+
+    for (unsigned i = 0; i < mChars.size(); i++) {
+        if (mChars[i].w != 0.0f && mChars[i].h != 0.0f) {
+            mChars[i] = atlas.RemapTexRect(*e, mChars[i]);
+        }
+    }
+
+    if (mOwnsTex) {
+        UntrackGPUMemory(GPU_TEXTURE, mTex);
+        glDeleteTextures(1, &mTex);
+    }
+    mTex = atlas.getTex();
+    mOwnsTex = false;
+
+    return true;
+}
+
 Font* CreateFont(const std::string& name)
 {
     Font* font = new Font;
@@ -132,20 +166,134 @@ TextBatch::TextBatch()
     : mFont(NULL)
     , mWidth(0)
     , mHeight(0)
+    , mVAO(0)
+    , mVBO(0)
+    , mGPUCapacity(0)
+    , mDirty(false)
 {
 }
 
+TextBatch::~TextBatch()
+{
+    if (mVAO) {
+        glDeleteVertexArrays(1, &mVAO);
+    }
+    if (mVBO) {
+        UntrackGPUMemory(GPU_VERTEX_BUFFER, mVBO);
+        glDeleteBuffers(1, &mVBO);
+    }
+}
+
 void TextBatch::Clear()
 {
     mFont = NULL;
     mWidth = 0;
     mHeight = 0;
+    mGlyphs.clear();
+    mDirty = true;
+}
+
+void TextBatch::beginText()
+{
+    // the previous layout is kept for endText; swapping and clearing keep both capacities,
+    // so steady-state updates don't allocate
+    mPrevGlyphs.swap(mGlyphs);
+    mGlyphs.clear();
+
+    mFont = NULL;
+    mWidth = 0;
+    mHeight = 0;
+}
+
+void TextBatch::endText()
+{
+    if (mGlyphs != mPrevGlyphs) {
+        mDirty = true;
+    }
+}
+
+void TextBatch::upload() const
+{
+    GLSH_MEMORY_SCOPE(MEMORY_TAG_TEXT);
+
+    mDirty = false;
+
+    if (!mVAO) {
+        glGenVertexArrays(1, &mVAO);
+        glGenBuffers(1, &mVBO);
+
+        BindVertexArray(mVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+        LabelGLObject(GL_BUFFER, mVBO, "text vertices");
+
+        glEnableVertexAttribArray(VA_POSITION);
+        glVertexAttribPointer(VA_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), GLSH_BUFFER_OFFSET(offsetof(GlyphVertex, pos)));
+        glEnableVertexAttribArray(VA_COLOR);
+        glVertexAttribPointer(VA_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphVertex), GLSH_BUFFER_OFFSET(offsetof(GlyphVertex, color)));
+        glEnableVertexAttribArray(VA_TEXCOORD);
+        glVertexAttribPointer(VA_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), GLSH_BUFFER_OFFSET(offsetof(GlyphVertex, texcoord)));
+
+        BindVertexArray(0);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    }
+
+    // two triangles per glyph, wound like UIBatch's quads
     mVerts.clear();
+    for (const GlyphInstance& g : mGlyphs) {
+        float x1 = g.rect.x;
+        float x2 = g.rect.x + g.rect.z;
+        float y1 = g.rect.y;
+        float y2 = g.rect.y - g.rect.w;
+
+        GlyphVertex tl = { glm::vec2(x1, y1), glm::vec2(g.texRect.x, g.texRect.y), { 255, 255, 255, 255 } };
+        GlyphVertex bl = { glm::vec2(x1, y2), glm::vec2(g.texRect.x, g.texRect.w), { 255, 255, 255, 255 } };
+        GlyphVertex tr = { glm::vec2(x2, y1), glm::vec2(g.texRect.z, g.texRect.y), { 255, 255, 255, 255 } };
+        GlyphVertex br = { glm::vec2(x2, y2), glm::vec2(g.texRect.z, g.texRect.w), { 255, 255, 255, 255 } };
+
+        mVerts.push_back(tl);
+        mVerts.push_back(bl);
+        mVerts.push_back(br);
+
+        mVerts.push_back(br);
+        mVerts.push_back(tr);
+        mVerts.push_back(tl);
+    }
+
+    GLsizeiptr size = mVerts.size() * sizeof(GlyphVertex);
+    if (mVerts.size() > mGPUCapacity) {
+        mGPUCapacity = mVerts.size();
+        glBufferData(GL_ARRAY_BUFFER, size, &mVerts[0], GL_DYNAMIC_DRAW);
+        TrackGPUMemory(GPU_VERTEX_BUFFER, mVBO, size);
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, &mVerts[0]);
+    }
+    CountBufferUpload(size);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GLuint TextBatch::GetVertexArray() const
+{
+    if (mGlyphs.empty()) {
+        return 0;
+    }
+    if (mDirty) {
+        upload();
+    }
+    return mVAO;
 }
 
 void TextBatch::SetText(const Font* font, const std::string& text, bool fixedWidth)
 {
-    Clear();
+    SetText(font, text.c_str(), fixedWidth);
+}
+
+void TextBatch::SetText(const Font* font, const char* text, bool fixedWidth)
+{
+    GLSH_MEMORY_SCOPE(MEMORY_TAG_TEXT);
+
+    beginText();
 
     if (font && font->IsLoaded()) {
         mFont = font;
@@ -163,7 +311,8 @@ void TextBatch::SetText(const Font* font, const std::string& text, bool fixedWid
         //float lineSpacing = 0.1f * fontHeight;
         float dy = fontHeight + lineSpacing;
 
-        for (char c : text) {
+        for (const char* p = text; *p; p++) {
+            char c = *p;
 
             if (c == '\n') {
 
@@ -181,18 +330,7 @@ void TextBatch::SetText(const Font* font, const std::string& text, bool fixedWid
                     xOffset = 0;
                 }
 
-                float x1 = x + xOffset;
-                float x2 = x1 + cRect.w;
-                float y1 = y;
-                float y2 = y1 - cRect.h;
-
-                mVerts.push_back(VPT(x1, y1, 0,  cRect.uLeft, cRect.vTop));        // top-left
-                mVerts.push_back(VPT(x1, y2, 0,  cRect.uLeft, cRect.vBottom));     // bottom-left
-                mVerts.push_back(VPT(x2, y2, 0,  cRect.uRight, cRect.vBottom));    // bottom-right
-
-                mVerts.push_back(VPT(x2, y2, 0,  cRect.uRight, cRect.vBottom));    // bottom-right
-                mVerts.push_back(VPT(x2, y1, 0,  cRect.uRight, cRect.vTop));       // top-right
-                mVerts.push_back(VPT(x1, y1, 0,  cRect.uLeft, cRect.vTop));        // top-left
+                mGlyphs.push_back(GlyphInstance(x + xOffset, y, cRect));
 
                 if (fixedWidth) {
                     x += fontWidth;
@@ -209,11 +347,15 @@ void TextBatch::SetText(const Font* font, const std::string& text, bool fixedWid
             mHeight = -(y - fontHeight);
         }
     }
+
+    endText();
 }
 
 void TextBatch::SetText(const Font* font, const std::vector<std::string>& textLines)
 {
-    Clear();
+    GLSH_MEMORY_SCOPE(MEMORY_TAG_TEXT);
+
+    beginText();
 
     if (font && font->IsLoaded()) {
         mFont = font;
@@ -247,13 +389,7 @@ void TextBatch::SetText(const Font* font, const std::vector<std::string>& textLi
                 } else if (font->hasChar(c)) {
                     const TexRect& cRect = font->getCharRect(c);
 
-                    mVerts.push_back(VPT(x, y, 0,                       cRect.uLeft, cRect.vTop));        // top-left
-                    mVerts.push_back(VPT(x, y - cRect.h, 0,             cRect.uLeft, cRect.vBottom));     // bottom-left
-                    mVerts.push_back(VPT(x + cRect.w, y - cRect.h, 0,   cRect.uRight, cRect.vBottom));    // bottom-right
-
-                    mVerts.push_back(VPT(x + cRect.w, y - cRect.h, 0,   cRect.uRight, cRect.vBottom));    // bottom-right
-                    mVerts.push_back(VPT(x + cRect.w, y, 0,             cRect.uRight, cRect.vTop));       // top-right
-                    mVerts.push_back(VPT(x, y, 0,                       cRect.uLeft, cRect.vTop));        // top-left
+                    mGlyphs.push_back(GlyphInstance(x, y, cRect));
 
                     x += cRect.w;
 
@@ -267,13 +403,8 @@ void TextBatch::SetText(const Font* font, const std::vector<std::string>& textLi
             }
         }
     }
-}
-
-void TextBatch::DrawGeometry() const
-{
-    ::glsh::DrawGeometry(GL_TRIANGLES, mVerts);
 
-    // FUTURE: could implement a retained mode
+    endText();
 }
 
 
@@ -3,6 +3,7 @@
 #ifndef GLSH_TEXT_H_
 #define GLSH_TEXT_H_
 
+#include "GLSH_Atlas.h"
 #include "GLSH_Texture.h"
 #include "GLSH_Vertex.h"
 
@@ -15,6 +16,7 @@ namespace glsh {
 class Font {
 
     GLuint                  mTex;
+    bool                    mOwnsTex;   // false once the glyphs live in a shared atlas
 
     std::vector<TexRect>    mChars;     // indexed using ASCII codes
 
@@ -30,6 +32,9 @@ public:
 
     bool                    IsLoaded() const;
 
+    // switch to the atlas copy of the font texture; the font's own texture is released
+    bool                    MoveToAtlas(const TextureAtlas& atlas, const std::string& entryName);
+
     GLuint                  getTex() const              { return mTex; }
 
     float                   getHeight() const           { return mHeight; }
@@ -49,26 +54,87 @@ public:
 Font* CreateFont(const std::string& name);
 
 
+//
+// One glyph quad, relative to the top-left corner of its text
+//
+struct GlyphInstance {
+    glm::vec4               rect;       // x, y of the top-left corner, width, height
+    glm::vec4               texRect;    // uLeft, vTop, uRight, vBottom
+
+    GlyphInstance()
+    { }
+
+    GlyphInstance(float x, float y, const TexRect& r)
+        : rect(x, y, r.w, r.h)
+        , texRect(r.uLeft, r.vTop, r.uRight, r.vBottom)
+    { }
+
+    bool operator==(const GlyphInstance& other) const   { return rect == other.rect && texRect == other.texRect; }
+    bool operator!=(const GlyphInstance& other) const   { return !(*this == other); }
+};
+
+
+//
+// A corner of a glyph quad in a TextBatch's vertex buffer. The color is white; UIBatch tints it.
+//
+struct GlyphVertex {
+    glm::vec2               pos;        // relative to the top-left corner of the text
+    glm::vec2               texcoord;
+    GLubyte                 color[4];
+};
+
+
+//
+// Retained text: the glyph quads of a string, laid out when the text is set. They're uploaded to a
+// vertex buffer of the batch's own the first time they're drawn after a change, so drawing text
+// that didn't change uploads nothing. Draw it with UIBatch::AddText.
+//
 class TextBatch {
 
-    const Font*             mFont;
-    std::vector<VPT>        mVerts;
-    float                   mWidth, mHeight;
+    const Font*                 mFont;
+    std::vector<GlyphInstance>  mGlyphs;
+    std::vector<GlyphInstance>  mPrevGlyphs;        // the last layout, to tell whether SetText changed anything
+    float                       mWidth, mHeight;
+
+    // filled in when drawn
+    mutable std::vector<GlyphVertex>    mVerts;
+    mutable GLuint              mVAO;
+    mutable GLuint              mVBO;
+    mutable size_t              mGPUCapacity;       // vertices the buffer has room for
+    mutable bool                mDirty;             // the glyphs changed since the last upload
+
+    void                        beginText();
+    void                        endText();
+    void                        upload() const;
+
+    // owns GL objects
+                                TextBatch(const TextBatch&) = delete;
+    TextBatch&                  operator=(const TextBatch&) = delete;
 
 public:
 
-                            TextBatch();
+                                TextBatch();
+                                ~TextBatch();
+
+    void                        SetText(const Font* font, const std::string& text, bool fixedWidth = false);
+    void                        SetText(const Font* font, const char* text, bool fixedWidth = false);     // doesn't allocate once warmed up
+    void                        SetText(const Font* font, const std::vector<std::string>& textLines);
+
+    void                        Clear();
 
-    void                    SetText(const Font* font, const std::string& text, bool fixedWidth = false);
-    void                    SetText(const Font* font, const std::vector<std::string>& textLines);
+    const Font*                 GetFont() const         { return mFont; }
+    float                       GetWidth() const        { return mWidth; }
+    float                       GetHeight() const       { return mHeight; }
 
-    void                    Clear();
+    int                         GetGlyphCount() const   { return (int)mGlyphs.size(); }
+    const GlyphInstance&        GetGlyph(int i) const   { return mGlyphs[i]; }
 
-    const Font*             GetFont() const         { return mFont; }
-    float                   GetWidth() const        { return mWidth; }
-    float                   GetHeight() const       { return mHeight; }
+    // the vertex array of the glyph quads (six GlyphVertex per glyph, drawn as GL_TRIANGLES),
+    // uploading them first if the text changed; 0 if there's nothing to draw
+    GLuint                      GetVertexArray() const;
 
-    void                    DrawGeometry() const;
+    // what the next GetVertexArray will upload
+    size_t                      GetPendingUploadBytes() const   { return mDirty ? mGlyphs.size() * 6 * sizeof(GlyphVertex) : 0; }
 };
 
 } // end of namespace
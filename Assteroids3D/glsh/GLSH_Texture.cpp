@@ -1,8 +1,15 @@
 #include "GLSH_Texture.h"
+#include "GLSH_GLDebug.h"
+#include "GLSH_GLStats.h"
+#include "GLSH_Memory.h"
 #include "GLSH_Image.h"
 #include "GLSH_Util.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <vector>
 
 namespace glsh {
 
@@ -10,7 +17,9 @@ GLuint CreateTexture2D(const std::string& path, bool genMipmaps)
 {
 	Image img;
 	if (img.LoadTarga(path)) {
-		return CreateTexture2D(img, genMipmaps);
+		GLuint tex = CreateTexture2D(img, genMipmaps);
+		LabelGLObject(GL_TEXTURE, tex, path);
+		return tex;
 	}
 	else {
 		std::cerr << "*** Failed to load texture from " << path << std::endl;
@@ -22,22 +31,34 @@ GLuint CreateTexture2D(const std::string& path, bool genMipmaps, int* width_ret,
 {
     Image img;
     if (img.LoadTarga(path)) {
-        return CreateTexture2D(img, genMipmaps);
+        if (width_ret) {
+            *width_ret = img.getWidth();
+        }
+        if (height_ret) {
+            *height_ret = img.getHeight();
+        }
+        GLuint tex = CreateTexture2D(img, genMipmaps);
+        LabelGLObject(GL_TEXTURE, tex, path);
+        return tex;
     } else {
         std::cerr << "*** Failed to load texture from " << path << std::endl;
         return 0;
     }
 }
 
-GLuint CreateTexture2D(const Image& img, bool genMipmaps)
+// elapsed milliseconds since a steady_clock time point
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+GLuint CreateTexture2D(const Image& img, bool genMipmaps, TextureUploadStats* stats_ret)
 {
     if (!img.isGood()) {
         std::cout << "*** Can't create texture from image: it ain't no good" << std::endl;
         return 0;
     }
 
-    int bpp = img.getBytesPerPixel();
-
     // GL texture format lookup table indexed by image color depth in bytes-per-pixel
     static const GLenum bpp2fmt[] = { GL_NONE, GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA };
 
@@ -70,8 +91,20 @@ GLuint CreateTexture2D(const Image& img, bool genMipmaps)
     }
 
     // upload texture data
+    auto uploadStart = std::chrono::steady_clock::now();
+
     glTexImage2D(GL_TEXTURE_2D, 0, texFormat, width, height,
                                 0, imgFormat, GL_UNSIGNED_BYTE, data);
+    CountTextureUpload((size_t)rowlen * height);
+
+    if (stats_ret) {
+        stats_ret->width = width;
+        stats_ret->height = height;
+        stats_ret->uncompressedBytes = (size_t)rowlen * height;
+        stats_ret->uploadedBytes = stats_ret->uncompressedBytes;
+        stats_ret->uploadMs = ElapsedMs(uploadStart);
+        stats_ret->uncompressedUploadMs = stats_ret->uploadMs;
+    }
 
     // generate mipmaps if needed
 
@@ -97,9 +130,250 @@ GLuint CreateTexture2D(const Image& img, bool genMipmaps)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
     }
 
+    // the mip chain adds about a third
+    size_t residentBytes = (size_t)rowlen * height;
+    TrackGPUMemory(GPU_TEXTURE, texId, haveMipmaps ? residentBytes + residentBytes / 3 : residentBytes);
+
     // FIXME: check for errors
 
     return texId;
 }
 
+GLuint CreateTexture2D(const CompressedImage& cimg, TextureUploadStats* stats_ret)
+{
+    if (!cimg.isGood()) {
+        std::cout << "*** Can't create texture from compressed image: it ain't no good" << std::endl;
+        return 0;
+    }
+
+    // no S3TC support in the driver: decode in software and upload the top level uncompressed
+    if (!GLEW_EXT_texture_compression_s3tc) {
+        std::cerr << "*** S3TC not supported, uploading decompressed texture" << std::endl;
+        Image img;
+        if (!cimg.Decompress(&img, 0)) {
+            return 0;
+        }
+        return CreateTexture2D(img, cimg.numLevels() > 1, stats_ret);
+    }
+
+    GLenum internalFormat = (cimg.getFormat() == COMPRESSED_BC1) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                                 : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+    // create texture object
+    GLuint texId = 0;
+    glGenTextures(1, &texId);
+
+    // bind it as a 2D texture
+    glBindTexture(GL_TEXTURE_2D, texId);
+
+    // upload all levels as-is
+    auto uploadStart = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < cimg.numLevels(); i++) {
+        const CompressedImage::Level& level = cimg.getLevel(i);
+        glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height,
+                               0, (GLsizei)level.blocks.size(), &level.blocks[0]);
+        CountTextureUpload(level.blocks.size());
+    }
+
+    double uploadMs = ElapsedMs(uploadStart);
+
+    // tell OpenGL how many levels this texture has (texture completeness)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, cimg.numLevels() - 1);
+
+    TrackGPUMemory(GPU_TEXTURE, texId, cimg.getSizeInBytes());
+
+    if (stats_ret) {
+        stats_ret->width = cimg.getWidth();
+        stats_ret->height = cimg.getHeight();
+        stats_ret->uploadedBytes = cimg.getSizeInBytes();
+        stats_ret->uploadMs = uploadMs;
+    }
+
+    return texId;
+}
+
+GLuint CreateCompressedTexture2D(const std::string& path, bool genMipmaps, int* width_ret, int* height_ret,
+                                 TextureUploadStats* stats_ret)
+{
+    Image img;
+    if (!img.LoadTarga(path)) {
+        std::cerr << "*** Failed to load texture from " << path << std::endl;
+        return 0;
+    }
+
+    if (width_ret) {
+        *width_ret = img.getWidth();
+    }
+    if (height_ret) {
+        *height_ret = img.getHeight();
+    }
+
+    // the compressed levels are uploaded directly, so the mip chain has to be built on the CPU
+    if (genMipmaps && !img.GenerateMipmaps(1)) {
+        std::cerr << "*** Oops, not generating mipmaps for " << path << std::endl;
+    }
+
+    bool hasAlpha = img.getBytesPerPixel() == 2 || img.getBytesPerPixel() == 4;
+
+    CompressedImage cimg;
+    if (!img.Compress(&cimg, hasAlpha ? COMPRESSED_BC3 : COMPRESSED_BC1)) {
+        std::cerr << "*** Failed to compress " << path << ", uploading uncompressed" << std::endl;
+        GLuint tex = CreateTexture2D(img, genMipmaps, stats_ret);
+        LabelGLObject(GL_TEXTURE, tex, path);
+        return tex;
+    }
+
+    TextureUploadStats stats;
+    GLuint tex = CreateTexture2D(cimg, &stats);
+    stats.uncompressedBytes = GetImageSizeInBytes(img);
+
+#if GLSH_TEXTURE_UPLOAD_BENCH
+    // reference upload of the uncompressed data to measure the upload time saved
+    {
+        TextureUploadStats refStats;
+        GLuint refTex = CreateTexture2D(img, false, &refStats);
+        stats.uncompressedUploadMs = refStats.uploadMs;
+        UntrackGPUMemory(GPU_TEXTURE, refTex);
+        glDeleteTextures(1, &refTex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+    }
+#endif
+
+    if (tex) {
+        LabelGLObject(GL_TEXTURE, tex, path);
+        ReportTextureUpload(path, stats);
+    }
+
+    if (stats_ret) {
+        *stats_ret = stats;
+    }
+
+    return tex;
+}
+
+GLuint CreateTexture2DArray(const Image& sheet, int numLayers, bool compress, TextureUploadStats* stats_ret)
+{
+    if (!sheet.isGood() || numLayers <= 0) {
+        std::cout << "*** Can't create texture array from image: it ain't no good" << std::endl;
+        return 0;
+    }
+
+    int bpp = sheet.getBytesPerPixel();
+    int width = sheet.getWidth() / numLayers;      // assumes frames are of equal width with no padding
+    int height = sheet.getHeight();
+
+    // gather the frames into consecutive layers
+    std::vector<Image> layers(numLayers);
+    for (int i = 0; i < numLayers; i++) {
+        layers[i].Allocate(width, height, bpp);
+        for (int y = 0; y < height; y++) {
+            const unsigned char* src = sheet.getData() + (y * sheet.getWidth() + i * width) * bpp;
+            std::copy(src, src + width * bpp, layers[i].getData() + y * width * bpp);
+        }
+    }
+
+    // block-compress each layer and upload them together
+    std::vector<unsigned char> blocks;
+    GLenum compressedFormat = GL_NONE;
+    if (compress && GLEW_EXT_texture_compression_s3tc) {
+        bool hasAlpha = bpp == 2 || bpp == 4;
+        for (int i = 0; i < numLayers; i++) {
+            CompressedImage cimg;
+            if (!layers[i].Compress(&cimg, hasAlpha ? COMPRESSED_BC3 : COMPRESSED_BC1)) {
+                std::cerr << "*** Failed to compress texture array layer, uploading uncompressed" << std::endl;
+                blocks.clear();
+                break;
+            }
+            const std::vector<unsigned char>& levelBlocks = cimg.getLevel(0).blocks;
+            blocks.insert(blocks.end(), levelBlocks.begin(), levelBlocks.end());
+        }
+        if (!blocks.empty()) {
+            compressedFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        }
+    }
+
+    GLuint texId = 0;
+    glGenTextures(1, &texId);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texId);
+
+    auto uploadStart = std::chrono::steady_clock::now();
+
+    size_t uncompressedBytes = (size_t)width * height * bpp * numLayers;
+    size_t uploadedBytes;
+
+    if (compressedFormat != GL_NONE) {
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, 0, compressedFormat, width, height, numLayers,
+                               0, (GLsizei)blocks.size(), &blocks[0]);
+        uploadedBytes = blocks.size();
+    } else {
+        static const GLenum bpp2fmt[] = { GL_NONE, GL_RED, GL_RG, GL_RGB, GL_RGBA };
+        GLenum imgFormat = bpp2fmt[bpp];
+
+        std::vector<unsigned char> texels(uncompressedBytes);
+        for (int i = 0; i < numLayers; i++) {
+            std::copy(layers[i].getData(), layers[i].getData() + width * height * bpp, &texels[i * width * height * bpp]);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, imgFormat, width, height, numLayers,
+                     0, imgFormat, GL_UNSIGNED_BYTE, &texels[0]);
+        uploadedBytes = uncompressedBytes;
+    }
+
+    double uploadMs = ElapsedMs(uploadStart);
+    CountTextureUpload(uploadedBytes);
+    TrackGPUMemory(GPU_TEXTURE, texId, uploadedBytes);
+
+    // one level per layer, and no bleeding between frames at the edges
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (stats_ret) {
+        stats_ret->width = width;
+        stats_ret->height = height;
+        stats_ret->uncompressedBytes = uncompressedBytes;
+        stats_ret->uploadedBytes = uploadedBytes;
+        stats_ret->uploadMs = uploadMs;
+    }
+
+    return texId;
+}
+
+static TextureUploadTotals gUploadTotals;
+
+void ReportTextureUpload(const std::string& name, const TextureUploadStats& stats)
+{
+    ++gUploadTotals.textures;
+    gUploadTotals.uncompressedBytes += stats.uncompressedBytes;
+    gUploadTotals.uploadedBytes += stats.uploadedBytes;
+    gUploadTotals.uploadMs += stats.uploadMs;
+    gUploadTotals.uncompressedUploadMs += stats.uncompressedUploadMs;
+
+    double uncompressedKB = stats.uncompressedBytes / 1024.0;
+    double uploadedKB = stats.uploadedBytes / 1024.0;
+    double saved = stats.uncompressedBytes ? 100.0 * (1.0 - (double)stats.uploadedBytes / stats.uncompressedBytes) : 0.0;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Texture " << name << " (" << stats.width << "x" << stats.height << "): "
+              << uncompressedKB << " KB -> " << uploadedKB << " KB (" << saved << "% saved), "
+              << std::setprecision(3) << "upload " << stats.uploadMs << " ms";
+    if (stats.uncompressedUploadMs > 0) {
+        std::cout << " vs " << stats.uncompressedUploadMs << " ms uncompressed";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+const TextureUploadTotals& GetTextureUploadTotals()
+{
+    return gUploadTotals;
+}
+
 } // end of namespace
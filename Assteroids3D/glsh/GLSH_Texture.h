@@ -2,13 +2,38 @@
 #define GLSH_TEXTURE_H_
 
 #include <GL/glew.h>
+#include "GLSH_GLTrace.h"
 #include <glm/glm.hpp>
 
 #include <string>
 
+// Build with GLSH_TEXTURE_UPLOAD_BENCH defined to 1 to also upload every compressed texture
+// uncompressed once, timing it against the compressed upload. It doubles the load-time uploads
+// and briefly needs the uncompressed texture's memory, so it's off by default and only the
+// byte savings are reported.
+#ifndef GLSH_TEXTURE_UPLOAD_BENCH
+#define GLSH_TEXTURE_UPLOAD_BENCH 0
+#endif
+
 namespace glsh {
 
 class Image;
+class CompressedImage;
+
+//
+// Per-texture upload statistics
+//
+struct TextureUploadStats {
+    int         width, height;
+    size_t      uncompressedBytes;      // size of all texel data if uploaded uncompressed
+    size_t      uploadedBytes;          // size of the data actually sent to GL
+    double      uploadMs;               // CPU time spent in the glTexImage2D/glCompressedTexImage2D calls
+    double      uncompressedUploadMs;   // reference upload of the uncompressed data (0 without GLSH_TEXTURE_UPLOAD_BENCH)
+
+    TextureUploadStats()
+        : width(0), height(0), uncompressedBytes(0), uploadedBytes(0), uploadMs(0), uncompressedUploadMs(0)
+    { }
+};
 
 GLuint CreateTexture2D(const std::string& path, bool genMipmaps);
 
@@ -16,7 +41,36 @@ GLuint CreateTexture2D(const std::string& path, bool genMipmaps);
 GLuint CreateTexture2D(const std::string& path, bool genMipmaps, int* width_ret, int* height_ret);
 
 // create texture from Image data in memory
-GLuint CreateTexture2D(const Image& img, bool genMipmaps);
+GLuint CreateTexture2D(const Image& img, bool genMipmaps, TextureUploadStats* stats_ret = NULL);
+
+// create texture from block-compressed data (decompresses in software if the driver lacks S3TC)
+GLuint CreateTexture2D(const CompressedImage& cimg, TextureUploadStats* stats_ret = NULL);
+
+// load texture from file and block-compress it on the CPU (BC3 if the image has alpha, BC1 otherwise)
+GLuint CreateCompressedTexture2D(const std::string& path, bool genMipmaps, int* width_ret = NULL, int* height_ret = NULL,
+                                 TextureUploadStats* stats_ret = NULL);
+
+// create a 2D array texture from a sheet of numLayers equal-width frames laid out left to right;
+// with compress set the layers are block-compressed on the CPU when the driver supports S3TC
+GLuint CreateTexture2DArray(const Image& sheet, int numLayers, bool compress = false, TextureUploadStats* stats_ret = NULL);
+
+// print memory and upload time savings for one texture, and add them to the totals
+void ReportTextureUpload(const std::string& name, const TextureUploadStats& stats);
+
+// sums over every texture reported so far
+struct TextureUploadTotals {
+    unsigned    textures;
+    size_t      uncompressedBytes;
+    size_t      uploadedBytes;
+    double      uploadMs;
+    double      uncompressedUploadMs;
+
+    TextureUploadTotals()
+        : textures(0), uncompressedBytes(0), uploadedBytes(0), uploadMs(0), uncompressedUploadMs(0)
+    { }
+};
+
+const TextureUploadTotals& GetTextureUploadTotals();
 
 
 struct TexRect {
@@ -0,0 +1,206 @@
+#include "GLSH_UIBatch.h"
+#include "GLSH_Memory.h"
+#include "GLSH_Mesh.h"
+#include "GLSH_Shaders.h"
+
+#include <cstddef>
+
+namespace glsh {
+
+UIBatch::UIBatch()
+    : mVAO(0)
+    , mWhiteTex(0)
+    , mSolidTex(0)
+    , mSolidUV(0.5f, 0.5f)
+    , mLastDrawCount(0)
+    , mLastUploadBytes(0)
+{
+}
+
+UIBatch::~UIBatch()
+{
+    if (mVAO) {
+        glDeleteVertexArrays(1, &mVAO);
+    }
+    if (mWhiteTex) {
+        UntrackGPUMemory(GPU_TEXTURE, mWhiteTex);
+        glDeleteTextures(1, &mWhiteTex);
+    }
+}
+
+void UIBatch::SetWhiteTexel(GLuint tex, const glm::vec2& uv)
+{
+    mSolidTex = tex;
+    mSolidUV = uv;
+}
+
+void UIBatch::setTexture(GLuint tex)
+{
+    // start a new draw only when the texture changes or text came in between, so submission order is kept
+    if (mCmds.empty() || mCmds.back().tex != tex || mCmds.back().text) {
+        DrawCmd cmd;
+        cmd.tex = tex;
+        cmd.first = (GLint)mVerts.size();
+        cmd.count = 0;
+        cmd.text = NULL;
+        mCmds.push_back(cmd);
+    }
+}
+
+void UIBatch::addQuad(float x, float y, float w, float h,
+                      float uLeft, float vTop, float uRight, float vBottom, const glm::vec4& color)
+{
+    UIVertex tl = { glm::vec2(x, y),         glm::vec2(uLeft, vTop),      color };
+    UIVertex bl = { glm::vec2(x, y - h),     glm::vec2(uLeft, vBottom),   color };
+    UIVertex tr = { glm::vec2(x + w, y),     glm::vec2(uRight, vTop),     color };
+    UIVertex br = { glm::vec2(x + w, y - h), glm::vec2(uRight, vBottom),  color };
+
+    mVerts.push_back(tl);
+    mVerts.push_back(bl);
+    mVerts.push_back(br);
+
+    mVerts.push_back(br);
+    mVerts.push_back(tr);
+    mVerts.push_back(tl);
+
+    mCmds.back().count += 6;
+}
+
+void UIBatch::AddRect(const glm::vec2& topLeft, float w, float h, const glm::vec4& color)
+{
+    if (!mSolidTex) {
+        if (!mWhiteTex) {
+            unsigned char white[] = { 255, 255, 255, 255 };
+            glGenTextures(1, &mWhiteTex);
+            glBindTexture(GL_TEXTURE_2D, mWhiteTex);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+            TrackGPUMemory(GPU_TEXTURE, mWhiteTex, sizeof(white));
+        }
+        mSolidTex = mWhiteTex;
+    }
+
+    setTexture(mSolidTex);
+    addQuad(topLeft.x, topLeft.y, w, h, mSolidUV.x, mSolidUV.y, mSolidUV.x, mSolidUV.y, color);
+}
+
+void UIBatch::AddOutline(const glm::vec2& topLeft, float w, float h, float thickness, const glm::vec4& color)
+{
+    float x = topLeft.x;
+    float y = topLeft.y;
+    float t = thickness;
+
+    AddRect(glm::vec2(x, y), w, t, color);                     // top
+    AddRect(glm::vec2(x, y - h + t), w, t, color);             // bottom
+    AddRect(glm::vec2(x, y - t), t, h - 2 * t, color);         // left
+    AddRect(glm::vec2(x + w - t, y - t), t, h - 2 * t, color); // right
+}
+
+void UIBatch::AddTexturedRect(GLuint tex, const glm::vec2& topLeft, const TexRect& r, const glm::vec4& color)
+{
+    setTexture(tex);
+    addQuad(topLeft.x, topLeft.y, r.w, r.h, r.uLeft, r.vTop, r.uRight, r.vBottom, color);
+}
+
+void UIBatch::AddText(const TextBatch& text, const glm::vec2& topLeft, const glm::vec4& color)
+{
+    if (!text.GetFont() || !text.GetGlyphCount()) {
+        return;
+    }
+
+    DrawCmd cmd;
+    cmd.tex = text.GetFont()->getTex();
+    cmd.first = 0;
+    cmd.count = text.GetGlyphCount() * 6;
+    cmd.text = &text;
+    cmd.offset = topLeft;
+    cmd.color = color;
+    mCmds.push_back(cmd);
+}
+
+void UIBatch::Flush(DynamicBuffer& stream)
+{
+    mLastDrawCount = 0;
+    mLastUploadBytes = 0;
+
+    if (mCmds.empty()) {
+        return;
+    }
+
+    GLint base = 0;
+    if (!mVerts.empty()) {
+        // vertex-aligned, so draws can address it with the first vertex index
+        GLintptr offset = stream.Write(&mVerts[0], mVerts.size() * sizeof(UIVertex), sizeof(UIVertex));
+        if (offset < 0) {
+            mVerts.clear();
+            mCmds.clear();
+            return;
+        }
+        base = (GLint)(offset / sizeof(UIVertex));
+        mLastUploadBytes += mVerts.size() * sizeof(UIVertex);
+
+        if (!mVAO) {
+            glGenVertexArrays(1, &mVAO);
+        }
+        BindVertexArray(mVAO);
+
+        // the stream buffer can be recreated when it grows, so the pointers are set on every flush
+        glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+        glEnableVertexAttribArray(VA_POSITION);
+        glVertexAttribPointer(VA_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(UIVertex), GLSH_BUFFER_OFFSET(offsetof(UIVertex, pos)));
+        glEnableVertexAttribArray(VA_COLOR);
+        glVertexAttribPointer(VA_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(UIVertex), GLSH_BUFFER_OFFSET(offsetof(UIVertex, color)));
+        glEnableVertexAttribArray(VA_TEXCOORD);
+        glVertexAttribPointer(VA_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(UIVertex), GLSH_BUFFER_OFFSET(offsetof(UIVertex, texcoord)));
+
+        BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    GLint offsetLoc = GetActiveShaderUniformLocation("u_Offset");
+    GLint colorLoc = GetActiveShaderUniformLocation("u_Color");
+    bool streamBound = false;
+
+    for (unsigned i = 0; i < mCmds.size(); i++) {
+        const DrawCmd& cmd = mCmds[i];
+        if (!cmd.count) {
+            continue;
+        }
+
+        if (cmd.text) {
+            // uploads the glyphs only if the text changed since it was last drawn
+            mLastUploadBytes += cmd.text->GetPendingUploadBytes();
+            GLuint vao = cmd.text->GetVertexArray();
+            if (!vao) {
+                continue;
+            }
+            BindVertexArray(vao);
+            SetShaderUniform(offsetLoc, cmd.offset);
+            SetShaderUniform(colorLoc, cmd.color);
+            streamBound = false;
+
+            glBindTexture(GL_TEXTURE_2D, cmd.tex);
+            glDrawArrays(GL_TRIANGLES, 0, cmd.count);
+        } else {
+            if (!streamBound) {
+                BindVertexArray(mVAO);
+                SetShaderUniform(offsetLoc, glm::vec2(0.0f));
+                SetShaderUniform(colorLoc, glm::vec4(1.0f));
+                streamBound = true;
+            }
+
+            glBindTexture(GL_TEXTURE_2D, cmd.tex);
+            glDrawArrays(GL_TRIANGLES, base + cmd.first, cmd.count);
+        }
+        mLastDrawCount++;
+        CountDrawCall();
+    }
+
+    BindVertexArray(0);
+
+    mVerts.clear();
+    mCmds.clear();
+}
+
+} // end of namespace
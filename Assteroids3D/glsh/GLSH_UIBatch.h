@@ -0,0 +1,89 @@
+#ifndef GLSH_UIBATCH_H_
+#define GLSH_UIBATCH_H_
+
+#include "GLSH_DynamicBuffer.h"
+#include "GLSH_Text.h"
+#include "GLSH_Texture.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace glsh {
+
+struct UIVertex {
+    glm::vec2 pos;
+    glm::vec2 texcoord;
+    glm::vec4 color;
+};
+
+
+//
+// Collects UI geometry (solid quads, outlines and text) from every panel drawn during a frame
+// and submits it in order, with one draw call per texture run and one per text.
+//
+// Positions are in pixels, y up, and rectangles are given by their top-left corner like TextBatch.
+// Solid geometry samples a white texel; point it into the atlas with SetWhiteTexel and the
+// quads between two texts go out in a single draw.
+//
+// Quads are written to the stream buffer every frame. Text is drawn from its TextBatch's own
+// buffer instead, placed and tinted with the u_Offset and u_Color uniforms, so unchanged text
+// costs a draw but no upload. A TextBatch has to stay alive and unchanged until the Flush.
+//
+// Draw with a program using shaders/ui-vs.glsl and shaders/ui-fs.glsl.
+//
+class UIBatch {
+
+    struct DrawCmd {
+        GLuint              tex;
+        GLint               first;
+        GLsizei             count;
+
+        const TextBatch*    text;       // NULL for the streamed vertices
+        glm::vec2           offset;
+        glm::vec4           color;
+    };
+
+    std::vector<UIVertex>   mVerts;
+    std::vector<DrawCmd>    mCmds;
+
+    GLuint                  mVAO;
+
+    GLuint                  mWhiteTex;      // 1x1 fallback, created on first use
+    GLuint                  mSolidTex;
+    glm::vec2               mSolidUV;
+
+    int                     mLastDrawCount;
+    size_t                  mLastUploadBytes;
+
+    void                    setTexture(GLuint tex);
+    void                    addQuad(float x, float y, float w, float h,
+                                    float uLeft, float vTop, float uRight, float vBottom, const glm::vec4& color);
+
+                            UIBatch(const UIBatch&) = delete;
+    UIBatch&                operator=(const UIBatch&) = delete;
+
+public:
+                            UIBatch();
+                            ~UIBatch();
+
+    // texture and texcoord of an opaque white texel used for solid geometry
+    void                    SetWhiteTexel(GLuint tex, const glm::vec2& uv);
+
+    void                    AddRect(const glm::vec2& topLeft, float w, float h, const glm::vec4& color);
+    void                    AddOutline(const glm::vec2& topLeft, float w, float h, float thickness, const glm::vec4& color);
+    void                    AddTexturedRect(GLuint tex, const glm::vec2& topLeft, const TexRect& r, const glm::vec4& color);
+    void                    AddText(const TextBatch& text, const glm::vec2& topLeft, const glm::vec4& color);
+
+    // write everything queued so far into the stream buffer, draw it with the current program and clear the batch
+    void                    Flush(DynamicBuffer& stream);
+
+    bool                    IsEmpty() const             { return mCmds.empty(); }
+    int                     GetVertexCount() const      { return (int)mVerts.size(); }        // streamed vertices queued so far
+    int                     GetLastDrawCount() const    { return mLastDrawCount; }     // draw calls made by the last Flush
+    size_t                  GetLastUploadBytes() const  { return mLastUploadBytes; }   // streamed vertices and changed text sent by the last Flush
+};
+
+} // end of namespace
+
+#endif
@@ -66,4 +66,37 @@ std::vector<std::string> Tokenize(const std::string& str)
     return tokens;
 }
 
+int FormatInt(char* buf, int bufSize, int value)
+{
+    if (bufSize <= 0) {
+        return 0;
+    }
+
+    // write the digits backwards into a scratch buffer (unsigned to handle INT_MIN)
+    char digits[16];
+    int n = 0;
+    unsigned u = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    do {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+
+    int len = n + (value < 0 ? 1 : 0);
+    if (len >= bufSize) {
+        buf[0] = '\0';
+        return 0;
+    }
+
+    char* p = buf;
+    if (value < 0) {
+        *p++ = '-';
+    }
+    while (n) {
+        *p++ = digits[--n];
+    }
+    *p = '\0';
+
+    return len;
+}
+
 }
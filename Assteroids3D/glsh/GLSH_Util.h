@@ -90,6 +90,16 @@ T FromString(const std::string& str)
     return value;
 }
 
+//
+// Format an integer into buf without allocating, returns the number of chars written
+// (not counting the terminating NUL, which is always written if bufSize > 0)
+//
+// FormatInt(buf, 16, 1234)   -->  "1234", 4
+// FormatInt(buf, 16, -56)    -->  "-56", 3
+// FormatInt(buf, 3, 1234)    -->  "", 0 (doesn't fit)
+//
+int FormatInt(char* buf, int bufSize, int value);
+
 inline bool StringBeginsWith(const std::string& s, const std::string& prefix)
 {
     return s.compare(0, prefix.length(), prefix) == 0;
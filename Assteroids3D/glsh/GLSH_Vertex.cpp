@@ -1,5 +1,10 @@
 #include "GLSH_Vertex.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
 namespace glsh {
 
 // default constructor (creates empty attribute list)
@@ -40,50 +45,260 @@ VertexFormat::VertexFormat(const VertexAttrib& va1, const VertexAttrib& va2, con
 }
 
 
+//
+// Layout arrays are odr-used by MakeVertexFormat, so they need a definition
+//
+constexpr VertexAttribDesc VertexLayout<VertexPosition>::attribs[];
+constexpr VertexAttribDesc VertexLayout<VertexPositionColor>::attribs[];
+constexpr VertexAttribDesc VertexLayout<VertexPositionTexture>::attribs[];
+constexpr VertexAttribDesc VertexLayout<VertexPositionNormal>::attribs[];
+constexpr VertexAttribDesc VertexLayout<VertexPositionNormalColor>::attribs[];
+constexpr VertexAttribDesc VertexLayout<VertexPositionNormalTexture>::attribs[];
+constexpr VertexAttribDesc VertexLayout<VertexPackedPositionNormalTexture>::attribs[];
+
+
 const VertexFormat& VertexPosition::GetFormat()
 {
-    static VertexFormat fmt(VertexAttrib(VA_POSITION, 3, GL_FLOAT, 3 * sizeof(GLfloat), (void*)0));
+    static VertexFormat fmt = MakeVertexFormat<VertexPosition>();
     return fmt;
 }
 
 const VertexFormat& VertexPositionColor::GetFormat()
 {
-    static VertexFormat fmt(VertexAttrib(VA_POSITION, 3, GL_FLOAT, 7 * sizeof(GLfloat), (void*)0),
-                            VertexAttrib(VA_COLOR,    4, GL_FLOAT, 7 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat))));
+    static VertexFormat fmt = MakeVertexFormat<VertexPositionColor>();
     return fmt;
 }
 
 const VertexFormat& VertexPositionTexture::GetFormat()
 {
-    static VertexFormat fmt(VertexAttrib(VA_POSITION, 3, GL_FLOAT, 5 * sizeof(GLfloat), (void*)0),
-                            VertexAttrib(VA_TEXCOORD, 2, GL_FLOAT, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat))));
+    static VertexFormat fmt = MakeVertexFormat<VertexPositionTexture>();
     return fmt;
 }
 
 const VertexFormat& VertexPositionNormal::GetFormat()
 {
-    static VertexFormat fmt(VertexAttrib(VA_POSITION, 3, GL_FLOAT, 6 * sizeof(GLfloat), (void*)0),
-                            VertexAttrib(VA_NORMAL,   3, GL_FLOAT, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat))));
+    static VertexFormat fmt = MakeVertexFormat<VertexPositionNormal>();
     return fmt;
 }
 
 const VertexFormat& VertexPositionNormalColor::GetFormat()
 {
-    static VertexFormat fmt(VertexAttrib(VA_POSITION, 3, GL_FLOAT, 10 * sizeof(GLfloat), (void*)0),
-                            VertexAttrib(VA_NORMAL,   3, GL_FLOAT, 10 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat))),
-                            VertexAttrib(VA_COLOR,    4, GL_FLOAT, 10 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat))));
+    static VertexFormat fmt = MakeVertexFormat<VertexPositionNormalColor>();
     return fmt;
 }
 
 const VertexFormat& VertexPositionNormalTexture::GetFormat()
 {
-    static VertexFormat fmt(VertexAttrib(VA_POSITION, 3, GL_FLOAT, 8 * sizeof(GLfloat), (void*)0),
-                            VertexAttrib(VA_NORMAL,   3, GL_FLOAT, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat))),
-                            VertexAttrib(VA_TEXCOORD, 2, GL_FLOAT, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat))));
+    static VertexFormat fmt = MakeVertexFormat<VertexPositionNormalTexture>();
+    return fmt;
+}
+
+const VertexFormat& VertexPackedPositionNormalTexture::GetFormat()
+{
+    static VertexFormat fmt = MakeVertexFormat<VertexPackedPositionNormalTexture>();
     return fmt;
 }
 
 
+GLushort PackHalf(float f)
+{
+    GLuint u;
+    std::memcpy(&u, &f, 4);
+
+    GLuint sign = (u >> 16) & 0x8000;
+    GLuint exp32 = (u >> 23) & 0xff;
+    GLuint mant = u & 0x7fffff;
+
+    if (exp32 == 0xff) {
+        return (GLushort)(sign | 0x7c00 | (mant ? 0x200 : 0));     // inf or nan
+    }
+
+    int exp = (int)exp32 - 127 + 15;
+    if (exp >= 31) {
+        return (GLushort)(sign | 0x7c00);                           // too big, inf
+    }
+
+    if (exp <= 0) {
+        if (exp < -10) {
+            return (GLushort)sign;                                  // too small, zero
+        }
+        // denormal
+        mant |= 0x800000;
+        int shift = 14 - exp;
+        GLuint h = mant >> shift;
+        if ((mant >> (shift - 1)) & 1) {
+            h++;
+        }
+        return (GLushort)(sign | h);
+    }
+
+    GLuint h = sign | (exp << 10) | (mant >> 13);
+    if (mant & 0x1000) {
+        h++;    // a carry out of the mantissa correctly bumps the exponent
+    }
+    return (GLushort)h;
+}
+
+float UnpackHalf(GLushort h)
+{
+    GLuint sign = (GLuint)(h & 0x8000) << 16;
+    GLuint exp = (h >> 10) & 0x1f;
+    GLuint mant = h & 0x3ff;
+
+    float f;
+    if (exp == 0) {
+        f = std::ldexp((float)mant, -24);
+        return sign ? -f : f;
+    }
+
+    GLuint u;
+    if (exp == 31) {
+        u = sign | 0x7f800000 | (mant << 13);
+    } else {
+        u = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+    }
+    std::memcpy(&f, &u, 4);
+    return f;
+}
+
+GLshort PackSnorm16(float f)
+{
+    f = std::min(std::max(f, -1.0f), 1.0f);
+    return (GLshort)std::floor(f * 32767.0f + 0.5f);
+}
+
+static GLuint PackSnorm10(float f)
+{
+    f = std::min(std::max(f, -1.0f), 1.0f);
+    int i = (int)std::floor(f * 511.0f + 0.5f);
+    return (GLuint)i & 0x3ff;
+}
+
+static float UnpackSnorm10(GLuint bits)
+{
+    int i = (int)(bits & 0x3ff);
+    if (i & 0x200) {
+        i -= 0x400;     // sign extend
+    }
+    return std::max(i / 511.0f, -1.0f);
+}
+
+GLuint PackOctahedralNormal(const glm::vec3& n)
+{
+    // project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one
+    float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (sum <= 0.0f) {
+        return PackSnorm10(0.0f) | (PackSnorm10(0.0f) << 10);    // decodes to +z
+    }
+
+    float x = n.x / sum;
+    float y = n.y / sum;
+    if (n.z < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+
+    return PackSnorm10(x) | (PackSnorm10(y) << 10);
+}
+
+glm::vec3 UnpackOctahedralNormal(GLuint packed)
+{
+    float x = UnpackSnorm10(packed);
+    float y = UnpackSnorm10(packed >> 10);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    return glm::normalize(glm::vec3(x, y, z));
+}
+
+glm::mat4 PositionQuantization::getMatrix() const
+{
+    glm::mat4 m(scale);
+    m[3] = glm::vec4(bias, 1.0f);
+    return m;
+}
+
+PositionQuantization ComputePositionQuantization(const glm::vec3* positions, unsigned numVertices)
+{
+    PositionQuantization q;
+    if (!numVertices) {
+        return q;
+    }
+
+    glm::vec3 lo(FLT_MAX);
+    glm::vec3 hi(-FLT_MAX);
+    for (unsigned i = 0; i < numVertices; i++) {
+        lo = glm::min(lo, positions[i]);
+        hi = glm::max(hi, positions[i]);
+    }
+
+    q.bias = 0.5f * (lo + hi);
+    glm::vec3 halfExtent = 0.5f * (hi - lo);
+    q.scale = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+    if (q.scale <= 0.0f) {
+        q.scale = 1.0f;
+    }
+    return q;
+}
+
+static void PackVertex(const glm::vec3& pos, const glm::vec3& normal, const glm::vec2& texcoord,
+                       const PositionQuantization& q, VertexPackedPositionNormalTexture& v)
+{
+    glm::vec3 p = (pos - q.bias) / q.scale;
+    v.pos[0] = PackSnorm16(p.x);
+    v.pos[1] = PackSnorm16(p.y);
+    v.pos[2] = PackSnorm16(p.z);
+    v.pos[3] = 32767;
+    v.normal = PackOctahedralNormal(normal);
+    v.texcoord[0] = PackHalf(texcoord.x);
+    v.texcoord[1] = PackHalf(texcoord.y);
+}
+
+void PackVertices(const std::vector<VertexPositionNormalTexture>& vertices,
+                  std::vector<VertexPackedPositionNormalTexture>& packed_ret, PositionQuantization* quant_ret)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].pos;
+    }
+    PositionQuantization q = ComputePositionQuantization(positions.empty() ? NULL : &positions[0], positions.size());
+
+    packed_ret.resize(vertices.size());
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        PackVertex(vertices[i].pos, vertices[i].normal, vertices[i].texcoord, q, packed_ret[i]);
+    }
+
+    if (quant_ret) {
+        *quant_ret = q;
+    }
+}
+
+void PackVertices(const std::vector<VertexPositionNormal>& vertices,
+                  std::vector<VertexPackedPositionNormalTexture>& packed_ret, PositionQuantization* quant_ret)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].pos;
+    }
+    PositionQuantization q = ComputePositionQuantization(positions.empty() ? NULL : &positions[0], positions.size());
+
+    packed_ret.resize(vertices.size());
+    for (unsigned i = 0; i < vertices.size(); i++) {
+        PackVertex(vertices[i].pos, vertices[i].normal, glm::vec2(0.0f, 0.0f), q, packed_ret[i]);
+    }
+
+    if (quant_ret) {
+        *quant_ret = q;
+    }
+}
+
+
 GLsizei GetGLTypeSize(GLenum type)
 {
     switch (type) {
@@ -4,6 +4,7 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <cstddef>
 #include <vector>
 
 namespace glsh {
@@ -18,6 +19,8 @@ enum VertexAttribIndex {
     VA_NORMAL    = 2,
     VA_TEXCOORD  = 3,
     VA_TANGENT   = 4,           // <--- !!!
+
+    VA_INSTANCE  = 5,           // first per-instance attribute (instanced draws from a MeshArena)
 };
 
 //
@@ -35,18 +38,25 @@ struct VertexAttrib {
     GLenum          type;
     GLsizei         stride;
     const GLvoid*   offset;
+    GLboolean       normalized;     // integer values map to [0, 1] (unsigned) or [-1, 1] (signed)
 
     // default constructor initializes everything to 0 (meaningless values)
     VertexAttrib()
-        : index(0), size(0), type(0), stride(0), offset(0)
+        : index(0), size(0), type(0), stride(0), offset(0), normalized(GL_FALSE)
     { }
 
-    VertexAttrib(GLuint index, GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
-        : index(index), size(size), type(type), stride(stride), offset(offset)
+    VertexAttrib(GLuint index, GLint size, GLenum type, GLsizei stride, const GLvoid* offset, GLboolean normalized = GL_FALSE)
+        : index(index), size(size), type(type), stride(stride), offset(offset), normalized(normalized)
     { }
 
     GLsizei getSizeInBytes() const
-    { return size * GetGLTypeSize(type); }  // number of components times component size
+    {
+        // packed types hold all four components in one 32-bit value
+        if (type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV) {
+            return 4;
+        }
+        return size * GetGLTypeSize(type);  // number of components times component size
+    }
 };
 
 
@@ -84,6 +94,146 @@ public:
 };
 
 
+//
+// Compile-time vertex layouts
+//
+// Every VertexXXX type lists its attributes in a constexpr array (a VertexLayout specialization),
+// which GLSH_CHECK_VERTEX_LAYOUT validates against the struct with static_assert. A member that
+// doesn't match its declared type and size, overlapping attributes, or padding the layout doesn't
+// account for are build errors.
+//
+// SetVertexAttribPointers<VertexType> sets up the bound VAO from the layout, with every
+// glVertexAttribPointer call unrolled and its arguments known at compile time.
+//
+
+// the compile-time counterpart of GetGLTypeSize
+constexpr GLsizei GLTypeSize(GLenum type)
+{
+    return (type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT) ? 4
+         : (type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT) ? 2
+         : (type == GL_BYTE || type == GL_UNSIGNED_BYTE) ? 1
+         : 0;
+}
+
+struct VertexAttribDesc {
+    GLuint      index;
+    GLint       size;           // number of components
+    GLenum      type;
+    GLboolean   normalized;
+    GLsizei     offset;         // offsetof the struct member
+    GLsizei     memberSize;     // sizeof the struct member
+
+    constexpr bool isPacked() const
+    { return type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV; }
+
+    constexpr GLsizei sizeInBytes() const
+    { return isPacked() ? 4 : size * GLTypeSize(type); }
+};
+
+// an attribute read from a member of a vertex struct
+#define GLSH_VERTEX_ATTRIB(VertexType, member, index, size, type, normalized) \
+    { index, size, type, normalized, (GLsizei)offsetof(VertexType, member), (GLsizei)sizeof(((VertexType*)0)->member) }
+
+template <typename VertexType>
+struct VertexLayout;    // specialized after each vertex type: static constexpr VertexAttribDesc attribs[]; count
+
+template <unsigned N>
+constexpr bool VertexAttribsMatchMembers(const VertexAttribDesc (&a)[N], unsigned i = 0)
+{
+    return i == N || ((a[i].size >= 1 && a[i].size <= 4) && (!a[i].isPacked() || a[i].size == 4) &&
+                      a[i].sizeInBytes() == a[i].memberSize && VertexAttribsMatchMembers(a, i + 1));
+}
+
+template <unsigned N>
+constexpr bool VertexAttribsInOrder(const VertexAttribDesc (&a)[N], unsigned i = 1)
+{
+    return i >= N || (a[i].offset >= a[i - 1].offset + a[i - 1].memberSize && VertexAttribsInOrder(a, i + 1));
+}
+
+template <unsigned N>
+constexpr bool VertexAttribIndexUnused(const VertexAttribDesc (&a)[N], GLuint index, unsigned i)
+{
+    return i == N || (a[i].index != index && VertexAttribIndexUnused(a, index, i + 1));
+}
+
+template <unsigned N>
+constexpr bool VertexAttribIndicesUnique(const VertexAttribDesc (&a)[N], unsigned i = 0)
+{
+    return i == N || (VertexAttribIndexUnused(a, a[i].index, i + 1) && VertexAttribIndicesUnique(a, i + 1));
+}
+
+template <unsigned N>
+constexpr GLsizei VertexAttribBytes(const VertexAttribDesc (&a)[N], unsigned i = 0)
+{
+    return i == N ? 0 : a[i].sizeInBytes() + VertexAttribBytes(a, i + 1);
+}
+
+#define GLSH_CHECK_VERTEX_LAYOUT(VertexType) \
+    static_assert(VertexAttribsMatchMembers(VertexLayout<VertexType>::attribs), \
+                  #VertexType ": an attribute's type and size don't match its struct member"); \
+    static_assert(VertexAttribsInOrder(VertexLayout<VertexType>::attribs), \
+                  #VertexType ": attributes overlap or aren't listed in member order"); \
+    static_assert(VertexAttribIndicesUnique(VertexLayout<VertexType>::attribs), \
+                  #VertexType ": an attribute location is used twice"); \
+    static_assert(VertexAttribBytes(VertexLayout<VertexType>::attribs) == sizeof(VertexType), \
+                  #VertexType ": the layout doesn't cover the struct (padding or unlisted members)")
+
+// unrolls the attribute setup of a layout, one attribute per instantiation
+// (GLSH_Mesh.h includes GLSH_GLTrace.h ahead of this header, so trace builds record these calls)
+template <typename VertexType, unsigned I = 0, bool Done = (I == VertexLayout<VertexType>::count)>
+struct VertexAttribSetup {
+    static void Enable(const char* base)
+    {
+        constexpr GLuint    index       = VertexLayout<VertexType>::attribs[I].index;
+        constexpr GLint     size        = VertexLayout<VertexType>::attribs[I].size;
+        constexpr GLenum    type        = VertexLayout<VertexType>::attribs[I].type;
+        constexpr GLboolean normalized  = VertexLayout<VertexType>::attribs[I].normalized;
+        constexpr GLsizei   offset      = VertexLayout<VertexType>::attribs[I].offset;
+
+        glVertexAttribPointer(index, size, type, normalized, sizeof(VertexType), base + offset);
+        glEnableVertexAttribArray(index);
+        VertexAttribSetup<VertexType, I + 1>::Enable(base);
+    }
+
+    static void Disable()
+    {
+        glDisableVertexAttribArray(VertexLayout<VertexType>::attribs[I].index);
+        VertexAttribSetup<VertexType, I + 1>::Disable();
+    }
+};
+
+template <typename VertexType, unsigned I>
+struct VertexAttribSetup<VertexType, I, true> {
+    static void Enable(const char*) { }
+    static void Disable() { }
+};
+
+// base is the address of the first vertex in RAM, or NULL to source from the bound GL_ARRAY_BUFFER
+template <typename VertexType>
+void SetVertexAttribPointers(const void* base)
+{
+    VertexAttribSetup<VertexType>::Enable((const char*)base);
+}
+
+template <typename VertexType>
+void DisableVertexAttribs()
+{
+    VertexAttribSetup<VertexType>::Disable();
+}
+
+// a runtime VertexFormat (for arenas and other code that picks formats at runtime)
+template <typename VertexType>
+VertexFormat MakeVertexFormat()
+{
+    VertexFormat fmt;
+    for (unsigned i = 0; i < VertexLayout<VertexType>::count; i++) {
+        const VertexAttribDesc& a = VertexLayout<VertexType>::attribs[i];
+        fmt.addAttrib(VertexAttrib(a.index, a.size, a.type, sizeof(VertexType), (const GLvoid*)(size_t)a.offset, a.normalized));
+    }
+    return fmt;
+}
+
+
 //
 // a structure that stores vertex positions
 //
@@ -105,6 +255,14 @@ struct VertexPosition {
     static const VertexFormat& GetFormat();
 };
 
+template <> struct VertexLayout<VertexPosition> {
+    static constexpr VertexAttribDesc attribs[] = {
+        GLSH_VERTEX_ATTRIB(VertexPosition, pos, VA_POSITION, 3, GL_FLOAT, GL_FALSE),
+    };
+    static constexpr unsigned count = sizeof(attribs) / sizeof(attribs[0]);
+};
+GLSH_CHECK_VERTEX_LAYOUT(VertexPosition);
+
 //
 // a structure that stores vertex position and color
 //
@@ -129,6 +287,15 @@ struct VertexPositionColor {
     static const VertexFormat& GetFormat();
 };
 
+template <> struct VertexLayout<VertexPositionColor> {
+    static constexpr VertexAttribDesc attribs[] = {
+        GLSH_VERTEX_ATTRIB(VertexPositionColor, pos, VA_POSITION, 3, GL_FLOAT, GL_FALSE),
+        GLSH_VERTEX_ATTRIB(VertexPositionColor, color, VA_COLOR, 4, GL_FLOAT, GL_FALSE),
+    };
+    static constexpr unsigned count = sizeof(attribs) / sizeof(attribs[0]);
+};
+GLSH_CHECK_VERTEX_LAYOUT(VertexPositionColor);
+
 
 //
 // a structure that stores vertex position and texture coordinates
@@ -154,6 +321,15 @@ struct VertexPositionTexture {
     static const VertexFormat& GetFormat();
 };
 
+template <> struct VertexLayout<VertexPositionTexture> {
+    static constexpr VertexAttribDesc attribs[] = {
+        GLSH_VERTEX_ATTRIB(VertexPositionTexture, pos, VA_POSITION, 3, GL_FLOAT, GL_FALSE),
+        GLSH_VERTEX_ATTRIB(VertexPositionTexture, texcoord, VA_TEXCOORD, 2, GL_FLOAT, GL_FALSE),
+    };
+    static constexpr unsigned count = sizeof(attribs) / sizeof(attribs[0]);
+};
+GLSH_CHECK_VERTEX_LAYOUT(VertexPositionTexture);
+
 //
 // a structure that stores vertex position and normal
 //
@@ -191,6 +367,15 @@ struct VertexPositionNormal {
     static const VertexFormat& GetFormat();
 };
 
+template <> struct VertexLayout<VertexPositionNormal> {
+    static constexpr VertexAttribDesc attribs[] = {
+        GLSH_VERTEX_ATTRIB(VertexPositionNormal, pos, VA_POSITION, 3, GL_FLOAT, GL_FALSE),
+        GLSH_VERTEX_ATTRIB(VertexPositionNormal, normal, VA_NORMAL, 3, GL_FLOAT, GL_FALSE),
+    };
+    static constexpr unsigned count = sizeof(attribs) / sizeof(attribs[0]);
+};
+GLSH_CHECK_VERTEX_LAYOUT(VertexPositionNormal);
+
 //
 // a structure that stores vertex position, normal, and color
 //
@@ -218,6 +403,16 @@ struct VertexPositionNormalColor {
     static const VertexFormat& GetFormat();
 };
 
+template <> struct VertexLayout<VertexPositionNormalColor> {
+    static constexpr VertexAttribDesc attribs[] = {
+        GLSH_VERTEX_ATTRIB(VertexPositionNormalColor, pos, VA_POSITION, 3, GL_FLOAT, GL_FALSE),
+        GLSH_VERTEX_ATTRIB(VertexPositionNormalColor, normal, VA_NORMAL, 3, GL_FLOAT, GL_FALSE),
+        GLSH_VERTEX_ATTRIB(VertexPositionNormalColor, color, VA_COLOR, 4, GL_FLOAT, GL_FALSE),
+    };
+    static constexpr unsigned count = sizeof(attribs) / sizeof(attribs[0]);
+};
+GLSH_CHECK_VERTEX_LAYOUT(VertexPositionNormalColor);
+
 //
 // a structure that stores vertex position, normal, and texture coordinates
 //
@@ -258,6 +453,71 @@ struct VertexPositionNormalTexture {
     static const VertexFormat& GetFormat();
 };
 
+template <> struct VertexLayout<VertexPositionNormalTexture> {
+    static constexpr VertexAttribDesc attribs[] = {
+        GLSH_VERTEX_ATTRIB(VertexPositionNormalTexture, pos, VA_POSITION, 3, GL_FLOAT, GL_FALSE),
+        GLSH_VERTEX_ATTRIB(VertexPositionNormalTexture, normal, VA_NORMAL, 3, GL_FLOAT, GL_FALSE),
+        GLSH_VERTEX_ATTRIB(VertexPositionNormalTexture, texcoord, VA_TEXCOORD, 2, GL_FLOAT, GL_FALSE),
+    };
+    static constexpr unsigned count = sizeof(attribs) / sizeof(attribs[0]);
+};
+GLSH_CHECK_VERTEX_LAYOUT(VertexPositionNormalTexture);
+
+//
+// Packed vertex attributes
+//
+GLushort    PackHalf(float f);                              // IEEE half float, rounded to nearest
+float       UnpackHalf(GLushort h);
+GLshort     PackSnorm16(float f);                           // [-1, 1] -> [-32767, 32767]
+GLuint      PackOctahedralNormal(const glm::vec3& n);       // octahedral x/y as snorm10 in GL_INT_2_10_10_10_REV
+glm::vec3   UnpackOctahedralNormal(GLuint packed);
+
+//
+// Positions stored as normalized 16-bit integers are dequantized as snorm * scale + bias.
+// The scale is the same on every axis, so normal transforms aren't affected.
+//
+struct PositionQuantization {
+    glm::vec3   bias;
+    float       scale;
+
+    PositionQuantization()
+        : bias(0.0f, 0.0f, 0.0f), scale(1.0f)
+    { }
+
+    // append to a model matrix to draw quantized positions
+    glm::mat4   getMatrix() const;
+};
+
+PositionQuantization ComputePositionQuantization(const glm::vec3* positions, unsigned numVertices);
+
+//
+// a compressed vertex: 16 bytes instead of 32 for VertexPositionNormalTexture
+//
+struct VertexPackedPositionNormalTexture {
+
+    GLshort     pos[4];         // snorm16 x, y, z, and w = 1 so shaders get a homogeneous position
+    GLuint      normal;         // PackOctahedralNormal; decode in the vertex shader
+    GLushort    texcoord[2];    // half floats
+
+    static const VertexFormat& GetFormat();
+};
+
+template <> struct VertexLayout<VertexPackedPositionNormalTexture> {
+    static constexpr VertexAttribDesc attribs[] = {
+        GLSH_VERTEX_ATTRIB(VertexPackedPositionNormalTexture, pos, VA_POSITION, 4, GL_SHORT, GL_TRUE),
+        GLSH_VERTEX_ATTRIB(VertexPackedPositionNormalTexture, normal, VA_NORMAL, 4, GL_INT_2_10_10_10_REV, GL_TRUE),
+        GLSH_VERTEX_ATTRIB(VertexPackedPositionNormalTexture, texcoord, VA_TEXCOORD, 2, GL_HALF_FLOAT, GL_FALSE),
+    };
+    static constexpr unsigned count = sizeof(attribs) / sizeof(attribs[0]);
+};
+GLSH_CHECK_VERTEX_LAYOUT(VertexPackedPositionNormalTexture);
+
+// pack a mesh's vertices, returning the quantization to draw them with
+void PackVertices(const std::vector<VertexPositionNormalTexture>& vertices,
+                  std::vector<VertexPackedPositionNormalTexture>& packed_ret, PositionQuantization* quant_ret);
+void PackVertices(const std::vector<VertexPositionNormal>& vertices,
+                  std::vector<VertexPackedPositionNormalTexture>& packed_ret, PositionQuantization* quant_ret);
+
 //
 // Short aliases for vertex types (saves some typing and horizontal space)
 //
@@ -268,6 +528,7 @@ typedef VertexPositionTexture           VPT;
 typedef VertexPositionNormal            VPN;
 typedef VertexPositionNormalColor       VPNC;
 typedef VertexPositionNormalTexture     VPNT;
+typedef VertexPackedPositionNormalTexture VPNTPacked;
 
 }
 
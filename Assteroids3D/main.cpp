@@ -1,9 +1,49 @@
 #include "Game.h"
 
-int main()
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char* argv[])
 {
+	// --gltrace <file> [frames] records the GL calls of the first frames (replay with tools/GLReplay);
+	// it needs a build with GLSH_GL_TRACE=1
+	// --assert-no-alloc aborts when a steady-state frame allocates from the heap
+	// --telemetry [name] publishes live stats in shared memory (read with tools/TelemetryReader)
+	// --record-input <file> logs the input and random seeds of the session; --replay-input <file> plays one back
+	//   (also headless, with tools/Stress --replay)
+	int width = 800;
+	int height = 600;
+
+	// the input log seeds the random numbers again
 	glsh::InitRandom();
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--gltrace") == 0 && i + 1 < argc) {
+			const char* path = argv[++i];
+			int frames = 300;
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+				frames = std::atoi(argv[++i]);
+			}
+			glsh::StartGLTrace(path, frames);
+		} else if (std::strcmp(argv[i], "--assert-no-alloc") == 0) {
+			glsh::SetZeroAllocationCheck(true);
+		} else if (std::strcmp(argv[i], "--telemetry") == 0) {
+			const char* name = TELEMETRY_NAME;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				name = argv[++i];
+			}
+			glsh::StartTelemetry(name);
+		} else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+			glsh::StartInputRecording(argv[++i], width, height);
+		} else if (std::strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc) {
+			if (glsh::StartInputReplay(argv[++i])) {
+				width = glsh::GetInputReplayWidth();
+				height = glsh::GetInputReplayHeight();
+			}
+		}
+	}
+
     Game game;
 
-    glsh::System::Run(game, "Assteroids", 800, 600);
+    glsh::System::Run(game, "Assteroids", width, height);
 }
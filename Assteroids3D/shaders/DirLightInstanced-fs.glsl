@@ -0,0 +1,14 @@
+#version 330
+
+// input from rasterizer
+in vec3 var_LightColor;		// interpolated per-vertex light color
+in vec4 var_Color;			// per-instance material color
+
+// outputs to framebuffer
+out vec4 out_Color;
+
+void main(void)
+{
+	out_Color.rgb = var_Color.rgb * var_LightColor;
+	out_Color.a = var_Color.a;
+}
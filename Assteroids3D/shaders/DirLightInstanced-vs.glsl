@@ -0,0 +1,42 @@
+#version 330
+
+// vertex attributes
+layout(location=0) in vec4 in_Position;
+layout(location=2) in vec3 in_Normal;
+
+// per-instance attributes
+layout(location=5) in mat4 in_ModelMatrix;     // occupies locations 5-8
+layout(location=9) in vec4 in_Color;
+
+// transform
+uniform mat4 u_ProjectionMatrix;
+uniform mat4 u_ViewMatrix;
+
+// directional light info
+uniform vec3 u_LightColor;
+uniform vec3 u_LightDir;    // direction to light (in camera space!)
+uniform vec3 u_AmbientCol;
+
+// outputs to rasterizer
+out vec3 var_LightColor;
+out vec4 var_Color;
+
+void main(void)
+{
+	mat4 modelViewMatrix = u_ViewMatrix * in_ModelMatrix;
+
+	// output transformed vertex position
+	gl_Position = u_ProjectionMatrix * modelViewMatrix * in_Position;
+
+	// game objects are only ever scaled uniformly, so the model-view rotation
+	// is the normal matrix up to a scale that normalize() takes out
+	vec3 N = normalize(mat3(modelViewMatrix) * in_Normal);		// transform surface normal
+	vec3 L = normalize(u_LightDir);						// direction to light
+
+	// compute diffuse lighting intensity
+	float NdotL = max(dot(N, L), 0.2);
+
+	// pass light color to rasterizer
+	var_LightColor = u_AmbientCol + NdotL * u_LightColor;
+	var_Color = in_Color;
+}
@@ -0,0 +1,52 @@
+#version 330
+
+// vertex attributes
+layout(location=0) in vec4 in_Position;   // quantized; the dequantization is part of in_ModelMatrix
+layout(location=2) in vec4 in_Normal;     // octahedral normal in x and y (glsh::PackOctahedralNormal)
+
+// per-instance attributes
+layout(location=5) in mat4 in_ModelMatrix;     // occupies locations 5-8
+layout(location=9) in vec4 in_Color;
+
+// transform
+uniform mat4 u_ProjectionMatrix;
+uniform mat4 u_ViewMatrix;
+
+// directional light info
+uniform vec3 u_LightColor;
+uniform vec3 u_LightDir;    // direction to light (in camera space!)
+uniform vec3 u_AmbientCol;
+
+// outputs to rasterizer
+out vec3 var_LightColor;
+out vec4 var_Color;
+
+vec3 DecodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) {
+		vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+		n.xy = (1.0 - abs(n.yx)) * s;
+	}
+	return normalize(n);
+}
+
+void main(void)
+{
+	mat4 modelViewMatrix = u_ViewMatrix * in_ModelMatrix;
+
+	// output transformed vertex position
+	gl_Position = u_ProjectionMatrix * modelViewMatrix * in_Position;
+
+	// game objects are only ever scaled uniformly, so the model-view rotation
+	// is the normal matrix up to a scale that normalize() takes out
+	vec3 N = normalize(mat3(modelViewMatrix) * DecodeOctahedral(in_Normal.xy));		// transform surface normal
+	vec3 L = normalize(u_LightDir);						// direction to light
+
+	// compute diffuse lighting intensity
+	float NdotL = max(dot(N, L), 0.2);
+
+	// pass light color to rasterizer
+	var_LightColor = u_AmbientCol + NdotL * u_LightColor;
+	var_Color = in_Color;
+}
@@ -0,0 +1,17 @@
+#version 330
+
+// input from rasterizer
+in vec3 var_TexCoord;
+
+// input from application
+uniform sampler2DArray u_TexSampler;
+
+uniform vec4 u_BlendWeight;
+
+// output to framebuffer
+out vec4 out_Color;
+
+void main()
+{
+    out_Color = u_BlendWeight * texture(u_TexSampler, var_TexCoord);  // texture array lookup
+}
@@ -0,0 +1,38 @@
+#version 330
+
+// per-effect instance attributes
+layout(location = 0) in vec4 in_Instance;   // x, y, angle (radians), start time
+layout(location = 3) in float in_Duration;
+
+// transformations
+uniform mat4 u_ProjectionMatrix;
+
+// animation
+uniform float u_Time;
+uniform int u_NumFrames;
+uniform sampler2DArray u_TexSampler;
+
+// outputs to rasterizer
+out vec3 var_TexCoord;      // u, v, frame layer
+
+void main()
+{
+    // triangle strip corners: bottom-left, bottom-right, top-left, top-right
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    // unit quad centered on the effect position, rotated by its angle
+    float s = sin(in_Instance.z);
+    float c = cos(in_Instance.z);
+    vec2 local = corner - 0.5;
+    vec2 pos = in_Instance.xy + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+
+    gl_Position = u_ProjectionMatrix * vec4(pos, 0.0, 1.0);
+
+    // pick the frame from the time elapsed since the effect started
+    float t = clamp((u_Time - in_Instance.w) / in_Duration, 0.0, 1.0);
+    int frame = min(int(t * u_NumFrames), u_NumFrames - 1);
+
+    // stay half a texel inside the frame
+    vec2 halfTexel = 0.5 / vec2(textureSize(u_TexSampler, 0).xy);
+    var_TexCoord = vec3(mix(halfTexel, 1.0 - halfTexel, corner), float(frame));
+}
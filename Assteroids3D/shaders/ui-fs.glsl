@@ -0,0 +1,17 @@
+#version 330
+
+// inputs from rasterizer
+in vec4 var_Color;
+in vec2 var_TexCoord;
+
+// input from application
+uniform sampler2D u_TexSampler;
+
+// outputs to framebuffer
+out vec4 out_Color;
+
+void main(void)
+{
+	// solid geometry samples a white texel, so this works for both fills and glyphs
+	out_Color = var_Color * texture(u_TexSampler, var_TexCoord);
+}
@@ -0,0 +1,25 @@
+#version 330
+
+// vertex attributes
+layout(location=0) in vec4 in_Position;
+layout(location=1) in vec4 in_Color;
+layout(location=3) in vec2 in_TexCoord;
+
+// transform (UI vertices are already in screen space)
+uniform mat4 u_ProjectionMatrix;
+
+// where text drawn from its own buffer goes, and its color; (0, 0) and white for everything else
+uniform vec2 u_Offset;
+uniform vec4 u_Color;
+
+// outputs to rasterizer
+out vec4 var_Color;
+out vec2 var_TexCoord;
+
+void main(void)
+{
+	gl_Position = u_ProjectionMatrix * (in_Position + vec4(u_Offset, 0.0, 0.0));
+
+	var_Color = in_Color * u_Color;
+	var_TexCoord = in_TexCoord;
+}
@@ -0,0 +1,552 @@
+//
+// Bench: headless benchmarks of the loaders, the glsh utilities and the game simulation,
+// with JSON output for tracking regressions between builds.
+//
+//     bench [--filter <text>] [--min-time <seconds>] [--json <file>] [--data <game dir>]
+//
+// Each benchmark runs its operation in batches until --min-time (0.5 s) of timed work and at least
+// 5 batches; the JSON has the median, mean, min and max time per operation and the heap allocations
+// per operation (counted by GLSH_Memory, timed batches only). Setup between batches isn't timed.
+// Progress goes to stderr, the JSON to stdout unless --json is given.
+//
+// The loaders need a GL context for their uploads. It comes from EGL on the surfaceless platform
+// (llvmpipe with Mesa), so no window system is needed; without one those benchmarks are reported
+// as skipped. Input files are generated into a temporary directory, except the font, which is
+// read from the game directory (--data, by default ../.., so run it from tools/Bench).
+//
+// Game::update runs on a headless window with an invulnerable player, so the field keeps its
+// asteroids; a tick is one 60 Hz update.
+//
+
+#include "Game.h"
+#include "OffscreenContext.h"
+#include "Wavefront.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+struct Result {
+    std::string     name;
+    std::string     skipped;        // why it didn't run
+    int             samples;
+    long            iterations;
+    double          medianNs;
+    double          meanNs;
+    double          minNs;
+    double          maxNs;
+    double          allocsPerIter;
+    double          allocBytesPerIter;
+};
+
+struct Options {
+    const char*     filter;
+    double          minTime;
+    const char*     jsonPath;
+    const char*     dataDir;
+};
+
+typedef std::function<void()> Op;
+
+const int           MIN_SAMPLES     = 5;
+const int           MAX_SAMPLES     = 100000;
+
+Options             gOptions = { NULL, 0.5, NULL, "../.." };
+std::vector<Result> gResults;
+std::string         gRenderer;
+std::string         gTempDir;
+std::vector<std::string> gTempFiles;
+
+volatile size_t     gSink;          // keeps results the compiler could otherwise drop
+
+bool Selected(const std::string& name)
+{
+    return !gOptions.filter || name.find(gOptions.filter) != std::string::npos;
+}
+
+void Skip(const std::string& name, const char* reason)
+{
+    if (!Selected(name)) {
+        return;
+    }
+
+    Result r = Result();
+    r.name = name;
+    r.skipped = reason;
+    gResults.push_back(r);
+    std::fprintf(stderr, "%-28s skipped: %s\n", name.c_str(), reason);
+}
+
+// times 'op' in batches of 'batch' calls; 'setup' runs before each batch, untimed
+void Run(const std::string& name, int batch, const Op& op, const Op& setup = Op())
+{
+    if (!Selected(name)) {
+        return;
+    }
+
+    std::fprintf(stderr, "%-28s", name.c_str());
+
+    // one untimed batch, for caches and lazily grown buffers
+    if (setup) {
+        setup();
+    }
+    for (int i = 0; i < batch; i++) {
+        op();
+    }
+
+    std::vector<double> samples;
+    uint64_t totalNs = 0;
+    uint64_t allocs = 0;
+    uint64_t allocBytes = 0;
+    const uint64_t minNs = (uint64_t)(gOptions.minTime * 1e9);
+
+    while ((totalNs < minNs || samples.size() < (size_t)MIN_SAMPLES) && samples.size() < (size_t)MAX_SAMPLES) {
+        if (setup) {
+            setup();
+        }
+
+        glsh::EndMemoryFrame();
+        uint64_t start = glsh::Profiler::Now();
+        for (int i = 0; i < batch; i++) {
+            op();
+        }
+        uint64_t end = glsh::Profiler::Now();
+        glsh::EndMemoryFrame();
+
+        const glsh::MemoryFrameStats& mem = glsh::GetLastFrameMemoryStats();
+        allocs += mem.totalAllocs();
+        allocBytes += mem.totalAllocBytes();
+
+        samples.push_back((end - start) / (double)batch);
+        totalNs += end - start;
+    }
+
+    Result r = Result();
+    r.name = name;
+    r.samples = (int)samples.size();
+    r.iterations = (long)samples.size() * batch;
+
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    r.medianNs = (n & 1) ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    r.minNs = samples.front();
+    r.maxNs = samples.back();
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    r.meanNs = sum / n;
+    r.allocsPerIter = allocs / (double)r.iterations;
+    r.allocBytesPerIter = allocBytes / (double)r.iterations;
+
+    gResults.push_back(r);
+    std::fprintf(stderr, " %12.0f ns  (min %.0f, %ld iterations, %.1f allocs)\n", r.medianNs, r.minNs, r.iterations, r.allocsPerIter);
+}
+
+//
+// offscreen GL context, for the loaders that upload
+//
+
+bool CreateContext()
+{
+    if (!CreateOffscreenGLEWContext()) {
+        return false;
+    }
+
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    gRenderer = renderer ? (const char*)renderer : "?";
+    return true;
+}
+
+//
+// generated inputs
+//
+
+// UV sphere with positions, texcoords and normals
+std::string WriteSphereOBJ(const char* name, int slices, int stacks)
+{
+    std::string path = gTempDir + "/" + name;
+    gTempFiles.push_back(path);
+    std::ofstream f(path.c_str());
+
+    const float PI = 3.14159265f;
+    for (int j = 0; j <= stacks; j++) {
+        float phi = PI * j / stacks;
+        for (int i = 0; i <= slices; i++) {
+            float theta = 2.0f * PI * i / slices;
+            float x = std::sin(phi) * std::cos(theta);
+            float y = std::cos(phi);
+            float z = std::sin(phi) * std::sin(theta);
+            f << "v " << x << " " << y << " " << z << "\n";
+            f << "vt " << (float)i / slices << " " << (float)j / stacks << "\n";
+            f << "vn " << x << " " << y << " " << z << "\n";
+        }
+    }
+
+    for (int j = 0; j < stacks; j++) {
+        for (int i = 0; i < slices; i++) {
+            int a = j * (slices + 1) + i + 1;
+            int b = a + slices + 1;
+            f << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << a + 1 << "/" << a + 1 << "/" << a + 1 << "\n";
+            f << "f " << a + 1 << "/" << a + 1 << "/" << a + 1 << " " << b << "/" << b << "/" << b << " " << b + 1 << "/" << b + 1 << "/" << b + 1 << "\n";
+        }
+    }
+
+    return path;
+}
+
+// flat blocks with a band of noise, so RLE gets both run and raw packets
+void FillTestImage(glsh::Image& img, int size)
+{
+    img.Allocate(size, size, 4);
+    unsigned char* p = img.getData();
+    unsigned seed = 12345;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            if (y > size / 2 && y < size / 2 + size / 8) {
+                seed = seed * 1664525u + 1013904223u;
+                p[0] = (unsigned char)(seed >> 24);
+                p[1] = (unsigned char)(seed >> 16);
+                p[2] = (unsigned char)(seed >> 8);
+            } else {
+                unsigned char v = ((x / 32 + y / 32) & 1) ? 200 : 40;
+                p[0] = v;
+                p[1] = (unsigned char)(v / 2);
+                p[2] = (unsigned char)(255 - v);
+            }
+            p[3] = 255;
+            p += 4;
+        }
+    }
+}
+
+void WriteTargaRLE(const std::string& path, const glsh::Image& img)
+{
+    std::ofstream f(path.c_str(), std::ios::binary);
+
+    unsigned char hdr[18] = {};
+    hdr[2] = 10;                                    // RLE true-color
+    hdr[12] = (unsigned char)(img.getWidth() & 0xff);
+    hdr[13] = (unsigned char)(img.getWidth() >> 8);
+    hdr[14] = (unsigned char)(img.getHeight() & 0xff);
+    hdr[15] = (unsigned char)(img.getHeight() >> 8);
+    hdr[16] = 32;
+    hdr[17] = 8;                                    // alpha bits
+    f.write((const char*)hdr, sizeof(hdr));
+
+    const unsigned* pixels = (const unsigned*)img.getData();
+    int n = img.getWidth() * img.getHeight();
+    int i = 0;
+    while (i < n) {
+        int run = 1;
+        while (i + run < n && run < 128 && pixels[i + run] == pixels[i]) {
+            run++;
+        }
+
+        if (run > 1) {
+            f.put((char)(0x80 | (run - 1)));
+            const unsigned char* c = (const unsigned char*)&pixels[i];
+            unsigned char bgra[4] = { c[2], c[1], c[0], c[3] };
+            f.write((const char*)bgra, 4);
+            i += run;
+        } else {
+            // raw packet up to the next run of two
+            int count = 1;
+            while (i + count < n && count < 128 && (i + count + 1 >= n || pixels[i + count] != pixels[i + count + 1])) {
+                count++;
+            }
+            f.put((char)(count - 1));
+            for (int k = 0; k < count; k++) {
+                const unsigned char* c = (const unsigned char*)&pixels[i + k];
+                unsigned char bgra[4] = { c[2], c[1], c[0], c[3] };
+                f.write((const char*)bgra, 4);
+            }
+            i += count;
+        }
+    }
+}
+
+//
+// benchmarks
+//
+
+void BenchLoaders(bool haveGL)
+{
+    std::string smallOBJ = WriteSphereOBJ("small.obj", 16, 8);
+    std::string largeOBJ = WriteSphereOBJ("large.obj", 256, 128);
+
+    if (haveGL) {
+        Run("obj/small (256 tris)", 1, [&] {
+            glsh::Mesh* mesh = LoadWavefrontOBJ(smallOBJ, PACK_MESH_VERTICES);
+            delete mesh;
+        });
+        Run("obj/large (64k tris)", 1, [&] {
+            glsh::Mesh* mesh = LoadWavefrontOBJ(largeOBJ, PACK_MESH_VERTICES);
+            delete mesh;
+        });
+    } else {
+        Skip("obj/small (256 tris)", "no GL context");
+        Skip("obj/large (64k tris)", "no GL context");
+    }
+
+    glsh::Image src;
+    FillTestImage(src, 512);
+    std::string rawTGA = gTempDir + "/raw.tga";
+    std::string rleTGA = gTempDir + "/rle.tga";
+    gTempFiles.push_back(rawTGA);
+    gTempFiles.push_back(rleTGA);
+    src.SaveTarga(rawTGA);
+    WriteTargaRLE(rleTGA, src);
+
+    Run("targa/raw 512x512", 1, [&] {
+        glsh::Image img;
+        img.LoadTarga(rawTGA);
+        gSink = img.getWidth();
+    });
+    Run("targa/rle 512x512", 1, [&] {
+        glsh::Image img;
+        img.LoadTarga(rleTGA);
+        gSink = img.getWidth();
+    });
+
+    // mipmaps are appended to what the image has, so each batch gets a fresh copy
+    glsh::Image base;
+    FillTestImage(base, 1024);
+    glsh::Image mipImg;
+    Run("mipmaps 1024x1024", 1, [&] {
+        mipImg.GenerateMipmaps(1);
+    }, [&] {
+        mipImg.Allocate(base.getWidth(), base.getHeight(), base.getBytesPerPixel());
+        std::memcpy(mipImg.getData(), base.getData(), base.getWidth() * base.getHeight() * base.getBytesPerPixel());
+    });
+}
+
+void BenchUtil()
+{
+    const std::string faceLine = "f 1021/1021/1021 1278/1278/1278 1022/1022/1022";
+    const std::string longLine = "  vertex   0.57735  -0.57735   0.57735   texcoord 0.25 0.75   normal 0.0 1.0 0.0  ";
+
+    Run("util/tokenize face", 1000, [&] {
+        gSink = glsh::Tokenize(faceLine).size();
+    });
+    Run("util/tokenize long", 1000, [&] {
+        gSink = glsh::Tokenize(longLine).size();
+    });
+    Run("util/split v/vt/vn", 1000, [&] {
+        gSink = glsh::Split("1021/1021/1021", '/').size();
+    });
+}
+
+void BenchText(bool haveGL)
+{
+    if (!haveGL) {
+        Skip("text/set_text 80x8", "no GL context");
+        return;
+    }
+
+    glsh::Font* font = glsh::CreateFont("fonts/Consolas13");
+    if (!font->IsLoaded()) {
+        Skip("text/set_text 80x8", "font not found (see --data)");
+        delete font;
+        return;
+    }
+
+    std::string text;
+    for (int line = 0; line < 8; line++) {
+        for (int i = 0; i < 80; i++) {
+            text += (char)('!' + (line * 80 + i) % 90);
+        }
+        text += '\n';
+    }
+
+    glsh::TextBatch batch;
+    Run("text/set_text 80x8", 100, [&] {
+        batch.SetText(font, text.c_str(), false);
+    });
+
+    delete font;
+}
+
+void BenchObjects()
+{
+    Asteroid a;
+    a.SetYaw(10.0f);
+    a.SetPitch(20.0f);
+    a.SetRoll(30.0f);
+
+    Run("object/update_rotation", 10000, [&] {
+        a.UpdateRotationMatrix();
+    });
+    gSink = (size_t)a.GetRotationMatrix()[0][0];
+}
+
+void BenchGameUpdate(int numAsteroids)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "game/update %d", numAsteroids);
+    if (!Selected(name)) {
+        return;
+    }
+
+    // same field every run
+    glsh::InitRandom(1);
+
+    Game* game = new Game();
+    glsh::Window* wnd = glsh::System::CreateHeadlessWindow(*game, 800, 600);
+    game->InitializeHeadless(800, 600);
+    game->StartGame();
+    game->SetPlayerInvulnerable(true);
+    while (game->GetAsteroidCount() < numAsteroids) {
+        game->SpawnAsteroid(glm::vec3(glsh::Random(-9.0f, 9.0f), glsh::Random(-9.0f, 9.0f), 0.0f), ASTEROID_SCALE);
+    }
+
+    // drains the spawn events
+    glsh::System::StepHeadless(wnd, 1.0f / 60.0f);
+
+    Run(name, 1, [&] {
+        glsh::System::StepHeadless(wnd, 1.0f / 60.0f);
+    });
+
+    glsh::System::DestroyHeadlessWindow(wnd);
+    delete game;
+}
+
+//
+// output
+//
+
+void WriteJSONString(FILE* f, const std::string& s)
+{
+    std::fputc('"', f);
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"' || c == '\\') {
+            std::fputc('\\', f);
+            std::fputc(c, f);
+        } else if ((unsigned char)c < 0x20) {
+            std::fprintf(f, "\\u%04x", c);
+        } else {
+            std::fputc(c, f);
+        }
+    }
+    std::fputc('"', f);
+}
+
+void WriteJSON(FILE* f)
+{
+    std::fprintf(f, "{\n  \"suite\": \"assteroids\",\n  \"version\": 1,\n  \"min_time_s\": %g,\n  \"gl_renderer\": ", gOptions.minTime);
+    WriteJSONString(f, gRenderer);
+#ifdef __VERSION__
+    std::fprintf(f, ",\n  \"compiler\": ");
+    WriteJSONString(f, __VERSION__);
+#endif
+#ifdef NDEBUG
+    std::fprintf(f, ",\n  \"build\": \"release\"");
+#else
+    std::fprintf(f, ",\n  \"build\": \"debug\"");
+#endif
+    std::fprintf(f, ",\n  \"benchmarks\": [");
+
+    for (size_t i = 0; i < gResults.size(); i++) {
+        const Result& r = gResults[i];
+        std::fprintf(f, "%s\n    { \"name\": ", i ? "," : "");
+        WriteJSONString(f, r.name);
+        if (!r.skipped.empty()) {
+            std::fprintf(f, ", \"skipped\": ");
+            WriteJSONString(f, r.skipped);
+        } else {
+            std::fprintf(f, ", \"samples\": %d, \"iterations\": %ld, \"median_ns\": %.1f, \"mean_ns\": %.1f, \"min_ns\": %.1f, \"max_ns\": %.1f"
+                            ", \"allocs_per_iter\": %.2f, \"alloc_bytes_per_iter\": %.1f",
+                         r.samples, r.iterations, r.medianNs, r.meanNs, r.minNs, r.maxNs, r.allocsPerIter, r.allocBytesPerIter);
+        }
+        std::fprintf(f, " }");
+    }
+
+    std::fprintf(f, "\n  ]\n}\n");
+}
+
+void PrintUsage()
+{
+    std::fprintf(stderr, "usage: bench [--filter <text>] [--min-time <seconds>] [--json <file>] [--data <game dir>]\n");
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            gOptions.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            gOptions.minTime = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            gOptions.jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            gOptions.dataDir = argv[++i];
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // opened before the chdir, so a relative --json path is relative to where bench was started
+    FILE* out = stdout;
+    if (gOptions.jsonPath) {
+        out = std::fopen(gOptions.jsonPath, "w");
+        if (!out) {
+            std::fprintf(stderr, "*** Can't open %s for writing\n", gOptions.jsonPath);
+            return 1;
+        }
+    }
+
+    if (chdir(gOptions.dataDir) != 0) {
+        std::fprintf(stderr, "*** Can't change to the game directory %s\n", gOptions.dataDir);
+        return 1;
+    }
+
+    char tempDir[] = "/tmp/assteroids-bench-XXXXXX";
+    if (!mkdtemp(tempDir)) {
+        std::fprintf(stderr, "*** Can't create a temporary directory\n");
+        return 1;
+    }
+    gTempDir = tempDir;
+
+    // the loaders report every file on cout; that's not what's being measured, and stdout may be the JSON
+    std::cout.setstate(std::ios::badbit);
+
+    bool haveGL = CreateContext();
+    if (!haveGL) {
+        std::fprintf(stderr, "*** No offscreen GL context; the loaders that upload are skipped\n");
+    }
+
+    BenchLoaders(haveGL);
+    BenchUtil();
+    BenchText(haveGL);
+    BenchObjects();
+    BenchGameUpdate(10);
+    BenchGameUpdate(1000);
+    BenchGameUpdate(100000);
+
+    for (size_t i = 0; i < gTempFiles.size(); i++) {
+        std::remove(gTempFiles[i].c_str());
+    }
+    rmdir(gTempDir.c_str());
+
+    WriteJSON(out);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    return 0;
+}
@@ -0,0 +1,596 @@
+//
+// GLReplay: re-issues a glsh GL trace (see glsh/GLSH_GLTrace.h) against an offscreen context
+// and reports how long the CPU spends submitting each frame.
+//
+//     glreplay <trace> [--csv <file>] [--repeat <n>]
+//
+// The context comes from EGL on the surfaceless platform, so no window system is needed;
+// with Mesa this is llvmpipe unless a GPU driver is picked up. Draws that went to the default
+// framebuffer go to an offscreen one of the size of the first viewport in the trace.
+// Every frame is finished (glFinish) after its submit time is taken, so queued GPU work
+// from one frame doesn't show up as submit time of the next.
+//
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include "GLSH_GLTraceFormat.h"
+#include "OffscreenContext.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace glsh;
+
+namespace {
+
+struct Call {
+    uint16_t                op;
+    uint64_t                a[12];          // scalar arguments in signature order
+    const unsigned char*    blob;           // NULL when the payload was
+    uint32_t                blobSize;
+};
+
+struct Frame {
+    size_t                  first;
+    size_t                  count;
+    unsigned                draws;
+};
+
+//
+// trace loading
+//
+
+bool LoadTrace(const char* path, std::vector<unsigned char>& data_ret)
+{
+    FILE* f = std::fopen(path, "rb");
+    if (!f) {
+        std::fprintf(stderr, "*** Can't open %s\n", path);
+        return false;
+    }
+    std::fseek(f, 0, SEEK_END);
+    long size = std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+
+    data_ret.resize(size > 0 ? size : 0);
+    bool ok = size > 0 && std::fread(&data_ret[0], 1, size, f) == (size_t)size;
+    std::fclose(f);
+
+    if (!ok) {
+        std::fprintf(stderr, "*** Can't read %s\n", path);
+    }
+    return ok;
+}
+
+bool IsDraw(uint16_t op)
+{
+    return op == GL_TRACE_DrawArrays || op == GL_TRACE_DrawArraysInstanced || op == GL_TRACE_DrawElements ||
+           op == GL_TRACE_DrawElementsBaseVertex || op == GL_TRACE_DrawElementsInstancedBaseVertex ||
+           op == GL_TRACE_MultiDrawElementsIndirect;
+}
+
+bool DecodeTrace(const std::vector<unsigned char>& data, std::vector<Call>& calls_ret, std::vector<Frame>& frames_ret)
+{
+    const size_t headerSize = sizeof(GL_TRACE_MAGIC) + 8;
+    if (data.size() < headerSize || std::memcmp(&data[0], GL_TRACE_MAGIC, sizeof(GL_TRACE_MAGIC)) != 0) {
+        std::fprintf(stderr, "*** Not a glsh GL trace\n");
+        return false;
+    }
+    uint32_t version;
+    std::memcpy(&version, &data[sizeof(GL_TRACE_MAGIC)], 4);
+    if (version != GL_TRACE_VERSION) {
+        std::fprintf(stderr, "*** Unsupported trace version %u\n", version);
+        return false;
+    }
+
+    const unsigned char* p = &data[headerSize];
+    const unsigned char* end = &data[0] + data.size();
+
+    Frame frame = { 0, 0, 0 };
+
+    while (p < end) {
+        Call c;
+        std::memset(&c, 0, sizeof(c));
+
+        if (end - p < 2) {
+            break;
+        }
+        std::memcpy(&c.op, p, 2);
+        p += 2;
+        if (c.op >= GL_TRACE_NUM_OPS) {
+            std::fprintf(stderr, "*** Bad op %u at offset %ld\n", c.op, (long)(p - &data[0]) - 2);
+            return false;
+        }
+
+        int n = 0;
+        for (const char* s = GL_TRACE_SIGNATURES[c.op]; *s; s++) {
+            if (*s == 'u') {
+                uint32_t v;
+                if (end - p < 4) return false;
+                std::memcpy(&v, p, 4);
+                p += 4;
+                c.a[n++] = v;
+            } else if (*s == 'q') {
+                if (end - p < 8) return false;
+                std::memcpy(&c.a[n++], p, 8);
+                p += 8;
+            } else if (*s == 'b') {
+                if (end - p < 4) return false;
+                std::memcpy(&c.blobSize, p, 4);
+                p += 4;
+                if ((size_t)(end - p) < c.blobSize) return false;
+                c.blob = c.blobSize ? p : NULL;
+                p += c.blobSize;
+            }
+        }
+
+        if (c.op == GL_TRACE_FrameEnd) {
+            frame.count = calls_ret.size() - frame.first;
+            frames_ret.push_back(frame);
+            frame.first = calls_ret.size();
+            frame.draws = 0;
+        } else {
+            if (IsDraw(c.op)) {
+                frame.draws++;
+            }
+            calls_ret.push_back(c);
+        }
+    }
+
+    // calls after the last swap (a trace stopped early)
+    if (calls_ret.size() > frame.first) {
+        frame.count = calls_ret.size() - frame.first;
+        frames_ret.push_back(frame);
+    }
+    return true;
+}
+
+//
+// replay state: the trace's object names mapped to ours
+//
+
+typedef std::unordered_map<uint32_t, GLuint> NameMap;
+
+NameMap                                 gTextures, gSamplers, gBuffers, gVertexArrays, gShaders, gPrograms, gFramebuffers;
+std::unordered_map<uint64_t, GLsync>    gSyncs;
+std::unordered_map<uint64_t, GLint>     gLocations;         // (our program << 32 | trace location) -> ours
+std::unordered_map<GLenum, GLuint>      gBoundBuffers;
+std::unordered_map<GLuint, unsigned char*> gMappings;
+GLuint                                  gCurrentProgram = 0;
+GLuint                                  gDefaultFramebuffer = 0;
+
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC    pglMaxShaderCompilerThreadsKHR = NULL;
+
+GLuint Map(const NameMap& m, uint64_t name)
+{
+    NameMap::const_iterator it = m.find((uint32_t)name);
+    return it != m.end() ? it->second : (GLuint)name;
+}
+
+GLint MapLocation(uint64_t location)
+{
+    if ((GLint)location < 0) {
+        return -1;
+    }
+    std::unordered_map<uint64_t, GLint>::const_iterator it = gLocations.find(((uint64_t)gCurrentProgram << 32) | (uint32_t)location);
+    return it != gLocations.end() ? it->second : -1;
+}
+
+void GenNames(const Call& c, NameMap& m, void (*gen)(GLsizei, GLuint*))
+{
+    GLsizei n = (GLsizei)c.a[0];
+    std::vector<GLuint> ours(n > 0 ? n : 0);
+    if (n > 0) {
+        gen(n, &ours[0]);
+    }
+    for (GLsizei i = 0; i < n && (i + 1) * 4 <= (GLsizei)c.blobSize; i++) {
+        uint32_t theirs;
+        std::memcpy(&theirs, c.blob + i * 4, 4);
+        m[theirs] = ours[i];
+    }
+}
+
+void DeleteNames(const Call& c, NameMap& m, void (*del)(GLsizei, const GLuint*))
+{
+    std::vector<GLuint> ours;
+    for (uint32_t i = 0; i + 4 <= c.blobSize; i += 4) {
+        uint32_t theirs;
+        std::memcpy(&theirs, c.blob + i, 4);
+        NameMap::iterator it = m.find(theirs);
+        if (it != m.end()) {
+            ours.push_back(it->second);
+            m.erase(it);
+        }
+    }
+    if (!ours.empty()) {
+        del((GLsizei)ours.size(), &ours[0]);
+    }
+}
+
+// glGen* entry points differ in calling convention on some platforms, so wrap them
+void GenTextures(GLsizei n, GLuint* names)                      { glGenTextures(n, names); }
+void GenBuffers(GLsizei n, GLuint* names)                       { glGenBuffers(n, names); }
+void GenVertexArrays(GLsizei n, GLuint* names)                  { glGenVertexArrays(n, names); }
+void GenSamplers(GLsizei n, GLuint* names)                      { glGenSamplers(n, names); }
+void GenFramebuffers(GLsizei n, GLuint* names)                  { glGenFramebuffers(n, names); }
+void DeleteTextures(GLsizei n, const GLuint* names)             { glDeleteTextures(n, names); }
+void DeleteBuffers(GLsizei n, const GLuint* names)              { glDeleteBuffers(n, names); }
+void DeleteVertexArrays(GLsizei n, const GLuint* names)         { glDeleteVertexArrays(n, names); }
+void DeleteSamplers(GLsizei n, const GLuint* names)             { glDeleteSamplers(n, names); }
+void DeleteFramebuffers(GLsizei n, const GLuint* names)         { glDeleteFramebuffers(n, names); }
+
+float F(uint64_t bits)
+{
+    uint32_t u = (uint32_t)bits;
+    float f;
+    std::memcpy(&f, &u, 4);
+    return f;
+}
+
+const void* Offset(uint64_t offset)
+{
+    return (const void*)(uintptr_t)offset;
+}
+
+void Execute(const Call& c)
+{
+    const uint64_t* a = c.a;
+
+    switch (c.op) {
+    case GL_TRACE_MappedWrite: {
+        std::unordered_map<GLuint, unsigned char*>::iterator it = gMappings.find(gBoundBuffers[(GLenum)a[0]]);
+        if (it != gMappings.end() && c.blob) {
+            std::memcpy(it->second + a[1], c.blob, c.blobSize);
+        }
+        break;
+    }
+    case GL_TRACE_Enable:                   glEnable((GLenum)a[0]); break;
+    case GL_TRACE_Disable:                  glDisable((GLenum)a[0]); break;
+    case GL_TRACE_BlendFunc:                glBlendFunc((GLenum)a[0], (GLenum)a[1]); break;
+    case GL_TRACE_Viewport:                 glViewport((GLint)a[0], (GLint)a[1], (GLsizei)a[2], (GLsizei)a[3]); break;
+    case GL_TRACE_ClearColor:               glClearColor(F(a[0]), F(a[1]), F(a[2]), F(a[3])); break;
+    case GL_TRACE_Clear:                    glClear((GLbitfield)a[0]); break;
+    case GL_TRACE_Hint:                     glHint((GLenum)a[0], (GLenum)a[1]); break;
+    case GL_TRACE_PixelStorei:              glPixelStorei((GLenum)a[0], (GLint)a[1]); break;
+    case GL_TRACE_GetError:                 glGetError(); break;
+    case GL_TRACE_GetIntegerv: {
+        GLint values[16];
+        glGetIntegerv((GLenum)a[0], values);
+        break;
+    }
+
+    case GL_TRACE_GenTextures:              GenNames(c, gTextures, GenTextures); break;
+    case GL_TRACE_DeleteTextures:           DeleteNames(c, gTextures, DeleteTextures); break;
+    case GL_TRACE_BindTexture:              glBindTexture((GLenum)a[0], Map(gTextures, a[1])); break;
+    case GL_TRACE_TexParameteri:            glTexParameteri((GLenum)a[0], (GLenum)a[1], (GLint)a[2]); break;
+    case GL_TRACE_TexImage2D:
+        glTexImage2D((GLenum)a[0], (GLint)a[1], (GLint)a[2], (GLsizei)a[3], (GLsizei)a[4], (GLint)a[5],
+                     (GLenum)a[6], (GLenum)a[7], c.blob);
+        break;
+    case GL_TRACE_TexImage3D:
+        glTexImage3D((GLenum)a[0], (GLint)a[1], (GLint)a[2], (GLsizei)a[3], (GLsizei)a[4], (GLsizei)a[5], (GLint)a[6],
+                     (GLenum)a[7], (GLenum)a[8], c.blob);
+        break;
+    case GL_TRACE_CompressedTexImage2D:
+        glCompressedTexImage2D((GLenum)a[0], (GLint)a[1], (GLenum)a[2], (GLsizei)a[3], (GLsizei)a[4], (GLint)a[5],
+                               (GLsizei)c.blobSize, c.blob);
+        break;
+    case GL_TRACE_CompressedTexImage3D:
+        glCompressedTexImage3D((GLenum)a[0], (GLint)a[1], (GLenum)a[2], (GLsizei)a[3], (GLsizei)a[4], (GLsizei)a[5], (GLint)a[6],
+                               (GLsizei)c.blobSize, c.blob);
+        break;
+    case GL_TRACE_GenerateMipmap:           glGenerateMipmap((GLenum)a[0]); break;
+    case GL_TRACE_GenSamplers:              GenNames(c, gSamplers, GenSamplers); break;
+    case GL_TRACE_DeleteSamplers:           DeleteNames(c, gSamplers, DeleteSamplers); break;
+    case GL_TRACE_BindSampler:              glBindSampler((GLuint)a[0], Map(gSamplers, a[1])); break;
+    case GL_TRACE_SamplerParameteri:        glSamplerParameteri(Map(gSamplers, a[0]), (GLenum)a[1], (GLint)a[2]); break;
+    case GL_TRACE_SamplerParameterf:        glSamplerParameterf(Map(gSamplers, a[0]), (GLenum)a[1], F(a[2])); break;
+
+    case GL_TRACE_GenBuffers:               GenNames(c, gBuffers, GenBuffers); break;
+    case GL_TRACE_DeleteBuffers: {
+        for (uint32_t i = 0; i + 4 <= c.blobSize; i += 4) {
+            uint32_t theirs;
+            std::memcpy(&theirs, c.blob + i, 4);
+            gMappings.erase(Map(gBuffers, theirs));
+        }
+        DeleteNames(c, gBuffers, DeleteBuffers);
+        break;
+    }
+    case GL_TRACE_BindBuffer: {
+        GLuint buffer = Map(gBuffers, a[1]);
+        gBoundBuffers[(GLenum)a[0]] = buffer;
+        glBindBuffer((GLenum)a[0], buffer);
+        break;
+    }
+    case GL_TRACE_BufferData:               glBufferData((GLenum)a[0], (GLsizeiptr)a[1], c.blob, (GLenum)a[2]); break;
+    case GL_TRACE_BufferSubData:            glBufferSubData((GLenum)a[0], (GLintptr)a[1], c.blobSize, c.blob); break;
+    case GL_TRACE_BufferStorage:            glBufferStorage((GLenum)a[0], (GLsizeiptr)a[1], c.blob, (GLbitfield)a[2]); break;
+    case GL_TRACE_MapBufferRange: {
+        void* ptr = glMapBufferRange((GLenum)a[0], (GLintptr)a[1], (GLsizeiptr)a[2], (GLbitfield)a[3]);
+        if (ptr) {
+            // writes are recorded relative to the start of the mapping
+            gMappings[gBoundBuffers[(GLenum)a[0]]] = (unsigned char*)ptr;
+        }
+        break;
+    }
+    case GL_TRACE_UnmapBuffer:
+        gMappings.erase(gBoundBuffers[(GLenum)a[0]]);
+        glUnmapBuffer((GLenum)a[0]);
+        break;
+    case GL_TRACE_CopyBufferSubData:
+        glCopyBufferSubData((GLenum)a[0], (GLenum)a[1], (GLintptr)a[2], (GLintptr)a[3], (GLsizeiptr)a[4]);
+        break;
+
+    case GL_TRACE_GenVertexArrays:          GenNames(c, gVertexArrays, GenVertexArrays); break;
+    case GL_TRACE_DeleteVertexArrays:       DeleteNames(c, gVertexArrays, DeleteVertexArrays); break;
+    case GL_TRACE_BindVertexArray:          glBindVertexArray(Map(gVertexArrays, a[0])); break;
+    case GL_TRACE_VertexAttribPointer:
+        if (!a[6]) {    // client memory wasn't captured
+            glVertexAttribPointer((GLuint)a[0], (GLint)a[1], (GLenum)a[2], (GLboolean)a[3], (GLsizei)a[4], Offset(a[5]));
+        }
+        break;
+    case GL_TRACE_EnableVertexAttribArray:  glEnableVertexAttribArray((GLuint)a[0]); break;
+    case GL_TRACE_DisableVertexAttribArray: glDisableVertexAttribArray((GLuint)a[0]); break;
+    case GL_TRACE_VertexAttribDivisor:      glVertexAttribDivisor((GLuint)a[0], (GLuint)a[1]); break;
+
+    case GL_TRACE_CreateShader:             gShaders[(uint32_t)a[1]] = glCreateShader((GLenum)a[0]); break;
+    case GL_TRACE_ShaderSource: {
+        const GLchar* src = c.blob ? (const GLchar*)c.blob : "";
+        GLint len = (GLint)c.blobSize;
+        glShaderSource(Map(gShaders, a[0]), 1, &src, &len);
+        break;
+    }
+    case GL_TRACE_CompileShader:            glCompileShader(Map(gShaders, a[0])); break;
+    case GL_TRACE_DeleteShader:             glDeleteShader(Map(gShaders, a[0])); gShaders.erase((uint32_t)a[0]); break;
+    case GL_TRACE_CreateProgram:            gPrograms[(uint32_t)a[0]] = glCreateProgram(); break;
+    case GL_TRACE_AttachShader:             glAttachShader(Map(gPrograms, a[0]), Map(gShaders, a[1])); break;
+    case GL_TRACE_LinkProgram:              glLinkProgram(Map(gPrograms, a[0])); break;
+    case GL_TRACE_DeleteProgram:            glDeleteProgram(Map(gPrograms, a[0])); gPrograms.erase((uint32_t)a[0]); break;
+    case GL_TRACE_ProgramParameteri:        glProgramParameteri(Map(gPrograms, a[0]), (GLenum)a[1], (GLint)a[2]); break;
+    case GL_TRACE_ProgramBinary:            glProgramBinary(Map(gPrograms, a[0]), (GLenum)a[1], c.blob, (GLsizei)c.blobSize); break;
+    case GL_TRACE_UseProgram:
+        gCurrentProgram = Map(gPrograms, a[0]);
+        glUseProgram(gCurrentProgram);
+        break;
+    case GL_TRACE_GetUniformLocation: {
+        GLuint program = Map(gPrograms, a[0]);
+        std::string name(c.blob ? (const char*)c.blob : "", c.blobSize);
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if ((GLint)a[1] >= 0) {
+            gLocations[((uint64_t)program << 32) | (uint32_t)a[1]] = location;
+        }
+        break;
+    }
+    case GL_TRACE_Uniform1f:                glUniform1f(MapLocation(a[0]), F(a[1])); break;
+    case GL_TRACE_Uniform1i:                glUniform1i(MapLocation(a[0]), (GLint)a[1]); break;
+    case GL_TRACE_Uniform2fv:               glUniform2fv(MapLocation(a[0]), (GLsizei)a[1], (const GLfloat*)c.blob); break;
+    case GL_TRACE_Uniform3fv:               glUniform3fv(MapLocation(a[0]), (GLsizei)a[1], (const GLfloat*)c.blob); break;
+    case GL_TRACE_Uniform4fv:               glUniform4fv(MapLocation(a[0]), (GLsizei)a[1], (const GLfloat*)c.blob); break;
+    case GL_TRACE_UniformMatrix3fv:         glUniformMatrix3fv(MapLocation(a[0]), (GLsizei)a[1], (GLboolean)a[2], (const GLfloat*)c.blob); break;
+    case GL_TRACE_UniformMatrix4fv:         glUniformMatrix4fv(MapLocation(a[0]), (GLsizei)a[1], (GLboolean)a[2], (const GLfloat*)c.blob); break;
+
+    case GL_TRACE_GenFramebuffers:          GenNames(c, gFramebuffers, GenFramebuffers); break;
+    case GL_TRACE_DeleteFramebuffers:       DeleteNames(c, gFramebuffers, DeleteFramebuffers); break;
+    case GL_TRACE_BindFramebuffer:
+        glBindFramebuffer((GLenum)a[0], a[1] ? Map(gFramebuffers, a[1]) : gDefaultFramebuffer);
+        break;
+    case GL_TRACE_FramebufferTexture2D:
+        glFramebufferTexture2D((GLenum)a[0], (GLenum)a[1], (GLenum)a[2], Map(gTextures, a[3]), (GLint)a[4]);
+        break;
+
+    case GL_TRACE_FenceSync:                gSyncs[a[2]] = glFenceSync((GLenum)a[0], (GLbitfield)a[1]); break;
+    case GL_TRACE_ClientWaitSync: {
+        std::unordered_map<uint64_t, GLsync>::iterator it = gSyncs.find(a[0]);
+        if (it != gSyncs.end()) {
+            glClientWaitSync(it->second, (GLbitfield)a[1], a[2]);
+        }
+        break;
+    }
+    case GL_TRACE_DeleteSync: {
+        std::unordered_map<uint64_t, GLsync>::iterator it = gSyncs.find(a[0]);
+        if (it != gSyncs.end()) {
+            glDeleteSync(it->second);
+            gSyncs.erase(it);
+        }
+        break;
+    }
+
+    case GL_TRACE_DrawArrays:               glDrawArrays((GLenum)a[0], (GLint)a[1], (GLsizei)a[2]); break;
+    case GL_TRACE_DrawArraysInstanced:      glDrawArraysInstanced((GLenum)a[0], (GLint)a[1], (GLsizei)a[2], (GLsizei)a[3]); break;
+    case GL_TRACE_DrawElements:             glDrawElements((GLenum)a[0], (GLsizei)a[1], (GLenum)a[2], Offset(a[3])); break;
+    case GL_TRACE_DrawElementsBaseVertex:
+        glDrawElementsBaseVertex((GLenum)a[0], (GLsizei)a[1], (GLenum)a[2], Offset(a[3]), (GLint)a[4]);
+        break;
+    case GL_TRACE_DrawElementsInstancedBaseVertex:
+        glDrawElementsInstancedBaseVertex((GLenum)a[0], (GLsizei)a[1], (GLenum)a[2], Offset(a[3]), (GLsizei)a[4], (GLint)a[5]);
+        break;
+    case GL_TRACE_MultiDrawElementsIndirect:
+        glMultiDrawElementsIndirect((GLenum)a[0], (GLenum)a[1], Offset(a[2]), (GLsizei)a[3], (GLsizei)a[4]);
+        break;
+    case GL_TRACE_MaxShaderCompilerThreadsKHR:
+        if (pglMaxShaderCompilerThreadsKHR) {
+            pglMaxShaderCompilerThreadsKHR((GLuint)a[0]);
+        }
+        break;
+    }
+}
+
+//
+// offscreen context
+//
+
+bool CreateContext()
+{
+    if (!CreateOffscreenContext()) {
+        return false;
+    }
+
+    pglMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    return true;
+}
+
+// stands in for the window's framebuffer
+void CreateDefaultFramebuffer(GLsizei width, GLsizei height)
+{
+    GLuint rb[2];
+    glGenRenderbuffers(2, rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, rb[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, rb[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &gDefaultFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, gDefaultFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rb[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::fprintf(stderr, "*** Offscreen framebuffer is incomplete\n");
+    }
+}
+
+double Percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+} // end of anonymous namespace
+
+
+int main(int argc, char* argv[])
+{
+    const char* tracePath = NULL;
+    const char* csvPath = NULL;
+    int repeat = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (!tracePath && argv[i][0] != '-') {
+            tracePath = argv[i];
+        } else {
+            tracePath = NULL;
+            break;
+        }
+    }
+    if (!tracePath) {
+        std::fprintf(stderr, "usage: %s <trace> [--csv <file>] [--repeat <n>]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<unsigned char> data;
+    std::vector<Call> calls;
+    std::vector<Frame> frames;
+    if (!LoadTrace(tracePath, data) || !DecodeTrace(data, calls, frames) || frames.empty()) {
+        return 1;
+    }
+
+    if (!CreateContext()) {
+        return 1;
+    }
+
+    GLsizei width = 800, height = 600;
+    for (size_t i = 0; i < calls.size(); i++) {
+        if (calls[i].op == GL_TRACE_Viewport && calls[i].a[2] && calls[i].a[3]) {
+            width = (GLsizei)calls[i].a[2];
+            height = (GLsizei)calls[i].a[3];
+            break;
+        }
+    }
+    CreateDefaultFramebuffer(width, height);
+
+    std::printf("renderer: %s | %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+    std::printf("trace: %s, %.1f MB, %zu calls in %zu frames, %dx%d\n",
+                tracePath, data.size() / (1024.0 * 1024.0), calls.size(), frames.size(), width, height);
+
+    FILE* csv = NULL;
+    if (csvPath) {
+        csv = std::fopen(csvPath, "w");
+        if (!csv) {
+            std::fprintf(stderr, "*** Can't open %s for writing\n", csvPath);
+            return 1;
+        }
+        std::fprintf(csv, "pass,frame,calls,draws,submit_ms,finish_ms\n");
+    }
+
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<double> submitMs, finishMs;
+    unsigned numErrors = 0;
+
+    // the first frame creates everything; later passes only repeat the frames after it
+    for (int pass = 0; pass < repeat; pass++) {
+        for (size_t f = pass ? 1 : 0; f < frames.size(); f++) {
+            const Frame& frame = frames[f];
+
+            Clock::time_point t0 = Clock::now();
+            for (size_t i = frame.first; i < frame.first + frame.count; i++) {
+                Execute(calls[i]);
+            }
+            Clock::time_point t1 = Clock::now();
+            glFinish();
+            Clock::time_point t2 = Clock::now();
+
+            double submit = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            double finish = std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+            while (glGetError() != GL_NO_ERROR) {
+                numErrors++;
+            }
+
+            if (f > 0) {
+                submitMs.push_back(submit);
+                finishMs.push_back(finish);
+            } else {
+                std::printf("frame 0 (setup): %zu calls, %.3f ms submit, %.3f ms finish\n", frame.count, submit, finish);
+            }
+
+            if (csv) {
+                std::fprintf(csv, "%d,%zu,%zu,%u,%.4f,%.4f\n", pass, f, frame.count, frame.draws, submit, finish);
+            }
+        }
+    }
+
+    if (csv) {
+        std::fclose(csv);
+    }
+
+    if (!submitMs.empty()) {
+        double sum = 0.0, fsum = 0.0, maxMs = 0.0;
+        for (size_t i = 0; i < submitMs.size(); i++) {
+            sum += submitMs[i];
+            fsum += finishMs[i];
+            maxMs = std::max(maxMs, submitMs[i]);
+        }
+        size_t callsPerFrame = 0;
+        for (size_t f = 1; f < frames.size(); f++) {
+            callsPerFrame += frames[f].count;
+        }
+        callsPerFrame /= std::max<size_t>(frames.size() - 1, 1);
+
+        std::printf("frames 1-%zu x %d: %zu calls/frame, submit ms avg %.3f  p50 %.3f  p99 %.3f  max %.3f, finish ms avg %.3f\n",
+                    frames.size() - 1, repeat, callsPerFrame, sum / submitMs.size(),
+                    Percentile(submitMs, 0.5), Percentile(submitMs, 0.99), maxMs, fsum / finishMs.size());
+    }
+
+    std::printf("GL errors during replay: %u\n", numErrors);
+    return 0;
+}
@@ -0,0 +1,37 @@
+# Shared build of the tools that link the game sources (all but main.cpp) and glsh into one
+# executable (Linux), along with the offscreen context code in tools/common. A tool's Makefile
+# sets TOOL to the executable and TOOL_SRCS to its own sources, then includes this file.
+
+CXX      ?= g++
+CXXFLAGS ?= -O2 -DNDEBUG
+CXXFLAGS += -std=c++14 -Wall -MMD -MP
+CPPFLAGS += -I../.. -I../../glsh -I../common
+LDLIBS   += -lGLEW -lglut -lGLU -lEGL -lOpenGL -pthread
+
+GAME_SRCS := $(filter-out ../../main.cpp,$(wildcard ../../*.cpp))
+GLSH_SRCS := $(wildcard ../../glsh/*.cpp)
+CTX_SRCS  := ../common/OffscreenContext.cpp ../common/OffscreenContextGLEW.cpp
+OBJS      := $(patsubst ../../%.cpp,obj/%.o,$(GAME_SRCS) $(GLSH_SRCS)) $(patsubst ../%.cpp,obj/%.o,$(CTX_SRCS)) \
+             $(patsubst %.cpp,obj/%.o,$(TOOL_SRCS))
+
+$(TOOL): $(OBJS)
+	$(CXX) $(CXXFLAGS) -o $@ $(OBJS) $(LDFLAGS) $(LDLIBS)
+
+obj/%.o: %.cpp
+	@mkdir -p $(dir $@)
+	$(CXX) $(CPPFLAGS) $(CXXFLAGS) -c -o $@ $<
+
+obj/common/%.o: ../common/%.cpp
+	@mkdir -p $(dir $@)
+	$(CXX) $(CPPFLAGS) $(CXXFLAGS) -c -o $@ $<
+
+obj/%.o: ../../%.cpp
+	@mkdir -p $(dir $@)
+	$(CXX) $(CPPFLAGS) $(CXXFLAGS) -c -o $@ $<
+
+clean:
+	rm -rf obj $(TOOL)
+
+.PHONY: clean
+
+-include $(OBJS:.o=.d)
@@ -0,0 +1,407 @@
+//
+// Stress: runs the game simulation from an XML scenario file, headless and deterministic, and
+// reports how fast it ticks.
+//
+//     stress <scenario.xml> [--ticks <n>] [--json <file>]
+//     stress --replay <input.log> [--data <game dir>] [--json <file>]
+//
+// A scenario sets the window and world size, the asteroid field and spawn rate, the enemy ships,
+// the missile speed and what the player holds down, plus a random seed, a tick rate and how many
+// seconds of game time to run (see scenarios/). Every tick is one Game::update with a fixed time
+// step, so the same scenario gives the same game on every run; the final counts and score are
+// printed to compare runs with.
+//
+// Reported: ticks per second of wall time, mean, median, p99 and max tick time, the peak of the
+// heap tracked by GLSH_Memory (game and glsh allocations) and the peak resident set size. Setting
+// up the field isn't timed, but it counts towards the memory peaks.
+//
+// Missing elements and attributes keep the game's own values (SimulationSettings):
+//
+//     <scenario name="..." seed="1" duration="30" tickRate="60">
+//         <world width="800" height="600" size="10"/>
+//         <asteroids initial="3" spawnRate="0"/>
+//         <enemies max="1" interval="10"/>
+//         <projectiles speed="5"/>
+//         <player invulnerable="false" fire="false" fireRate="0.5" turn="none|left|right" thrust="none|forward|back"/>
+//     </scenario>
+//
+// --replay runs an input log recorded by the game (--record-input, see GLSH_InputLog.h) instead,
+// with its window size, time steps and seeds, until the log ends, and fails if the game's state
+// differs from the recording's on any tick. So a session that went wrong can be run again here,
+// under a profiler or in CI. The menu buttons are hit-tested against their text, so the font is
+// loaded from the game directory (--data, by default ../..) into an offscreen GL context from EGL
+// on the surfaceless platform; nothing else is drawn.
+//
+
+#include "Game.h"
+#include "OffscreenContext.h"
+#include "tinyxml2.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+struct Scenario {
+    std::string         name;
+    unsigned            seed;
+    float               duration;       // seconds of game time
+    float               tickRate;
+    int                 width, height;  // window pixels
+    SimulationSettings  settings;
+    bool                invulnerable;
+    std::vector<glsh::KeyCode> keys;    // held down from the first tick
+};
+
+struct Report {
+    int                 ticks;
+    float               gameSeconds;
+    double              wallSeconds;
+    double              meanMs;
+    double              medianMs;
+    double              p99Ms;
+    double              maxMs;
+    size_t              peakHeapBytes;
+    long                peakRSSKB;
+    int                 peakAsteroids;
+    PerfEntityCounts    final;
+    int                 score;
+    int                 lives;
+    unsigned            mismatches;     // replays: ticks whose state differed from the recording
+};
+
+bool ParseKey(const char* value, const char* a, glsh::KeyCode ka, const char* b, glsh::KeyCode kb, std::vector<glsh::KeyCode>& keys)
+{
+    if (!value || std::strcmp(value, "none") == 0) {
+        return true;
+    } else if (std::strcmp(value, a) == 0) {
+        keys.push_back(ka);
+        return true;
+    } else if (std::strcmp(value, b) == 0) {
+        keys.push_back(kb);
+        return true;
+    }
+    return false;
+}
+
+bool LoadScenario(const char* path, Scenario& s)
+{
+    using namespace tinyxml2;
+
+    XMLDocument doc;
+    if (doc.LoadFile(path) != XML_NO_ERROR) {
+        std::cerr << "*** Can't load scenario " << path << std::endl;
+        return false;
+    }
+
+    XMLElement* root = doc.FirstChildElement("scenario");
+    if (!root) {
+        std::cerr << "*** " << path << " has no <scenario> element" << std::endl;
+        return false;
+    }
+
+    const char* name = root->Attribute("name");
+    s.name = name ? name : path;
+    s.seed = 1;
+    s.duration = 30.0f;
+    s.tickRate = 60.0f;
+    root->QueryUnsignedAttribute("seed", &s.seed);
+    root->QueryFloatAttribute("duration", &s.duration);
+    root->QueryFloatAttribute("tickRate", &s.tickRate);
+
+    s.width = 800;
+    s.height = 600;
+    if (XMLElement* e = root->FirstChildElement("world")) {
+        e->QueryIntAttribute("width", &s.width);
+        e->QueryIntAttribute("height", &s.height);
+        e->QueryFloatAttribute("size", &s.settings.worldSize);
+    }
+
+    if (XMLElement* e = root->FirstChildElement("asteroids")) {
+        e->QueryIntAttribute("initial", &s.settings.asteroids);
+        e->QueryFloatAttribute("spawnRate", &s.settings.asteroidSpawnRate);
+    }
+
+    if (XMLElement* e = root->FirstChildElement("enemies")) {
+        e->QueryIntAttribute("max", &s.settings.maxEnemies);
+        e->QueryFloatAttribute("interval", &s.settings.enemyInterval);
+    }
+
+    if (XMLElement* e = root->FirstChildElement("projectiles")) {
+        e->QueryFloatAttribute("speed", &s.settings.missileSpeed);
+    }
+
+    s.invulnerable = false;
+    if (XMLElement* e = root->FirstChildElement("player")) {
+        e->QueryBoolAttribute("invulnerable", &s.invulnerable);
+        e->QueryFloatAttribute("fireRate", &s.settings.fireRate);
+
+        bool fire = false;
+        e->QueryBoolAttribute("fire", &fire);
+        if (fire) {
+            s.keys.push_back(glsh::KC_SPACE);
+        }
+        if (!ParseKey(e->Attribute("turn"), "left", glsh::KC_LEFT, "right", glsh::KC_RIGHT, s.keys)) {
+            std::cerr << "*** " << path << ": turn is none, left or right" << std::endl;
+            return false;
+        }
+        if (!ParseKey(e->Attribute("thrust"), "forward", glsh::KC_UP, "back", glsh::KC_DOWN, s.keys)) {
+            std::cerr << "*** " << path << ": thrust is none, forward or back" << std::endl;
+            return false;
+        }
+    }
+
+    if (s.duration <= 0.0f || s.tickRate <= 0.0f || s.width <= 0 || s.height <= 0 || s.settings.asteroids < 0) {
+        std::cerr << "*** " << path << ": duration, tickRate and the world size must be positive" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+long PeakRSSKB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;     // kilobytes on Linux
+}
+
+// steps the game maxTicks times, or until it quits if maxTicks is 0; false if it quit
+bool RunTicks(Game* game, glsh::Window* wnd, float dt, int maxTicks, Report& r)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<double> tickMs;
+    tickMs.reserve(maxTicks > 0 ? maxTicks : 4096);
+    r.peakAsteroids = 0;
+
+    const Clock::time_point start = Clock::now();
+    bool running = true;
+    while (running && (maxTicks <= 0 || (int)tickMs.size() < maxTicks)) {
+        Clock::time_point before = Clock::now();
+        running = glsh::System::StepHeadless(wnd, dt);
+        if (running) {
+            tickMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - before).count());
+        }
+
+        glsh::EndMemoryFrame();
+        r.peakAsteroids = std::max(r.peakAsteroids, game->GetAsteroidCount());
+    }
+    r.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    r.ticks = (int)tickMs.size();
+    r.gameSeconds = wnd->getTime();
+    r.final = game->GetEntityCounts();
+    r.score = game->currentScore;
+    r.lives = game->currentLives;
+    r.peakHeapBytes = glsh::GetLastFrameMemoryStats().peakHeapBytes;
+    r.peakRSSKB = PeakRSSKB();
+    r.mismatches = 0;
+
+    double total = 0.0;
+    for (size_t i = 0; i < tickMs.size(); i++) {
+        total += tickMs[i];
+    }
+    std::sort(tickMs.begin(), tickMs.end());
+    r.meanMs = r.ticks ? total / r.ticks : 0.0;
+    r.medianMs = r.ticks ? tickMs[r.ticks / 2] : 0.0;
+    r.p99Ms = r.ticks ? tickMs[std::min(r.ticks - 1, (int)(r.ticks * 0.99))] : 0.0;
+    r.maxMs = r.ticks ? tickMs.back() : 0.0;
+
+    return running;
+}
+
+bool Run(const Scenario& s, int ticks, Report& r)
+{
+    // the only source of randomness in the game
+    glsh::InitRandom(s.seed);
+
+    Game* game = new Game();
+    glsh::Window* wnd = glsh::System::CreateHeadlessWindow(*game, s.width, s.height);
+    game->SetSimulationSettings(s.settings);
+    game->InitializeHeadless(s.width, s.height);
+    game->SetPlayerInvulnerable(s.invulnerable);
+    game->StartGame();
+
+    for (size_t i = 0; i < s.keys.size(); i++) {
+        glsh::InputEvent e;
+        e.type = glsh::KEY_DOWN_EVENT;
+        e.ke.key = s.keys[i];
+        glsh::System::PostHeadlessEvent(wnd, e);
+    }
+
+    bool running = RunTicks(game, wnd, 1.0f / s.tickRate, ticks, r);
+
+    glsh::System::DestroyHeadlessWindow(wnd);
+    delete game;
+
+    if (!running) {
+        std::cerr << "*** The game stopped after " << r.ticks << " of " << ticks << " ticks" << std::endl;
+    }
+    return running;
+}
+
+bool Replay(const char* path, const char* dataDir, Report& r)
+{
+    // seeds the random numbers for what the game's initialization randomizes
+    if (!glsh::StartInputReplay(path)) {
+        return false;
+    }
+    const int width = glsh::GetInputReplayWidth();
+    const int height = glsh::GetInputReplayHeight();
+
+    Game* game = new Game();
+    glsh::Window* wnd = glsh::System::CreateHeadlessWindow(*game, width, height);
+    game->InitializeHeadless(width, height);
+
+    // the menu buttons are hit-tested against their text, which is measured with the font
+    char cwd[4096];
+    bool haveUI = CreateOffscreenGLEWContext() && getcwd(cwd, sizeof(cwd)) && chdir(dataDir) == 0;
+    if (haveUI) {
+        haveUI = game->LoadHeadlessUI();
+        if (chdir(cwd) != 0) {
+            std::cerr << "*** Can't return to " << cwd << std::endl;
+        }
+    }
+    if (!haveUI) {
+        std::cerr << "*** No offscreen GL context or no font in " << dataDir << "; clicks on the menu won't land" << std::endl;
+    }
+
+    // the time steps come from the log
+    RunTicks(game, wnd, 1.0f / 60.0f, 0, r);
+    r.mismatches = glsh::GetInputReplayMismatches();
+
+    glsh::System::DestroyHeadlessWindow(wnd);
+    delete game;
+
+    return r.mismatches == 0;
+}
+
+void PrintReport(const std::string& name, const Report& r, bool replay)
+{
+    std::fprintf(stderr, "%s: %d ticks (%.1f s of game time) in %.2f s\n", name.c_str(), r.ticks, r.gameSeconds, r.wallSeconds);
+    std::fprintf(stderr, "  ticks/sec    %.1f\n", r.wallSeconds > 0.0 ? r.ticks / r.wallSeconds : 0.0);
+    std::fprintf(stderr, "  tick ms      mean %.3f  median %.3f  p99 %.3f  max %.3f\n", r.meanMs, r.medianMs, r.p99Ms, r.maxMs);
+    std::fprintf(stderr, "  peak memory  heap %.1f MB  rss %.1f MB\n", r.peakHeapBytes / (1024.0 * 1024.0), r.peakRSSKB / 1024.0);
+    std::fprintf(stderr, "  entities     %d asteroids (peak %d), %d missiles, %d enemy missiles\n",
+                 r.final.asteroids, r.peakAsteroids, r.final.missiles, r.final.enemyMissiles);
+    std::fprintf(stderr, "  game         score %d, lives %d\n", r.score, r.lives);
+    if (replay) {
+        if (r.mismatches) {
+            std::fprintf(stderr, "  replay       differed from the recording in %u ticks\n", r.mismatches);
+        } else {
+            std::fprintf(stderr, "  replay       matched the recording\n");
+        }
+    }
+}
+
+// s is NULL for replays
+void WriteJSON(FILE* f, const std::string& name, const Scenario* s, const Report& r)
+{
+    // scenario names come from the file; keep them valid JSON
+    std::string safe;
+    for (size_t i = 0; i < name.size(); i++) {
+        char c = name[i];
+        safe += (c == '"' || c == '\\' || (unsigned char)c < 0x20) ? '_' : c;
+    }
+
+    if (s) {
+        std::fprintf(f, "{\n  \"scenario\": \"%s\",\n  \"seed\": %u,\n  \"tick_rate\": %g,\n", safe.c_str(), s->seed, s->tickRate);
+    } else {
+        std::fprintf(f, "{\n  \"replay\": \"%s\",\n  \"mismatched_ticks\": %u,\n", safe.c_str(), r.mismatches);
+    }
+    std::fprintf(f, "  \"ticks\": %d,\n  \"game_s\": %.3f,\n  \"wall_s\": %.3f,\n"
+                    "  \"ticks_per_s\": %.1f,\n  \"mean_ms\": %.4f,\n  \"median_ms\": %.4f,\n  \"p99_ms\": %.4f,\n  \"max_ms\": %.4f,\n"
+                    "  \"peak_heap_bytes\": %llu,\n  \"peak_rss_kb\": %ld,\n  \"peak_asteroids\": %d,\n"
+                    "  \"final\": { \"asteroids\": %d, \"missiles\": %d, \"enemy_missiles\": %d, \"score\": %d, \"lives\": %d }\n}\n",
+                 r.ticks, r.gameSeconds, r.wallSeconds,
+                 r.wallSeconds > 0.0 ? r.ticks / r.wallSeconds : 0.0, r.meanMs, r.medianMs, r.p99Ms, r.maxMs,
+                 (unsigned long long)r.peakHeapBytes, r.peakRSSKB, r.peakAsteroids,
+                 r.final.asteroids, r.final.missiles, r.final.enemyMissiles, r.score, r.lives);
+}
+
+void PrintUsage()
+{
+    std::fprintf(stderr, "usage: stress <scenario.xml> [--ticks <n>] [--json <file>]\n"
+                         "       stress --replay <input.log> [--data <game dir>] [--json <file>]\n");
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    const char* scenarioPath = NULL;
+    const char* replayPath = NULL;
+    const char* dataDir = "../..";
+    const char* jsonPath = NULL;
+    int ticks = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            dataDir = argv[++i];
+        } else if (argv[i][0] != '-' && !scenarioPath) {
+            scenarioPath = argv[i];
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (!scenarioPath == !replayPath) {
+        PrintUsage();
+        return 1;
+    }
+
+    Scenario scenario;
+    if (scenarioPath) {
+        if (!LoadScenario(scenarioPath, scenario)) {
+            return 1;
+        }
+        if (ticks <= 0) {
+            ticks = (int)(scenario.duration * scenario.tickRate + 0.5f);
+        }
+    }
+
+    // the game reports on cout; the report goes to stderr and the JSON may go to stdout
+    std::cout.setstate(std::ios::badbit);
+
+    Report report;
+    bool ok;
+    std::string name;
+    if (scenarioPath) {
+        ok = Run(scenario, ticks, report);
+        name = scenario.name;
+    } else {
+        ok = Replay(replayPath, dataDir, report);
+        name = replayPath;
+    }
+    PrintReport(name, report, replayPath != NULL);
+
+    if (jsonPath) {
+        FILE* out = std::strcmp(jsonPath, "-") == 0 ? stdout : std::fopen(jsonPath, "w");
+        if (!out) {
+            std::fprintf(stderr, "*** Can't open %s for writing\n", jsonPath);
+            return 1;
+        }
+        WriteJSON(out, name, scenarioPath ? &scenario : NULL, report);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+//
+// TelemetryReader: samples the shared memory block of a game run with --telemetry
+// (see glsh/GLSH_Telemetry.h) and writes one CSV row per new frame seen.
+//
+//     telemetryreader [name] [--hz <rate>] [--seconds <n>] [--out <file>] [--wait]
+//
+// The name defaults to /assteroids, the rate to 10 samples a second and the output to stdout.
+// Samples that find the same frame as the previous one are dropped, so a rate above the frame
+// rate gets every frame once. The header is written again if the game changes its phases or
+// counters. The reader stops when the game closes the block, after --seconds, or on Ctrl+C;
+// --wait keeps trying until the game has created the block and written its header.
+//
+
+#include "GLSH_TelemetryFormat.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+using namespace glsh;
+
+namespace {
+
+volatile std::sig_atomic_t  gInterrupted = 0;
+
+void OnInterrupt(int)
+{
+    gInterrupted = 1;
+}
+
+const TelemetryBlock* OpenBlock(const char* name)
+{
+#ifdef _WIN32
+    std::string mappingName = std::string("Local\\") + (name[0] == '/' ? name + 1 : name);
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName.c_str());
+    if (!mapping) {
+        return NULL;
+    }
+    void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(TelemetryBlock));
+    CloseHandle(mapping);
+    return static_cast<const TelemetryBlock*>(p);
+#else
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    // the game sizes the object right after creating it; touching a page past the end would be SIGBUS
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TelemetryBlock)) {
+        close(fd);
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(TelemetryBlock), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : static_cast<const TelemetryBlock*>(p);
+#endif
+}
+
+void CloseBlock(const TelemetryBlock* block)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(block);
+#else
+    munmap(const_cast<TelemetryBlock*>(block), sizeof(TelemetryBlock));
+#endif
+}
+
+// the game writes the magic last, so until it's there the rest of the header may not be either
+bool HasHeader(const TelemetryBlock* block)
+{
+    bool found = std::memcmp(block->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return found;
+}
+
+bool IsValid(const TelemetryBlock* block)
+{
+    return HasHeader(block)
+        && block->version == TELEMETRY_VERSION
+        && block->size == sizeof(TelemetryBlock);
+}
+
+// a copy of a whole frame; false if the game kept writing (it publishes far less often than we retry)
+bool ReadFrame(const TelemetryBlock* block, TelemetryData& data_ret)
+{
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        uint32_t before = block->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::memcpy(&data_ret, &block->data, sizeof(TelemetryData));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block->sequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SameLayout(const TelemetryData& a, const TelemetryData& b)
+{
+    return a.numPhases == b.numPhases && a.numCounters == b.numCounters
+        && std::memcmp(a.phaseNames, b.phaseNames, sizeof(a.phaseNames)) == 0
+        && std::memcmp(a.counterNames, b.counterNames, sizeof(a.counterNames)) == 0;
+}
+
+// column names can't have commas or spaces; zone names like "draw scene" get underscores
+void WriteColumnName(FILE* out, const char* prefix, const char* name)
+{
+    std::fprintf(out, ",%s", prefix);
+    for (const char* c = name; *c && c < name + TELEMETRY_NAME_LENGTH; c++) {
+        std::fputc((*c == ',' || *c == ' ' || *c == '"') ? '_' : *c, out);
+    }
+}
+
+void WriteHeader(FILE* out, const TelemetryData& d)
+{
+    std::fprintf(out, "time_s,frame,frame_ms,draw_calls,buffer_uploads,buffer_kb,texture_uploads,program_binds,"
+                      "heap_allocs,heap_frees,heap_alloc_kb,heap_kb,peak_heap_kb,gpu_kb");
+    for (uint32_t p = 0; p < d.numPhases && p < (uint32_t)TELEMETRY_MAX_PHASES; p++) {
+        WriteColumnName(out, "ms_", d.phaseNames[p]);
+    }
+    for (uint32_t c = 0; c < d.numCounters && c < (uint32_t)TELEMETRY_MAX_COUNTERS; c++) {
+        WriteColumnName(out, "", d.counterNames[c]);
+    }
+    std::fputc('\n', out);
+}
+
+void WriteRow(FILE* out, double seconds, const TelemetryData& d)
+{
+    std::fprintf(out, "%.3f,%llu,%.3f,%u,%u,%.1f,%u,%u,%u,%u,%.1f,%.1f,%.1f,%.1f",
+                 seconds, (unsigned long long)d.frame, d.frameMs, d.drawCalls, d.bufferUploads, d.bufferBytes / 1024.0,
+                 d.textureUploads, d.programBinds, d.heapAllocs, d.heapFrees, d.heapAllocBytes / 1024.0,
+                 d.heapBytes / 1024.0, d.peakHeapBytes / 1024.0, d.gpuBytes / 1024.0);
+    for (uint32_t p = 0; p < d.numPhases && p < (uint32_t)TELEMETRY_MAX_PHASES; p++) {
+        std::fprintf(out, ",%.3f", d.phaseMs[p]);
+    }
+    for (uint32_t c = 0; c < d.numCounters && c < (uint32_t)TELEMETRY_MAX_COUNTERS; c++) {
+        std::fprintf(out, ",%lld", (long long)d.counters[c]);
+    }
+    std::fputc('\n', out);
+}
+
+void PrintUsage()
+{
+    std::fprintf(stderr, "usage: telemetryreader [name] [--hz <rate>] [--seconds <n>] [--out <file>] [--wait]\n");
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    const char* name = "/assteroids";
+    const char* outPath = NULL;
+    double hz = 10.0;
+    double duration = 0.0;
+    bool wait = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            hz = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            duration = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--wait") == 0) {
+            wait = true;
+        } else if (argv[i][0] != '-') {
+            name = argv[i];
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (hz <= 0.0) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::signal(SIGINT, OnInterrupt);
+
+    const TelemetryBlock* block = OpenBlock(name);
+    while (wait && !gInterrupted && (!block || !HasHeader(block))) {
+        if (block) {
+            CloseBlock(block);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        block = OpenBlock(name);
+    }
+    if (!block) {
+        std::fprintf(stderr, "*** Can't open the telemetry block %s (is the game running with --telemetry?)\n", name);
+        return 1;
+    }
+    if (!IsValid(block)) {
+        std::fprintf(stderr, "*** %s isn't a telemetry block of this version\n", name);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (outPath) {
+        out = std::fopen(outPath, "w");
+        if (!out) {
+            std::fprintf(stderr, "*** Can't open %s for writing\n", outPath);
+            return 1;
+        }
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+    const Clock::time_point start = Clock::now();
+    Clock::time_point next = start;
+
+    TelemetryData data;
+    TelemetryData layout;
+    bool haveLayout = false;
+    uint64_t lastFrame = 0;
+    unsigned rows = 0;
+    unsigned torn = 0;
+
+    while (!gInterrupted) {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (duration > 0.0 && seconds >= duration) {
+            break;
+        }
+
+        if (!ReadFrame(block, data)) {
+            torn++;
+        } else {
+            if (data.frame != lastFrame) {
+                if (!haveLayout || !SameLayout(data, layout)) {
+                    WriteHeader(out, data);
+                    std::memcpy(&layout, &data, sizeof(TelemetryData));
+                    haveLayout = true;
+                }
+                WriteRow(out, seconds, data);
+                lastFrame = data.frame;
+                rows++;
+            }
+            if (!data.running && data.frame) {
+                break;
+            }
+        }
+
+        // keep the rate even if a sample took a while; don't try to catch up on missed ones
+        next += period;
+        Clock::time_point now = Clock::now();
+        if (next < now) {
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+    }
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    std::fprintf(stderr, "%u rows from %s (pid %u)%s\n", rows, name, block->pid,
+                 torn ? ", some samples skipped while the game was writing" : "");
+    return 0;
+}
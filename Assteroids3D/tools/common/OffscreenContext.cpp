@@ -0,0 +1,38 @@
+#include "OffscreenContext.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdio>
+
+bool CreateOffscreenContext()
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!getPlatformDisplay) {
+        std::fprintf(stderr, "*** EGL_EXT_platform_base is not available\n");
+        return false;
+    }
+
+    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::fprintf(stderr, "*** Can't initialize the surfaceless EGL platform (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    // the game uses compatibility features (GL_LUMINANCE textures, VAO 0)
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::fprintf(stderr, "*** Can't create a GL 4.3 context (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    return true;
+}
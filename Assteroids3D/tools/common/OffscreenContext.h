@@ -0,0 +1,17 @@
+#ifndef OFFSCREEN_CONTEXT_H_
+#define OFFSCREEN_CONTEXT_H_
+
+//
+// Offscreen GL for the tools (Linux): a GL 4.3 compatibility context on EGL's surfaceless
+// platform (Mesa's llvmpipe is enough), made current on the calling thread. No X server or
+// window is used; there's no default framebuffer, so tools that draw bind one of their own.
+// Failures are reported on stderr.
+//
+
+// the context alone, for tools that load GL entry points themselves
+bool CreateOffscreenContext();
+
+// the context plus GLEW, for tools that run glsh or game code (OffscreenContextGLEW.cpp, needs -lGLEW)
+bool CreateOffscreenGLEWContext();
+
+#endif
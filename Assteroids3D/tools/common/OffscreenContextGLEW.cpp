@@ -0,0 +1,26 @@
+#include "OffscreenContext.h"
+
+#include <GL/glew.h>
+
+#include <cstdio>
+
+bool CreateOffscreenGLEWContext()
+{
+    if (!CreateOffscreenContext()) {
+        return false;
+    }
+
+    // GLEW looks for a GLX display after loading the entry points, which is fine to miss here
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY) {
+        err = GLEW_OK;
+    }
+#endif
+    if (err != GLEW_OK) {
+        std::fprintf(stderr, "*** Can't load the GL entry points (%s)\n", (const char*)glewGetErrorString(err));
+        return false;
+    }
+    return true;
+}